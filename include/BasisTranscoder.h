@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+
+#include "TextureTranscoding.h"
+
+namespace VulkanSample
+{
+
+// Formats ETC1S data is transcoded to, in order of preference
+enum class BasisTarget
+{
+    BC7,         // mode 5, color and alpha indices of their own
+    ASTC,        // 4x4 LDR, opaque images only
+    ETC2,        // ETC2 RGB8, with an EAC alpha block for images with alpha
+    RGBA8
+};
+
+VkFormat getBasisTargetFormat(BasisTarget target, bool alpha, bool srgb);
+char const *getBasisTargetName(BasisTarget target);
+
+// Canonical Huffman code of BasisLZ data
+struct BasisHuffmanTable
+{
+    std::vector<uint32_t> lookup;        // by the next LOOKUP_BITS bits: symbol << 8 | length, 0 for longer codes
+    std::vector<uint16_t> symbols;       // ordered by code
+    uint16_t              counts[17];    // codes of every length
+};
+
+// Transcoder for ETC1S images, the Basis Universal mode KTX2 stores with BasisLZ supercompression.
+// The file's global data holds endpoint and selector codebooks and the Huffman tables shared by
+// all images; every image is an RGB slice and an optional alpha slice of Huffman coded codebook
+// references. An ETC1S block has one color and intensity table for all texels, so its colors
+// lie on a line: the target's endpoints per color channel and intensity, and the indices per
+// selector codebook entry, are computed once, leaving per block lookups and bit packing. RGBA8
+// texels and EAC alpha indices are produced per block by the SSSE3 and NEON kernels of
+// TextureTranscoding. UASTC images are not supported.
+class BasisTranscoder
+{
+public:
+    BasisTranscoder();
+
+    // imageCount images are described by the global data, one per level for 2D textures
+    bool create(uint8_t const *globalData, size_t size, uint32_t imageCount);
+    void destroy();
+
+    // levelData is the level holding the image. destination receives it in the target's format:
+    // rows of 4x4 blocks, or rows of RGBA8 texels. With alpha the image's alpha slice is decoded,
+    // images without one are opaque.
+    bool transcode(BasisTarget target, TranscodeKernel kernel, uint32_t imageIndex, bool alpha, uint8_t const *levelData,
+                   size_t levelSize, uint32_t width, uint32_t height, uint8_t *destination) const;
+
+private:
+    struct Endpoint
+    {
+        uint8_t                   color5[3];
+        uint8_t                   intensity;       // ETC1 modifier table
+    };
+
+    struct Selector
+    {
+        uint8_t                   texels[16];      // 0 darkest to 3 brightest, raster order
+        uint32_t                  bc7Indices;      // 31-bit field of mode 5
+        bool                      bc7Swapped;      // bc7Indices need the endpoints swapped
+        uint32_t                  astcWeights;     // reversed as stored at the top of the block
+        uint32_t                  etc1Indices;     // most significant bits, then least, big-endian
+    };
+
+    struct ImageDesc
+    {
+        uint32_t                  imageFlags;
+        uint32_t                  rgbSliceByteOffset;
+        uint32_t                  rgbSliceByteLength;
+        uint32_t                  alphaSliceByteOffset;
+        uint32_t                  alphaSliceByteLength;
+    };
+
+    struct BlockReference
+    {
+        uint16_t                  endpoint;
+        uint16_t                  selector;
+    };
+
+    bool decodeEndpoints(uint8_t const *data, size_t size, uint32_t count);
+    bool decodeSelectors(uint8_t const *data, size_t size, uint32_t count);
+    bool decodeTables(uint8_t const *data, size_t size);
+    bool decodeSlice(uint8_t const *data, size_t size, uint32_t blocksX, uint32_t blocksY,
+                     std::vector<BlockReference> &blocks) const;
+
+    std::vector<Endpoint>                    mEndpoints;
+    std::vector<uint8_t>                     mPalettes;          // four RGBA8 colors per endpoint
+    std::vector<Selector>                    mSelectors;
+    std::vector<ImageDesc>                   mImages;
+    BasisHuffmanTable                        mEndpointPredictionTable;
+    BasisHuffmanTable                        mEndpointDeltaTable;
+    BasisHuffmanTable                        mSelectorTable;
+    BasisHuffmanTable                        mSelectorHistoryRunTable;
+    uint32_t                                 mSelectorHistorySize;
+};
+
+} // namespace VulkanSample
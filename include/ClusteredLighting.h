@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Common.h"
+#include "MathTypes.h"
+
+namespace VulkanSample
+{
+
+// Point light as the shaders read it (std430, 32 bytes)
+struct ClusteredLight
+{
+    float    position[3];       // world space
+    float    radius;            // the light has no effect beyond it
+    float    color[3];
+    float    intensity;
+};
+
+struct ClusteredLightingParameters
+{
+    uint32_t tileSize;                  // pixels covered by a cluster along x and y
+    uint32_t depthSlices;               // distributed exponentially between the near and far plane
+    uint32_t maxLights;
+    uint32_t averageLightsPerCluster;   // sizes the shared light index list
+};
+
+// Camera the clusters are built for. View space is right-handed with y up and the camera looking
+// down -z; pixel rows go down the screen, as with a Vulkan projection that flips y.
+struct ClusteredLightingView
+{
+    Float4x4   view;                    // world to view
+    float      tanHalfFovX;
+    float      tanHalfFovY;
+    float      nearPlane;
+    float      farPlane;
+    VkExtent2D extent;                  // of the render target shaded with the clusters
+};
+
+struct ClusterGrid
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t z;
+};
+
+struct ClusteredLightingStats
+{
+    uint32_t    lightCount;
+    ClusterGrid grid;
+    uint32_t    clusterCount;
+    uint32_t    indexCapacity;
+};
+
+// Clustered light culling for scenes with thousands of dynamic lights. The view frustum is split
+// into a 3D grid of froxels: screen tiles of tileSize pixels times depthSlices exponential depth
+// slices. A compute pass assigns the lights to clusters, one workgroup per cluster testing every
+// light sphere against the view space bounds of the cluster; the hits are gathered in shared
+// memory and the workgroup then reserves a compact range of a global light index list with a
+// single atomic. Fragment shading (meshlet_clustered.frag) finds its cluster from gl_FragCoord and
+// view depth and only loops over the lights in that range.
+//
+// Every frame in flight has its own light, cluster and index buffers; the GPU must have finished
+// the frame that used a frameIndex before setLights and recordCulling reuse it. Culling is meant
+// for the compute queue: the buffers are shared concurrently between the families passed to
+// create(), and the caller orders recordCulling before the fragment reads (render graph pass or
+// semaphore). A cluster keeps at most MAX_LIGHTS_PER_CLUSTER lights, a frame at most
+// indexCapacity light references; further hits are dropped. Requires bufferDeviceAddress and
+// synchronization2.
+class ClusteredLighting
+{
+public:
+    static const uint32_t MAX_LIGHTS_PER_CLUSTER = 512;     // shared memory list in cluster_lights.comp
+
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    static bool isSupported(DeviceCapabilities const &capabilities);
+    static ClusteredLightingParameters getDefaultParameters();
+    static ClusterGrid getClusterGrid(ClusteredLightingParameters const &parameters, VkExtent2D extent);
+
+    // Buffers are sized for render targets up to maxExtent
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, std::vector<uint32_t> const &queueFamilies,
+                uint32_t framesInFlight, VkExtent2D maxExtent, ClusteredLightingParameters const &parameters,
+                VkPipelineCache pipelineCache);
+    void destroy();
+
+    // Uploads the lights of the frame, at most maxLights
+    bool setLights(uint32_t frameIndex, std::vector<ClusteredLight> const &lights);
+    // Builds the clusters of the frame for the view, the extent must not exceed maxExtent
+    void recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex, ClusteredLightingView const &view);
+
+    // Device address of the frame's shading data block, for MeshletGeometry::recordLightingData
+    VkDeviceAddress getShadingData(uint32_t frameIndex) const;
+    // Per cluster (offset, count) pairs into the light index list, x fastest then y then z
+    VkBuffer getClusterRangeBuffer(uint32_t frameIndex) const;
+    // A uint32_t counter of reserved entries followed by the light index list
+    VkBuffer getLightIndexBuffer(uint32_t frameIndex) const;
+
+    ClusteredLightingStats getStats() const;
+
+private:
+    struct FrameResources
+    {
+        VkBuffer        lightBuffer;
+        VkDeviceMemory  lightMemory;
+        VkDeviceAddress lightAddress;
+        void           *lightData;
+        VkBuffer        shadingBuffer;
+        VkDeviceMemory  shadingMemory;
+        VkDeviceAddress shadingAddress;
+        void           *shadingData;
+        VkBuffer        clusterRangeBuffer;
+        VkDeviceMemory  clusterRangeMemory;
+        VkDeviceAddress clusterRangeAddress;
+        VkBuffer        lightIndexBuffer;
+        VkDeviceMemory  lightIndexMemory;
+        VkDeviceAddress lightIndexAddress;
+        uint32_t        lightCount;
+    };
+
+    VkDevice                    mLogicalDevice;
+    ClusteredLightingParameters mParameters;
+    VkExtent2D                  mMaxExtent;
+    uint32_t                    mMaxClusterCount;
+    uint32_t                    mIndexCapacity;
+    VkPipelineLayout            mPipelineLayout;
+    VkPipeline                  mPipeline;
+    std::vector<FrameResources> mFrames;
+    ClusteredLightingStats      mStats;
+};
+
+// CPU reference of the light assignment: the lights of every cluster in ascending order, without
+// the per-cluster and index capacity limits. radiusScale grows or shrinks all lights, so callers
+// can bracket the GPU result against floating point differences at cluster borders.
+void referenceAssignLights(ClusteredLightingParameters const &parameters, ClusteredLightingView const &view,
+                           std::vector<ClusteredLight> const &lights, float radiusScale,
+                           std::vector<std::vector<uint32_t>> &clusterLights);
+
+} // namespace VulkanSample
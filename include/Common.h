@@ -5,6 +5,8 @@
 
 #ifdef _WIN32
 #include <Windows.h>
+#elif defined __linux
+#include <dlfcn.h>
 #endif
 
 #include "VulkanFunctions.h"
@@ -15,7 +17,7 @@ namespace VulkanSample
 
 #ifdef _WIN32
 #define LIBRARY_TYPE HMODULE
-#elif defined _linux
+#elif defined __linux
 #define LIBRARY_TYPE void*
 #endif
 
@@ -42,6 +44,62 @@ struct QueueParameters
   uint32_t  familyIndex;
 };
 
+// Surface independent properties of a physical device, gathered before the window exists
+struct PhysicalDeviceProbe
+{
+  VkPhysicalDevice                    physicalDevice;
+  VkPhysicalDeviceProperties          properties;
+  std::vector<VkExtensionProperties>  availableExtensions;
+  uint32_t                            graphicsQueueFamilyIndex;
+  uint32_t                            computeQueueFamilyIndex;
+  VkPhysicalDeviceSubgroupProperties  subgroupProperties;            // zeroed before Vulkan 1.1
+  bool                                suitable;                      // required queues and extensions are present
+  bool                                vulkan13Device;
+  bool                                timelineSemaphoreSupported;
+  bool                                synchronization2Supported;
+  bool                                bufferDeviceAddressSupported;
+  bool                                meshShaderSupported;
+  bool                                externalMemoryHostSupported;
+  bool                                pushDescriptorSupported;
+  bool                                dynamicRenderingSupported;
+  bool                                graphicsPipelineLibrarySupported;
+  bool                                storageImageWriteWithoutFormatSupported;
+  bool                                pipelineStatisticsQuerySupported;
+  bool                                occlusionQueryPreciseSupported;
+  bool                                multiDrawIndirectSupported;
+  bool                                drawIndirectFirstInstanceSupported;
+  bool                                sparseResidencyImage2DSupported;   // with a graphics queue that binds sparse memory
+  bool                                fragmentStoresAndAtomicsSupported;
+};
+
+// Physical device chosen by createLogicalDevice together with the optional features it enabled
+struct DeviceCapabilities
+{
+  VkPhysicalDevice                   physicalDevice;
+  VkPhysicalDeviceProperties         properties;
+  VkPhysicalDeviceMemoryProperties   memoryProperties;
+  bool                               meshShaderSupported;
+  uint32_t                           maxTaskWorkGroupCount[3];           // zeroed without mesh shaders
+  uint32_t                           maxTaskWorkGroupTotalCount;
+  bool                               externalMemoryHostSupported;
+  bool                               timelineSynchronizationSupported;   // timelineSemaphore + synchronization2
+  bool                               bufferDeviceAddressSupported;
+  bool                               pushDescriptorSupported;
+  uint32_t                           maxPushDescriptors;                 // 0 without VK_KHR_push_descriptor
+  bool                               dynamicRenderingSupported;
+  bool                               graphicsPipelineLibrarySupported;
+  bool                               graphicsPipelineLibraryFastLinking;
+  bool                               storageImageWriteWithoutFormatSupported;
+  bool                               pipelineStatisticsQuerySupported;
+  bool                               occlusionQueryPreciseSupported;
+  bool                               multiDrawIndirectSupported;
+  bool                               drawIndirectFirstInstanceSupported;
+  bool                               sparseResidencyImage2DSupported;    // sparseBinding + sparseResidencyImage2D on the graphics queue
+  bool                               fragmentStoresAndAtomicsSupported;
+  VkDeviceSize                       minImportedHostPointerAlignment;
+  VkPhysicalDeviceSubgroupProperties subgroupProperties;
+};
+
 bool loadVkLibrary(LIBRARY_TYPE &vkLibrary);
 bool loadFunctionFromVulkanLibrary(LIBRARY_TYPE const &vkLibrary);
 bool loadGlobalLevelFunctions();
@@ -54,10 +112,21 @@ bool enumerateAvailablePhysicalDevices(VkInstance &instance, std::vector<VkPhysi
 bool checkAvailableDeviceExtensions(VkPhysicalDevice physicalDevice, std::vector<VkExtensionProperties> &availableExtensions);
 bool selectQueueFamilyIndex(VkPhysicalDevice physicalDevice, VkQueueFlags desiredCapabilities, uint32_t &queueFamilyIndex);
 bool selectQueueFamilyIndex(VkPhysicalDevice physicalDevice, VkSurfaceKHR presentationSurface, uint32_t &queueFamilyIndex);
-bool loadDeviceLevelFunctions(VkDevice logicalDevice, std::vector<const char *> const &enabledExtensions);
-bool createLogicalDevice(VkInstance instance, VkDevice &logicalDevice, std::vector<const char*> &desiredExtensions, VkSurfaceKHR surface,
-                         QueueParameters &graphicsQueue, QueueParameters &computeQueue, QueueParameters &presentQueue);
-bool createPresentationSurface(VkInstance instance, WindowParameters windowParameters, VkSurfaceKHR presentationSurface);
+bool loadDeviceLevelFunctions(VkDevice logicalDevice, uint32_t apiVersion, std::vector<const char *> const &enabledExtensions);
+// Device-level functions are global. By default they are resolved with vkGetDeviceProcAddr for the
+// most recently created device; with several devices alive at once they must be loader trampolines
+// instead, which dispatch on the handle they are called with. Enable before creating the devices.
+void setMultiDeviceDispatch(bool enabled);
+// Only queries the device, so several devices may be probed concurrently
+bool probePhysicalDevice(VkPhysicalDevice physicalDevice, std::vector<const char*> const &desiredExtensions,
+                         PhysicalDeviceProbe &probe);
+// Creates the device on the first suitable probed physical device that can present to the surface,
+// surface may be VK_NULL_HANDLE for headless use
+bool createLogicalDevice(std::vector<PhysicalDeviceProbe> const &physicalDevices, VkDevice &logicalDevice,
+                         std::vector<const char*> const &desiredExtensions, VkSurfaceKHR surface,
+                         QueueParameters &graphicsQueue, QueueParameters &computeQueue, QueueParameters &presentQueue,
+                         DeviceCapabilities &capabilities);
+bool createPresentationSurface(VkInstance instance, WindowParameters windowParameters, VkSurfaceKHR &presentationSurface);
 bool selectPresentationMode(VkPhysicalDevice physicalDevice, VkSurfaceKHR presentationSurface, VkPresentModeKHR desiredMode, 
                             VkPresentModeKHR &presentMode);
 bool selectSwapchainImageFormat(VkPhysicalDevice physicalDevice, VkSurfaceKHR presentationSurface,
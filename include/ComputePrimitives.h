@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+enum class RadixSortKeyType : uint32_t
+{
+    Uint32 = 1,
+    Uint64 = 2               // stored as little endian pairs of 32-bit words
+};
+
+// Data-parallel building blocks on 32-bit unsigned values: reduction, exclusive prefix sum,
+// stream compaction and LSD radix sort with 8-bit digits. Workgroups of 256 invocations handle
+// blocks of 1024 elements; inside a workgroup subgroup arithmetic does the work and only one
+// value per subgroup goes through shared memory. Across blocks the scan is reduce-then-scan, which
+// needs no forward progress guarantees between workgroups (lavapipe and many mobile GPUs give none).
+//
+// Buffers are passed by device address. The record functions insert the barriers between their
+// own passes and a compute-to-compute barrier up front, because they share scratch memory; the
+// caller synchronizes inputs and outputs with the surrounding work. Requires bufferDeviceAddress,
+// synchronization2 and subgroup basic + arithmetic operations in compute shaders.
+class ComputePrimitives
+{
+public:
+    ComputePrimitives();
+    ~ComputePrimitives();
+
+    static bool isSupported(DeviceCapabilities const &capabilities);
+
+    // Scratch memory is sized for maxElementCount elements (and keys of up to 64 bits)
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t maxElementCount,
+                VkPipelineCache pipelineCache);
+    void destroy();
+
+    // result[0] = sum of count values
+    void recordReduce(VkCommandBuffer commandBuffer, VkDeviceAddress values, uint32_t count, VkDeviceAddress result);
+    // destination may equal source
+    void recordExclusiveScan(VkCommandBuffer commandBuffer, VkDeviceAddress source, VkDeviceAddress destination,
+                             uint32_t count);
+    // Keeps values[i] where flags[i] != 0 in order, keptCount[0] receives their number
+    void recordCompact(VkCommandBuffer commandBuffer, VkDeviceAddress values, VkDeviceAddress flags, uint32_t count,
+                       VkDeviceAddress destination, VkDeviceAddress keptCount);
+    // Stable in-place sort, payloads (one 32-bit word per key) may be 0
+    void recordRadixSort(VkCommandBuffer commandBuffer, RadixSortKeyType keyType, VkDeviceAddress keys,
+                         VkDeviceAddress payloads, uint32_t count);
+
+private:
+    enum Pipeline
+    {
+        PIPELINE_SCAN_REDUCE,
+        PIPELINE_SCAN_DOWNSWEEP,
+        PIPELINE_RADIX_COUNT,
+        PIPELINE_RADIX_SCATTER,
+        PIPELINE_COUNT
+    };
+
+    void recordScan(VkCommandBuffer commandBuffer, VkDeviceAddress source, VkDeviceAddress destination,
+                    VkDeviceAddress payloads, VkDeviceAddress total, uint32_t count, uint32_t flags, uint32_t level);
+    void recordDispatch(VkCommandBuffer commandBuffer, Pipeline pipeline, void const *constants, uint32_t size,
+                        uint32_t groupCount);
+    void recordBarrier(VkCommandBuffer commandBuffer);
+
+    VkDevice                     mLogicalDevice;
+    uint32_t                     mMaxElementCount;
+    VkPipelineLayout             mPipelineLayout;
+    VkPipeline                   mPipelines[PIPELINE_COUNT];
+
+    VkBuffer                     mScratchBuffer;
+    VkDeviceMemory               mScratchMemory;
+    std::vector<VkDeviceAddress> mScanLevels;          // block sums of every recursion level
+    VkDeviceAddress              mRadixHistogram;
+    VkDeviceAddress              mRadixKeys;
+    VkDeviceAddress              mRadixPayloads;
+};
+
+// CPU references with the same semantics, used to validate the GPU results
+uint32_t referenceReduce(std::vector<uint32_t> const &values);
+void referenceExclusiveScan(std::vector<uint32_t> const &values, std::vector<uint32_t> &prefixSums);
+void referenceCompact(std::vector<uint32_t> const &values, std::vector<uint32_t> const &flags, std::vector<uint32_t> &kept);
+// keys holds one word per key for Uint32 and two for Uint64, payloads may be empty
+void referenceRadixSort(RadixSortKeyType keyType, std::vector<uint32_t> &keys, std::vector<uint32_t> &payloads);
+
+} // namespace VulkanSample
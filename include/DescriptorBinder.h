@@ -0,0 +1,125 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+struct DescriptorBinding
+{
+    uint32_t              binding;
+    VkDescriptorType      type;
+    uint32_t              descriptorCount;
+    VkShaderStageFlags    stages;
+};
+
+// One entry of the data handed to bind(): descriptors follow each other in the order of the
+// layout's bindings, arrays take descriptorCount consecutive entries
+union DescriptorInfo
+{
+    VkDescriptorBufferInfo buffer;       // *_BUFFER and *_BUFFER_DYNAMIC
+    VkDescriptorImageInfo  image;        // samplers, images and input attachments
+    VkBufferView           texelBuffer;  // *_TEXEL_BUFFER
+
+    static DescriptorInfo fromBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+    static DescriptorInfo fromImage(VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout);
+    static DescriptorInfo fromTexelBuffer(VkBufferView texelBuffer);
+};
+
+struct DescriptorBinderStats
+{
+    uint64_t              descriptorWrites;        // written into cached sets with update templates
+    uint64_t              avoidedDescriptorWrites; // not written again because a cached set was reused
+    uint64_t              pushedDescriptors;       // recorded with push descriptor templates
+    uint32_t              cacheHits;
+    uint32_t              cacheMisses;
+    uint32_t              cachedSets;              // sets holding cache entries, invalidated ones until recycled
+    uint32_t              allocatedSets;
+};
+
+// Per-draw descriptor binding. Every layout is compiled into a VkDescriptorUpdateTemplate, so a set
+// is written with one call from a packed DescriptorInfo array instead of VkWriteDescriptorSet
+// structures. Layouts created for frequently changing bindings use VK_KHR_push_descriptor and are
+// written straight into the command buffer; without the extension (or above maxPushDescriptors)
+// they fall back to the cache. Other layouts keep their sets in a cache keyed by a hash of the
+// descriptor contents: identical bindings, e.g. a FrameRingAllocator buffer with dynamic offsets,
+// reuse the set written in an earlier frame. Sets unused for framesInFlight frames are recycled.
+// Not thread-safe, use one binder per recording thread.
+class DescriptorBinder
+{
+public:
+    DescriptorBinder();
+    ~DescriptorBinder();
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight);
+    void destroy();
+
+    bool createLayout(std::vector<DescriptorBinding> const &bindings, bool pushDescriptors, uint32_t &layoutIndex);
+    VkDescriptorSetLayout getSetLayout(uint32_t layoutIndex) const;
+    bool usesPushDescriptors(uint32_t layoutIndex) const;
+
+    // Call once per frame, the GPU must have finished the frame recorded framesInFlight frames ago
+    void beginFrame();
+    // Resources referenced by cached sets are about to be destroyed, stop handing those sets out
+    void invalidate();
+
+    // descriptors holds one DescriptorInfo per descriptor of the layout
+    bool bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set,
+              uint32_t layoutIndex, DescriptorInfo const *descriptors, uint32_t dynamicOffsetCount = 0,
+              uint32_t const *dynamicOffsets = nullptr);
+    // Returns a cached set, written only when no set with the same contents exists
+    bool getDescriptorSet(uint32_t layoutIndex, DescriptorInfo const *descriptors, VkDescriptorSet &descriptorSet);
+
+    DescriptorBinderStats const &getStats() const;
+
+private:
+    struct PushTemplate
+    {
+        VkPipelineBindPoint        bindPoint;
+        VkPipelineLayout           pipelineLayout;
+        uint32_t                   set;
+        VkDescriptorUpdateTemplate updateTemplate;
+    };
+
+    struct CachedSet
+    {
+        VkDescriptorSet             descriptorSet;
+        uint64_t                    hash;
+        uint64_t                    lastUsedFrame;
+        bool                        cached;          // holds a cache entry, otherwise on the free list
+        bool                        stale;           // invalidated, out of the lookup until it is recycled
+        std::vector<DescriptorInfo> descriptors;
+    };
+
+    struct Layout
+    {
+        std::vector<DescriptorBinding>           bindings;
+        std::vector<VkDescriptorType>            descriptorTypes;   // per DescriptorInfo entry
+        VkDescriptorSetLayout                    setLayout;
+        bool                                     pushDescriptors;
+        VkDescriptorUpdateTemplate               updateTemplate;    // for cached sets
+        std::vector<PushTemplate>                pushTemplates;
+        std::vector<VkDescriptorPool>            pools;
+        uint32_t                                 poolSetsLeft;
+        std::vector<CachedSet>                   sets;
+        std::unordered_multimap<uint64_t, uint32_t> lookup;
+        std::vector<uint32_t>                    freeSets;
+    };
+
+    bool getPushTemplate(Layout &layout, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set,
+                         VkDescriptorUpdateTemplate &updateTemplate);
+    bool allocateSet(Layout &layout, uint32_t &setIndex);
+    void uncacheSet(Layout &layout, uint32_t setIndex);
+
+    VkDevice                   mLogicalDevice;
+    bool                       mPushDescriptorSupported;
+    uint32_t                   mMaxPushDescriptors;
+    uint32_t                   mFramesInFlight;
+    uint64_t                   mFrame;
+    std::vector<Layout>        mLayouts;
+    DescriptorBinderStats      mStats;
+};
+
+} // namespace VulkanSample
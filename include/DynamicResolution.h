@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Common.h"
+#include "DescriptorBinder.h"
+
+namespace VulkanSample
+{
+
+struct DynamicResolutionParameters
+{
+    float                 targetFrameMs    = 14.0f;   // GPU budget per frame, keep headroom below the refresh interval
+    float                 minScale         = 0.5f;    // of the output extent, per axis
+    float                 maxScale         = 1.0f;
+    float                 proportionalGain = 0.3f;
+    float                 integralGain     = 0.05f;
+    float                 derivativeGain   = 0.1f;
+    float                 sharpness        = 0.15f;   // unsharp mask strength of the upscaler, 0 disables it
+};
+
+struct DynamicResolutionStats
+{
+    DynamicResolutionParameters parameters;
+    float                 scale;
+    VkExtent2D            renderExtent;
+    VkExtent2D            outputExtent;
+    bool                  timestampsSupported;   // without them the scale stays at maxScale
+    uint32_t              sampleCount;           // GPU frame times in the percentile window
+    float                 lastFrameMs;
+    float                 frameMsP50;
+    float                 frameMsP95;
+    float                 frameMsP99;
+    float                 error;                 // (frame time - target) / target of the last sample
+    float                 integral;
+    float                 derivative;
+};
+
+// Holds the GPU frame time at a target by rendering the scene at a variable resolution. The scene
+// goes into an offscreen target allocated for maxScale, only the top left getRenderExtent() part
+// of it is used; viewport and scissor must match that extent. A PID controller fed by timestamp
+// queries around the frame picks the scale, and a compute pass upscales the rendered part to the
+// output extent, normally the one createSwapchain() chose. Output images need STORAGE usage and
+// outputFormat, the format of the output views, needs storage support: sRGB swapchain formats such
+// as B8G8R8A8_SRGB have none, their images need a UNORM view (MUTABLE_FORMAT swapchain) or an
+// intermediate UNORM image. queueFamilyIndex is the family recording the frames.
+//
+// Per frame:
+//   beginFrame()     reads the timing of the frame that used the slot before, updates the scale,
+//                    starts timing and moves the target to COLOR_ATTACHMENT_OPTIMAL
+//   render the scene into getRenderTargetView() with the render extent
+//   recordUpscale()  writes the output and stops timing
+class DynamicResolution
+{
+public:
+    DynamicResolution();
+    ~DynamicResolution();
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t queueFamilyIndex,
+                uint32_t framesInFlight, VkExtent2D outputExtent, VkFormat renderFormat, VkFormat outputFormat,
+                DynamicResolutionParameters const &parameters, VkPipelineCache pipelineCache);
+    void destroy();
+
+    // After the swapchain was recreated, the device must be idle
+    bool resize(VkExtent2D outputExtent);
+    void setParameters(DynamicResolutionParameters const &parameters);
+
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    VkExtent2D getRenderExtent() const;
+    VkImage getRenderTarget() const;
+    VkImageView getRenderTargetView() const;
+
+    // outputImage is taken from any layout (its contents are overwritten) and left in finalLayout.
+    // A swapchain image's acquire semaphore must be waited for at the compute shader stage.
+    bool recordUpscale(VkCommandBuffer commandBuffer, VkImage outputImage, VkImageView outputView, VkImageLayout finalLayout);
+
+    DynamicResolutionStats getStats() const;
+
+private:
+    static const uint32_t FRAME_TIME_WINDOW = 256;
+
+    bool createRenderTarget();
+    void destroyRenderTarget();
+    bool createUpscalePipeline(VkPipelineCache pipelineCache);
+    void updateController(float frameMs);
+    void updateRenderExtent();
+
+    VkDevice                     mLogicalDevice;
+    DeviceCapabilities           mCapabilities;
+    uint32_t                     mFramesInFlight;
+    DynamicResolutionParameters  mParameters;
+    VkFormat                     mRenderFormat;
+    VkExtent2D                   mOutputExtent;
+    VkExtent2D                   mTargetExtent;     // allocated, outputExtent * maxScale
+    VkExtent2D                   mRenderExtent;
+
+    VkImage                      mRenderTarget;
+    VkDeviceMemory               mRenderTargetMemory;
+    VkImageView                  mRenderTargetView;
+
+    bool                         mTimestampsSupported;
+    uint64_t                     mTimestampMask;    // timestampValidBits of the queue family
+    VkQueryPool                  mQueryPool;        // begin and end timestamp per frame in flight
+    std::vector<bool>            mQueriesWritten;
+    uint32_t                     mFrameSlot;
+
+    float                        mScale;
+    float                        mIntegral;
+    float                        mLastError;
+    float                        mDerivative;
+    std::vector<float>           mFrameTimes;       // ring of the last FRAME_TIME_WINDOW GPU frame times
+    uint32_t                     mFrameTimeHead;
+
+    DescriptorBinder             mDescriptorBinder;
+    uint32_t                     mUpscaleLayoutIndex;
+    VkPipelineLayout             mUpscalePipelineLayout;
+    VkPipeline                   mUpscalePipeline;
+    VkSampler                    mSampler;
+};
+
+} // namespace VulkanSample
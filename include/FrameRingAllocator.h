@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstring>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+struct RingAllocation
+{
+    void                 *data;              // persistently mapped, write sequentially and never read back
+    VkBuffer              buffer;
+    uint32_t              dynamicOffset;     // for *_BUFFER_DYNAMIC descriptors bound to buffer at offset 0
+    VkDeviceAddress       deviceAddress;     // 0 when bufferDeviceAddress is not supported
+};
+
+struct FrameRingAllocatorStats
+{
+    VkDeviceSize          capacity;          // per frame
+    VkDeviceSize          used;              // by the current frame, including alignment padding
+    VkDeviceSize          highWaterMark;
+    uint32_t              allocations;       // by the current frame
+    uint32_t              failedAllocations; // since create()
+    bool                  deviceLocal;       // DEVICE_LOCAL | HOST_VISIBLE memory (resizable BAR) is used
+};
+
+// Linear allocator for per-draw constants. Every frame in flight owns one buffer in a single
+// persistently mapped, host coherent allocation, preferring DEVICE_LOCAL | HOST_VISIBLE memory so
+// shaders read the data from VRAM. Allocations are aligned to minUniformBufferOffsetAlignment
+// (and minStorageBufferOffsetAlignment for storage usage) and cost one pointer bump; everything is
+// released at once when the frame's buffer is reused. Not thread-safe, use one allocator per
+// recording thread.
+class FrameRingAllocator
+{
+public:
+    FrameRingAllocator();
+    ~FrameRingAllocator();
+
+    // usage is combined with SHADER_DEVICE_ADDRESS when the device supports buffer device addresses
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, VkDeviceSize sizePerFrame,
+                uint32_t framesInFlight, VkBufferUsageFlags usage);
+    void destroy();
+
+    // The GPU must have finished the frame that used this slot before
+    void beginFrame(uint32_t frameIndex);
+
+    bool allocate(VkDeviceSize size, RingAllocation &allocation);
+    template<typename Type>
+    bool push(Type const &value, RingAllocation &allocation);
+
+    // Buffers are created once, descriptors referencing them can be written up front
+    VkBuffer getBuffer(uint32_t frameIndex) const;
+    VkDeviceSize getAlignment() const;
+    FrameRingAllocatorStats getStats() const;
+
+private:
+    struct Frame
+    {
+        VkBuffer          buffer;
+        unsigned char    *data;
+        VkDeviceAddress   deviceAddress;
+    };
+
+    VkDevice                mLogicalDevice;
+    VkDeviceMemory          mMemory;
+    std::vector<Frame>      mFrames;
+    VkDeviceSize            mAlignment;
+    VkDeviceSize            mCapacity;
+
+    Frame                  *mCurrent;
+    VkDeviceSize            mHead;
+    FrameRingAllocatorStats mStats;
+};
+
+inline bool FrameRingAllocator::allocate(VkDeviceSize size, RingAllocation &allocation)
+{
+    VkDeviceSize offset = (mHead + mAlignment - 1) & ~(mAlignment - 1);
+    if(mCurrent == nullptr || offset + size > mCapacity)
+    {
+        ++mStats.failedAllocations;
+        return false;
+    }
+    mHead = offset + size;
+
+    allocation.data          = mCurrent->data + offset;
+    allocation.buffer        = mCurrent->buffer;
+    allocation.dynamicOffset = static_cast<uint32_t>(offset);
+    allocation.deviceAddress = mCurrent->deviceAddress != 0 ? mCurrent->deviceAddress + offset : 0;
+    ++mStats.allocations;
+    return true;
+}
+
+template<typename Type>
+bool FrameRingAllocator::push(Type const &value, RingAllocation &allocation)
+{
+    if(!allocate(sizeof(Type), allocation))
+        return false;
+    std::memcpy(allocation.data, &value, sizeof(Type));
+    return true;
+}
+
+} // namespace VulkanSample
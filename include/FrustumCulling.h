@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MathTypes.h"
+
+namespace VulkanSample
+{
+
+// Bounding spheres stored as separate arrays so kernels can load 4/8 spheres per instruction
+struct SphereArrays
+{
+    float const *centerX;
+    float const *centerY;
+    float const *centerZ;
+    float const *radius;
+};
+
+enum class CullingKernel
+{
+    Scalar,
+    SSE,
+    AVX2,
+    NEON
+};
+
+// Tests spheres [begin, end) against the frustum and writes indices of the intersecting
+// ones to outIndices, which must have room for (end - begin) entries. Returns the count written.
+typedef uint32_t (*CullSpheresFunction)(Frustum const &frustum, SphereArrays const &spheres,
+                                        uint32_t begin, uint32_t end, uint32_t *outIndices);
+
+uint32_t cullSpheresScalar(Frustum const &frustum, SphereArrays const &spheres, uint32_t begin, uint32_t end, uint32_t *outIndices);
+
+// Picks the widest kernel supported by the compiler and the running CPU
+CullingKernel selectCullingKernel();
+CullSpheresFunction getCullSpheresFunction(CullingKernel kernel);
+char const *getCullingKernelName(CullingKernel kernel);
+
+} // namespace VulkanSample
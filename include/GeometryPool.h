@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Common.h"
+#include "MathTypes.h"
+
+namespace VulkanSample
+{
+
+// Where the float attributes of one vertex live, in bytes. Stride and offsets must be multiples
+// of 4; a mesh without normals or texture coordinates marks them ABSENT.
+struct VertexLayout
+{
+    static const uint32_t ABSENT = 0xFFFFFFFF;
+
+    uint32_t stride;
+    uint32_t positionOffset;    // float[3]
+    uint32_t normalOffset;      // float[3], (0, 0, 1) when absent
+    uint32_t texCoordOffset;    // float[2], (0, 0) when absent
+};
+
+struct GeometryPoolParameters
+{
+    VkDeviceSize vertexBytes;           // shared by the vertices of all meshes
+    uint32_t     maxIndices;
+    uint32_t     maxMeshes;
+    uint32_t     maxDrawsPerFrame;
+};
+
+struct GeometryPoolStats
+{
+    uint32_t     meshes;
+    VkDeviceSize vertexBytes;           // used, including alignment
+    uint32_t     indices;
+    uint32_t     draws;                 // recorded by the latest recordDraws
+    uint32_t     indirectCalls;         // 1 with multiDrawIndirect, draws otherwise
+};
+
+// Mesh storage for vertex pulling. All vertices live in one device address buffer and all indices
+// in one index buffer, whatever the vertex layout of a mesh; geometry_pull.vert reads vertices
+// through 64-bit buffer device addresses instead of fixed-function vertex input. A mesh table
+// describes the layout of each mesh, a per-frame instance table holds the transform of each draw,
+// and all draws of a frame merge into a single vkCmdDrawIndexedIndirect whose firstInstance picks
+// the instance record, so meshes of different layouts need neither rebinding nor other pipelines.
+//
+// Meshes are appended with addMesh and reach the GPU with the next recordUpload; the arenas are
+// never compacted. Per frame: beginFrame(), addDraw() for every visible mesh instance, then
+// recordDraws() inside the render pass with a pipeline built from createShaderStages and an empty
+// vertex input state. The GPU must have finished the frame that used a frameIndex before it is
+// reused. Requires bufferDeviceAddress, drawIndirectFirstInstance and synchronization2.
+class GeometryPool
+{
+public:
+    GeometryPool();
+    ~GeometryPool();
+
+    static bool isSupported(DeviceCapabilities const &capabilities);
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight,
+                GeometryPoolParameters const &parameters);
+    void destroy();
+
+    // vertexData holds vertexCount vertices of the layout, indices are relative to the first one.
+    // Returns false when the layout is invalid or the pool is full.
+    bool addMesh(VertexLayout const &layout, void const *vertexData, uint32_t vertexCount,
+                 std::vector<uint32_t> const &indices, uint32_t &meshIndex);
+    // Copies the meshes added since the previous upload, outside of a render pass. The staging
+    // buffers are kept until releaseTransferResources, once that command buffer has finished.
+    bool recordUpload(VkCommandBuffer commandBuffer);
+    void releaseTransferResources();
+
+    VkPipelineLayout getPipelineLayout() const;
+    // Vertex + fragment stages of the pulling pipeline. The modules are owned by the pool, created by
+    // the first call and shared by every later one.
+    bool createShaderStages(std::vector<VkPipelineShaderStageCreateInfo> &shaderStages);
+
+    void beginFrame(uint32_t frameIndex);
+    // Returns false beyond maxDrawsPerFrame
+    bool addDraw(uint32_t meshIndex, Float4x4 const &model);
+    // Draws everything added since beginFrame
+    void recordDraws(VkCommandBuffer commandBuffer, Float4x4 const &viewProjection);
+
+    GeometryPoolStats getStats() const;
+
+private:
+    // Mesh table entry as geometry_pull.vert reads it (std430), offsets in 32-bit words
+    struct GpuMesh
+    {
+        VkDeviceAddress vertices;
+        uint32_t        strideWords;
+        uint32_t        positionWord;
+        uint32_t        normalWord;
+        uint32_t        texCoordWord;
+    };
+
+    // Instance table entry (std430)
+    struct GpuInstance
+    {
+        Float4x4 model;
+        uint32_t mesh;
+        uint32_t padding[3];
+    };
+
+    struct MeshRange
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    struct PendingCopy
+    {
+        VkBuffer     dstBuffer;
+        VkDeviceSize srcOffset;
+        VkDeviceSize dstOffset;
+        VkDeviceSize size;
+    };
+
+    struct FrameResources
+    {
+        VkBuffer        instanceBuffer;
+        VkDeviceMemory  instanceMemory;
+        VkDeviceAddress instanceAddress;
+        GpuInstance    *instances;
+        VkBuffer        commandBuffer;
+        VkDeviceMemory  commandMemory;
+        VkDrawIndexedIndirectCommand *commands;
+    };
+
+    void queueCopy(VkBuffer dstBuffer, VkDeviceSize dstOffset, void const *data, VkDeviceSize size);
+
+    VkDevice                         mLogicalDevice;
+    VkPhysicalDeviceMemoryProperties mMemoryProperties;
+    GeometryPoolParameters           mParameters;
+    bool                             mMultiDrawIndirect;
+
+    VkBuffer                         mVertexBuffer;
+    VkDeviceMemory                   mVertexMemory;
+    VkDeviceAddress                  mVertexAddress;
+    VkBuffer                         mIndexBuffer;
+    VkDeviceMemory                   mIndexMemory;
+    VkBuffer                         mMeshBuffer;
+    VkDeviceMemory                   mMeshMemory;
+    VkDeviceAddress                  mMeshAddress;
+    VkDeviceSize                     mVertexBytes;
+    uint32_t                         mIndexCount;
+    std::vector<MeshRange>           mMeshes;
+
+    std::vector<unsigned char>       mPendingData;
+    std::vector<PendingCopy>         mPendingCopies;
+    std::vector<VkBuffer>            mTransferBuffers;
+    std::vector<VkDeviceMemory>      mTransferMemories;
+
+    VkPipelineLayout                 mPipelineLayout;
+    std::vector<VkShaderModule>      mShaderModules;
+    std::vector<FrameResources>      mFrames;
+    uint32_t                         mFrameIndex;
+    uint32_t                         mDrawCount;
+    GeometryPoolStats                mStats;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+
+#include "BasisTranscoder.h"
+#include "Common.h"
+#include "MappedFile.h"
+
+namespace VulkanSample
+{
+
+enum class Ktx2Supercompression : uint32_t
+{
+    None    = 0,
+    BasisLZ = 1,
+    Zstd    = 2,
+    Zlib    = 3
+};
+
+struct Ktx2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Reader for 2D KTX2 textures (no arrays, cube maps or 3D textures) on top of a file mapping.
+// Levels are stored as-is or with zstd supercompression (when built with zstd). Basis Universal
+// ETC1S payloads (BasisLZ supercompression, vkFormat UNDEFINED) are transcoded when a level is
+// fetched, to the target chosen with setTranscodeTarget(); UASTC payloads are rejected.
+class Ktx2File
+{
+public:
+    Ktx2File();
+
+    bool open(std::string const &filename);
+    void close();
+
+    // VK_FORMAT_UNDEFINED for Basis Universal files until a transcode target is set
+    VkFormat getFormat() const;
+    uint32_t getWidth() const;
+    uint32_t getHeight() const;
+    // Levels stored in the file, level 0 is the largest. A file may ask for generated mips
+    // by storing only level 0.
+    uint32_t getLevelCount() const;
+    bool isBasisUniversal() const;
+    // Whether a Basis Universal file has an alpha channel
+    bool hasAlpha() const;
+    // Formats with alpha cannot take ASTC as target
+    bool setTranscodeTarget(BasisTarget target, TranscodeKernel kernel);
+
+    // data points into the mapping, or into scratch when the level had to be decompressed or
+    // transcoded
+    bool getLevelData(uint32_t level, std::vector<uint8_t> &scratch, uint8_t const *&data, size_t &size) const;
+
+private:
+    MappedFile                 mFile;
+    std::string                mFilename;
+    VkFormat                   mFormat;
+    uint32_t                   mWidth;
+    uint32_t                   mHeight;
+    Ktx2Supercompression       mSupercompression;
+    std::vector<Ktx2Level>     mLevels;
+    bool                       mSrgb;
+    bool                       mAlpha;
+    BasisTranscoder            mTranscoder;
+    BasisTarget                mTarget;
+    TranscodeKernel            mKernel;
+};
+
+} // namespace VulkanSample
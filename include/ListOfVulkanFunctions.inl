@@ -23,7 +23,12 @@ GLOBAL_LEVEL_VULKAN_FUNCTION(vkCreateInstance)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkEnumeratePhysicalDevices)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkEnumerateDeviceExtensionProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceProperties)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceProperties2)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceFeatures)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceFeatures2)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceMemoryProperties)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceFormatProperties)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceSparseImageFormatProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkCreateDevice)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetDeviceProcAddr)
@@ -44,9 +49,9 @@ INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySurfaceKHR,
 #ifdef VK_USE_PLATFORM_WIN32_KHR
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateWin32SurfaceKHR, VK_KHR_WIN32_SURFACE_EXTENSION_NAME)
 #elif defined VK_USE_PLATFORM_XCB_KHR
-INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXcbSurfaceKHR, VK_KHR_XLIB_SURFACE_EXTENSION_NAME)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXcbSurfaceKHR, VK_KHR_XCB_SURFACE_EXTENSION_NAME)
 #elif defined VK_USE_PLATFORM_XLIB_KHR
-INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXlibSurfaceKHR, VK_KHR_XCB_SURFACE_EXTENSION_NAME)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXlibSurfaceKHR, VK_KHR_XLIB_SURFACE_EXTENSION_NAME)
 #endif
 
 #undef INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
@@ -56,11 +61,97 @@ INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateXlibSurfaceKHR, VK_KHR_XCB
 #endif
 DEVICE_LEVEL_VULKAN_FUNCTION(vkGetDeviceQueue)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkDeviceWaitIdle)
-DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDevice)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkQueueWaitIdle)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateBuffer)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkGetBufferMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetImageMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBindImageMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetImageSparseMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkQueueBindSparse)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateImageView)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateSampler)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyImageView)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkFreeMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBindBufferMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkMapMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkUnmapMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateShaderModule)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateDescriptorSetLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkUpdateDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateSemaphore)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkResetCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateCommandBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBeginCommandBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkEndCommandBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreatePipelineLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreatePipelineCache)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateComputePipelines)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateGraphicsPipelines)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindPipeline)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdPushConstants)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDispatch)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdPipelineBarrier)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdFillBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdExecuteCommands)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyBufferToImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindVertexBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindIndexBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexed)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexedIndirect)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyImageToBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdResetQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetQueryPoolResults)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyQueryPoolResults)
 #undef DEVICE_LEVEL_VULKAN_FUNCTION
 
+// Rarely called entry points (mostly teardown) are resolved on their first call instead of
+// during device bring-up
+#ifndef DEVICE_LEVEL_VULKAN_FUNCTION_LAZY
+#define DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(function)
+#endif
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyDevice)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyShaderModule)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyDescriptorSetLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroySemaphore)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyPipelineLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyPipeline)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkGetPipelineCacheData)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyPipelineCache)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroyDescriptorUpdateTemplate)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkDestroySampler)
+DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(vkGetDeviceMemoryCommitment)
+#undef DEVICE_LEVEL_VULKAN_FUNCTION_LAZY
+
+#ifndef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(function, version)
+#endif
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkCreateDescriptorUpdateTemplate,   VK_API_VERSION_1_1)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkUpdateDescriptorSetWithTemplate,  VK_API_VERSION_1_1)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkWaitSemaphores,                   VK_API_VERSION_1_2)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkGetSemaphoreCounterValue,         VK_API_VERSION_1_2)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkGetBufferDeviceAddress,           VK_API_VERSION_1_2)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkQueueSubmit2,                     VK_API_VERSION_1_3)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkCmdPipelineBarrier2,              VK_API_VERSION_1_3)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkCmdWriteTimestamp2,               VK_API_VERSION_1_3)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkCmdBeginRendering,                VK_API_VERSION_1_3)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(vkCmdEndRendering,                  VK_API_VERSION_1_3)
+#undef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION
+
 #ifndef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(function, extension)
 #endif
@@ -69,4 +160,7 @@ DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetSwapchainImagesKHR, VK_KHR_SWAP
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkAcquireNextImageKHR,   VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkQueuePresentKHR,       VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySwapchainKHR,   VK_KHR_SWAPCHAIN_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCmdDrawMeshTasksEXT,   VK_EXT_MESH_SHADER_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetMemoryHostPointerPropertiesEXT, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCmdPushDescriptorSetWithTemplateKHR, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)
 #undef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
\ No newline at end of file
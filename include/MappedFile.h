@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace VulkanSample
+{
+
+// Read-only memory mapping of a whole file. The mapping base is page aligned.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    bool open(std::string const &filename);
+    void close();
+
+    uint8_t const *getData() const;
+    size_t getSize() const;
+
+    static size_t getPageSize();
+
+private:
+    uint8_t const *mData;
+    size_t         mSize;
+#ifdef _WIN32
+    HANDLE         mFile;
+    HANDLE         mMapping;
+#else
+    int            mFile;
+#endif
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace VulkanSample
+{
+
+struct Float3
+{
+    float x;
+    float y;
+    float z;
+};
+
+struct Float4
+{
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+// Column-major 4x4 matrix, element (row, column) is stored at m[column * 4 + row]
+struct Float4x4
+{
+    float m[16];
+};
+
+// Planes are stored as (normal, distance) with normals pointing inside the frustum
+struct Frustum
+{
+    Float4 planes[6];
+};
+
+inline Float4x4 identityMatrix()
+{
+    Float4x4 result = {};
+    result.m[0] = result.m[5] = result.m[10] = result.m[15] = 1.0f;
+    return result;
+}
+
+inline Float4x4 multiply(Float4x4 const &lhs, Float4x4 const &rhs)
+{
+    Float4x4 result;
+    for(uint32_t column = 0; column < 4; ++column)
+    {
+        for(uint32_t row = 0; row < 4; ++row)
+        {
+            result.m[column * 4 + row] = lhs.m[0 * 4 + row] * rhs.m[column * 4 + 0] +
+                                         lhs.m[1 * 4 + row] * rhs.m[column * 4 + 1] +
+                                         lhs.m[2 * 4 + row] * rhs.m[column * 4 + 2] +
+                                         lhs.m[3 * 4 + row] * rhs.m[column * 4 + 3];
+        }
+    }
+    return result;
+}
+
+inline Float3 transformPoint(Float4x4 const &matrix, Float3 const &point)
+{
+    return {
+        matrix.m[0] * point.x + matrix.m[4] * point.y + matrix.m[8]  * point.z + matrix.m[12],
+        matrix.m[1] * point.x + matrix.m[5] * point.y + matrix.m[9]  * point.z + matrix.m[13],
+        matrix.m[2] * point.x + matrix.m[6] * point.y + matrix.m[10] * point.z + matrix.m[14]
+    };
+}
+
+// Largest axis scale of the upper 3x3 part, used to grow bounding spheres
+inline float maxScale(Float4x4 const &matrix)
+{
+    float sx = matrix.m[0] * matrix.m[0] + matrix.m[1] * matrix.m[1] + matrix.m[2]  * matrix.m[2];
+    float sy = matrix.m[4] * matrix.m[4] + matrix.m[5] * matrix.m[5] + matrix.m[6]  * matrix.m[6];
+    float sz = matrix.m[8] * matrix.m[8] + matrix.m[9] * matrix.m[9] + matrix.m[10] * matrix.m[10];
+    float largest = sx > sy ? sx : sy;
+    largest = largest > sz ? largest : sz;
+    return std::sqrt(largest);
+}
+
+// Gribb-Hartmann plane extraction for a Vulkan style (0..1 depth) view-projection matrix
+inline Frustum extractFrustum(Float4x4 const &viewProjection)
+{
+    auto row = [&viewProjection](uint32_t index) -> Float4
+    {
+        return { viewProjection.m[0 * 4 + index], viewProjection.m[1 * 4 + index],
+                 viewProjection.m[2 * 4 + index], viewProjection.m[3 * 4 + index] };
+    };
+    Float4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    Frustum frustum;
+    frustum.planes[0] = { r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w }; // left
+    frustum.planes[1] = { r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w }; // right
+    frustum.planes[2] = { r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w }; // bottom
+    frustum.planes[3] = { r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w }; // top
+    frustum.planes[4] = { r2.x,        r2.y,        r2.z,        r2.w        }; // near
+    frustum.planes[5] = { r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w }; // far
+
+    for(auto &plane : frustum.planes)
+    {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if(length > 0.0f)
+        {
+            plane.x /= length;
+            plane.y /= length;
+            plane.z /= length;
+            plane.w /= length;
+        }
+    }
+    return frustum;
+}
+
+} // namespace VulkanSample
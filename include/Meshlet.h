@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace VulkanSample
+{
+
+static const uint32_t MESHLET_MAX_VERTICES  = 64;
+static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+struct MeshVertex
+{
+    float position[3];
+    float normal[3];
+    float texCoord[2];
+};
+
+// Layout matches the std430 Meshlet struct used by the meshlet shaders
+struct Meshlet
+{
+    float    center[3];       // bounding sphere
+    float    radius;
+    float    coneApex[3];     // backface cone, cull when dot(normalize(apex - eye), axis) >= cutoff
+    float    coneCutoff;
+    float    coneAxis[3];
+    uint32_t vertexOffset;    // first entry in MeshletData::vertices
+    uint32_t triangleOffset;  // first entry in MeshletData::triangles
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint32_t padding;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet>  meshlets;
+    std::vector<uint32_t> vertices;   // meshlet local vertex -> mesh vertex index
+    std::vector<uint32_t> triangles;  // three 8-bit meshlet local indices packed per entry
+};
+
+// Offline clustering of an indexed triangle list into meshlets of at most
+// MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles
+bool buildMeshlets(std::vector<MeshVertex> const &vertices, std::vector<uint32_t> const &indices, MeshletData &meshletData);
+
+inline uint32_t packMeshletTriangle(uint32_t a, uint32_t b, uint32_t c)
+{
+    return a | (b << 8) | (c << 16);
+}
+
+} // namespace VulkanSample
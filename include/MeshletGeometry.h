@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Common.h"
+#include "MathTypes.h"
+#include "Meshlet.h"
+
+namespace VulkanSample
+{
+
+// Push constant block shared by all meshlet shaders
+struct MeshletDrawConstants
+{
+    Float4x4 viewProjection;
+    float    cameraPosition[3];
+    uint32_t meshletCount;
+};
+
+// GPU side of a meshlet mesh. Devices with VK_EXT_mesh_shader draw meshlets directly
+// through the task/mesh stages; everything else culls and expands visible meshlets into
+// a plain index buffer with a compute pass and draws it with vkCmdDrawIndexedIndirect.
+class MeshletGeometry
+{
+public:
+    MeshletGeometry();
+    ~MeshletGeometry();
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities,
+                std::vector<MeshVertex> const &vertices, MeshletData const &meshletData);
+    void destroy();
+
+    bool usesMeshShader() const;
+    uint32_t getMeshletCount() const;
+
+    // Layout used by both the graphics pipeline and the expansion compute pipeline
+    VkDescriptorSetLayout getDescriptorSetLayout() const;
+    VkPipelineLayout getPipelineLayout() const;
+
+    // Shader stages for the graphics pipeline: task + mesh + fragment or vertex + fragment.
+    // With clusteredLighting the fragment stage shades with the lights of ClusteredLighting,
+    // which needs bufferDeviceAddress and recordLightingData before each draw.
+    bool createShaderStages(std::vector<VkPipelineShaderStageCreateInfo> &shaderStages, bool clusteredLighting = false);
+    static void getFallbackVertexInput(VkVertexInputBindingDescription &binding,
+                                       std::vector<VkVertexInputAttributeDescription> &attributes);
+
+    // Fallback path only, record outside of a render pass before recordDraw
+    void recordIndexExpansion(VkCommandBuffer commandBuffer, MeshletDrawConstants const &constants);
+    // Records the draw, a graphics pipeline built from createShaderStages must be bound
+    void recordDraw(VkCommandBuffer commandBuffer, MeshletDrawConstants const &constants);
+    // Clustered fragment stage only: ClusteredLighting::getShadingData of the frame being drawn
+    void recordLightingData(VkCommandBuffer commandBuffer, VkDeviceAddress shadingData);
+
+private:
+    bool createDescriptors();
+
+    VkDevice              mLogicalDevice;
+    bool                  mUseMeshShader;
+    uint32_t              mMeshletCount;
+    uint32_t              mTaskGroupCountX;
+    uint32_t              mTaskGroupCountY;
+    uint32_t              mIndexCount;
+
+    VkBuffer              mMeshletBuffer;
+    VkDeviceMemory        mMeshletMemory;
+    VkBuffer              mMeshletVertexBuffer;
+    VkDeviceMemory        mMeshletVertexMemory;
+    VkBuffer              mMeshletTriangleBuffer;
+    VkDeviceMemory        mMeshletTriangleMemory;
+    VkBuffer              mVertexBuffer;
+    VkDeviceMemory        mVertexMemory;
+    VkBuffer              mExpandedIndexBuffer;
+    VkDeviceMemory        mExpandedIndexMemory;
+    VkBuffer              mDrawCommandBuffer;
+    VkDeviceMemory        mDrawCommandMemory;
+
+    VkDescriptorSetLayout mDescriptorSetLayout;
+    VkDescriptorPool      mDescriptorPool;
+    VkDescriptorSet       mDescriptorSet;
+    VkPipelineLayout      mPipelineLayout;
+    VkPipeline            mExpansionPipeline;
+    std::vector<VkShaderModule> mShaderModules;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace VulkanSample
+{
+
+// Unbounded multi-producer single-consumer queue. push() may be called from any thread and is
+// lock-free except for the node allocation, which goes through the global allocator and may take
+// a lock; pop() and empty() only from the single consumer. A push that is still in flight may
+// be reported as empty for a moment; it becomes visible as soon as the producer links its node.
+template<typename Type>
+class MpscQueue
+{
+public:
+    MpscQueue()
+    {
+        Node *stub = new Node();
+        mHead.store(stub);
+        mTail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        Type value;
+        while(pop(value))
+        {
+        }
+        delete mTail;
+    }
+
+    MpscQueue(MpscQueue const &) = delete;
+    MpscQueue &operator=(MpscQueue const &) = delete;
+
+    void push(Type value)
+    {
+        // The only step that can block, linking the node is a single exchange
+        Node *node = new Node();
+        node->value = std::move(value);
+        Node *previous = mHead.exchange(node);
+        previous->next.store(node);
+    }
+
+    bool pop(Type &value)
+    {
+        Node *next = mTail->next.load();
+        if(next == nullptr)
+            return false;
+
+        value = std::move(next->value);
+        delete mTail;
+        mTail = next;
+        return true;
+    }
+
+    bool empty() const
+    {
+        return mTail->next.load() == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next;
+        Type                value;
+
+        Node() : next(nullptr), value()
+        {
+        }
+    };
+
+    std::atomic<Node *> mHead;   // last pushed node, shared by producers
+    Node               *mTail;   // already consumed node, owned by the consumer
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+// A compute job split into chunks of elements. The callbacks run on the worker thread of each
+// device; calls for different devices happen concurrently, calls for one device never do.
+struct MultiDeviceJob
+{
+    uint64_t              elementCount;
+    uint32_t              chunkElements;     // unit of distribution and stealing
+    // Once per device before its first chunk: pipelines and buffers for SLOTS_PER_DEVICE chunks in flight
+    std::function<bool(uint32_t device, VkDevice logicalDevice, DeviceCapabilities const &capabilities)> prepare;
+    // Records elements [first, first + count) into an already begun command buffer, using the
+    // resources of slot; must end with the barriers that make the results visible to the host
+    std::function<bool(uint32_t device, uint32_t slot, VkCommandBuffer commandBuffer, uint64_t first, uint32_t count)> record;
+    // Called when the chunk has finished on the GPU, before slot is reused
+    std::function<bool(uint32_t device, uint32_t slot, uint64_t first, uint32_t count)> gather;
+    // After the last chunk or a failed prepare, the device is idle
+    std::function<void(uint32_t device)> release;
+};
+
+struct ComputeDeviceStats
+{
+    std::string           name;
+    uint64_t              elements;          // of the last run
+    uint32_t              chunks;
+    uint32_t              stolenChunks;      // taken from the queue of another device
+    double                busySeconds;
+    double                throughput;        // elements per second, moving average over runs
+};
+
+struct MultiDeviceComputeStats
+{
+    std::vector<ComputeDeviceStats> devices;
+    double                          seconds;  // wall time of the last run
+};
+
+// Runs compute jobs on a logical device per eligible physical device. Chunks are handed out in
+// proportion to the throughput every device reached in the previous runs; each device works
+// through its own queue front to back and, when it runs dry, steals from the back of the
+// fullest other queue, so a slower device or a wrong estimate only costs the last chunks.
+// Every device gets a worker thread, a compute queue and a timeline semaphore that tracks
+// SLOTS_PER_DEVICE chunks in flight.
+//
+// Device-level functions are switched to loader trampolines (setMultiDeviceDispatch), which also
+// keeps any device created earlier working. devicesPerPhysicalDevice > 1 creates several logical
+// devices on one physical device, so the scheduling can be exercised with a single lavapipe;
+// several ICDs (VK_DRIVER_FILES) or a mock ICD show up as separate physical devices.
+class MultiDeviceCompute
+{
+public:
+    static const uint32_t SLOTS_PER_DEVICE = 2;
+
+    MultiDeviceCompute();
+    ~MultiDeviceCompute();
+
+    // Uses every suitable probe with timeline semaphores and synchronization2
+    bool create(std::vector<PhysicalDeviceProbe> const &physicalDevices, uint32_t devicesPerPhysicalDevice = 1);
+    void destroy();
+
+    uint32_t getDeviceCount() const;
+    DeviceCapabilities const & getDeviceCapabilities(uint32_t device) const;
+
+    // Blocks until all chunks are gathered, false if any callback or Vulkan call failed
+    bool run(MultiDeviceJob const &job);
+
+    MultiDeviceComputeStats getStats() const;
+
+private:
+    struct Chunk
+    {
+        uint64_t first;
+        uint32_t count;
+    };
+
+    struct ComputeDevice
+    {
+        VkDevice             logicalDevice;
+        DeviceCapabilities   capabilities;
+        QueueParameters      queue;
+        VkCommandPool        commandPools[SLOTS_PER_DEVICE];
+        VkCommandBuffer      commandBuffers[SLOTS_PER_DEVICE];
+        VkSemaphore          timelineSemaphore;
+        uint64_t             timelineValue;
+        std::mutex           mutex;         // guards chunks
+        std::deque<Chunk>    chunks;
+        ComputeDeviceStats   stats;
+    };
+
+    bool createDevice(PhysicalDeviceProbe const &probe, ComputeDevice &device);
+    void destroyDevice(ComputeDevice &device);
+    void distributeChunks(MultiDeviceJob const &job);
+    bool takeChunk(uint32_t device, Chunk &chunk, bool &stolen);
+    bool submitChunk(uint32_t device, MultiDeviceJob const &job, uint32_t slot, Chunk const &chunk);
+    bool waitForChunk(uint32_t device, uint64_t timelineValue);
+    void work(uint32_t device, MultiDeviceJob const &job);
+
+    std::vector<std::unique_ptr<ComputeDevice>> mDevices;
+    std::atomic<bool>            mFailed;
+    double                       mSeconds;
+};
+
+} // namespace VulkanSample
@@ -2,11 +2,17 @@
 
 #ifdef _WIN32
 #include <Windows.h>
+#elif defined VK_USE_PLATFORM_XCB_KHR
+#include <xcb/xcb.h>
+#elif defined VK_USE_PLATFORM_XLIB_KHR
+#include <X11/Xlib.h>
 #endif
 
 namespace VulkanSample
 {
 
+class WindowEventQueue;
+
 struct WindowParameters
 {
 #ifdef VK_USE_PLATFORM_WIN32_KHR
@@ -18,6 +24,8 @@ struct WindowParameters
 #elif defined VK_USE_PLATFORM_XCB_KHR
     xcb_connection_t * Connection;
     xcb_window_t       Window;
+    xcb_atom_t         ProtocolsAtom;      // WM_PROTOCOLS
+    xcb_atom_t         DeleteWindowAtom;   // WM_DELETE_WINDOW, the close button
 #endif
 };
 
@@ -25,4 +33,11 @@ bool createWindowHandle(WindowParameters &windowParameters, const char* title, i
                         int width, int height);
 void destroyWindowHandle(WindowParameters &windowParameters);
 
-} // namespace VulkanSample
\ No newline at end of file
+// Runs the message pump of the window until exitWindowEventLoop() is called, translating input,
+// resize and close messages into events. Must run on the thread that created the window; the
+// window's close button and Escape only post a quit event, the consumer decides when to exit.
+void runWindowEventLoop(WindowParameters &windowParameters, WindowEventQueue &events);
+// May be called from any thread
+void exitWindowEventLoop(WindowParameters &windowParameters);
+
+} // namespace VulkanSample
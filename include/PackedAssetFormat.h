@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace VulkanSample
+{
+
+// Packed asset file layout:
+//   PackedAssetHeader
+//   PackedAssetSection[sectionCount]
+//   section payloads, each starting at a multiple of PACKED_ASSET_SECTION_ALIGNMENT
+// The file size is padded to the alignment as well, so every uncompressed section
+// can be handed to the GPU straight from the mapping (including its rounded up size).
+
+static const uint32_t PACKED_ASSET_MAGIC             = 0x4B505356; // "VSPK"
+static const uint32_t PACKED_ASSET_VERSION           = 1;
+static const uint64_t PACKED_ASSET_SECTION_ALIGNMENT = 4096;
+
+enum class AssetSectionType : uint32_t
+{
+    Vertices         = 0,
+    Indices          = 1,
+    Meshlets         = 2,
+    MeshletVertices  = 3,
+    MeshletTriangles = 4,
+    Count
+};
+
+enum class AssetCompression : uint32_t
+{
+    None = 0,
+    LZ4  = 1,
+    Zstd = 2
+};
+
+struct PackedAssetHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t flags;
+    uint64_t fileSize;
+    uint64_t reserved;
+};
+
+struct PackedAssetSection
+{
+    AssetSectionType type;
+    AssetCompression compression;
+    uint32_t         elementSize;
+    uint32_t         elementCount;
+    uint64_t         offset;       // from the start of the file
+    uint64_t         storedSize;   // bytes in the file
+    uint64_t         size;         // bytes after decompression
+};
+
+static_assert(sizeof(PackedAssetHeader) == 32, "PackedAssetHeader layout is part of the file format");
+static_assert(sizeof(PackedAssetSection) == 40, "PackedAssetSection layout is part of the file format");
+
+bool isCompressionAvailable(AssetCompression compression);
+char const *getSectionTypeName(AssetSectionType type);
+
+class PackedAssetWriter
+{
+public:
+    // Falls back to AssetCompression::None when the codec is not compiled in or does not help
+    void addSection(AssetSectionType type, uint32_t elementSize, uint32_t elementCount, void const *data,
+                    AssetCompression compression);
+    bool write(std::string const &filename) const;
+
+private:
+    struct PendingSection
+    {
+        PackedAssetSection   description;
+        std::vector<uint8_t> payload;
+    };
+
+    std::vector<PendingSection> mSections;
+};
+
+// Memory mapped view of a packed asset. Section data pointers stay valid while the asset is open.
+class PackedAsset
+{
+public:
+    bool open(std::string const &filename);
+    void close();
+
+    PackedAssetSection const *findSection(AssetSectionType type) const;
+    std::vector<PackedAssetSection> const &getSections() const;
+    uint8_t const *getStoredData(PackedAssetSection const &section) const;
+
+    // Copies or decompresses section contents, destination must hold section.size bytes
+    bool readSection(PackedAssetSection const &section, void *destination) const;
+
+private:
+    MappedFile                      mFile;
+    std::vector<PackedAssetSection> mSections;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common.h"
+#include "PackedAssetFormat.h"
+
+namespace VulkanSample
+{
+
+// Device local buffers created from a packed asset, indexed by AssetSectionType
+struct GpuMeshBuffers
+{
+    VkBuffer       buffers[static_cast<uint32_t>(AssetSectionType::Count)];
+    VkDeviceMemory memoryObjects[static_cast<uint32_t>(AssetSectionType::Count)];
+    uint32_t       elementCounts[static_cast<uint32_t>(AssetSectionType::Count)];
+};
+
+struct PackedAssetLoadStats
+{
+    uint32_t importedSections;   // copied by the GPU straight out of the file mapping
+    uint32_t stagedSections;     // copied or decompressed into a staging buffer first
+    uint64_t importedBytes;
+    uint64_t stagedBytes;
+    uint64_t decompressedBytes;
+    double   cpuMilliseconds;    // time spent in recordUpload
+};
+
+// Uploads a mapped packed asset into device local buffers. Uncompressed sections are imported
+// with VK_EXT_external_memory_host when the device supports it, so the GPU reads the page cache
+// directly; everything else goes through one staging buffer filled from the mapping.
+class PackedAssetLoader
+{
+public:
+    PackedAssetLoader();
+    ~PackedAssetLoader();
+
+    // Records transfer commands into commandBuffer. The asset must stay open and
+    // releaseTransferResources must not be called until the command buffer has finished.
+    bool recordUpload(VkDevice logicalDevice, DeviceCapabilities const &capabilities, PackedAsset const &asset,
+                      VkCommandBuffer commandBuffer, GpuMeshBuffers &mesh);
+    void releaseTransferResources();
+
+    PackedAssetLoadStats const &getStats() const;
+
+    static void destroyMeshBuffers(VkDevice logicalDevice, GpuMeshBuffers &mesh);
+
+private:
+    bool importSection(DeviceCapabilities const &capabilities, PackedAsset const &asset,
+                       PackedAssetSection const &section, VkBuffer &sourceBuffer);
+
+    VkDevice                    mLogicalDevice;
+    std::vector<VkBuffer>       mTransferBuffers;
+    std::vector<VkDeviceMemory> mTransferMemoryObjects;
+    PackedAssetLoadStats        mStats;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+// Counters of one pass, taken from the most recent frame whose results have been resolved
+struct PassQueryCounters
+{
+    std::string           name;
+    uint64_t              frame;                    // beginFrame count of the frame that was measured
+    bool                  statisticsValid;          // pipelineStatisticsQuery is supported
+    uint64_t              inputVertices;
+    uint64_t              inputPrimitives;
+    uint64_t              vertexInvocations;        // zero on the mesh shader path
+    uint64_t              clippingInvocations;      // primitives reaching the clipping stage
+    uint64_t              clippingPrimitives;       // primitives leaving it
+    uint64_t              fragmentInvocations;
+    uint64_t              computeInvocations;
+    uint64_t              samplesPassed;            // depth and stencil tests passed, exact when occlusionQueryPrecise is supported
+};
+
+struct PassQueryStats
+{
+    uint32_t              passes;                   // in the latest resolved frame
+    uint64_t              resolvedFrames;
+    uint64_t              droppedPasses;            // beyond maxPasses in a frame
+};
+
+// Per-pass pipeline statistics and occlusion queries, to tell whether a pass is bound by vertex
+// work, fragment work or overdraw. Every frame in flight owns a range of both query pools; the
+// results are copied into a host visible readback buffer with vkCmdCopyQueryPoolResults at the
+// end of the frame and read when the slot comes around again. The copy waits for the queries on
+// the GPU timeline only, the CPU never waits for a query.
+//
+// Per frame, on a graphics queue command buffer:
+//   beginFrame()       reads the results of the frame that used the slot before and resets its queries
+//   beginPass() / endPass() around each pass, not nested, both inside or both outside a render pass
+//   recordResolve()    outside of a render pass after the last pass
+// Secondary command buffers executed inside a pass are not covered.
+class PassQueries
+{
+public:
+    PassQueries();
+    ~PassQueries();
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight, uint32_t maxPasses);
+    void destroy();
+
+    // The GPU must have finished the frame recorded framesInFlight frames ago
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void beginPass(VkCommandBuffer commandBuffer, char const *name);
+    void endPass(VkCommandBuffer commandBuffer);
+    void recordResolve(VkCommandBuffer commandBuffer);
+
+    std::vector<PassQueryCounters> const &getCounters() const;
+    PassQueryStats getStats() const;
+    // Counters of the latest resolved frame with derived ratios
+    bool exportJson(std::string const &filename) const;
+
+private:
+    static const uint32_t STATISTICS_COUNT = 7;     // bits of PIPELINE_STATISTICS, in result order
+
+    struct FrameSlot
+    {
+        std::vector<std::string> passNames;
+        uint64_t                 frame;
+        bool                     resolved;            // recordResolve was recorded for the slot
+    };
+
+    void readResults(FrameSlot &slot, uint32_t slotIndex);
+
+    VkDevice                       mLogicalDevice;
+    uint32_t                       mMaxPasses;
+    bool                           mStatisticsSupported;
+    VkQueryControlFlags            mOcclusionFlags;
+    VkQueryPool                    mStatisticsPool;
+    VkQueryPool                    mOcclusionPool;
+    VkBuffer                       mReadbackBuffer;
+    VkDeviceMemory                 mReadbackMemory;
+    uint64_t                      *mReadbackData;
+    std::vector<FrameSlot>         mSlots;
+    uint32_t                       mSlotIndex;
+    bool                           mPassActive;
+    uint64_t                       mFrame;
+
+    std::vector<PassQueryCounters> mCounters;
+    PassQueryStats                 mStats;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+class ThreadPool;
+
+// Everything that distinguishes one graphics pipeline from another, grouped by the pipeline
+// library part it belongs to. Pipelines render with dynamic rendering, viewport and scissor are
+// dynamic state. Shader modules, pipeline layouts and specialization data must outlive the manager.
+struct GraphicsPipelineState
+{
+    // Vertex input interface, ignored for task/mesh pipelines
+    std::vector<VkVertexInputBindingDescription>   vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology                            topology        = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Pre-rasterization shaders
+    std::vector<VkPipelineShaderStageCreateInfo>   preRasterizationStages;    // vertex, or task + mesh
+    VkPipelineLayout                               pipelineLayout  = VK_NULL_HANDLE;
+    VkPolygonMode                                  polygonMode     = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags                                cullMode        = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace                                    frontFace       = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    // Fragment shader
+    VkPipelineShaderStageCreateInfo                fragmentStage   = {};
+    bool                                           depthTest       = true;
+    bool                                           depthWrite      = true;
+    VkCompareOp                                    depthCompareOp  = VK_COMPARE_OP_GREATER_OR_EQUAL;   // reversed Z
+
+    // Fragment output interface
+    std::vector<VkFormat>                          colorFormats;
+    VkFormat                                       depthFormat     = VK_FORMAT_UNDEFINED;
+    bool                                           blendEnable     = false;   // premultiplied alpha on every color attachment
+    VkSampleCountFlagBits                          samples         = VK_SAMPLE_COUNT_1_BIT;
+};
+
+struct PipelineManagerStats
+{
+    uint32_t              libraries;               // precompiled parts
+    uint32_t              fastLinkedPipelines;     // still waiting for their optimized variant
+    uint32_t              optimizedPipelines;      // link-time optimized variants swapped in
+    uint32_t              monolithicPipelines;     // created without pipeline libraries
+    double                slowestCreateMs;         // on the calling thread, the worst hitch a new pipeline caused
+};
+
+// Creates graphics pipelines without stalling the frame that first needs them. With
+// VK_EXT_graphics_pipeline_library (and fast linking) every pipeline is split into vertex input,
+// pre-rasterization, fragment shader and fragment output libraries, which are compiled once and
+// shared between pipelines. A state combination seen for the first time is fast-linked from its
+// libraries; the link-time optimized variant is then built on the thread pool and swapped in by
+// beginFrame(), the fast-linked pipeline is destroyed once no frame in flight can use it anymore.
+// Devices without the extension get monolithic pipelines backed by the pipeline cache.
+// Only the background optimization runs on other threads, call everything else from one thread.
+class PipelineManager
+{
+public:
+    PipelineManager();
+    ~PipelineManager();
+
+    // Without a thread pool the optimized variant is built immediately instead of fast-linking
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, VkPipelineCache pipelineCache,
+                uint32_t framesInFlight, ThreadPool *threadPool);
+    void destroy();
+
+    bool usesPipelineLibraries() const;
+
+    // Compiles the libraries of a pipeline ahead of time (or the whole pipeline without libraries)
+    bool precompile(GraphicsPipelineState const &state);
+    // Returns a stable index, the pipeline behind it may be replaced by its optimized variant
+    bool requestPipeline(GraphicsPipelineState const &state, uint32_t &pipelineIndex);
+    VkPipeline getPipeline(uint32_t pipelineIndex) const;
+
+    // Call once per frame, the GPU must have finished the frame recorded framesInFlight frames ago
+    void beginFrame();
+
+    PipelineManagerStats getStats() const;
+
+private:
+    enum LibraryPart
+    {
+        LIBRARY_VERTEX_INPUT,
+        LIBRARY_PRE_RASTERIZATION,
+        LIBRARY_FRAGMENT_SHADER,
+        LIBRARY_FRAGMENT_OUTPUT,
+        LIBRARY_PART_COUNT
+    };
+
+    struct Library
+    {
+        std::vector<uint8_t> key;                           // canonical bytes of the part's state
+        VkPipeline           library;
+    };
+
+    struct Pipeline
+    {
+        std::vector<uint8_t> key;                           // library keys of every used part
+        VkPipeline           pipeline;
+        VkPipelineLayout     pipelineLayout;
+        VkPipeline           libraries[LIBRARY_PART_COUNT]; // VK_NULL_HANDLE for unused parts
+        bool                 optimized;
+    };
+
+    struct RetiredPipeline
+    {
+        VkPipeline        pipeline;
+        uint64_t          frame;
+    };
+
+    bool getLibrary(LibraryPart part, GraphicsPipelineState const &state, VkPipeline &library);
+    bool createLibraries(GraphicsPipelineState const &state, VkPipeline (&libraries)[LIBRARY_PART_COUNT]);
+    bool linkPipeline(VkPipeline const (&libraries)[LIBRARY_PART_COUNT], VkPipelineLayout pipelineLayout, bool optimize,
+                      VkPipeline &pipeline);
+    void optimizeInBackground(uint32_t pipelineIndex);
+
+    VkDevice                                    mLogicalDevice;
+    VkPipelineCache                             mPipelineCache;
+    ThreadPool                                 *mThreadPool;
+    bool                                        mUsePipelineLibraries;
+    uint32_t                                    mFramesInFlight;
+    uint64_t                                    mFrame;
+
+    // Keyed by the hash of the state's key, colliding entries are told apart by comparing keys
+    std::unordered_multimap<uint64_t, Library>  mLibraries[LIBRARY_PART_COUNT];
+    std::unordered_multimap<uint64_t, uint32_t> mPipelineLookup;
+    std::vector<uint8_t>                        mKeyScratch;
+    std::vector<Pipeline>                       mPipelines;
+    std::vector<RetiredPipeline>                mRetiredPipelines;
+    PipelineManagerStats                        mStats;
+
+    // Shared with the background tasks
+    std::mutex                                  mMutex;
+    std::condition_variable                     mCondition;
+    std::vector<std::pair<uint32_t, VkPipeline>> mOptimizedPipelines;
+    uint32_t                                    mPendingOptimizations;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifdef VULKANSAMPLE_PROFILING
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VULKANSAMPLE_PROFILING_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+#endif
+
+namespace VulkanSample
+{
+
+// CPU zone profiler. Every thread records finished zones into its own chunked buffer without
+// locks; exporting walks all buffers and may run while other threads keep recording.
+// Configure with -DVULKANSAMPLE_PROFILING=OFF to compile all zones out.
+//
+// Binary export layout (little endian, no padding):
+//   uint32 magic "VSPF", uint32 version, uint64 ticksPerSecond, uint32 nameCount, uint32 threadCount
+//   nameCount  x { uint16 length, char name[length] }
+//   threadCount x { uint32 threadIndex, uint16 length, char name[length], uint32 zoneCount,
+//                   zoneCount x { uint32 nameIndex, uint64 begin, uint64 duration } }
+// Zone times are in ticks relative to the earliest recorded zone.
+
+void setProfileThreadName(char const *name);
+bool exportProfileChromeTrace(std::string const &filename);
+bool exportProfileBinary(std::string const &filename);
+
+#ifdef VULKANSAMPLE_PROFILING
+
+inline uint64_t readProfileTimestamp()
+{
+#ifdef VULKANSAMPLE_PROFILING_RDTSC
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// name must outlive the profiler, string literals and __func__ do
+void recordProfileZone(char const *name, uint64_t begin, uint64_t end);
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(char const *name)
+    {
+        mName  = name;
+        mBegin = readProfileTimestamp();
+    }
+
+    ~ProfileZone()
+    {
+        recordProfileZone(mName, mBegin, readProfileTimestamp());
+    }
+
+    ProfileZone(ProfileZone const &) = delete;
+    ProfileZone &operator=(ProfileZone const &) = delete;
+
+private:
+    char const *mName;
+    uint64_t    mBegin;
+};
+
+#define PROFILE_CONCATENATE_IMPL(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_IMPL(a, b)
+#define PROFILE_ZONE(name) VulkanSample::ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_THREAD_NAME(name) VulkanSample::setProfileThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+
+#endif
+
+} // namespace VulkanSample
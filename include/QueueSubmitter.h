@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Common.h"
+#include "MpscQueue.h"
+
+namespace VulkanSample
+{
+
+struct QueueSubmission
+{
+    std::vector<VkSemaphoreSubmitInfo>     waitSemaphores;
+    std::vector<VkCommandBufferSubmitInfo> commandBuffers;
+    std::vector<VkSemaphoreSubmitInfo>     signalSemaphores;
+    VkFence                                fence;              // optional, ends the vkQueueSubmit2 call it is part of
+};
+
+struct QueuePresentation
+{
+    std::vector<VkSemaphore> waitSemaphores;
+    VkSwapchainKHR           swapchain;
+    uint32_t                 imageIndex;
+};
+
+struct QueueSubmitterStats
+{
+    uint64_t submissions;          // QueueSubmission objects handed in
+    uint64_t submitCalls;          // vkQueueSubmit2 calls made for them
+    uint64_t submitInfos;          // VkSubmitInfo2 structures after merging
+    uint64_t commandBuffers;
+    uint64_t presents;
+    double   submissionsPerCall;   // batching ratio
+};
+
+// Owns a VkQueue on a dedicated thread. Any thread may hand in work through a lock-free queue;
+// the submission thread drains everything pending and issues it with as few vkQueueSubmit2 calls
+// as possible, so callers never contend for the externally synchronized queue. Adjacent
+// submissions are merged into one VkSubmitInfo2 when the first signals nothing and the second
+// waits for nothing. Presents are issued in order with the submissions around them, so the
+// present queue's submitter must be used for vkQueuePresentKHR.
+class QueueSubmitter
+{
+public:
+    QueueSubmitter();
+    ~QueueSubmitter();
+
+    QueueSubmitter(QueueSubmitter const &) = delete;
+    QueueSubmitter &operator=(QueueSubmitter const &) = delete;
+
+    bool create(VkQueue queue);
+    // Issues all pending work before the thread stops
+    void destroy();
+
+    VkQueue getQueue() const;
+
+    void submit(QueueSubmission submission);
+    void present(QueuePresentation presentation);
+    // Blocks until everything handed in so far has been passed to the driver
+    void flush();
+
+    // Most recent present result other than VK_SUCCESS (e.g. VK_ERROR_OUT_OF_DATE_KHR), resets it to VK_SUCCESS
+    VkResult takePresentResult();
+    // True once a vkQueueSubmit2 call has failed, the device is most likely lost
+    bool hasFailed() const;
+
+    QueueSubmitterStats getStats() const;
+
+private:
+    struct Work
+    {
+        bool              isPresent;
+        QueueSubmission   submission;
+        QueuePresentation presentation;
+    };
+
+    void enqueue(Work work);
+    void threadLoop();
+    void issue(std::vector<Work> &pending);
+    void issueSubmissions(std::vector<Work> &pending, size_t begin, size_t end, VkFence fence);
+
+    VkQueue                 mQueue;
+    std::thread             mThread;
+    MpscQueue<Work>         mWork;
+    std::atomic<bool>       mSleeping;
+    std::atomic<bool>       mStopping;
+    std::mutex              mMutex;
+    std::condition_variable mWakeUp;
+    std::condition_variable mIssued;
+    std::atomic<uint64_t>   mEnqueuedCount;
+    std::atomic<uint64_t>   mIssuedCount;
+
+    std::atomic<VkResult>   mPresentResult;
+    std::atomic<bool>       mFailed;
+
+    std::atomic<uint64_t>   mSubmissions;
+    std::atomic<uint64_t>   mSubmitCalls;
+    std::atomic<uint64_t>   mSubmitInfos;
+    std::atomic<uint64_t>   mCommandBuffers;
+    std::atomic<uint64_t>   mPresents;
+
+    // Scratch storage of the submission thread
+    std::vector<VkSemaphoreSubmitInfo>     mWaitScratch;
+    std::vector<VkCommandBufferSubmitInfo> mCommandBufferScratch;
+    std::vector<VkSemaphoreSubmitInfo>     mSignalScratch;
+    std::vector<VkSubmitInfo2>             mSubmitScratch;
+};
+
+} // namespace VulkanSample
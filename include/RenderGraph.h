@@ -0,0 +1,261 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "Common.h"
+#include "QueueSubmitter.h"
+
+namespace VulkanSample
+{
+
+enum class RenderGraphQueue : uint32_t
+{
+    Graphics = 0,
+    Compute  = 1,
+    Count
+};
+
+typedef uint32_t RenderGraphResource;
+static const RenderGraphResource INVALID_RENDER_GRAPH_RESOURCE = 0xFFFFFFFF;
+
+struct RenderGraphImageDesc
+{
+    VkFormat              format;
+    VkExtent2D            extent;
+    uint32_t              mipLevels;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags     usage;
+    VkImageAspectFlags    aspect;
+};
+
+struct RenderGraphBufferDesc
+{
+    VkDeviceSize          size;
+    VkBufferUsageFlags    usage;
+};
+
+struct RenderGraphStats
+{
+    uint32_t              declaredPasses;
+    uint32_t              culledPasses;
+    uint32_t              imageBarriers;
+    uint32_t              memoryBarriers;       // buffer hazards of a pass are folded into one global barrier
+    uint32_t              barrierCalls;         // vkCmdPipelineBarrier2 calls per frame
+    uint32_t              submitBatches;
+    uint32_t              crossQueueWaits;
+    uint32_t              cacheHits;
+    uint32_t              cacheMisses;
+    VkDeviceSize          transientBytesRequested;  // dedicated allocations of every transient resource
+    VkDeviceSize          transientBytesAllocated;  // memory objects backing them after aliasing
+    VkDeviceSize          transientBytesLazy;       // part of the allocated bytes in lazily allocated memory
+    VkDeviceSize          transientBytesCommitted;  // peak physical backing, lazy memory counts with its largest commitment
+                                                    // once a frame of the plan has finished, with its full size before
+    VkDeviceSize          transientBytesSaved;      // transientBytesRequested - transientBytesCommitted
+};
+
+typedef std::function<void(VkCommandBuffer commandBuffer)> RenderGraphPassFunction;
+
+// Frame graph of graphics and compute passes. Every frame the passes are declared again together
+// with the resources they read and write, then compile() either reuses the plan built for the same
+// topology or builds a new one:
+//   - passes that do not contribute to an output (or have no side effects) are culled,
+//   - transient images and buffers whose lifetimes do not overlap share device memory,
+//   - transient attachments get lazily allocated memory where the device offers it,
+//   - all hazards of a pass are resolved by a single vkCmdPipelineBarrier2 recorded before it,
+//   - consecutive passes of one queue form a batch, batches of different queues are ordered
+//     with timeline semaphores, one per queue.
+// Transient resources are shared by all frames in flight, consecutive frames are ordered on the GPU.
+// Imported resources accessed from both queues must use VK_SHARING_MODE_CONCURRENT, transient ones
+// are created that way when the queues belong to different families, so no ownership transfers are needed.
+class RenderGraph
+{
+public:
+    RenderGraph();
+    ~RenderGraph();
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, QueueParameters const &graphicsQueue,
+                QueueParameters const &computeQueue, uint32_t framesInFlight);
+    void destroy();
+
+    // Routes submissions through per-queue submission threads instead of calling vkQueueSubmit2
+    // directly, nullptr restores direct submission. The submitters must outlive the graph.
+    void setQueueSubmitters(QueueSubmitter *graphicsSubmitter, QueueSubmitter *computeSubmitter);
+
+    // Starts declaring a new frame, the compiled plan and transient resources are kept
+    void reset();
+
+    RenderGraphResource createTransientImage(char const *name, RenderGraphImageDesc const &desc);
+    RenderGraphResource createTransientBuffer(char const *name, RenderGraphBufferDesc const &desc);
+    // Depth, G-buffer or MSAA attachment whose contents never leave the passes rendering to it: loaded
+    // with CLEAR or DONT_CARE and stored with DONT_CARE (or resolved). Usage may only contain attachment
+    // bits. The image gets TRANSIENT_ATTACHMENT usage and, where the device has a LAZILY_ALLOCATED
+    // memory type, memory that tile-based GPUs never need to back physically.
+    RenderGraphResource createTransientAttachment(char const *name, RenderGraphImageDesc const &desc);
+    // Imported handles may change from frame to frame (e.g. swapchain images) without invalidating the plan.
+    // finalLayout VK_IMAGE_LAYOUT_UNDEFINED leaves the image in the layout of its last use.
+    RenderGraphResource importImage(char const *name, VkImage image, VkImageView view, RenderGraphImageDesc const &desc,
+                                    VkImageLayout initialLayout, VkImageLayout finalLayout);
+    RenderGraphResource importBuffer(char const *name, VkBuffer buffer, VkDeviceSize size);
+    void markOutput(RenderGraphResource resource);
+
+    uint32_t addPass(char const *name, RenderGraphQueue queue, RenderGraphPassFunction const &function);
+    // Layout is ignored for buffers. A pass may read and write the same image only in a single layout.
+    void readResource(uint32_t pass, RenderGraphResource resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                      VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+    void writeResource(uint32_t pass, RenderGraphResource resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                       VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+    // Keeps the pass alive even when nothing reads its outputs (readbacks, queries)
+    void setSideEffects(uint32_t pass);
+
+    bool compile();
+    // External waits are added to the first batch touching an imported resource (the first batch when none
+    // does); the first such batch of the other queue waits for it. External signals are added to the last
+    // batch, which completes after all others.
+    bool execute(uint32_t frameIndex, std::vector<VkSemaphoreSubmitInfo> const &waitSemaphores,
+                 std::vector<VkSemaphoreSubmitInfo> const &signalSemaphores);
+
+    VkImage getImage(RenderGraphResource resource) const;
+    VkImageView getImageView(RenderGraphResource resource) const;
+    VkBuffer getBuffer(RenderGraphResource resource) const;
+
+    RenderGraphStats const &getStats() const;
+
+private:
+    static const uint32_t QUEUE_COUNT = static_cast<uint32_t>(RenderGraphQueue::Count);
+
+    struct ResourceAccess
+    {
+        RenderGraphResource   resource;
+        VkPipelineStageFlags2 stages;
+        VkAccessFlags2        access;
+        VkImageLayout         layout;
+        bool                  write;
+    };
+
+    struct Pass
+    {
+        std::string                 name;
+        RenderGraphQueue            queue;
+        RenderGraphPassFunction     function;
+        std::vector<ResourceAccess> accesses;
+        bool                        sideEffects;
+    };
+
+    struct Resource
+    {
+        std::string           name;
+        bool                  isImage;
+        bool                  imported;
+        bool                  output;
+        bool                  transientAttachment;
+        RenderGraphImageDesc  imageDesc;
+        RenderGraphBufferDesc bufferDesc;
+        VkImageLayout         initialLayout;
+        VkImageLayout         finalLayout;
+        VkImage               image;                // imported handles
+        VkImageView           view;
+        VkBuffer              buffer;
+    };
+
+    // Objects backing a transient resource, owned by the compiled plan
+    struct TransientObject
+    {
+        VkImage               image;
+        VkImageView           view;
+        VkBuffer              buffer;
+        VkMemoryRequirements  requirements;
+        uint32_t              firstUse;             // planned pass positions, UINT32_MAX when unused
+        uint32_t              lastUse;
+        uint32_t              block;
+        RenderGraphResource   predecessor;          // previous resource in the same memory block
+        bool                  lazy;                 // needs a lazily allocated block
+    };
+
+    struct MemoryBlock
+    {
+        VkDeviceMemory        memory;
+        VkDeviceSize          size;
+        VkDeviceSize          alignment;
+        uint32_t              memoryTypeBits;
+        uint32_t              lastUse;
+        RenderGraphResource   lastResource;
+        bool                  lazy;
+        VkDeviceSize          peakCommitment;       // lazy blocks only
+    };
+
+    struct PlannedImageBarrier
+    {
+        RenderGraphResource   resource;
+        VkImageMemoryBarrier2 barrier;              // image handle is resolved while recording
+    };
+
+    struct PlannedPass
+    {
+        uint32_t                         pass;
+        RenderGraphQueue                 queue;
+        std::vector<PlannedImageBarrier> imageBarriers;
+        VkMemoryBarrier2                 memoryBarrier;
+        std::vector<PlannedImageBarrier> finalBarriers;   // recorded after the pass
+        std::vector<uint32_t>            waitPasses;      // passes of other queues that must complete first
+    };
+
+    struct Batch
+    {
+        RenderGraphQueue      queue;
+        uint32_t              firstPass;            // index into mPlannedPasses
+        uint32_t              passCount;
+        std::vector<uint32_t> waitBatches;
+        bool                  externalWaits;        // carries the semaphores passed to execute()
+    };
+
+    struct FrameResources
+    {
+        VkCommandPool                commandPools[QUEUE_COUNT];
+        std::vector<VkCommandBuffer> commandBuffers[QUEUE_COUNT];
+        uint64_t                     completionValues[QUEUE_COUNT];
+        bool                         currentPlan;           // last executed with the plan compiled last
+    };
+
+    void addAccess(uint32_t pass, RenderGraphResource resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                   VkImageLayout layout, bool write);
+    RenderGraphQueue getExecutionQueue(RenderGraphQueue queue) const;
+    void waitIdle();
+    uint64_t computeTopologyHash() const;
+    void cullPasses();
+    bool createTransientObjects();
+    void assignTransientMemory();
+    void planBarriers();
+    void buildBatches();
+    bool allocateTransientMemory();
+    void destroyTransientObjects();
+    void queryTransientCommitment();
+    void recordBarriers(VkCommandBuffer commandBuffer, std::vector<PlannedImageBarrier> const &imageBarriers,
+                        VkMemoryBarrier2 const *memoryBarrier);
+
+    VkDevice                      mLogicalDevice;
+    DeviceCapabilities            mCapabilities;
+    QueueParameters               mQueues[QUEUE_COUNT];
+    bool                          mSharedQueue;
+    QueueSubmitter               *mSubmitters[QUEUE_COUNT];
+    VkSemaphore                   mTimelineSemaphores[QUEUE_COUNT];
+    uint64_t                      mTimelineValues[QUEUE_COUNT];
+    std::vector<FrameResources>   mFrames;
+
+    std::vector<Pass>             mPasses;
+    std::vector<Resource>         mResources;
+    bool                          mDeclarationError;
+
+    bool                          mCompiled;
+    uint64_t                      mTopologyHash;
+    std::vector<bool>             mPassAlive;
+    std::vector<PlannedPass>      mPlannedPasses;
+    std::vector<Batch>            mBatches;
+    std::vector<TransientObject>  mTransients;      // indexed by resource, only used for transient ones
+    std::vector<MemoryBlock>      mMemoryBlocks;
+
+    std::vector<VkImageMemoryBarrier2> mBarrierScratch;
+    RenderGraphStats              mStats;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "MathTypes.h"
+
+namespace VulkanSample
+{
+
+class ThreadPool;
+
+static const uint32_t INVALID_SCENE_NODE = 0xFFFFFFFFu;
+
+enum SceneNodeFlagBits : uint32_t
+{
+    SCENE_NODE_VISIBLE_BIT      = 0x00000001, // participates in culling at all
+    SCENE_NODE_STATIC_BIT       = 0x00000002, // transform never changes after creation
+    SCENE_NODE_NEVER_CULLED_BIT = 0x00000004  // always reported as visible (sky, fullscreen passes)
+};
+
+// Compact result of a culling pass. Node indices are in ascending order,
+// meshIds[i] belongs to nodes[i] so a draw path can batch without touching the scene.
+struct VisibleList
+{
+    std::vector<uint32_t> nodes;
+    std::vector<uint32_t> meshIds;
+};
+
+// Data oriented scene: every per-node property lives in its own array indexed by node id.
+// Parents are always created before their children, which makes the depth of a node
+// known at creation time and lets hierarchy updates run level by level in parallel.
+class Scene
+{
+public:
+    Scene();
+
+    void reserve(uint32_t nodeCount);
+    void clear();
+
+    uint32_t createNode(uint32_t parent, Float4x4 const &localTransform, Float4 const &localBoundingSphere,
+                        uint32_t meshId, uint32_t flags);
+    void setLocalTransform(uint32_t node, Float4x4 const &localTransform);
+    void setFlags(uint32_t node, uint32_t flags);
+
+    // Recomputes world transforms and world bounding spheres. Pass nullptr to run on the calling thread.
+    void updateTransforms(ThreadPool *threadPool);
+
+    // Fills visibleList with nodes whose world bounding sphere intersects the frustum
+    void cull(Frustum const &frustum, VisibleList &visibleList, ThreadPool *threadPool);
+
+    void setCullingKernel(CullingKernel kernel);
+    CullingKernel getCullingKernel() const;
+
+    uint32_t getNodeCount() const;
+    uint32_t getLevelCount() const;
+    std::vector<Float4x4> const &getWorldTransforms() const;
+    std::vector<uint32_t> const &getMeshIds() const;
+    // Changes whenever a static node is created, moved (itself or through an ancestor) or has its
+    // flags changed, and on clear().
+    // Keys recordings of static geometry that are reused across frames (SecondaryCommandCache).
+    uint64_t getStaticVersion() const;
+
+private:
+    void addStaticDescendant(uint32_t ancestor, int32_t delta);
+    void rebuildLevels();
+    void updateNodes(uint32_t const *nodes, uint32_t count);
+
+    // Hierarchy
+    std::vector<uint32_t>  mParents;
+    std::vector<uint32_t>  mDepths;
+
+    // Transforms
+    std::vector<Float4x4>  mLocalTransforms;
+    std::vector<Float4x4>  mWorldTransforms;
+
+    // Bounds, local (object space) and world
+    std::vector<Float4>    mLocalSpheres;
+    std::vector<float>     mWorldCenterX;
+    std::vector<float>     mWorldCenterY;
+    std::vector<float>     mWorldCenterZ;
+    std::vector<float>     mWorldRadius;
+
+    std::vector<uint32_t>  mFlags;
+    std::vector<uint32_t>  mStaticDescendants;     // static nodes below each node
+    std::vector<uint32_t>  mMeshIds;
+
+    // Nodes sorted by depth, level i is mLevelNodes[mLevelOffsets[i] .. mLevelOffsets[i + 1])
+    std::vector<uint32_t>  mLevelNodes;
+    std::vector<uint32_t>  mLevelOffsets;
+    bool                   mLevelsDirty;
+    uint64_t               mStaticVersion;
+
+    // Per chunk scratch space for culling, reused between frames
+    std::vector<std::vector<uint32_t>> mCullCandidates;
+    std::vector<std::vector<uint32_t>> mCullScratch;
+    std::vector<uint32_t>              mCullCounts;
+    CullSpheresFunction                mCullFunction;
+    CullingKernel                      mCullingKernel;
+};
+
+} // namespace VulkanSample
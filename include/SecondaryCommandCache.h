@@ -0,0 +1,115 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+// Identifies one recording of static draws. The pipeline handle changes when PipelineManager
+// swaps in an optimized variant, the scene version (Scene::getStaticVersion()) when static
+// geometry changes; either makes the cached recording stale.
+struct SecondaryCommandKey
+{
+    uint32_t              pass;
+    VkPipeline            pipeline;
+    uint64_t              sceneVersion;
+};
+
+// Dynamic rendering state the secondary command buffer is recorded for. Secondaries do not inherit
+// dynamic state, the recording sets its own viewport and scissor from the extent.
+struct SecondaryRenderingInfo
+{
+    std::vector<VkFormat> colorFormats;
+    VkFormat              depthFormat = VK_FORMAT_UNDEFINED;
+    VkFormat              stencilFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkExtent2D            extent = { 0, 0 };
+    VkRenderingFlags      flags = 0;            // of the VkRenderingInfo executing the secondaries
+};
+
+struct SecondaryCommandCacheStats
+{
+    uint32_t              entries;
+    uint32_t              frameHits;            // replayed in the current frame
+    uint32_t              frameMisses;          // recorded in the current frame
+    uint64_t              totalHits;
+    uint64_t              totalMisses;
+    float                 hitRate;              // totalHits / (totalHits + totalMisses)
+    uint64_t              invalidations;        // entries re-recorded because their key went stale
+    uint64_t              evictions;            // entries dropped after EVICTION_FRAMES unused frames
+    double                frameRecordMs;        // CPU time spent recording secondaries this frame
+    double                frameSavedMs;         // recording time of the entries replayed this frame
+    double                totalSavedMs;
+};
+
+// Records static draws once into secondary command buffers and replays them with
+// vkCmdExecuteCommands, so the per-frame recording cost follows the dynamic content only.
+// There is one entry per pass and pipeline; a lookup with a different scene version or rendering
+// info re-records it. Stale buffers are reused once no frame in flight can execute them anymore.
+//
+// The secondaries are recorded with SIMULTANEOUS_USE, since consecutive frames replay them while
+// earlier ones are still executing. A dynamic rendering instance either executes secondaries only
+// or records inline only: begin the static part with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+// and VK_RENDERING_SUSPENDING_BIT, and resume it for the dynamic draws without the contents flag.
+// Pass the static part's rendering flags in SecondaryRenderingInfo::flags, the secondaries must
+// inherit them apart from the contents flag.
+// Resources referenced by cached recordings must stay alive until invalidate() was called and
+// framesInFlight frames have passed. Call everything from the thread recording the primaries.
+class SecondaryCommandCache
+{
+public:
+    static const uint32_t EVICTION_FRAMES = 120;
+
+    SecondaryCommandCache();
+    ~SecondaryCommandCache();
+
+    bool create(VkDevice logicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight);
+    void destroy();
+
+    // Call once per frame, the GPU must have finished the frame recorded framesInFlight frames ago
+    void beginFrame();
+
+    // Replays the cached recording of key into primaryCommandBuffer, recording it first through
+    // record when the key is new or stale. record receives a begun secondary command buffer.
+    bool execute(VkCommandBuffer primaryCommandBuffer, SecondaryCommandKey const &key,
+                 SecondaryRenderingInfo const &renderingInfo, std::function<void(VkCommandBuffer)> const &record);
+
+    // Drops the recordings of a pass, or of all passes with UINT32_MAX
+    void invalidate(uint32_t pass = UINT32_MAX);
+
+    SecondaryCommandCacheStats getStats() const;
+
+private:
+    struct Entry
+    {
+        SecondaryCommandKey   key;
+        uint64_t              renderingHash;
+        VkCommandBuffer       commandBuffer;
+        double                recordMs;
+        uint64_t              lastUsedFrame;
+    };
+
+    struct RetiredCommandBuffer
+    {
+        VkCommandBuffer       commandBuffer;
+        uint64_t              frame;
+    };
+
+    bool acquireCommandBuffer(VkCommandBuffer &commandBuffer);
+    void retire(Entry const &entry);
+    bool recordEntry(Entry &entry, SecondaryRenderingInfo const &renderingInfo, std::function<void(VkCommandBuffer)> const &record);
+
+    VkDevice                                   mLogicalDevice;
+    uint32_t                                   mFramesInFlight;
+    uint64_t                                   mFrame;
+    VkCommandPool                              mCommandPool;
+    std::unordered_map<uint64_t, Entry>        mEntries;      // by pass and pipeline
+    std::vector<RetiredCommandBuffer>          mRetiredCommandBuffers;
+    std::vector<VkCommandBuffer>               mFreeCommandBuffers;
+    SecondaryCommandCacheStats                 mStats;
+};
+
+} // namespace VulkanSample
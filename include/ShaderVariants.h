@@ -0,0 +1,135 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "PipelineManager.h"
+
+namespace VulkanSample
+{
+
+// One bit per feature of a shader family, bit i enables ShaderFamilyInfo::features[i]
+typedef uint32_t ShaderFeatureKey;
+
+struct ShaderFeature
+{
+    std::string        name;            // recorded in the usage list, no whitespace
+    uint32_t           constantId;      // constant_id of a bool specialization constant
+    VkShaderStageFlags stages;          // stages reading it, the others keep sharing their libraries
+};
+
+// Pipeline state whose shaders are specialized per variant. The stages must not carry
+// specialization info of their own.
+struct ShaderFamilyInfo
+{
+    std::string                name;     // stable across runs, no whitespace
+    GraphicsPipelineState      state;
+    std::vector<ShaderFeature> features;
+};
+
+struct ShaderVariantStats
+{
+    uint32_t families;
+    uint32_t variants;                   // pipelines created, prewarmed ones included
+    uint32_t prewarmedVariants;
+    uint32_t discardedUsageEntries;      // unknown families or features, malformed lines
+    uint64_t requests;
+    uint64_t cacheHits;
+};
+
+// Shader variants specialized by feature bits instead of branching on material features at run
+// time. A variant is the family's pipeline state with every feature turned into a VkBool32
+// specialization constant; it is created through the PipelineManager on first request and found
+// by its family and (masked) key afterwards. Each stage only gets the constants it reads, so
+// variants differing in fragment features share their vertex input and pre-rasterization
+// libraries.
+// The variants a run requested are written to a usage list; the next run loads it and prewarms
+// them before they are needed, entries unused for USAGE_RETENTION_RUNS runs are dropped. Features
+// are recorded by name, reordering them in code keeps the list valid.
+// The specialization data lives here: destroy the PipelineManager first. Not thread-safe.
+class ShaderVariantCache
+{
+public:
+    static const uint32_t MAX_FEATURES         = 32;
+    static const uint32_t USAGE_RETENTION_RUNS = 8;
+
+    ShaderVariantCache();
+    ~ShaderVariantCache();
+
+    bool create(PipelineManager *pipelineManager);
+    void destroy();
+
+    bool registerFamily(ShaderFamilyInfo const &info, uint32_t &familyIndex);
+    bool findFamily(std::string const &name, uint32_t &familyIndex) const;
+
+    // Bits beyond the family's features are ignored, one material key can serve several families.
+    // pipelineIndex is the PipelineManager's.
+    bool requestVariant(uint32_t familyIndex, ShaderFeatureKey key, uint32_t &pipelineIndex);
+
+    // A missing file is not an error, nothing is prewarmed then
+    bool loadUsage(std::string const &filename);
+    // Creates up to maxVariants of the loaded variants whose families are registered by now, so
+    // warming can be spread over several frames of a loading screen
+    bool prewarm(uint32_t maxVariants, uint32_t &remaining);
+    bool saveUsage(std::string const &filename) const;
+
+    ShaderVariantStats getStats() const;
+
+private:
+    struct StageSpecialization
+    {
+        std::vector<VkSpecializationMapEntry> mapEntries;
+        std::vector<uint32_t>                 features;     // feature index of every map entry
+    };
+
+    struct Family
+    {
+        ShaderFamilyInfo                 info;
+        ShaderFeatureKey                 featureMask;
+        std::vector<StageSpecialization> stages;            // pre-rasterization stages, then fragment
+    };
+
+    struct Variant
+    {
+        uint32_t                          family;
+        ShaderFeatureKey                  key;
+        uint32_t                          pipelineIndex;
+        bool                              used;             // requested in this run
+        std::vector<std::vector<VkBool32>> values;          // per stage
+        std::vector<VkSpecializationInfo> specializations;  // per stage
+    };
+
+    struct UsageEntry
+    {
+        uint32_t                 runsSinceUse;
+        std::string              family;
+        std::vector<std::string> features;                  // sorted
+    };
+
+    bool createVariant(uint32_t familyIndex, ShaderFeatureKey key, uint32_t &variantIndex);
+    bool resolveUsage(UsageEntry const &entry, uint32_t &familyIndex, ShaderFeatureKey &key) const;
+    std::string getUsageLine(uint32_t familyIndex, ShaderFeatureKey key) const;
+
+    PipelineManager                         *mPipelineManager;
+    std::deque<Family>                       mFamilies;     // map entries must not move
+    std::unordered_map<std::string, uint32_t> mFamilyLookup;
+    std::deque<Variant>                      mVariants;     // specialization data must not move
+    std::unordered_map<uint64_t, uint32_t>   mVariantLookup;
+    std::vector<UsageEntry>                  mUsage;
+    size_t                                   mPrewarmCursor;
+    ShaderVariantStats                       mStats;
+};
+
+// Features of material_variants.frag
+enum MaterialFeature : ShaderFeatureKey
+{
+    MATERIAL_FEATURE_LIGHTING           = 1u << 0,
+    MATERIAL_FEATURE_CHECKER            = 1u << 1,
+    MATERIAL_FEATURE_HEMISPHERE_AMBIENT = 1u << 2,
+    MATERIAL_FEATURE_HEIGHT_FOG         = 1u << 3
+};
+
+std::vector<ShaderFeature> getMaterialFeatures();
+
+} // namespace VulkanSample
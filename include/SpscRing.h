@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace VulkanSample
+{
+
+// Bounded single-producer single-consumer ring. push() only from the producer thread, pop() only
+// from the consumer thread; neither ever blocks or allocates. The indices grow monotonically and
+// live on separate cache lines, so producer and consumer do not share a line they both write.
+template<typename Type>
+class SpscRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+    {
+        size_t size = 1;
+        while(size < capacity)
+            size <<= 1;
+        mItems.resize(size);
+        mMask = size - 1;
+        mHead.store(0);
+        mTail.store(0);
+    }
+
+    SpscRing(SpscRing const &) = delete;
+    SpscRing &operator=(SpscRing const &) = delete;
+
+    // false when the ring is full
+    bool push(Type const &value)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        if(head - mTail.load(std::memory_order_acquire) > mMask)
+            return false;
+
+        mItems[head & mMask] = value;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(Type &value)
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        if(tail == mHead.load(std::memory_order_acquire))
+            return false;
+
+        value = mItems[tail & mMask];
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called while the other side is active
+    size_t size() const
+    {
+        return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return mMask + 1;
+    }
+
+private:
+    std::vector<Type>           mItems;
+    size_t                      mMask;
+    alignas(64) std::atomic<size_t> mHead;   // next slot to write, owned by the producer
+    alignas(64) std::atomic<size_t> mTail;   // next slot to read, owned by the consumer
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace VulkanSample
+{
+
+// Wall clock stages of application start-up. Stages may be recorded from any thread but must not
+// nest on one thread. The report compares the sum of all stage durations, i.e. the time a serial
+// start-up would take, with the time start-up actually took; the difference is what overlapping saved.
+class StartupTimeline
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    StartupTimeline();
+
+    void record(std::string const &stage, Clock::time_point begin, Clock::time_point end);
+    // Marks the end of start-up, time is measured from construction
+    void finish();
+    void print(std::ostream &stream) const;
+
+private:
+    struct Stage
+    {
+        std::string name;
+        uint32_t    thread;
+        double      begin;                  // milliseconds since construction
+        double      duration;
+    };
+
+    double toMilliseconds(Clock::duration duration) const;
+
+    mutable std::mutex            mMutex;
+    Clock::time_point             mOrigin;
+    Clock::time_point             mFinish;
+    bool                          mFinished;
+    std::vector<Stage>            mStages;
+    std::vector<std::thread::id>  mThreads;           // index is the thread number in the report
+};
+
+class StartupStage
+{
+public:
+    StartupStage(StartupTimeline &timeline, char const *name)
+    {
+        mTimeline = &timeline;
+        mName     = name;
+        mBegin    = StartupTimeline::Clock::now();
+    }
+
+    ~StartupStage()
+    {
+        mTimeline->record(mName, mBegin, StartupTimeline::Clock::now());
+    }
+
+    StartupStage(StartupStage const &) = delete;
+    StartupStage &operator=(StartupStage const &) = delete;
+
+private:
+    StartupTimeline                  *mTimeline;
+    char const                       *mName;
+    StartupTimeline::Clock::time_point mBegin;
+};
+
+} // namespace VulkanSample
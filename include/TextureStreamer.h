@@ -0,0 +1,133 @@
+#pragma once
+
+#include <memory>
+
+#include "Common.h"
+#include "DescriptorBinder.h"
+#include "FrameRingAllocator.h"
+#include "Ktx2File.h"
+#include "TextureTranscoding.h"
+
+namespace VulkanSample
+{
+
+// Block compressed family the device samples best, assets should be built for it
+enum class CompressedFormatFamily
+{
+    BC,          // BC1-BC7, desktop GPUs
+    ASTC,        // ASTC LDR, most mobile GPUs
+    ETC2,        // ETC2/EAC, guaranteed by older mobile GPUs
+    None         // only uncompressed formats
+};
+
+struct TextureStreamerStats
+{
+    uint32_t              textures;
+    uint32_t              pendingLevels;       // stored levels not uploaded yet
+    uint64_t              uploadedBytes;       // copied from staging memory since create()
+    uint64_t              expandedBytes;       // of RGB8 data expanded to RGBA8 on the CPU
+    uint32_t              generatedMipChains;
+};
+
+// Streams 2D KTX2 textures into device local images. Every frame a fixed staging budget is
+// filled from a FrameRingAllocator, always with the coarsest level still missing across all
+// textures, so a texture becomes usable after its smallest level arrived and sharpens from there;
+// large levels are split by block rows over several frames. Textures stored without mips get
+// their chain from mip_downsample.comp, which builds all levels in one dispatch. Block compressed
+// formats are uploaded as stored, so they must carry their own mips and be supported by the device.
+// ETC1S files are transcoded level by level to BC7, ASTC or ETC2, whichever the device samples
+// best, and to RGBA8 on devices without any of them.
+// Not thread-safe, use from the recording thread.
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight,
+                VkDeviceSize stagingBytesPerFrame, VkPipelineCache pipelineCache);
+    void destroy();
+
+    // Maps the file and creates the image, data is uploaded by recordStreaming()
+    bool loadTexture(std::string const &filename, uint32_t &textureIndex);
+
+    // Records this frame's uploads, mip generation and layout transitions. Call once per frame
+    // before commands sampling the textures; the GPU must have finished the frame that last
+    // used frameIndex.
+    bool recordStreaming(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // VK_NULL_HANDLE until the first level is resident. The view changes whenever a finer level
+    // arrives, descriptors must be written again; old views stay valid for framesInFlight frames.
+    VkImageView getImageView(uint32_t textureIndex) const;
+    // Finest resident level, the image's level count while nothing is resident
+    uint32_t getResidentMipLevel(uint32_t textureIndex) const;
+
+    CompressedFormatFamily getCompressedFormatFamily() const;
+    static char const *getCompressedFormatFamilyName(CompressedFormatFamily family);
+    TextureStreamerStats const &getStats() const;
+
+private:
+    struct Texture
+    {
+        Ktx2File                  file;
+        VkFormat                  format;
+        FormatBlockInfo           sourceBlock;     // of the file data
+        FormatBlockInfo           uploadBlock;     // of the image data
+        bool                      expand;          // RGB8 stored, RGBA8 uploaded
+        bool                      generateMips;
+        uint32_t                  width;
+        uint32_t                  height;
+        uint32_t                  levelCount;      // of the image
+        VkImage                   image;
+        VkDeviceMemory            memory;
+        VkImageView               view;
+        bool                      initialized;     // all levels transitioned to TRANSFER_DST_OPTIMAL
+        uint32_t                  residentLevel;   // finest uploaded level, levelCount when none
+        uint32_t                  uploadLevel;     // level being uploaded
+        uint32_t                  uploadedRows;    // block rows of uploadLevel already copied
+        uint8_t const            *levelData;       // of uploadLevel, nullptr until fetched
+        std::vector<uint8_t>      levelScratch;    // decompressed uploadLevel
+    };
+
+    struct RetiredView
+    {
+        VkImageView               view;
+        uint64_t                  frame;
+        bool                      storage;         // referenced by descriptor sets of the binder
+    };
+
+    bool createDownsamplePipeline(VkPipelineCache pipelineCache);
+    Texture *selectUpload();
+    bool recordUpload(VkCommandBuffer commandBuffer, Texture &texture, VkDeviceSize &budget);
+    bool recordMipGeneration(VkCommandBuffer commandBuffer, Texture &texture);
+    bool finishLevel(VkCommandBuffer commandBuffer, Texture &texture);
+    void recordLevelTransition(VkCommandBuffer commandBuffer, Texture const &texture, uint32_t baseLevel,
+                               uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout);
+    void retireView(VkImageView view, bool storage);
+    VkDeviceSize getUploadRowSize(Texture const &texture, uint32_t level) const;
+    BasisTarget selectBasisTarget(bool alpha) const;
+
+    VkDevice                                 mLogicalDevice;
+    DeviceCapabilities                       mCapabilities;
+    uint32_t                                 mFramesInFlight;
+    uint64_t                                 mFrame;
+    TranscodeKernel                          mKernel;
+    CompressedFormatFamily                   mCompressedFormatFamily;
+    bool                                     mMipGenerationSupported;
+    FrameRingAllocator                       mStaging;
+    VkDeviceSize                             mStagingBytesPerFrame;
+    std::vector<std::unique_ptr<Texture>>    mTextures;
+    std::vector<RetiredView>                 mRetiredViews;
+
+    DescriptorBinder                         mDescriptorBinder;
+    uint32_t                                 mDownsampleLayoutIndex;
+    VkPipelineLayout                         mDownsamplePipelineLayout;
+    VkPipeline                               mDownsamplePipeline;
+    VkBuffer                                 mCounterBuffer;
+    VkDeviceMemory                           mCounterMemory;
+    bool                                     mCounterInitialized;
+
+    TextureStreamerStats                     mStats;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+enum class TranscodeKernel
+{
+    Scalar,
+    SSSE3,
+    NEON
+};
+
+// Texel block footprint of the formats the texture streamer uploads
+struct FormatBlockInfo
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes;
+};
+
+bool getFormatBlockInfo(VkFormat format, FormatBlockInfo &blockInfo);
+size_t getLevelByteSize(FormatBlockInfo const &blockInfo, uint32_t width, uint32_t height);
+
+// Three channel 8-bit formats are rarely sampleable, they are expanded to four channels on upload.
+// Returns VK_FORMAT_UNDEFINED for formats that need no expansion.
+VkFormat getExpandedFormat(VkFormat format);
+
+// Picks the widest kernel supported by the compiler and the running CPU
+TranscodeKernel selectTranscodeKernel();
+char const *getTranscodeKernelName(TranscodeKernel kernel);
+
+// destination receives pixelCount RGBA texels with alpha 255
+void expandRGB8ToRGBA8(TranscodeKernel kernel, uint8_t const *source, uint8_t *destination, size_t pixelCount);
+
+// ETC1S block helpers. Selectors are the 2-bit selectors of the 16 texels of a 4x4 block, one per
+// byte in raster order; a palette is the four RGBA8 colors a selector picks from.
+
+// Writes the block's texels to four rows rowPitch bytes apart. With an alphaPalette the alpha of
+// every texel is the green channel of the color its alpha selector picks, otherwise the palette's.
+void decodeSelectorBlock(TranscodeKernel kernel, uint8_t const *palette, uint8_t const *selectors,
+                         uint8_t const *alphaPalette, uint8_t const *alphaSelectors, uint8_t *destination,
+                         size_t rowPitch);
+// Maps the selectors through remap (four 3-bit indices) and packs them in EAC order: texels by
+// column, the first one in the top bits of the 48-bit result
+uint64_t packEacSelectors(TranscodeKernel kernel, uint8_t const *remap, uint8_t const *selectors);
+
+} // namespace VulkanSample
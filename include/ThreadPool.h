@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VulkanSample
+{
+
+class ThreadPool
+{
+public:
+    // threadCount == 0 picks std::thread::hardware_concurrency() - 1 workers
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Splits [0, count) into chunks of grainSize and runs body(begin, end) on the workers
+    // and the calling thread. Returns once every chunk has finished.
+    void parallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t, uint32_t)> const &body);
+
+    uint32_t getThreadCount() const;
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread>          mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex                        mMutex;
+    std::condition_variable           mCondition;
+    bool                              mStopping;
+};
+
+} // namespace VulkanSample
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "Common.h"
+#include "Ktx2File.h"
+#include "MpscQueue.h"
+
+namespace VulkanSample
+{
+
+class ThreadPool;
+
+struct VirtualTextureParameters
+{
+    uint32_t cachePages;                // physical pages: page cache slots or sparse memory blocks
+    uint32_t maxUploadsPerFrame;        // pages copied to the GPU per frame
+    uint32_t maxPendingLoads;           // pages being read by the I/O threads or waiting for their upload
+    bool     forcePageCache;            // use the indirection page cache even where sparse residency works
+};
+
+struct VirtualTextureStats
+{
+    bool     sparse;
+    uint32_t virtualPages;              // over all levels
+    uint32_t residentPages;
+    uint32_t requestedPages;            // by the latest feedback read back
+    uint32_t pendingLoads;
+    uint64_t loadedPages;
+    uint64_t evictedPages;
+    uint64_t deferredRequests;          // missing pages left for a later frame by the load budget
+    uint32_t failedPages;               // could not be read, served by their ancestors
+};
+
+// Virtual texturing for RGBA8 KTX2 textures larger than device memory. The texture is split into
+// PAGE_SIZE x PAGE_SIZE texel pages on every level and only the pages the GPU actually samples
+// are kept resident:
+//  - with sparseResidencyImage2D the pages are bound into a sparse image out of a fixed pool of
+//    page memory, the mip tail stays bound all the time
+//  - otherwise they are copied into slots of a page cache image, each with a PAGE_BORDER texel
+//    border for bilinear filtering
+// In both cases a page table maps every virtual page to its finest resident ancestor, and
+// virtual_texture.frag records the pages it wanted in a feedback buffer (one pixel of every 4x4
+// block per frame, rotating). That feedback is read back when the frame slot comes around again.
+// Missing pages are queued coarse levels first and read on the I/O threads into staging slots;
+// at most maxUploadsPerFrame of them are copied per frame. When the pool runs out, the page used
+// least recently is evicted, its slot is reused once no frame in flight can still sample it.
+// Pages whose level cannot be read are not requested again, their ancestors stay in place.
+//
+// Per frame, on the graphics queue:
+//   recordUpdate()          outside of a render pass, before the passes sampling the texture
+//   ... passes binding getDescriptorSet(frameIndex) for virtual_texture.frag
+//   recordFeedbackResolve() outside of a render pass, after them
+//   submitSparseBinds()     sparse only, before submitting the command buffer, which must wait
+//                           for the semaphore value
+// Requires fragmentStoresAndAtomics and synchronization2 with timeline semaphores. Call
+// everything from the recording thread.
+class VirtualTexture
+{
+public:
+    static const uint32_t PAGE_SIZE   = 128;    // the standard sparse block of 32-bit texels
+    static const uint32_t PAGE_BORDER = 4;      // page cache only
+    static const uint32_t MAX_LEVELS  = 16;
+
+    VirtualTexture();
+    ~VirtualTexture();
+
+    static bool isSupported(DeviceCapabilities const &capabilities);
+    static VirtualTextureParameters getDefaultParameters();
+
+    // Without I/O threads the pages are read on the calling thread during recordUpdate
+    bool create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight,
+                std::string const &filename, VirtualTextureParameters const &parameters, ThreadPool *ioThreads);
+    void destroy();
+
+    bool usesSparseResidency() const;
+    // Combined image sampler, page table and feedback buffer for the fragment stage
+    VkDescriptorSetLayout getDescriptorSetLayout() const;
+    VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+
+    // The GPU must have finished the frame recorded framesInFlight frames ago
+    bool recordUpdate(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void recordFeedbackResolve(VkCommandBuffer commandBuffer);
+    // Sparse residency only: binds the pages uploaded by the latest recordUpdate and unbinds
+    // released ones. Always signals the timeline semaphore, even when there is nothing to bind.
+    bool submitSparseBinds(VkQueue queue, VkSemaphore timelineSemaphore, uint64_t signalValue);
+
+    VirtualTextureStats getStats() const;
+
+private:
+    static const uint32_t NO_SLOT   = 0xFFFFFFFF;
+    static const uint32_t TAIL_SLOT = 0xFFFFFFFE;   // sparse mip tail, always bound
+
+    enum class PageState : uint8_t
+    {
+        Missing,
+        Loading,
+        Resident,
+        Failed                              // its level could not be read, never requested again
+    };
+
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t pagesX;
+        uint32_t pagesY;
+        uint32_t firstPage;                 // index of its first page among all pages
+    };
+
+    // Level data shared by the I/O threads, decompressed once when stored supercompressed
+    struct LevelSource
+    {
+        std::once_flag          once;
+        bool                    valid;
+        std::vector<uint8_t>    scratch;
+        uint8_t const          *data;
+    };
+
+    struct Page
+    {
+        PageState state;
+        bool      pinned;                   // coarsest pages, never evicted
+        uint32_t  slot;
+        uint64_t  lastRequested;            // frame, stops walking up to ancestors visited already
+        uint32_t  evictions;                // tells a retirement of an earlier residency from the latest
+    };
+
+    // Physical page, linked into the LRU list while it holds an evictable page
+    struct Slot
+    {
+        uint32_t page;
+        uint32_t previous;
+        uint32_t next;
+        uint64_t lastUsed;
+    };
+
+    struct RetiredSlot
+    {
+        uint32_t slot;
+        uint32_t page;                      // sparse: region to unbind
+        uint32_t evictions;                 // of the page when it was evicted
+        uint64_t frame;
+    };
+
+    struct LoadResult
+    {
+        uint32_t page;
+        uint32_t stagingSlot;
+        bool     success;
+    };
+
+    struct FrameSlot
+    {
+        VkBuffer        tableBuffer;
+        VkDeviceMemory  tableMemory;
+        uint32_t       *tableData;
+        uint64_t        tableVersion;
+        VkBuffer        readbackBuffer;
+        VkDeviceMemory  readbackMemory;
+        uint32_t const *readbackData;
+        bool            resolved;           // recordFeedbackResolve was recorded for the slot
+        VkDescriptorSet descriptorSet;
+    };
+
+    bool createSparseImage(DeviceCapabilities const &capabilities);
+    void destroySparseImage();
+    bool createCacheImage(DeviceCapabilities const &capabilities);
+    bool createFrameSlots(DeviceCapabilities const &capabilities, uint32_t framesInFlight);
+    bool createDescriptors();
+    uint32_t getPageLevel(uint32_t page) const;
+    uint32_t getParentPage(uint32_t page) const;
+    void getPageRegion(uint32_t page, uint32_t &level, VkOffset3D &offset, VkExtent3D &extent) const;
+    bool getLevelSource(uint32_t level, uint8_t const *&data);
+    void readFeedback(FrameSlot &slot, std::vector<uint32_t> &missing);
+    void requestPage(uint32_t page, std::vector<uint32_t> &missing);
+    void linkSlot(uint32_t slot);
+    void unlinkSlot(uint32_t slot);
+    void releaseRetiredSlots();
+    bool collectLoadResults();
+    void queueLoads(std::vector<uint32_t> &missing);
+    void loadPage(uint32_t page, uint32_t stagingSlot);
+    void evictAhead();
+    bool recordInitialization(VkCommandBuffer commandBuffer);
+    void recordUploads(VkCommandBuffer commandBuffer);
+    void recordImageTransition(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+    void rebuildPageTable();
+
+    VkDevice                         mLogicalDevice;
+    VirtualTextureParameters         mParameters;
+    uint32_t                         mFramesInFlight;
+    ThreadPool                      *mIoThreads;
+    Ktx2File                         mFile;
+    uint32_t                         mWidth;
+    uint32_t                         mHeight;
+    std::vector<Level>               mLevels;
+    std::unique_ptr<LevelSource[]>   mLevelSources;
+    bool                             mSparse;
+    uint32_t                         mMipTailFirstLevel;     // level count without a mip tail
+    uint32_t                         mPinnedLevel;           // pages from here on are never evicted
+    uint64_t                         mFrame;
+    uint32_t                         mFrameIndex;
+
+    VkImage                          mImage;
+    uint32_t                         mImageLevelCount;
+    VkDeviceMemory                   mImageMemory;           // cache image, or sparse page pool
+    VkDeviceMemory                   mMipTailMemory;
+    VkDeviceSize                     mSparsePageBytes;
+    VkSparseMemoryBind               mMipTailBind;
+    bool                             mMipTailBound;
+    VkImageView                      mImageView;
+    VkSampler                        mSampler;
+    bool                             mImageInitialized;
+    uint32_t                         mSlotsPerRow;           // page cache
+
+    std::vector<Page>                mPages;
+    std::vector<Slot>                mSlots;
+    uint32_t                         mLruHead;               // least recently used
+    uint32_t                         mLruTail;
+    std::vector<uint32_t>            mFreeSlots;
+    std::deque<RetiredSlot>          mRetiredSlots;
+    std::vector<VkSparseImageMemoryBind> mPendingBinds;
+
+    VkBuffer                         mStagingBuffer;
+    VkDeviceMemory                   mStagingMemory;
+    uint8_t                         *mStagingData;
+    VkDeviceSize                     mStagingSlotBytes;
+    VkDeviceSize                     mTailStagingOffset;     // sparse mip tail levels, uploaded once
+    std::vector<uint32_t>            mFreeStagingSlots;
+    std::deque<std::pair<uint32_t, uint64_t>> mRetiredStagingSlots;
+    MpscQueue<LoadResult>            mLoadResults;
+    std::deque<LoadResult>           mLoadedPages;          // waiting for their upload
+    std::mutex                       mMutex;
+    std::condition_variable          mCondition;
+    uint32_t                         mPendingLoads;         // loadPage calls still running, guarded by mMutex
+
+    std::vector<uint32_t>            mPageTable;
+    uint64_t                         mPageTableVersion;
+    bool                             mPageTableDirty;
+    VkBuffer                         mFeedbackBuffer;        // one bit per page
+    VkDeviceMemory                   mFeedbackMemory;
+    VkDeviceSize                     mFeedbackBytes;
+    std::vector<FrameSlot>           mFrameSlots;
+
+    VkDescriptorSetLayout            mDescriptorSetLayout;
+    VkDescriptorPool                 mDescriptorPool;
+
+    VirtualTextureStats              mStats;
+};
+
+} // namespace VulkanSample
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <future>
+
 #include "Common.h"
+#include "StartupTimeline.h"
+#include "WindowEventQueue.h"
 
 namespace VulkanSample
 {
@@ -10,17 +14,48 @@ class VulkanApp
 public:
     VulkanApp();
     ~VulkanApp();
+
+    // Starts loading Vulkan, creating the instance and probing physical devices on a worker thread
+    // and reading the pipeline cache on another, so the caller can create the window meanwhile.
+    // init() calls it when it was not called before.
+    void startInit();
     bool init(WindowParameters windowParameters);
 
+    // Body of the render thread: takes the window events once per frame and renders until a quit
+    // event arrives. Never waits for the thread running the window's message pump.
+    void runRenderLoop(WindowEventQueue &events);
+
+    StartupTimeline &getStartupTimeline();
+
 private:
-    LIBRARY_TYPE     mVkLibrary;
-    VkInstance       mInstance;
-    VkSurfaceKHR     mSurface;
-    VkDevice         mLogicalDevice;
-    QueueParameters  mGraphicsQueue;
-    QueueParameters  mComputeQueue;
-    QueueParameters  mPresentQueue;
-    VkSwapchainKHR   mSwapchain;
+    bool createInstanceStage();
+    void probePhysicalDevice(VkPhysicalDevice physicalDevice, PhysicalDeviceProbe &probe);
+    // Returns false on quit
+    bool handleWindowEvents(std::vector<WindowEvent> const &events);
+
+    LIBRARY_TYPE                      mVkLibrary;
+    VkInstance                        mInstance;
+    VkSurfaceKHR                      mSurface;
+    VkDevice                          mLogicalDevice;
+    QueueParameters                   mGraphicsQueue;
+    QueueParameters                   mComputeQueue;
+    QueueParameters                   mPresentQueue;
+    VkSwapchainKHR                    mSwapchain;
+    VkPipelineCache                   mPipelineCache;
+    DeviceCapabilities                mDeviceCapabilities;
+
+    // Window state as seen by the render thread
+    VkExtent2D                        mWindowExtent;
+    bool                              mSwapchainOutOfDate;
+    int32_t                           mMouseX;
+    int32_t                           mMouseY;
+    bool                              mMouseButtons[2];
+    float                             mMouseWheel;        // notches since the last frame
+
+    std::vector<PhysicalDeviceProbe>  mPhysicalDevices;
+    std::future<bool>                 mInstanceStage;
+    std::future<std::vector<unsigned char>> mPipelineCacheData;
+    StartupTimeline                   mStartupTimeline;
 };
 
 } //namespace VulkanSample
@@ -10,6 +10,8 @@ namespace VulkanSample
 #define INSTANCE_LEVEL_VULKAN_FUNCTION(name) extern PFN_##name name;
 #define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension) extern PFN_##name name;
 #define DEVICE_LEVEL_VULKAN_FUNCTION(name) extern PFN_##name name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(name) extern PFN_##name name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(name, version) extern PFN_##name name;
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension) extern PFN_##name name;
 
 #include "ListOfVulkanFunctions.inl"
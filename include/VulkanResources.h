@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+namespace VulkanSample
+{
+
+bool getBinaryFileContents(std::string const &filename, std::vector<unsigned char> &contents);
+std::string getShaderPath(char const *shaderName);
+
+bool selectMemoryType(VkPhysicalDeviceMemoryProperties const &memoryProperties, uint32_t memoryTypeBits,
+                      VkMemoryPropertyFlags desiredProperties, uint32_t &memoryTypeIndex);
+
+// With more than one distinct queue family the buffer is created with VK_SHARING_MODE_CONCURRENT
+bool createBuffer(VkDevice logicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer,
+                  std::vector<uint32_t> const &queueFamilies = {});
+bool allocateAndBindMemoryObjectToBuffer(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                                         VkBuffer buffer, VkMemoryPropertyFlags memoryObjectProperties,
+                                         VkDeviceMemory &memoryObject, VkMemoryAllocateFlags allocateFlags = 0);
+// Creates a host visible buffer and copies data into it
+bool createHostVisibleBuffer(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                             VkDeviceSize size, VkBufferUsageFlags usage, void const *data,
+                             VkBuffer &buffer, VkDeviceMemory &memoryObject);
+// Requires the bufferDeviceAddress feature, the buffer gets SHADER_DEVICE_ADDRESS usage and its memory
+// is allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+bool createDeviceAddressBuffer(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                               VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryObjectProperties,
+                               VkBuffer &buffer, VkDeviceMemory &memoryObject, VkDeviceAddress &deviceAddress,
+                               std::vector<uint32_t> const &queueFamilies = {});
+VkDeviceAddress getBufferDeviceAddress(VkDevice logicalDevice, VkBuffer buffer);
+
+// Checks the optimal tiling features of a format
+bool isFormatFeatureSupported(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatFeatureFlags features);
+bool allocateAndBindMemoryObjectToImage(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                                        VkImage image, VkMemoryPropertyFlags memoryObjectProperties,
+                                        VkDeviceMemory &memoryObject);
+// Color view of a 2D image covering levelCount mip levels starting at baseMipLevel
+bool createImageView(VkDevice logicalDevice, VkImage image, VkFormat format, uint32_t baseMipLevel, uint32_t levelCount,
+                     VkImageView &imageView);
+// Sampler without anisotropy or comparison, mip levels use the same filter as magnification
+bool createSampler(VkDevice logicalDevice, VkFilter filter, VkSamplerAddressMode addressMode, VkSampler &sampler);
+
+bool createShaderModule(VkDevice logicalDevice, std::vector<unsigned char> const &sourceCode, VkShaderModule &shaderModule);
+bool createShaderModuleFromFile(VkDevice logicalDevice, char const *shaderName, VkShaderModule &shaderModule);
+bool createComputePipeline(VkDevice logicalDevice, VkShaderModule shaderModule, VkPipelineLayout pipelineLayout,
+                           VkSpecializationInfo const *specializationInfo, VkPipelineCache pipelineCache,
+                           VkPipeline &computePipeline);
+
+// A missing file is not an error, the cache then starts empty
+bool loadPipelineCacheData(std::string const &filename, std::vector<unsigned char> &data);
+// Data written by another driver or device is dropped instead of being handed to the driver
+bool createPipelineCache(VkDevice logicalDevice, VkPhysicalDeviceProperties const &properties,
+                         std::vector<unsigned char> const &initialData, VkPipelineCache &pipelineCache);
+bool savePipelineCache(VkDevice logicalDevice, VkPipelineCache pipelineCache, std::string const &filename);
+
+void destroyBuffer(VkDevice logicalDevice, VkBuffer &buffer);
+void destroyImage(VkDevice logicalDevice, VkImage &image);
+void destroyImageView(VkDevice logicalDevice, VkImageView &imageView);
+void destroySampler(VkDevice logicalDevice, VkSampler &sampler);
+void freeMemoryObject(VkDevice logicalDevice, VkDeviceMemory &memoryObject);
+void destroyShaderModule(VkDevice logicalDevice, VkShaderModule &shaderModule);
+void destroyPipeline(VkDevice logicalDevice, VkPipeline &pipeline);
+void destroyPipelineLayout(VkDevice logicalDevice, VkPipelineLayout &pipelineLayout);
+void destroyDescriptorSetLayout(VkDevice logicalDevice, VkDescriptorSetLayout &descriptorSetLayout);
+void destroyDescriptorPool(VkDevice logicalDevice, VkDescriptorPool &descriptorPool);
+void destroyPipelineCache(VkDevice logicalDevice, VkPipelineCache &pipelineCache);
+
+} // namespace VulkanSample
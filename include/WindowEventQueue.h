@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "SpscRing.h"
+
+namespace VulkanSample
+{
+
+enum class WindowEventType : uint32_t
+{
+    Resize,
+    Quit,
+    MouseMove,
+    MouseClick,
+    MouseWheel
+};
+
+struct WindowEvent
+{
+    WindowEventType       type;
+    int32_t               x;            // MouseMove: position in the client area
+    int32_t               y;
+    uint32_t              width;        // Resize: client area, 0 x 0 while minimized
+    uint32_t              height;
+    uint32_t              button;       // MouseClick: 0 left, 1 right
+    bool                  pressed;
+    float                 wheelDelta;   // MouseWheel: in notches, positive away from the user
+};
+
+struct WindowEventStats
+{
+    uint64_t              posted;
+    uint64_t              merged;       // mouse moves and resizes folded into a later one
+    uint64_t              dropped;      // the ring was full, only possible while the consumer stalls
+};
+
+// Carries window events from the thread that runs the OS message pump to the render thread, so
+// neither waits for the other: a window being dragged or resized or a burst of input messages
+// never holds up frame submission, and a long frame never blocks the pump.
+//
+// Mouse moves and resizes are only state updates. The producer keeps the latest one pending and
+// pushes it with flush() at the end of each batch of OS messages; the consumer folds consecutive
+// ones together again, so a frame sees at most one move between two clicks. Other events keep
+// their order relative to them. A quit is additionally latched in a flag and can never be lost.
+class WindowEventQueue
+{
+public:
+    static const uint32_t CAPACITY = 1024;
+
+    WindowEventQueue();
+
+    // Producer (OS message pump thread)
+    void post(WindowEvent const &event);
+    void flush();
+
+    // Consumer (render thread), once per frame: appends the events that arrived since the last call
+    void poll(std::vector<WindowEvent> &events);
+    bool isQuitRequested() const;
+
+    WindowEventStats getStats() const;
+
+private:
+    bool push(WindowEvent const &event);
+
+    SpscRing<WindowEvent>  mRing;
+
+    // Owned by the producer
+    WindowEvent            mPendingMove;
+    WindowEvent            mPendingResize;
+    bool                   mMovePending;
+    bool                   mResizePending;
+
+    std::atomic<bool>      mQuitRequested;
+    bool                   mQuitDelivered;    // owned by the consumer
+    std::atomic<uint64_t>  mPosted;
+    std::atomic<uint64_t>  mMerged;
+    std::atomic<uint64_t>  mDropped;
+};
+
+} // namespace VulkanSample
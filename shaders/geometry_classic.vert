@@ -0,0 +1,27 @@
+#version 460
+
+// Fixed-function vertex input counterpart of geometry_pull.vert, used by VertexPullingBenchmark.
+// Every vertex layout needs its own pipeline and every mesh its own vertex buffer binding.
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(push_constant) uniform DrawConstants
+{
+  mat4 viewProjection;
+  mat4 model;
+};
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) out vec3 outWorldPosition;
+
+void main()
+{
+  vec4 worldPosition = model * vec4(inPosition, 1.0);
+  gl_Position = viewProjection * worldPosition;
+  outNormal = mat3(model) * inNormal;
+  outTexCoord = inTexCoord;
+  outWorldPosition = worldPosition.xyz;
+}
@@ -0,0 +1,84 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Vertex pulling for GeometryPool: there is no vertex input, the shader reads the vertex from the
+// mesh's range of the shared vertex buffer through its device address, in whatever layout the
+// mesh table describes. firstInstance of each indirect draw selects its instance record.
+
+const uint ATTRIBUTE_ABSENT = 0xFFFFFFFFu;    // VertexLayout::ABSENT
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexWords
+{
+  uint words[];
+};
+
+struct Mesh
+{
+  VertexWords vertices;
+  uint        strideWords;
+  uint        positionWord;
+  uint        normalWord;
+  uint        texCoordWord;
+};
+
+struct Instance
+{
+  mat4 model;
+  uint mesh;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer Meshes
+{
+  Mesh meshes[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer Instances
+{
+  Instance instances[];
+};
+
+layout(push_constant) uniform DrawConstants
+{
+  mat4      viewProjection;
+  Instances instanceTable;
+  Meshes    meshTable;
+};
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) out vec3 outWorldPosition;
+
+float readFloat(Mesh mesh, uint word)
+{
+  return uintBitsToFloat(mesh.vertices.words[word]);
+}
+
+void main()
+{
+  Instance instance = instanceTable.instances[gl_InstanceIndex];
+  Mesh mesh = meshTable.meshes[instance.mesh];
+  uint base = uint(gl_VertexIndex) * mesh.strideWords;
+
+  uint word = base + mesh.positionWord;
+  vec3 position = vec3(readFloat(mesh, word), readFloat(mesh, word + 1), readFloat(mesh, word + 2));
+
+  vec3 normal = vec3(0.0, 0.0, 1.0);
+  if(mesh.normalWord != ATTRIBUTE_ABSENT)
+  {
+    word = base + mesh.normalWord;
+    normal = vec3(readFloat(mesh, word), readFloat(mesh, word + 1), readFloat(mesh, word + 2));
+  }
+
+  vec2 texCoord = vec2(0.0);
+  if(mesh.texCoordWord != ATTRIBUTE_ABSENT)
+  {
+    word = base + mesh.texCoordWord;
+    texCoord = vec2(readFloat(mesh, word), readFloat(mesh, word + 1));
+  }
+
+  vec4 worldPosition = instance.model * vec4(position, 1.0);
+  gl_Position = viewProjection * worldPosition;
+  outNormal = mat3(instance.model) * normal;
+  outTexCoord = texCoord;
+  outWorldPosition = worldPosition.xyz;
+}
@@ -0,0 +1,47 @@
+#version 460
+
+// Material shading for ShaderVariantCache. Every feature is a bool specialization constant, so a
+// variant compiles without the code of its disabled features instead of branching over it per
+// fragment. The constant_ids follow getMaterialFeatures() in ShaderVariants.h.
+
+layout(constant_id = 0) const bool FEATURE_LIGHTING           = false;
+layout(constant_id = 1) const bool FEATURE_CHECKER            = false;
+layout(constant_id = 2) const bool FEATURE_HEMISPHERE_AMBIENT = false;
+layout(constant_id = 3) const bool FEATURE_HEIGHT_FOG         = false;
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec3 inWorldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+  vec3 normal = normalize(inNormal);
+
+  vec3 albedo = vec3(0.8);
+  if(FEATURE_CHECKER)
+  {
+    ivec2 cell = ivec2(floor(inTexCoord * 8.0));
+    albedo = ((cell.x + cell.y) & 1) != 0 ? vec3(0.9) : vec3(0.35);
+  }
+
+  vec3 ambient = vec3(0.1);
+  if(FEATURE_HEMISPHERE_AMBIENT)
+    ambient = mix(vec3(0.08, 0.06, 0.05), vec3(0.15, 0.2, 0.3), normal.y * 0.5 + 0.5);
+
+  vec3 color = albedo;
+  if(FEATURE_LIGHTING)
+  {
+    float diffuse = max(dot(normal, normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+    color = albedo * (ambient + 0.9 * diffuse);
+  }
+
+  if(FEATURE_HEIGHT_FOG)
+  {
+    float fog = exp(-max(inWorldPosition.y, 0.0) * 0.25);
+    color = mix(color, vec3(0.6, 0.65, 0.7), 0.7 * fog);
+  }
+
+  outColor = vec4(color, 1.0);
+}
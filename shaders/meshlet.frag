@@ -0,0 +1,12 @@
+#version 460
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+  float diffuse = max(dot(normalize(inNormal), normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+  outColor = vec4(vec3(0.1 + 0.9 * diffuse), 1.0);
+}
@@ -0,0 +1,88 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// meshlet.frag with the point lights of ClusteredLighting: only the lights assigned to the cluster
+// of the fragment are evaluated
+
+struct Light
+{
+  vec3  position;
+  float radius;
+  vec3  color;
+  float intensity;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer Lights
+{
+  Light lights[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer ClusterRanges
+{
+  uvec2 ranges[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer LightIndices
+{
+  uint counter;
+  uint indices[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer ShadingData
+{
+  mat4          view;
+  uint          gridX;
+  uint          gridY;
+  uint          gridZ;
+  uint          tileSize;
+  uint          width;
+  uint          height;
+  uint          lightCount;
+  uint          indexCapacity;
+  float         tanHalfFovX;
+  float         tanHalfFovY;
+  float         nearPlane;
+  float         farPlane;
+  float         sliceScale;
+  float         sliceBias;
+  Lights        lights;
+  ClusterRanges clusterRanges;
+  LightIndices  lightIndices;
+};
+
+// Follows MeshletDrawConstants
+layout(push_constant) uniform LightingConstants
+{
+  layout(offset = 80) ShadingData shading;
+};
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec3 inWorldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+  vec3 normal = normalize(inNormal);
+  float diffuse = max(dot(normal, normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+  vec3 color = vec3(0.1 + 0.9 * diffuse);
+
+  float depth = -(shading.view * vec4(inWorldPosition, 1.0)).z;
+  uvec2 tile = min(uvec2(gl_FragCoord.xy) / shading.tileSize, uvec2(shading.gridX - 1, shading.gridY - 1));
+  float slice = log(max(depth, shading.nearPlane)) * shading.sliceScale + shading.sliceBias;
+  uint z = uint(clamp(slice, 0.0, float(shading.gridZ - 1)));
+  uvec2 range = shading.clusterRanges.ranges[(z * shading.gridY + tile.y) * shading.gridX + tile.x];
+
+  for(uint index = 0; index < range.y; ++index)
+  {
+    Light light = shading.lights.lights[shading.lightIndices.indices[range.x + index]];
+    vec3 toLight = light.position - inWorldPosition;
+    float distance = length(toLight);
+    float falloff = clamp(1.0 - (distance * distance) / (light.radius * light.radius), 0.0, 1.0);
+    float lambert = max(dot(normal, toLight / max(distance, 1e-4)), 0.0);
+    color += light.color * (light.intensity * falloff * falloff * lambert);
+  }
+
+  outColor = vec4(color, 1.0);
+}
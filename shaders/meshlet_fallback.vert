@@ -0,0 +1,24 @@
+#version 460
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(push_constant) uniform DrawConstants
+{
+  mat4 viewProjection;
+  vec3 cameraPosition;
+  uint meshletCount;
+};
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) out vec3 outWorldPosition;
+
+void main()
+{
+  gl_Position = viewProjection * vec4(inPosition, 1.0);
+  outNormal = inNormal;
+  outTexCoord = inTexCoord;
+  outWorldPosition = inPosition;
+}
@@ -0,0 +1,81 @@
+#version 460
+
+// Virtual texture sampling for VirtualTexture. The page table maps the page at the level the
+// derivatives ask for to its finest resident ancestor: a level of the sparse image, or a slot of
+// the page cache whose border keeps bilinear taps inside the slot. One pixel of every 4x4 block,
+// a different one each frame, marks the wanted page in the feedback bit set.
+
+const uint PAGE_SIZE   = 128;           // VirtualTexture::PAGE_SIZE
+const uint PAGE_BORDER = 4;             // VirtualTexture::PAGE_BORDER
+const uint MAX_LEVELS  = 16;
+const uint ENTRY_VALID = 0x80000000u;
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(set = 0, binding = 0) uniform sampler2D pageSource;
+
+layout(set = 0, binding = 1, std430) readonly buffer PageTable
+{
+  uint width;
+  uint height;
+  uint levelCount;
+  uint sparse;
+  uint slotsPerRow;
+  uint feedbackJitter;
+  uint padding[2];
+  uint levelFirstPage[MAX_LEVELS];
+  uint levelPagesX[MAX_LEVELS];
+  uint entries[];       // bit 31 valid, bits 24-27 resident level, bits 12-23 slot row, bits 0-11 slot column
+};
+
+layout(set = 0, binding = 2, std430) buffer Feedback
+{
+  uint requestedPages[];
+};
+
+layout(location = 0) out vec4 outColor;
+
+uvec2 getLevelSize(uint level)
+{
+  return max(uvec2(width, height) >> level, uvec2(1));
+}
+
+void main()
+{
+  vec2 texCoord = fract(inTexCoord);
+  vec2 texels = inTexCoord * vec2(width, height);
+  vec2 dx = dFdx(texels);
+  vec2 dy = dFdy(texels);
+  float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+  uint level = uint(clamp(floor(lod), 0.0, float(levelCount - 1)));
+
+  uvec2 levelSize = getLevelSize(level);
+  uvec2 page = min(uvec2(texCoord * vec2(levelSize)), levelSize - 1) / PAGE_SIZE;
+  uint pageIndex = levelFirstPage[level] + page.y * levelPagesX[level] + page.x;
+
+  uvec2 pixel = uvec2(gl_FragCoord.xy) & 3u;
+  if(pixel.y * 4u + pixel.x == feedbackJitter)
+    atomicOr(requestedPages[pageIndex >> 5], 1u << (pageIndex & 31u));
+
+  vec3 albedo = vec3(0.5);
+  uint entry = entries[pageIndex];
+  if((entry & ENTRY_VALID) != 0)
+  {
+    uint residentLevel = (entry >> 24) & 0xFu;
+    if(sparse != 0)
+      albedo = textureLod(pageSource, texCoord, float(residentLevel)).rgb;
+    else
+    {
+      uvec2 residentSize = getLevelSize(residentLevel);
+      vec2 texel = texCoord * vec2(residentSize);
+      vec2 residentPage = vec2(min(uvec2(texel), residentSize - 1) / PAGE_SIZE);
+      vec2 slot = vec2(entry & 0xFFFu, (entry >> 12) & 0xFFFu);
+      vec2 cacheTexel = slot * float(PAGE_SIZE + 2 * PAGE_BORDER) + float(PAGE_BORDER) + texel - residentPage * float(PAGE_SIZE);
+      albedo = textureLod(pageSource, cacheTexel / vec2(textureSize(pageSource, 0)), 0.0).rgb;
+    }
+  }
+
+  float diffuse = max(dot(normalize(inNormal), normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+  outColor = vec4(albedo * (0.1 + 0.9 * diffuse), 1.0);
+}
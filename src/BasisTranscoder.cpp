@@ -0,0 +1,953 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "BasisTranscoder.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t LOOKUP_BITS                       = 10;
+  const uint32_t MAX_CODE_LENGTH                   = 16;
+  const uint32_t SYMBOL_COUNT_BITS                 = 14;
+  const uint32_t CODE_LENGTH_CODE_COUNT            = 21;
+  const uint32_t SMALL_ZERO_RUN_CODE               = 17;     // 3 + 3-bit count zero lengths
+  const uint32_t BIG_ZERO_RUN_CODE                 = 18;     // 11 + 7-bit count zero lengths
+  const uint32_t SMALL_REPEAT_CODE                 = 19;     // 3 + 2-bit count copies of the last length
+  // Code length codes in the order their sizes are stored
+  const uint8_t  CODE_LENGTH_CODE_ORDER[CODE_LENGTH_CODE_COUNT] = { 17, 18, 19, 20, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15, 16 };
+
+  const uint32_t COLOR5_TABLE0_LIMIT               = 9;      // previous values up to this use the first delta code
+  const uint32_t COLOR5_TABLE1_LIMIT               = 21;
+  const uint32_t ENDPOINT_PREDICTION_REPEAT_SYMBOL = 256;
+  const uint32_t ENDPOINT_PREDICTION_MIN_REPEAT    = 3;
+  const uint32_t ENDPOINT_PREDICTION_COUNT_BITS    = 4;
+  const uint32_t SELECTOR_HISTORY_RUN_THRESHOLD    = 3;
+  const uint32_t SELECTOR_HISTORY_RUN_SYMBOLS      = 64;
+  const uint32_t SELECTOR_HISTORY_RUN_COUNT_BITS   = 7;
+  const uint32_t SELECTOR_HISTORY_SIZE_BITS        = 13;
+  const uint32_t IMAGE_FLAG_P_FRAME                = 2;
+
+  // ETC1 modifiers by selector, darkest first
+  const int INTENSITY_MODIFIERS[8][4] = {
+    { -8, -2, 2, 8 }, { -17, -5, 5, 17 }, { -29, -9, 9, 29 }, { -42, -13, 13, 42 },
+    { -60, -18, 18, 60 }, { -80, -24, 24, 80 }, { -106, -33, 33, 106 }, { -183, -47, 47, 183 }
+  };
+  // ETC1 pixel index of every selector
+  const uint8_t ETC1_INDICES[4] = { 3, 2, 0, 1 };
+
+  const int EAC_MODIFIERS[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 }, { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 }, { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 }, { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 }, { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 }, { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+  };
+  const uint8_t EAC_OPAQUE_INDEX = 4;             // +2 in table 0, clamps 255 to 255
+
+  // BC7 mode 5 and ASTC interpolate 2-bit indices with these weights out of 64
+  const int INDEX_WEIGHTS[4] = { 0, 21, 43, 64 };
+  // 4x4 weight grid of 2-bit weights, one partition of LDR RGB direct endpoints (CEM 8)
+  const uint64_t ASTC_BLOCK_MODE                   = 0x42;
+  const uint64_t ASTC_ENDPOINT_MODE                = 8;
+
+  struct GlobalDataHeader
+  {
+    uint16_t endpointCount;
+    uint16_t selectorCount;
+    uint32_t endpointsByteLength;
+    uint32_t selectorsByteLength;
+    uint32_t tablesByteLength;
+    uint32_t extendedByteLength;
+  };
+
+  // Reads least significant bit first; bits past the end read as zero but fail once consumed
+  class BitReader
+  {
+  public:
+    BitReader(uint8_t const *data, size_t size)
+    {
+      mData       = data;
+      mEnd        = data + size;
+      mBuffer     = 0;
+      mBufferBits = 0;
+      mAvailable  = static_cast<uint64_t>(size) * 8;
+      mFailed     = false;
+    }
+
+    uint32_t peekBits(uint32_t count)
+    {
+      while(mBufferBits < count)
+      {
+        uint64_t byte = mData < mEnd ? *mData++ : 0;
+        mBuffer |= byte << mBufferBits;
+        mBufferBits += 8;
+      }
+      return static_cast<uint32_t>(mBuffer & ((static_cast<uint64_t>(1) << count) - 1));
+    }
+
+    void skipBits(uint32_t count)
+    {
+      mBuffer >>= count;
+      mBufferBits -= count;
+      if(mAvailable < count)
+        mFailed = true;
+      mAvailable -= std::min<uint64_t>(mAvailable, count);
+    }
+
+    uint32_t getBits(uint32_t count)
+    {
+      if(count == 0)
+        return 0;
+      uint32_t value = peekBits(count);
+      skipBits(count);
+      return value;
+    }
+
+    // chunkBits at a time, each chunk followed by a bit telling whether another one follows
+    uint32_t getVariableLength(uint32_t chunkBits)
+    {
+      uint32_t value = 0;
+      for(uint32_t shift = 0; shift < 32; shift += chunkBits)
+      {
+        uint32_t chunk = getBits(chunkBits + 1);
+        value |= (chunk & ((1u << chunkBits) - 1)) << shift;
+        if((chunk >> chunkBits) == 0)
+          break;
+      }
+      return value;
+    }
+
+    void fail()
+    {
+      mFailed = true;
+    }
+
+    bool failed() const
+    {
+      return mFailed;
+    }
+
+  private:
+    uint8_t const *mData;
+    uint8_t const *mEnd;
+    uint64_t       mBuffer;
+    uint32_t       mBufferBits;
+    uint64_t       mAvailable;
+    bool           mFailed;
+  };
+
+  uint32_t reverseBits(uint32_t value, uint32_t count)
+  {
+    uint32_t reversed = 0;
+    for(uint32_t bit = 0; bit < count; ++bit)
+      reversed |= ((value >> bit) & 1) << (count - 1 - bit);
+    return reversed;
+  }
+
+  // Canonical code: shorter codes first, equal lengths in symbol order. Incomplete codes (a
+  // single used symbol) are valid, over-subscribed ones are not.
+  bool buildHuffmanTable(uint8_t const *codeSizes, uint32_t symbolCount, BasisHuffmanTable &table)
+  {
+    std::fill(table.counts, table.counts + MAX_CODE_LENGTH + 1, static_cast<uint16_t>(0));
+    for(uint32_t symbol = 0; symbol < symbolCount; ++symbol)
+    {
+      if(codeSizes[symbol] > MAX_CODE_LENGTH)
+        return false;
+      ++table.counts[codeSizes[symbol]];
+    }
+    table.counts[0] = 0;
+
+    int32_t left = 1;
+    uint16_t offsets[MAX_CODE_LENGTH + 2] = {};
+    for(uint32_t length = 1; length <= MAX_CODE_LENGTH; ++length)
+    {
+      left = (left << 1) - table.counts[length];
+      if(left < 0)
+        return false;
+      offsets[length + 1] = static_cast<uint16_t>(offsets[length] + table.counts[length]);
+    }
+
+    table.symbols.resize(offsets[MAX_CODE_LENGTH + 1]);
+    for(uint32_t symbol = 0; symbol < symbolCount; ++symbol)
+    {
+      if(codeSizes[symbol] != 0)
+        table.symbols[offsets[codeSizes[symbol]]++] = static_cast<uint16_t>(symbol);
+    }
+
+    // Codes arrive first bit first in the low bits, so short codes are looked up reversed
+    table.lookup.assign(1u << LOOKUP_BITS, 0);
+    uint32_t code = 0;
+    uint32_t index = 0;
+    for(uint32_t length = 1; length <= LOOKUP_BITS; ++length)
+    {
+      for(uint32_t count = 0; count < table.counts[length]; ++count, ++code, ++index)
+      {
+        for(uint32_t entry = reverseBits(code, length); entry < (1u << LOOKUP_BITS); entry += 1u << length)
+          table.lookup[entry] = (static_cast<uint32_t>(table.symbols[index]) << 8) | length;
+      }
+      code <<= 1;
+    }
+    return true;
+  }
+
+  uint32_t decodeSymbol(BitReader &reader, BasisHuffmanTable const &table)
+  {
+    if(table.symbols.empty())
+    {
+      reader.fail();
+      return 0;
+    }
+
+    uint32_t bits = reader.peekBits(MAX_CODE_LENGTH);
+    uint32_t entry = table.lookup[bits & ((1u << LOOKUP_BITS) - 1)];
+    if(entry != 0)
+    {
+      reader.skipBits(entry & 0xFF);
+      return entry >> 8;
+    }
+
+    // Codes longer than the lookup are walked a bit at a time
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for(uint32_t length = 1; length <= MAX_CODE_LENGTH; ++length)
+    {
+      code |= (bits >> (length - 1)) & 1;
+      int32_t count = table.counts[length];
+      if(code - first < count)
+      {
+        reader.skipBits(length);
+        return table.symbols[index + code - first];
+      }
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    reader.fail();
+    return 0;
+  }
+
+  // The code sizes are themselves Huffman coded, with runs of zero and repeated sizes
+  bool readHuffmanTable(BitReader &reader, BasisHuffmanTable &table)
+  {
+    table.lookup.clear();
+    table.symbols.clear();
+    std::fill(table.counts, table.counts + MAX_CODE_LENGTH + 1, static_cast<uint16_t>(0));
+
+    uint32_t symbolCount = reader.getBits(SYMBOL_COUNT_BITS);
+    if(symbolCount == 0)
+      return true;
+
+    uint32_t codeLengthCodeCount = reader.getBits(5);
+    if(codeLengthCodeCount == 0 || codeLengthCodeCount > CODE_LENGTH_CODE_COUNT)
+      return false;
+    uint8_t codeLengthCodeSizes[CODE_LENGTH_CODE_COUNT] = {};
+    for(uint32_t code = 0; code < codeLengthCodeCount; ++code)
+      codeLengthCodeSizes[CODE_LENGTH_CODE_ORDER[code]] = static_cast<uint8_t>(reader.getBits(3));
+
+    BasisHuffmanTable codeLengthTable;
+    if(!buildHuffmanTable(codeLengthCodeSizes, CODE_LENGTH_CODE_COUNT, codeLengthTable))
+      return false;
+
+    std::vector<uint8_t> codeSizes(symbolCount, 0);
+    uint32_t symbol = 0;
+    while(symbol < symbolCount && !reader.failed())
+    {
+      uint32_t code = decodeSymbol(reader, codeLengthTable);
+      if(code <= MAX_CODE_LENGTH)
+        codeSizes[symbol++] = static_cast<uint8_t>(code);
+      else if(code == SMALL_ZERO_RUN_CODE)
+        symbol += reader.getBits(3) + 3;
+      else if(code == BIG_ZERO_RUN_CODE)
+        symbol += reader.getBits(7) + 11;
+      else
+      {
+        if(symbol == 0 || codeSizes[symbol - 1] == 0)
+          return false;
+        uint32_t repeat = code == SMALL_REPEAT_CODE ? reader.getBits(2) + 3 : reader.getBits(7) + 7;
+        if(symbol + repeat > symbolCount)
+          return false;
+        std::fill(codeSizes.begin() + symbol, codeSizes.begin() + symbol + repeat, codeSizes[symbol - 1]);
+        symbol += repeat;
+      }
+    }
+    if(symbol != symbolCount || reader.failed())
+      return false;
+    return buildHuffmanTable(codeSizes.data(), symbolCount, table);
+  }
+
+  int getEtc1sValue(uint32_t color5, uint32_t intensity, uint32_t selector)
+  {
+    int base = static_cast<int>((color5 << 3) | (color5 >> 2));
+    return std::min(std::max(base + INTENSITY_MODIFIERS[intensity][selector], 0), 255);
+  }
+
+  struct EndpointFit
+  {
+    uint8_t low;
+    uint8_t high;
+  };
+
+  struct EacFit
+  {
+    uint8_t base;
+    uint8_t multiplierAndTable;
+    uint8_t indices[4];      // EAC index of every selector
+  };
+
+  // By color5 value and intensity table: the values of an ETC1S channel only depend on those
+  struct ConversionTables
+  {
+    EndpointFit bc7[32][8];      // 7-bit endpoints
+    EndpointFit unorm8[32][8];   // 8-bit endpoints
+    EacFit      eac[32][8];
+  };
+
+  int interpolate(int low, int high, int weight)
+  {
+    return ((64 - weight) * low + weight * high + 32) >> 6;
+  }
+
+  // Least squares endpoints for the four selector values at the index weights, then the best
+  // quantized pair around them. Endpoints stay ordered, ASTC would blue-contract swapped ones.
+  EndpointFit fitEndpoints(int const *values, uint32_t bits)
+  {
+    double aa = 0.0, ab = 0.0, bb = 0.0, av = 0.0, bv = 0.0;
+    for(uint32_t selector = 0; selector < 4; ++selector)
+    {
+      double b = INDEX_WEIGHTS[selector] / 64.0;
+      double a = 1.0 - b;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      av += a * values[selector];
+      bv += b * values[selector];
+    }
+    double determinant = aa * bb - ab * ab;
+    double low = (av * bb - bv * ab) / determinant;
+    double high = (bv * aa - av * ab) / determinant;
+
+    int maximum = (1 << bits) - 1;
+    auto quantize = [maximum](double value) {
+      return std::min(std::max(static_cast<int>(std::lround(value * maximum / 255.0)), 0), maximum);
+    };
+    auto expand = [bits](int value) { return bits == 7 ? (value << 1) | (value >> 6) : value; };
+
+    int centerLow = quantize(low);
+    int centerHigh = quantize(high);
+    EndpointFit best = {};
+    int bestError = INT_MAX;
+    for(int lowCandidate = std::max(centerLow - 2, 0); lowCandidate <= std::min(centerLow + 2, maximum); ++lowCandidate)
+    {
+      for(int highCandidate = std::max(centerHigh - 2, lowCandidate); highCandidate <= std::min(centerHigh + 2, maximum); ++highCandidate)
+      {
+        int error = 0;
+        for(uint32_t selector = 0; selector < 4; ++selector)
+        {
+          int difference = interpolate(expand(lowCandidate), expand(highCandidate), INDEX_WEIGHTS[selector]) - values[selector];
+          error += difference * difference;
+        }
+        if(error < bestError)
+        {
+          best = { static_cast<uint8_t>(lowCandidate), static_cast<uint8_t>(highCandidate) };
+          bestError = error;
+        }
+      }
+    }
+    return best;
+  }
+
+  // Every table and multiplier with the base centering the table's span on the values
+  EacFit fitEac(int const *values)
+  {
+    EacFit best = {};
+    int bestError = INT_MAX;
+    for(int table = 0; table < 16 && bestError > 0; ++table)
+    {
+      int const *modifiers = EAC_MODIFIERS[table];
+      for(int multiplier = 1; multiplier < 16; ++multiplier)
+      {
+        int center = (values[0] + values[3] - (modifiers[3] + modifiers[7]) * multiplier) / 2;
+        for(int base = std::max(center - 1, 0); base <= std::min(center + 1, 255); ++base)
+        {
+          EacFit fit = { static_cast<uint8_t>(base), static_cast<uint8_t>((multiplier << 4) | table), {} };
+          int error = 0;
+          for(uint32_t selector = 0; selector < 4; ++selector)
+          {
+            int bestDifference = INT_MAX;
+            for(uint8_t index = 0; index < 8; ++index)
+            {
+              int value = std::min(std::max(base + modifiers[index] * multiplier, 0), 255);
+              int difference = std::abs(value - values[selector]);
+              if(difference < bestDifference)
+              {
+                bestDifference = difference;
+                fit.indices[selector] = index;
+              }
+            }
+            error += bestDifference * bestDifference;
+          }
+          if(error < bestError)
+          {
+            best = fit;
+            bestError = error;
+          }
+        }
+      }
+    }
+    return best;
+  }
+
+  ConversionTables createConversionTables()
+  {
+    ConversionTables tables;
+    for(uint32_t color5 = 0; color5 < 32; ++color5)
+    {
+      for(uint32_t intensity = 0; intensity < 8; ++intensity)
+      {
+        int values[4];
+        for(uint32_t selector = 0; selector < 4; ++selector)
+          values[selector] = getEtc1sValue(color5, intensity, selector);
+        tables.bc7[color5][intensity]    = fitEndpoints(values, 7);
+        tables.unorm8[color5][intensity] = fitEndpoints(values, 8);
+        tables.eac[color5][intensity]    = fitEac(values);
+      }
+    }
+    return tables;
+  }
+
+  ConversionTables const &getConversionTables()
+  {
+    static ConversionTables const tables = createConversionTables();
+    return tables;
+  }
+
+  void storeBlock(uint64_t low, uint64_t high, uint8_t *block)
+  {
+    std::memcpy(block, &low, sizeof(low));
+    std::memcpy(block + 8, &high, sizeof(high));
+  }
+
+  void storeBigEndian(uint64_t value, uint32_t bytes, uint8_t *destination)
+  {
+    for(uint32_t byte = 0; byte < bytes; ++byte)
+      destination[byte] = static_cast<uint8_t>(value >> ((bytes - 1 - byte) * 8));
+  }
+
+  // Mode 5: rotation 0, 7-bit color and 8-bit alpha endpoints, 31 bits of color indices and
+  // 31 bits of alpha indices
+  void writeBc7Block(EndpointFit const *color, EndpointFit alpha, uint32_t colorIndices, uint32_t alphaIndices, uint8_t *block)
+  {
+    uint64_t low = 1u << 5;
+    for(uint32_t channel = 0; channel < 3; ++channel)
+    {
+      low |= static_cast<uint64_t>(color[channel].low) << (8 + channel * 14);
+      low |= static_cast<uint64_t>(color[channel].high) << (15 + channel * 14);
+    }
+    low |= static_cast<uint64_t>(alpha.low) << 50;
+    low |= static_cast<uint64_t>(alpha.high) << 58;
+    uint64_t high = static_cast<uint64_t>(alpha.high >> 6) | (static_cast<uint64_t>(colorIndices) << 2) |
+                    (static_cast<uint64_t>(alphaIndices) << 33);
+    storeBlock(low, high, block);
+  }
+
+  // Endpoint values from bit 17 in the order R0 R1 G0 G1 B0 B1, weights from the top down
+  void writeAstcBlock(EndpointFit const *color, uint32_t weights, uint8_t *block)
+  {
+    uint64_t low = ASTC_BLOCK_MODE | (ASTC_ENDPOINT_MODE << 13);
+    for(uint32_t channel = 0; channel < 3; ++channel)
+    {
+      low |= static_cast<uint64_t>(color[channel].low) << (17 + channel * 16);
+      if(channel < 2)
+        low |= static_cast<uint64_t>(color[channel].high) << (25 + channel * 16);
+    }
+    low |= static_cast<uint64_t>(color[2].high) << 57;
+    uint64_t high = static_cast<uint64_t>(color[2].high >> 7) | (static_cast<uint64_t>(weights) << 32);
+    storeBlock(low, high, block);
+  }
+
+  // Differential mode without color difference, one intensity table for both halves
+  void writeEtc1Block(uint8_t const *color5, uint32_t intensity, uint32_t indices, uint8_t *block)
+  {
+    block[0] = static_cast<uint8_t>(color5[0] << 3);
+    block[1] = static_cast<uint8_t>(color5[1] << 3);
+    block[2] = static_cast<uint8_t>(color5[2] << 3);
+    block[3] = static_cast<uint8_t>((intensity << 5) | (intensity << 2) | 3);
+    storeBigEndian(indices, 4, block + 4);
+  }
+
+  void writeEacBlock(uint8_t base, uint8_t multiplierAndTable, uint64_t indices, uint8_t *block)
+  {
+    block[0] = base;
+    block[1] = multiplierAndTable;
+    storeBigEndian(indices, 6, block + 2);
+  }
+}
+
+VkFormat getBasisTargetFormat(BasisTarget target, bool alpha, bool srgb)
+{
+    switch(target)
+    {
+        case BasisTarget::BC7:
+            return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        case BasisTarget::ASTC:
+            return srgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK : VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+        case BasisTarget::ETC2:
+            if(alpha)
+                return srgb ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+            return srgb ? VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+        default:
+            return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+char const *getBasisTargetName(BasisTarget target)
+{
+    switch(target)
+    {
+        case BasisTarget::BC7:
+            return "BC7";
+        case BasisTarget::ASTC:
+            return "ASTC 4x4";
+        case BasisTarget::ETC2:
+            return "ETC2";
+        default:
+            return "RGBA8";
+    }
+}
+
+BasisTranscoder::BasisTranscoder()
+{
+    mSelectorHistorySize = 0;
+}
+
+bool BasisTranscoder::create(uint8_t const *globalData, size_t size, uint32_t imageCount)
+{
+    destroy();
+
+    GlobalDataHeader header;
+    size_t imagesEnd = sizeof(header) + imageCount * sizeof(ImageDesc);
+    if(size < imagesEnd)
+    {
+        std::cerr << "BasisLZ global data is truncated." << std::endl;
+        return false;
+    }
+    std::memcpy(&header, globalData, sizeof(header));
+    uint64_t dataEnd = imagesEnd + static_cast<uint64_t>(header.endpointsByteLength) + header.selectorsByteLength +
+                       header.tablesByteLength + header.extendedByteLength;
+    if(dataEnd > size)
+    {
+        std::cerr << "BasisLZ global data is truncated." << std::endl;
+        return false;
+    }
+    if(header.endpointCount == 0 || header.selectorCount == 0)
+    {
+        std::cerr << "BasisLZ global data has empty codebooks." << std::endl;
+        return false;
+    }
+
+    mImages.resize(imageCount);
+    std::memcpy(mImages.data(), globalData + sizeof(header), imageCount * sizeof(ImageDesc));
+    for(auto &image : mImages)
+    {
+        if(image.imageFlags & IMAGE_FLAG_P_FRAME)
+        {
+            std::cerr << "BasisLZ video frames are not supported." << std::endl;
+            destroy();
+            return false;
+        }
+    }
+
+    uint8_t const *endpointData = globalData + imagesEnd;
+    uint8_t const *selectorData = endpointData + header.endpointsByteLength;
+    uint8_t const *tableData = selectorData + header.selectorsByteLength;
+    if(!decodeEndpoints(endpointData, header.endpointsByteLength, header.endpointCount) ||
+       !decodeSelectors(selectorData, header.selectorsByteLength, header.selectorCount) ||
+       !decodeTables(tableData, header.tablesByteLength))
+    {
+        std::cerr << "Could not decode the BasisLZ codebooks." << std::endl;
+        destroy();
+        return false;
+    }
+
+    mPalettes.resize(mEndpoints.size() * 16);
+    for(size_t index = 0; index < mEndpoints.size(); ++index)
+    {
+        Endpoint const &endpoint = mEndpoints[index];
+        uint8_t *palette = &mPalettes[index * 16];
+        for(uint32_t selector = 0; selector < 4; ++selector)
+        {
+            for(uint32_t channel = 0; channel < 3; ++channel)
+                palette[selector * 4 + channel] = static_cast<uint8_t>(getEtc1sValue(endpoint.color5[channel], endpoint.intensity, selector));
+            palette[selector * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+void BasisTranscoder::destroy()
+{
+    mEndpoints.clear();
+    mPalettes.clear();
+    mSelectors.clear();
+    mImages.clear();
+    mSelectorHistorySize = 0;
+}
+
+bool BasisTranscoder::decodeEndpoints(uint8_t const *data, size_t size, uint32_t count)
+{
+    BitReader reader(data, size);
+    BasisHuffmanTable colorDeltaTables[3];
+    BasisHuffmanTable intensityDeltaTable;
+    if(!readHuffmanTable(reader, colorDeltaTables[0]) || !readHuffmanTable(reader, colorDeltaTables[1]) ||
+       !readHuffmanTable(reader, colorDeltaTables[2]) || !readHuffmanTable(reader, intensityDeltaTable))
+        return false;
+    uint32_t channelCount = reader.getBits(1) != 0 ? 1 : 3;
+
+    // Deltas to the previous entry, coded by the range the previous value lies in
+    mEndpoints.resize(count);
+    uint32_t previousColor[3] = { 16, 16, 16 };
+    uint32_t previousIntensity = 0;
+    for(auto &endpoint : mEndpoints)
+    {
+        previousIntensity = (previousIntensity + decodeSymbol(reader, intensityDeltaTable)) & 7;
+        endpoint.intensity = static_cast<uint8_t>(previousIntensity);
+        for(uint32_t channel = 0; channel < channelCount; ++channel)
+        {
+            uint32_t previous = previousColor[channel];
+            uint32_t table = previous <= COLOR5_TABLE0_LIMIT ? 0 : (previous <= COLOR5_TABLE1_LIMIT ? 1 : 2);
+            previousColor[channel] = (previous + decodeSymbol(reader, colorDeltaTables[table])) & 31;
+            endpoint.color5[channel] = static_cast<uint8_t>(previousColor[channel]);
+        }
+        if(channelCount == 1)
+            endpoint.color5[1] = endpoint.color5[2] = endpoint.color5[0];
+    }
+    return !reader.failed();
+}
+
+bool BasisTranscoder::decodeSelectors(uint8_t const *data, size_t size, uint32_t count)
+{
+    BitReader reader(data, size);
+    // Global and hybrid selector codebooks predate KTX2 and are not allowed in it
+    if(reader.getBits(1) != 0 || reader.getBits(1) != 0)
+        return false;
+    bool raw = reader.getBits(1) != 0;
+    BasisHuffmanTable deltaTable;
+    if(!raw && !readHuffmanTable(reader, deltaTable))
+        return false;
+
+    // A byte per row, 2 bits per texel; coded entries XOR the previous entry's rows
+    mSelectors.resize(count);
+    uint32_t previousRows[4] = {};
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        Selector &selector = mSelectors[index];
+        for(uint32_t y = 0; y < 4; ++y)
+        {
+            uint32_t row = raw || index == 0 ? reader.getBits(8) : (decodeSymbol(reader, deltaTable) ^ previousRows[y]) & 0xFF;
+            previousRows[y] = row;
+            for(uint32_t x = 0; x < 4; ++x)
+                selector.texels[y * 4 + x] = static_cast<uint8_t>((row >> (x * 2)) & 3);
+        }
+
+        // Selectors are ordered like the fitted weights; BC7 needs the first texel's top index bit
+        // clear, so its indices are inverted and its endpoints swapped otherwise
+        selector.bc7Swapped = selector.texels[0] >= 2;
+        uint32_t weights = 0;
+        uint32_t bc7Indices = 0;
+        uint32_t etc1High = 0;
+        uint32_t etc1Low = 0;
+        for(uint32_t texel = 0; texel < 16; ++texel)
+        {
+            uint32_t value = selector.texels[texel];
+            weights |= value << (texel * 2);
+            bc7Indices |= (selector.bc7Swapped ? 3 - value : value) << (texel * 2);
+
+            uint32_t pixel = (texel % 4) * 4 + texel / 4;
+            etc1High |= (ETC1_INDICES[value] >> 1) << pixel;
+            etc1Low |= (ETC1_INDICES[value] & 1) << pixel;
+        }
+        selector.bc7Indices = (bc7Indices & 1) | ((bc7Indices >> 2) << 1);
+        selector.astcWeights = reverseBits(weights, 32);
+        selector.etc1Indices = (etc1High << 16) | etc1Low;
+    }
+    return !reader.failed();
+}
+
+bool BasisTranscoder::decodeTables(uint8_t const *data, size_t size)
+{
+    BitReader reader(data, size);
+    if(!readHuffmanTable(reader, mEndpointPredictionTable) || !readHuffmanTable(reader, mEndpointDeltaTable) ||
+       !readHuffmanTable(reader, mSelectorTable) || !readHuffmanTable(reader, mSelectorHistoryRunTable))
+        return false;
+    mSelectorHistorySize = reader.getBits(SELECTOR_HISTORY_SIZE_BITS);
+    return !reader.failed() && mSelectorHistorySize != 0;
+}
+
+bool BasisTranscoder::decodeSlice(uint8_t const *data, size_t size, uint32_t blocksX, uint32_t blocksY,
+                                  std::vector<BlockReference> &blocks) const
+{
+    uint32_t endpointCount = static_cast<uint32_t>(mEndpoints.size());
+    uint32_t selectorCount = static_cast<uint32_t>(mSelectors.size());
+    blocks.resize(static_cast<size_t>(blocksX) * blocksY);
+    BitReader reader(data, size);
+
+    // Recently used selectors; new ones go to the back half, a hit moves halfway to the front
+    std::vector<uint16_t> history(mSelectorHistorySize, 0);
+    uint32_t historyInsert = mSelectorHistorySize / 2;
+    uint32_t historyRunSymbol = selectorCount + mSelectorHistorySize;
+    uint32_t historyRun = 0;
+
+    // A prediction symbol holds 2 bits for each block of a 2x2 group, the lower half is kept for
+    // the odd row
+    std::vector<uint8_t> lowerPredictions(blocksX, 0);
+    uint32_t predictions = 0;
+    uint32_t previousPredictions = 0;
+    uint32_t predictionRepeat = 0;
+    uint32_t previousEndpoint = 0;
+
+    for(uint32_t blockY = 0; blockY < blocksY; ++blockY)
+    {
+        BlockReference *row = &blocks[static_cast<size_t>(blockY) * blocksX];
+        BlockReference const *upperRow = blockY > 0 ? row - blocksX : nullptr;
+        for(uint32_t blockX = 0; blockX < blocksX; ++blockX)
+        {
+            if((blockX & 1) == 0)
+            {
+                if(blockY & 1)
+                    predictions = lowerPredictions[blockX];
+                else
+                {
+                    if(predictionRepeat > 0)
+                    {
+                        --predictionRepeat;
+                        predictions = previousPredictions;
+                    }
+                    else
+                    {
+                        predictions = decodeSymbol(reader, mEndpointPredictionTable);
+                        if(predictions == ENDPOINT_PREDICTION_REPEAT_SYMBOL)
+                        {
+                            predictionRepeat = reader.getVariableLength(ENDPOINT_PREDICTION_COUNT_BITS) + ENDPOINT_PREDICTION_MIN_REPEAT - 1;
+                            predictions = previousPredictions;
+                        }
+                        else
+                            previousPredictions = predictions;
+                    }
+                    lowerPredictions[blockX] = static_cast<uint8_t>(predictions >> 4);
+                }
+            }
+
+            uint32_t prediction = predictions & 3;
+            predictions >>= 2;
+            uint32_t endpoint;
+            if(prediction == 0)
+            {
+                // Left
+                if(blockX == 0)
+                    return false;
+                endpoint = previousEndpoint;
+            }
+            else if(prediction == 1)
+            {
+                // Above
+                if(blockY == 0)
+                    return false;
+                endpoint = upperRow[blockX].endpoint;
+            }
+            else if(prediction == 2)
+            {
+                // Above left
+                if(blockX == 0 || blockY == 0)
+                    return false;
+                endpoint = upperRow[blockX - 1].endpoint;
+            }
+            else
+            {
+                endpoint = previousEndpoint + decodeSymbol(reader, mEndpointDeltaTable);
+                if(endpoint >= endpointCount)
+                    endpoint -= endpointCount;
+            }
+            if(endpoint >= endpointCount)
+                return false;
+            previousEndpoint = endpoint;
+
+            uint32_t symbol;
+            if(historyRun > 0)
+            {
+                --historyRun;
+                symbol = selectorCount;
+            }
+            else
+            {
+                symbol = decodeSymbol(reader, mSelectorTable);
+                if(symbol == historyRunSymbol)
+                {
+                    // A run of blocks repeating the most recent selector
+                    uint32_t runSymbol = decodeSymbol(reader, mSelectorHistoryRunTable);
+                    if(runSymbol == SELECTOR_HISTORY_RUN_SYMBOLS - 1)
+                        historyRun = reader.getVariableLength(SELECTOR_HISTORY_RUN_COUNT_BITS) + SELECTOR_HISTORY_RUN_THRESHOLD;
+                    else
+                        historyRun = runSymbol + SELECTOR_HISTORY_RUN_THRESHOLD;
+                    if(historyRun > blocks.size())
+                        return false;
+                    symbol = selectorCount;
+                    --historyRun;
+                }
+            }
+
+            uint32_t selector;
+            if(symbol >= selectorCount)
+            {
+                uint32_t historyIndex = symbol - selectorCount;
+                if(historyIndex >= history.size())
+                    return false;
+                selector = history[historyIndex];
+                if(historyIndex != 0)
+                    std::swap(history[historyIndex / 2], history[historyIndex]);
+            }
+            else
+            {
+                selector = symbol;
+                history[historyInsert++] = static_cast<uint16_t>(selector);
+                if(historyInsert == history.size())
+                    historyInsert = mSelectorHistorySize / 2;
+            }
+
+            row[blockX].endpoint = static_cast<uint16_t>(endpoint);
+            row[blockX].selector = static_cast<uint16_t>(selector);
+        }
+    }
+    return !reader.failed();
+}
+
+bool BasisTranscoder::transcode(BasisTarget target, TranscodeKernel kernel, uint32_t imageIndex, bool alpha,
+                                uint8_t const *levelData, size_t levelSize, uint32_t width, uint32_t height,
+                                uint8_t *destination) const
+{
+    if(imageIndex >= mImages.size())
+    {
+        std::cerr << "BasisLZ image " << imageIndex << " does not exist." << std::endl;
+        return false;
+    }
+    if(target == BasisTarget::ASTC && alpha)
+    {
+        std::cerr << "ETC1S images with alpha cannot be transcoded to ASTC." << std::endl;
+        return false;
+    }
+
+    ImageDesc const &image = mImages[imageIndex];
+    bool alphaSlice = alpha && image.alphaSliceByteLength != 0;
+    if(static_cast<uint64_t>(image.rgbSliceByteOffset) + image.rgbSliceByteLength > levelSize ||
+       (alphaSlice && static_cast<uint64_t>(image.alphaSliceByteOffset) + image.alphaSliceByteLength > levelSize))
+    {
+        std::cerr << "BasisLZ image " << imageIndex << " lies outside of its level." << std::endl;
+        return false;
+    }
+
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    std::vector<BlockReference> colorBlocks;
+    std::vector<BlockReference> alphaBlocks;
+    if(!decodeSlice(levelData + image.rgbSliceByteOffset, image.rgbSliceByteLength, blocksX, blocksY, colorBlocks) ||
+       (alphaSlice && !decodeSlice(levelData + image.alphaSliceByteOffset, image.alphaSliceByteLength, blocksX, blocksY,
+                                   alphaBlocks)))
+    {
+        std::cerr << "Could not decode BasisLZ image " << imageIndex << "." << std::endl;
+        return false;
+    }
+
+    ConversionTables const &tables = getConversionTables();
+    uint64_t opaqueEacIndices = 0;
+    for(uint32_t texel = 0; texel < 16; ++texel)
+        opaqueEacIndices = (opaqueEacIndices << 3) | EAC_OPAQUE_INDEX;
+
+    size_t blockBytes = target == BasisTarget::ETC2 && !alpha ? 8 : 16;
+    size_t rowPitch = static_cast<size_t>(width) * 4;
+    uint8_t texels[64];
+    for(uint32_t blockY = 0; blockY < blocksY; ++blockY)
+    {
+        for(uint32_t blockX = 0; blockX < blocksX; ++blockX)
+        {
+            size_t index = static_cast<size_t>(blockY) * blocksX + blockX;
+            Endpoint const &endpoint = mEndpoints[colorBlocks[index].endpoint];
+            Selector const &selector = mSelectors[colorBlocks[index].selector];
+            Endpoint const *alphaEndpoint = alphaSlice ? &mEndpoints[alphaBlocks[index].endpoint] : nullptr;
+            Selector const *alphaSelector = alphaSlice ? &mSelectors[alphaBlocks[index].selector] : nullptr;
+            uint8_t *block = destination + index * blockBytes;
+
+            switch(target)
+            {
+                case BasisTarget::BC7:
+                {
+                    EndpointFit color[3];
+                    for(uint32_t channel = 0; channel < 3; ++channel)
+                    {
+                        color[channel] = tables.bc7[endpoint.color5[channel]][endpoint.intensity];
+                        if(selector.bc7Swapped)
+                            std::swap(color[channel].low, color[channel].high);
+                    }
+                    EndpointFit alphaFit = { 255, 255 };
+                    uint32_t alphaIndices = 0;
+                    if(alphaSlice)
+                    {
+                        alphaFit = tables.unorm8[alphaEndpoint->color5[1]][alphaEndpoint->intensity];
+                        if(alphaSelector->bc7Swapped)
+                            std::swap(alphaFit.low, alphaFit.high);
+                        alphaIndices = alphaSelector->bc7Indices;
+                    }
+                    writeBc7Block(color, alphaFit, selector.bc7Indices, alphaIndices, block);
+                    break;
+                }
+                case BasisTarget::ASTC:
+                {
+                    EndpointFit color[3];
+                    for(uint32_t channel = 0; channel < 3; ++channel)
+                        color[channel] = tables.unorm8[endpoint.color5[channel]][endpoint.intensity];
+                    writeAstcBlock(color, selector.astcWeights, block);
+                    break;
+                }
+                case BasisTarget::ETC2:
+                    if(alphaSlice)
+                    {
+                        EacFit const &fit = tables.eac[alphaEndpoint->color5[1]][alphaEndpoint->intensity];
+                        writeEacBlock(fit.base, fit.multiplierAndTable, packEacSelectors(kernel, fit.indices, alphaSelector->texels), block);
+                        block += 8;
+                    }
+                    else if(alpha)
+                    {
+                        writeEacBlock(255, 1 << 4, opaqueEacIndices, block);
+                        block += 8;
+                    }
+                    writeEtc1Block(endpoint.color5, endpoint.intensity, selector.etc1Indices, block);
+                    break;
+                default:
+                {
+                    // Blocks reaching past the image are decoded aside and clipped
+                    uint32_t x = blockX * 4;
+                    uint32_t y = blockY * 4;
+                    bool inside = x + 4 <= width && y + 4 <= height;
+                    uint8_t *output = inside ? destination + y * rowPitch + x * 4 : texels;
+                    decodeSelectorBlock(kernel, &mPalettes[colorBlocks[index].endpoint * 16], selector.texels,
+                                        alphaSlice ? &mPalettes[alphaBlocks[index].endpoint * 16] : nullptr,
+                                        alphaSlice ? alphaSelector->texels : nullptr, output, inside ? rowPitch : 16);
+                    if(!inside)
+                    {
+                        for(uint32_t row = 0; row < std::min(4u, height - y); ++row)
+                            std::memcpy(destination + (y + row) * rowPitch + x * 4, texels + row * 16, std::min(4u, width - x) * 4);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace VulkanSample
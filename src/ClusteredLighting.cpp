@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ClusteredLighting.h"
+#include "Profiler.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t WORKGROUP_SIZE = 128;    // local_size_x of cluster_lights.comp
+
+  // Shading data block, laid out like the ShadingData buffer reference in cluster_lights.comp and
+  // meshlet_clustered.frag
+  struct ShadingData
+  {
+    Float4x4        view;
+    uint32_t        gridX;
+    uint32_t        gridY;
+    uint32_t        gridZ;
+    uint32_t        tileSize;
+    uint32_t        width;
+    uint32_t        height;
+    uint32_t        lightCount;
+    uint32_t        indexCapacity;
+    float           tanHalfFovX;
+    float           tanHalfFovY;
+    float           nearPlane;
+    float           farPlane;
+    float           sliceScale;             // slice = log(depth) * sliceScale + sliceBias
+    float           sliceBias;
+    VkDeviceAddress lights;
+    VkDeviceAddress clusterRanges;
+    VkDeviceAddress lightIndices;
+  };
+  static_assert(sizeof(ShadingData) == 144, "ShadingData must match the std430 layout of the shaders");
+
+  struct ClusterBounds
+  {
+    Float3 minimum;
+    Float3 maximum;
+  };
+
+  void getSliceParameters(ClusteredLightingView const &view, uint32_t depthSlices, float &sliceScale, float &sliceBias)
+  {
+    sliceScale = depthSlices / std::log(view.farPlane / view.nearPlane);
+    sliceBias = -std::log(view.nearPlane) * sliceScale;
+  }
+
+  // View space box around a froxel, the same computation as in cluster_lights.comp
+  ClusterBounds getClusterBounds(ClusteredLightingView const &view, uint32_t tileSize, float sliceScale, float sliceBias,
+                                 uint32_t x, uint32_t y, uint32_t z)
+  {
+    float ndcX[2] = {
+      2.0f * (x * tileSize) / view.extent.width - 1.0f,
+      2.0f * std::min((x + 1) * tileSize, view.extent.width) / view.extent.width - 1.0f
+    };
+    float ndcY[2] = {
+      2.0f * (y * tileSize) / view.extent.height - 1.0f,
+      2.0f * std::min((y + 1) * tileSize, view.extent.height) / view.extent.height - 1.0f
+    };
+    float depth[2] = {
+      std::exp((z - sliceBias) / sliceScale),
+      std::exp((z + 1 - sliceBias) / sliceScale)
+    };
+
+    ClusterBounds bounds = { { 1e30f, 1e30f, -depth[1] }, { -1e30f, -1e30f, -depth[0] } };
+    for(float d : depth)
+    {
+      for(uint32_t corner = 0; corner < 2; ++corner)
+      {
+        float viewX = ndcX[corner] * view.tanHalfFovX * d;
+        float viewY = -ndcY[corner] * view.tanHalfFovY * d;
+        bounds.minimum.x = std::min(bounds.minimum.x, viewX);
+        bounds.maximum.x = std::max(bounds.maximum.x, viewX);
+        bounds.minimum.y = std::min(bounds.minimum.y, viewY);
+        bounds.maximum.y = std::max(bounds.maximum.y, viewY);
+      }
+    }
+    return bounds;
+  }
+}
+
+ClusteredLighting::ClusteredLighting()
+{
+    mLogicalDevice   = VK_NULL_HANDLE;
+    mParameters      = getDefaultParameters();
+    mMaxExtent       = { 0, 0 };
+    mMaxClusterCount = 0;
+    mIndexCapacity   = 0;
+    mPipelineLayout  = VK_NULL_HANDLE;
+    mPipeline        = VK_NULL_HANDLE;
+    mStats           = {};
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+    destroy();
+}
+
+bool ClusteredLighting::isSupported(DeviceCapabilities const &capabilities)
+{
+    VkPhysicalDeviceLimits const &limits = capabilities.properties.limits;
+    return capabilities.bufferDeviceAddressSupported && capabilities.timelineSynchronizationSupported &&
+           (limits.maxComputeWorkGroupInvocations >= WORKGROUP_SIZE) && (limits.maxComputeWorkGroupSize[0] >= WORKGROUP_SIZE) &&
+           (limits.maxComputeSharedMemorySize >= (MAX_LIGHTS_PER_CLUSTER + 2) * sizeof(uint32_t));
+}
+
+ClusteredLightingParameters ClusteredLighting::getDefaultParameters()
+{
+    ClusteredLightingParameters parameters;
+    parameters.tileSize                = 64;
+    parameters.depthSlices             = 24;
+    parameters.maxLights               = 16384;
+    parameters.averageLightsPerCluster = 64;
+    return parameters;
+}
+
+ClusterGrid ClusteredLighting::getClusterGrid(ClusteredLightingParameters const &parameters, VkExtent2D extent)
+{
+    return {
+        (extent.width + parameters.tileSize - 1) / parameters.tileSize,
+        (extent.height + parameters.tileSize - 1) / parameters.tileSize,
+        parameters.depthSlices
+    };
+}
+
+bool ClusteredLighting::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, std::vector<uint32_t> const &queueFamilies,
+                               uint32_t framesInFlight, VkExtent2D maxExtent, ClusteredLightingParameters const &parameters,
+                               VkPipelineCache pipelineCache)
+{
+    destroy();
+    mLogicalDevice = logicalDevice;
+
+    if(!isSupported(capabilities))
+    {
+        std::cerr << "Clustered lighting requires buffer device addresses and synchronization2." << std::endl;
+        return false;
+    }
+    if((parameters.tileSize == 0) || (parameters.depthSlices == 0) || (parameters.maxLights == 0) ||
+       (parameters.averageLightsPerCluster == 0) || (framesInFlight == 0) || (maxExtent.width == 0) || (maxExtent.height == 0))
+    {
+        std::cerr << "Invalid clustered lighting parameters." << std::endl;
+        return false;
+    }
+
+    ClusterGrid grid = getClusterGrid(parameters, maxExtent);
+    VkPhysicalDeviceLimits const &limits = capabilities.properties.limits;
+    if((grid.x > limits.maxComputeWorkGroupCount[0]) || (grid.y > limits.maxComputeWorkGroupCount[1]) ||
+       (grid.z > limits.maxComputeWorkGroupCount[2]))
+    {
+        std::cerr << "Cluster grid of " << grid.x << " x " << grid.y << " x " << grid.z << " exceeds the dispatch limits." << std::endl;
+        return false;
+    }
+
+    mParameters      = parameters;
+    mMaxExtent       = maxExtent;
+    mMaxClusterCount = grid.x * grid.y * grid.z;
+    mIndexCapacity   = mMaxClusterCount * parameters.averageLightsPerCluster;
+
+    VkPushConstantRange pushConstantRange = {
+        VK_SHADER_STAGE_COMPUTE_BIT,            // VkShaderStageFlags     stageFlags
+        0,                                      // uint32_t               offset
+        sizeof(VkDeviceAddress)                 // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+        nullptr,                                        // const void                     * pNext
+        0,                                              // VkPipelineLayoutCreateFlags      flags
+        0,                                              // uint32_t                         setLayoutCount
+        nullptr,                                        // const VkDescriptorSetLayout    * pSetLayouts
+        1,                                              // uint32_t                         pushConstantRangeCount
+        &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    VkResult result = vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &mPipelineLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create clustered lighting pipeline layout." << std::endl;
+        destroy();
+        return false;
+    }
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    bool created = createShaderModuleFromFile(mLogicalDevice, "cluster_lights.comp", shaderModule) &&
+                   createComputePipeline(mLogicalDevice, shaderModule, mPipelineLayout, nullptr, pipelineCache, mPipeline);
+    destroyShaderModule(mLogicalDevice, shaderModule);
+    if(!created)
+    {
+        destroy();
+        return false;
+    }
+
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkDeviceSize lightSize = VkDeviceSize(parameters.maxLights) * sizeof(ClusteredLight);
+    VkDeviceSize clusterRangeSize = VkDeviceSize(mMaxClusterCount) * 2 * sizeof(uint32_t);
+    VkDeviceSize lightIndexSize = (VkDeviceSize(mIndexCapacity) + 1) * sizeof(uint32_t);
+
+    mFrames.resize(framesInFlight);
+    for(auto &frame : mFrames)
+    {
+        frame = {};
+        if(!createDeviceAddressBuffer(capabilities.memoryProperties, mLogicalDevice, lightSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      hostVisible, frame.lightBuffer, frame.lightMemory, frame.lightAddress, queueFamilies) ||
+           !createDeviceAddressBuffer(capabilities.memoryProperties, mLogicalDevice, sizeof(ShadingData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      hostVisible, frame.shadingBuffer, frame.shadingMemory, frame.shadingAddress, queueFamilies) ||
+           !createDeviceAddressBuffer(capabilities.memoryProperties, mLogicalDevice, clusterRangeSize,
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.clusterRangeBuffer, frame.clusterRangeMemory,
+                                      frame.clusterRangeAddress, queueFamilies) ||
+           !createDeviceAddressBuffer(capabilities.memoryProperties, mLogicalDevice, lightIndexSize,
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.lightIndexBuffer, frame.lightIndexMemory,
+                                      frame.lightIndexAddress, queueFamilies))
+        {
+            destroy();
+            return false;
+        }
+
+        if((vkMapMemory(mLogicalDevice, frame.lightMemory, 0, VK_WHOLE_SIZE, 0, &frame.lightData) != VK_SUCCESS) ||
+           (vkMapMemory(mLogicalDevice, frame.shadingMemory, 0, VK_WHOLE_SIZE, 0, &frame.shadingData) != VK_SUCCESS))
+        {
+            std::cerr << "Could not map clustered lighting buffers." << std::endl;
+            destroy();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ClusteredLighting::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    for(auto &frame : mFrames)
+    {
+        destroyBuffer(mLogicalDevice, frame.lightBuffer);
+        freeMemoryObject(mLogicalDevice, frame.lightMemory);
+        destroyBuffer(mLogicalDevice, frame.shadingBuffer);
+        freeMemoryObject(mLogicalDevice, frame.shadingMemory);
+        destroyBuffer(mLogicalDevice, frame.clusterRangeBuffer);
+        freeMemoryObject(mLogicalDevice, frame.clusterRangeMemory);
+        destroyBuffer(mLogicalDevice, frame.lightIndexBuffer);
+        freeMemoryObject(mLogicalDevice, frame.lightIndexMemory);
+    }
+    mFrames.clear();
+    destroyPipeline(mLogicalDevice, mPipeline);
+    destroyPipelineLayout(mLogicalDevice, mPipelineLayout);
+
+    mMaxClusterCount = 0;
+    mIndexCapacity   = 0;
+    mStats           = {};
+}
+
+bool ClusteredLighting::setLights(uint32_t frameIndex, std::vector<ClusteredLight> const &lights)
+{
+    FrameResources &frame = mFrames[frameIndex];
+    if(lights.size() > mParameters.maxLights)
+    {
+        std::cerr << "Clustered lighting holds at most " << mParameters.maxLights << " lights, got " << lights.size() << "." << std::endl;
+        frame.lightCount = 0;
+        return false;
+    }
+
+    std::memcpy(frame.lightData, lights.data(), lights.size() * sizeof(ClusteredLight));
+    frame.lightCount = static_cast<uint32_t>(lights.size());
+    return true;
+}
+
+void ClusteredLighting::recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex, ClusteredLightingView const &view)
+{
+    PROFILE_FUNCTION();
+
+    if((view.extent.width > mMaxExtent.width) || (view.extent.height > mMaxExtent.height) ||
+       (view.extent.width == 0) || (view.extent.height == 0))
+    {
+        std::cerr << "Clustered lighting cannot cull for a " << view.extent.width << " x " << view.extent.height << " target." << std::endl;
+        return;
+    }
+
+    FrameResources &frame = mFrames[frameIndex];
+    ClusterGrid grid = getClusterGrid(mParameters, view.extent);
+
+    ShadingData shading;
+    shading.view          = view.view;
+    shading.gridX         = grid.x;
+    shading.gridY         = grid.y;
+    shading.gridZ         = grid.z;
+    shading.tileSize      = mParameters.tileSize;
+    shading.width         = view.extent.width;
+    shading.height        = view.extent.height;
+    shading.lightCount    = frame.lightCount;
+    shading.indexCapacity = mIndexCapacity;
+    shading.tanHalfFovX   = view.tanHalfFovX;
+    shading.tanHalfFovY   = view.tanHalfFovY;
+    shading.nearPlane     = view.nearPlane;
+    shading.farPlane      = view.farPlane;
+    getSliceParameters(view, mParameters.depthSlices, shading.sliceScale, shading.sliceBias);
+    shading.lights        = frame.lightAddress;
+    shading.clusterRanges = frame.clusterRangeAddress;
+    shading.lightIndices  = frame.lightIndexAddress;
+    std::memcpy(frame.shadingData, &shading, sizeof(shading));
+
+    // Reset the counter of reserved index list entries
+    vkCmdFillBuffer(commandBuffer, frame.lightIndexBuffer, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier2 clearBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,                               // VkStructureType          sType
+        nullptr,                                                          // const void             * pNext
+        VK_PIPELINE_STAGE_2_CLEAR_BIT,                                    // VkPipelineStageFlags2    srcStageMask
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,                                   // VkAccessFlags2           srcAccessMask
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,                           // VkPipelineStageFlags2    dstStageMask
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT  // VkAccessFlags2 dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+        nullptr,                                // const void                     * pNext
+        0,                                      // VkDependencyFlags                dependencyFlags
+        1,                                      // uint32_t                         memoryBarrierCount
+        &clearBarrier,                          // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                      // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        0,                                      // uint32_t                         imageMemoryBarrierCount
+        nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(frame.shadingAddress), &frame.shadingAddress);
+    vkCmdDispatch(commandBuffer, grid.x, grid.y, grid.z);
+
+    mStats.lightCount    = frame.lightCount;
+    mStats.grid          = grid;
+    mStats.clusterCount  = grid.x * grid.y * grid.z;
+    mStats.indexCapacity = mIndexCapacity;
+}
+
+VkDeviceAddress ClusteredLighting::getShadingData(uint32_t frameIndex) const
+{
+    return mFrames[frameIndex].shadingAddress;
+}
+
+VkBuffer ClusteredLighting::getClusterRangeBuffer(uint32_t frameIndex) const
+{
+    return mFrames[frameIndex].clusterRangeBuffer;
+}
+
+VkBuffer ClusteredLighting::getLightIndexBuffer(uint32_t frameIndex) const
+{
+    return mFrames[frameIndex].lightIndexBuffer;
+}
+
+ClusteredLightingStats ClusteredLighting::getStats() const
+{
+    return mStats;
+}
+
+void referenceAssignLights(ClusteredLightingParameters const &parameters, ClusteredLightingView const &view,
+                           std::vector<ClusteredLight> const &lights, float radiusScale,
+                           std::vector<std::vector<uint32_t>> &clusterLights)
+{
+  ClusterGrid grid = ClusteredLighting::getClusterGrid(parameters, view.extent);
+  float sliceScale, sliceBias;
+  getSliceParameters(view, parameters.depthSlices, sliceScale, sliceBias);
+
+  std::vector<Float3> viewPositions;
+  viewPositions.reserve(lights.size());
+  for(auto &light : lights)
+    viewPositions.push_back(transformPoint(view.view, { light.position[0], light.position[1], light.position[2] }));
+
+  clusterLights.assign(size_t(grid.x) * grid.y * grid.z, {});
+  for(uint32_t z = 0; z < grid.z; ++z)
+  {
+    for(uint32_t y = 0; y < grid.y; ++y)
+    {
+      for(uint32_t x = 0; x < grid.x; ++x)
+      {
+        ClusterBounds bounds = getClusterBounds(view, parameters.tileSize, sliceScale, sliceBias, x, y, z);
+        auto &cluster = clusterLights[(size_t(z) * grid.y + y) * grid.x + x];
+        for(uint32_t index = 0; index < lights.size(); ++index)
+        {
+          Float3 const &position = viewPositions[index];
+          float dx = position.x - std::min(std::max(position.x, bounds.minimum.x), bounds.maximum.x);
+          float dy = position.y - std::min(std::max(position.y, bounds.minimum.y), bounds.maximum.y);
+          float dz = position.z - std::min(std::max(position.z, bounds.minimum.z), bounds.maximum.z);
+          float radius = lights[index].radius * radiusScale;
+          if(dx * dx + dy * dy + dz * dz <= radius * radius)
+            cluster.push_back(index);
+        }
+      }
+    }
+  }
+}
+
+} // namespace VulkanSample
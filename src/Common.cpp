@@ -1,12 +1,44 @@
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 
 #include "Common.h"
+#include "Profiler.h"
 
 namespace VulkanSample
 {
 
+namespace
+{
+  // vkGetInstanceProcAddr returns loader trampolines for device-level functions, they dispatch on
+  // the device handle, so lazily resolved functions stay valid for every device
+  std::atomic<VkInstance> lazyFunctionInstance(nullptr);
+  std::atomic<bool> multiDeviceDispatch(false);
+
+  PFN_vkVoidFunction getDeviceFunction(VkDevice logicalDevice, char const *name)
+  {
+    if(multiDeviceDispatch)
+      return vkGetInstanceProcAddr(lazyFunctionInstance.load(), name);
+    return vkGetDeviceProcAddr(logicalDevice, name);
+  }
+
+  PFN_vkVoidFunction resolveLazyFunction(char const *name)
+  {
+    PFN_vkVoidFunction function = vkGetInstanceProcAddr(lazyFunctionInstance.load(), name);
+    if(function == nullptr)
+    {
+      std::cerr << "Could not load device-level Vulkan function named: " << name << std::endl;
+      std::abort();
+    }
+    return function;
+  }
+}
+
 bool loadVkLibrary(LIBRARY_TYPE &vkLibrary)
 {
+  PROFILE_FUNCTION();
+
 #if defined _WIN32
     vkLibrary = LoadLibrary( "vulkan-1.dll" );
 #elif defined __linux
@@ -23,6 +55,8 @@ bool loadVkLibrary(LIBRARY_TYPE &vkLibrary)
 
 bool loadFunctionFromVulkanLibrary(LIBRARY_TYPE const &vkLibrary)
 {
+  PROFILE_FUNCTION();
+
 #if defined _WIN32
   #define LoadFunction GetProcAddress
 #elif defined __linux
@@ -44,6 +78,8 @@ bool loadFunctionFromVulkanLibrary(LIBRARY_TYPE const &vkLibrary)
 
 bool loadGlobalLevelFunctions()
 {
+  PROFILE_FUNCTION();
+
 #define GLOBAL_LEVEL_VULKAN_FUNCTION(name)                                \
     name = (PFN_##name)vkGetInstanceProcAddr(nullptr, #name);             \
     if(name == nullptr) {                                                 \
@@ -59,6 +95,8 @@ bool loadGlobalLevelFunctions()
 
 bool checkAvailableInstanceExtensions(std::vector<VkExtensionProperties> &availableExtensions)
 {
+  PROFILE_FUNCTION();
+
   uint32_t extensionsCount = 0;
   VkResult result = VK_SUCCESS;
 
@@ -124,6 +162,8 @@ bool isLayerSupported(const char* desiredLayer)
 
 bool createInstance(std::vector<const char*> &desiredExtensions, const char* const appName, VkInstance &instance)
 {
+  PROFILE_FUNCTION();
+
   std::vector<VkExtensionProperties> availableExtensions;
   if(!checkAvailableInstanceExtensions(availableExtensions))
     return false;
@@ -183,6 +223,8 @@ bool createInstance(std::vector<const char*> &desiredExtensions, const char* con
 
 bool loadInstanceLevelFunctions(VkInstance &instance, std::vector<char const *> const & enabledExtensions)
 {
+  PROFILE_FUNCTION();
+
 // Load core Vulkan API instance-level functions
 #define INSTANCE_LEVEL_VULKAN_FUNCTION(name)                                  \
     name = (PFN_##name)vkGetInstanceProcAddr(instance, #name);                \
@@ -211,11 +253,14 @@ bool loadInstanceLevelFunctions(VkInstance &instance, std::vector<char const *>
 
 #include "ListOfVulkanFunctions.inl"
 
+    lazyFunctionInstance = instance;
     return true;
 }
 
 bool enumerateAvailablePhysicalDevices(VkInstance &instance, std::vector<VkPhysicalDevice> &availableDevices)
 {
+  PROFILE_FUNCTION();
+
   uint32_t devices_count = 0;
   VkResult result = VK_SUCCESS;
 
@@ -239,6 +284,8 @@ bool enumerateAvailablePhysicalDevices(VkInstance &instance, std::vector<VkPhysi
 
 bool checkAvailableDeviceExtensions(VkPhysicalDevice physicalDevice, std::vector<VkExtensionProperties> &availableExtensions)
 {
+  PROFILE_FUNCTION();
+
   uint32_t extensionsCount = 0;
   VkResult result = VK_SUCCESS;
 
@@ -325,24 +372,52 @@ bool selectQueueFamilyIndex(VkPhysicalDevice physicalDevice, VkSurfaceKHR presen
   return false;
 }
 
-bool loadDeviceLevelFunctions(VkDevice logicalDevice, std::vector<const char *> const &enabledExtensions)
+void setMultiDeviceDispatch(bool enabled)
+{
+  multiDeviceDispatch = enabled;
+}
+
+bool loadDeviceLevelFunctions(VkDevice logicalDevice, uint32_t apiVersion, std::vector<const char *> const &enabledExtensions)
 {
+  PROFILE_FUNCTION();
+
   // Load core Vulkan API device-level functions
 #define DEVICE_LEVEL_VULKAN_FUNCTION(name)                                                 \
-  name = (PFN_##name)vkGetDeviceProcAddr(logicalDevice, #name);                            \
+  name = (PFN_##name)getDeviceFunction(logicalDevice, #name);                              \
   if(name == nullptr)                                                                      \
   {                                                                                        \
     std::cerr << "Could not load device-level Vulkan function named: " #name << std::endl; \
     return false;                                                                          \
   }
 
+  // Install trampolines that resolve a function on its first call, the function-local static
+  // makes concurrent first calls safe
+#define DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(name)                                              \
+  name = [](auto... arguments)                                                             \
+  {                                                                                        \
+    static PFN_##name const function = (PFN_##name)resolveLazyFunction(#name);             \
+    return function(arguments...);                                                         \
+  };
+
+  // Load core device-level functions promoted in newer API versions, when the device supports them
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(name, version)                               \
+  if(apiVersion >= version)                                                                \
+  {                                                                                        \
+    name = (PFN_##name)getDeviceFunction(logicalDevice, #name);                            \
+    if(name == nullptr)                                                                    \
+    {                                                                                      \
+      std::cerr << "Could not load device-level Vulkan function named: " #name << std::endl; \
+      return false;                                                                        \
+    }                                                                                      \
+  }
+
   // Load device-level functions from enabled extensions
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension)          \
     for(auto &enabledExtension : enabledExtensions) \
     {                      \
       if(std::string(enabledExtension) == std::string(extension))                                \
       {                                                                                          \
-        name = (PFN_##name)vkGetDeviceProcAddr(logicalDevice, #name);                            \
+        name = (PFN_##name)getDeviceFunction(logicalDevice, #name);                              \
         if(name == nullptr)                                                                      \
         {                                                                                        \
           std::cerr << "Could not load device-level Vulkan function named: " #name << std::endl; \
@@ -356,45 +431,160 @@ bool loadDeviceLevelFunctions(VkDevice logicalDevice, std::vector<const char *>
   return true;
 }
 
-bool createLogicalDevice(VkInstance instance, VkDevice &logicalDevice, std::vector<const char*> &desiredExtensions, VkSurfaceKHR surface,
-                         QueueParameters &graphicsQueue, QueueParameters &computeQueue, QueueParameters &presentQueue)
+bool probePhysicalDevice(VkPhysicalDevice physicalDevice, std::vector<const char*> const &desiredExtensions,
+                         PhysicalDeviceProbe &probe)
 {
+  PROFILE_FUNCTION();
+
+  probe.physicalDevice = physicalDevice;
+  probe.suitable = false;
+  probe.vulkan13Device = false;
+  probe.timelineSemaphoreSupported = false;
+  probe.synchronization2Supported = false;
+  probe.bufferDeviceAddressSupported = false;
+  probe.meshShaderSupported = false;
+  probe.externalMemoryHostSupported = false;
+  probe.pushDescriptorSupported = false;
+  probe.dynamicRenderingSupported = false;
+  probe.graphicsPipelineLibrarySupported = false;
+  probe.storageImageWriteWithoutFormatSupported = false;
+  probe.pipelineStatisticsQuerySupported = false;
+  probe.occlusionQueryPreciseSupported = false;
+  probe.multiDrawIndirectSupported = false;
+  probe.drawIndirectFirstInstanceSupported = false;
+  probe.sparseResidencyImage2DSupported = false;
+  probe.fragmentStoresAndAtomicsSupported = false;
+  probe.availableExtensions.clear();
+  vkGetPhysicalDeviceProperties(physicalDevice, &probe.properties);
+
+  probe.subgroupProperties = {};
+  probe.subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+  if(probe.properties.apiVersion >= VK_API_VERSION_1_1)
+  {
+    VkPhysicalDeviceProperties2 properties2 = {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &probe.subgroupProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+    probe.subgroupProperties.pNext = nullptr;
+  }
 
-  std::vector<VkPhysicalDevice> physicalDevices;
-  enumerateAvailablePhysicalDevices(instance, physicalDevices);
+  if(!selectQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT, probe.graphicsQueueFamilyIndex))
+  {
+    return false;
+  }
 
-  for(auto &physicalDevice : physicalDevices)
+  if(!selectQueueFamilyIndex(physicalDevice, VK_QUEUE_COMPUTE_BIT, probe.computeQueueFamilyIndex))
   {
-    VkPhysicalDeviceFeatures deviceFeatures;
-    VkPhysicalDeviceProperties deviceProperties;
+    return false;
+  }
 
-    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
-    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+  if(!checkAvailableDeviceExtensions(physicalDevice, probe.availableExtensions))
+  {
+    return false;
+  }
 
-    if(!deviceFeatures.geometryShader)
-    {
-      continue;
-    }
-    else
+  bool allExtensionsSupported = true;
+  for(auto &extension : desiredExtensions)
+  {
+    if(!isExtensionSupported(probe.availableExtensions, extension))
     {
-      deviceFeatures = {};
-      deviceFeatures.geometryShader = VK_TRUE;
+      std::cerr << "Extension named '" << extension << "' is not supported by a physical device." << std::endl;
+      allExtensionsSupported = false;
     }
+  }
+  if(!allExtensionsSupported)
+  {
+    return false;
+  }
 
-    uint32_t graphicsQueueFamilyIndex;
-    if(!selectQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT, graphicsQueueFamilyIndex))
-    {
-      continue;
-    }
+  // Optional features are only queried when their extension is present,
+  // devices without them are still eligible and use fallback paths
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+  vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+  meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+  VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures = {};
+  graphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+  VkPhysicalDeviceFeatures2 supportedFeatures = {};
+  supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+  auto appendToChain = [](void *&chain, auto &structure)
+  {
+    structure.pNext = chain;
+    chain = &structure;
+  };
+
+  probe.vulkan13Device = probe.properties.apiVersion >= VK_API_VERSION_1_3;
+  if(probe.vulkan13Device)
+  {
+    appendToChain(supportedFeatures.pNext, vulkan12Features);
+    appendToChain(supportedFeatures.pNext, vulkan13Features);
+  }
+
+  bool meshShaderExtension = isExtensionSupported(probe.availableExtensions, VK_EXT_MESH_SHADER_EXTENSION_NAME);
+  if(meshShaderExtension)
+    appendToChain(supportedFeatures.pNext, meshShaderFeatures);
+
+  bool graphicsPipelineLibraryExtension = isExtensionSupported(probe.availableExtensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+                                          isExtensionSupported(probe.availableExtensions, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+  if(graphicsPipelineLibraryExtension)
+    appendToChain(supportedFeatures.pNext, graphicsPipelineLibraryFeatures);
+
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+  probe.timelineSemaphoreSupported = probe.vulkan13Device && vulkan12Features.timelineSemaphore;
+  probe.synchronization2Supported = probe.vulkan13Device && vulkan13Features.synchronization2;
+  probe.bufferDeviceAddressSupported = probe.vulkan13Device && vulkan12Features.bufferDeviceAddress;
+  probe.meshShaderSupported = meshShaderExtension && meshShaderFeatures.meshShader && meshShaderFeatures.taskShader;
+  probe.externalMemoryHostSupported = isExtensionSupported(probe.availableExtensions, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+  probe.pushDescriptorSupported = isExtensionSupported(probe.availableExtensions, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  probe.dynamicRenderingSupported = probe.vulkan13Device && vulkan13Features.dynamicRendering;
+  probe.graphicsPipelineLibrarySupported = graphicsPipelineLibraryExtension && graphicsPipelineLibraryFeatures.graphicsPipelineLibrary &&
+                                           probe.dynamicRenderingSupported;
+  probe.storageImageWriteWithoutFormatSupported = supportedFeatures.features.shaderStorageImageWriteWithoutFormat;
+  probe.pipelineStatisticsQuerySupported = supportedFeatures.features.pipelineStatisticsQuery;
+  probe.occlusionQueryPreciseSupported = supportedFeatures.features.occlusionQueryPrecise;
+  probe.multiDrawIndirectSupported = supportedFeatures.features.multiDrawIndirect;
+  probe.drawIndirectFirstInstanceSupported = supportedFeatures.features.drawIndirectFirstInstance;
+
+  // Sparse pages of virtual textures are bound on the graphics queue
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+  bool sparseBindingQueue = (queueFamilies[probe.graphicsQueueFamilyIndex].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) != 0;
+  probe.sparseResidencyImage2DSupported = supportedFeatures.features.sparseBinding && supportedFeatures.features.sparseResidencyImage2D &&
+                                          sparseBindingQueue;
+  probe.fragmentStoresAndAtomicsSupported = supportedFeatures.features.fragmentStoresAndAtomics;
+  probe.suitable = true;
+  return true;
+}
+
+bool createLogicalDevice(std::vector<PhysicalDeviceProbe> const &physicalDevices, VkDevice &logicalDevice,
+                         std::vector<const char*> const &desiredExtensions, VkSurfaceKHR surface,
+                         QueueParameters &graphicsQueue, QueueParameters &computeQueue, QueueParameters &presentQueue,
+                         DeviceCapabilities &capabilities)
+{
+  PROFILE_FUNCTION();
 
-    uint32_t computeQueueFamilyIndex;
-    if(!selectQueueFamilyIndex(physicalDevice, VK_QUEUE_COMPUTE_BIT, computeQueueFamilyIndex))
+  for(auto &probe : physicalDevices)
+  {
+    if(!probe.suitable)
     {
       continue;
     }
 
-    uint32_t presentQueueFamilyIndex;
-    if(!selectQueueFamilyIndex(physicalDevice, surface, presentQueueFamilyIndex))
+    VkPhysicalDevice physicalDevice = probe.physicalDevice;
+    uint32_t graphicsQueueFamilyIndex = probe.graphicsQueueFamilyIndex;
+    uint32_t computeQueueFamilyIndex = probe.computeQueueFamilyIndex;
+
+    // Presentation support is the only property that depends on the surface,
+    // headless tools pass no surface and get the graphics queue back as the present queue
+    uint32_t presentQueueFamilyIndex = graphicsQueueFamilyIndex;
+    if((surface != VK_NULL_HANDLE) && !selectQueueFamilyIndex(physicalDevice, surface, presentQueueFamilyIndex))
     {
       continue;
     }
@@ -411,19 +601,84 @@ bool createLogicalDevice(VkInstance instance, VkDevice &logicalDevice, std::vect
     insertIfUnique(requestedQueues, {computeQueueFamilyIndex, { 1.0f }});
     insertIfUnique(requestedQueues, {presentQueueFamilyIndex, { 1.0f }});
 
-    std::vector<VkExtensionProperties> availableExtensions;
-    if(!checkAvailableDeviceExtensions(physicalDevice, availableExtensions))
+    std::vector<const char*> enabledExtensions = desiredExtensions;
+
+    VkPhysicalDeviceFeatures2 enabledFeatures = {};
+    enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+    VkPhysicalDeviceVulkan12Features enabledVulkan12Features = {};
+    enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceVulkan13Features enabledVulkan13Features = {};
+    enabledVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceMeshShaderFeaturesEXT enabledMeshShaderFeatures = {};
+    enabledMeshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT enabledGraphicsPipelineLibraryFeatures = {};
+    enabledGraphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+    auto appendToChain = [](void *&chain, auto &structure)
     {
-      continue;
+      structure.pNext = chain;
+      chain = &structure;
+    };
+
+    // Timeline semaphores and synchronization2 back the render graph
+    bool timelineSynchronizationSupported = probe.timelineSemaphoreSupported && probe.synchronization2Supported;
+    if(probe.vulkan13Device)
+    {
+      enabledVulkan12Features.timelineSemaphore = probe.timelineSemaphoreSupported;
+      enabledVulkan12Features.bufferDeviceAddress = probe.bufferDeviceAddressSupported;
+      enabledVulkan13Features.synchronization2 = probe.synchronization2Supported;
+      enabledVulkan13Features.dynamicRendering = probe.dynamicRenderingSupported;
+      appendToChain(enabledFeatures.pNext, enabledVulkan12Features);
+      appendToChain(enabledFeatures.pNext, enabledVulkan13Features);
     }
 
-    for(auto &extension : desiredExtensions)
+    bool meshShaderSupported = probe.meshShaderSupported;
+    if(meshShaderSupported)
     {
-      if(!isExtensionSupported(availableExtensions, extension))
-      {
-        std::cerr << "Extension named '" << extension << "' is not supported by a physical device." << std::endl;
-        continue;
-      }
+      enabledMeshShaderFeatures.meshShader = VK_TRUE;
+      enabledMeshShaderFeatures.taskShader = VK_TRUE;
+      appendToChain(enabledFeatures.pNext, enabledMeshShaderFeatures);
+      enabledExtensions.emplace_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    }
+
+    // Lets compute shaders write swapchain images whatever their channel order
+    enabledFeatures.features.shaderStorageImageWriteWithoutFormat = probe.storageImageWriteWithoutFormatSupported;
+
+    // Per-pass pipeline statistics and exact occlusion sample counts for pass diagnostics
+    enabledFeatures.features.pipelineStatisticsQuery = probe.pipelineStatisticsQuerySupported;
+    enabledFeatures.features.occlusionQueryPrecise = probe.occlusionQueryPreciseSupported;
+
+    // Merged indirect draws of GeometryPool, firstInstance selects the per-draw record
+    enabledFeatures.features.multiDrawIndirect = probe.multiDrawIndirectSupported;
+    enabledFeatures.features.drawIndirectFirstInstance = probe.drawIndirectFirstInstanceSupported;
+
+    // Sparse residency backend of virtual textures
+    enabledFeatures.features.sparseBinding = probe.sparseResidencyImage2DSupported;
+    enabledFeatures.features.sparseResidencyImage2D = probe.sparseResidencyImage2DSupported;
+    // Fragment shaders record the virtual texture pages they sample
+    enabledFeatures.features.fragmentStoresAndAtomics = probe.fragmentStoresAndAtomicsSupported;
+
+    bool externalMemoryHostSupported = probe.externalMemoryHostSupported;
+    if(externalMemoryHostSupported)
+    {
+      enabledExtensions.emplace_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    }
+
+    bool pushDescriptorSupported = probe.pushDescriptorSupported;
+    if(pushDescriptorSupported)
+    {
+      enabledExtensions.emplace_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    // Pipeline libraries let the pipeline manager link pipelines from precompiled parts
+    bool graphicsPipelineLibrarySupported = probe.graphicsPipelineLibrarySupported;
+    if(graphicsPipelineLibrarySupported)
+    {
+      enabledGraphicsPipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+      appendToChain(enabledFeatures.pNext, enabledGraphicsPipelineLibraryFeatures);
+      enabledExtensions.emplace_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+      enabledExtensions.emplace_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
     }
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
@@ -442,15 +697,15 @@ bool createLogicalDevice(VkInstance instance, VkDevice &logicalDevice, std::vect
 
     VkDeviceCreateInfo deviceCreateInfo = {
       VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,             // VkStructureType                  sType
-      nullptr,                                          // const void                     * pNext
+      &enabledFeatures,                                 // const void                     * pNext
       0,                                                // VkDeviceCreateFlags              flags
       static_cast<uint32_t>(queueCreateInfos.size()),   // uint32_t                         queueCreateInfoCount
       queueCreateInfos.data(),                          // const VkDeviceQueueCreateInfo  * pQueueCreateInfos
       0,                                                // uint32_t                         enabledLayerCount
       nullptr,                                          // const char * const             * ppEnabledLayerNames
-      static_cast<uint32_t>(desiredExtensions.size()), // uint32_t                         enabledExtensionCount
-      desiredExtensions.data(),                        // const char * const             * ppEnabledExtensionNames
-      &deviceFeatures                                  // const VkPhysicalDeviceFeatures * pEnabledFeatures
+      static_cast<uint32_t>(enabledExtensions.size()), // uint32_t                         enabledExtensionCount
+      enabledExtensions.data(),                        // const char * const             * ppEnabledExtensionNames
+      nullptr                                          // const VkPhysicalDeviceFeatures * pEnabledFeatures
     };
 
     VkResult result = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &logicalDevice );
@@ -460,21 +715,94 @@ bool createLogicalDevice(VkInstance instance, VkDevice &logicalDevice, std::vect
       continue;
     }
 
-    if(!loadDeviceLevelFunctions(logicalDevice, {}))
+    if(!loadDeviceLevelFunctions(logicalDevice, probe.properties.apiVersion, enabledExtensions))
     {
       return false;
     }
     vkGetDeviceQueue(logicalDevice, graphicsQueueFamilyIndex, 0, &graphicsQueue.handle);
     vkGetDeviceQueue(logicalDevice, computeQueueFamilyIndex, 0, &computeQueue.handle);
     vkGetDeviceQueue(logicalDevice, presentQueueFamilyIndex, 0, &presentQueue.handle);
+    graphicsQueue.familyIndex = graphicsQueueFamilyIndex;
+    computeQueue.familyIndex = computeQueueFamilyIndex;
+    presentQueue.familyIndex = presentQueueFamilyIndex;
+
+    capabilities.physicalDevice = physicalDevice;
+    capabilities.properties = probe.properties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &capabilities.memoryProperties);
+    capabilities.meshShaderSupported = meshShaderSupported;
+    capabilities.maxTaskWorkGroupCount[0] = 0;
+    capabilities.maxTaskWorkGroupCount[1] = 0;
+    capabilities.maxTaskWorkGroupCount[2] = 0;
+    capabilities.maxTaskWorkGroupTotalCount = 0;
+    if(meshShaderSupported)
+    {
+      VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties = {};
+      meshShaderProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT;
+      VkPhysicalDeviceProperties2 properties2 = {};
+      properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      properties2.pNext = &meshShaderProperties;
+      vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+      for(uint32_t dimension = 0; dimension < 3; ++dimension)
+        capabilities.maxTaskWorkGroupCount[dimension] = meshShaderProperties.maxTaskWorkGroupCount[dimension];
+      capabilities.maxTaskWorkGroupTotalCount = meshShaderProperties.maxTaskWorkGroupTotalCount;
+    }
+    capabilities.externalMemoryHostSupported = externalMemoryHostSupported;
+    capabilities.timelineSynchronizationSupported = timelineSynchronizationSupported;
+    capabilities.bufferDeviceAddressSupported = probe.bufferDeviceAddressSupported;
+    capabilities.subgroupProperties = probe.subgroupProperties;
+    capabilities.pushDescriptorSupported = pushDescriptorSupported;
+    capabilities.maxPushDescriptors = 0;
+    if(pushDescriptorSupported)
+    {
+      VkPhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProperties = {};
+      pushDescriptorProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+      VkPhysicalDeviceProperties2 properties2 = {};
+      properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      properties2.pNext = &pushDescriptorProperties;
+      vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+      capabilities.maxPushDescriptors = pushDescriptorProperties.maxPushDescriptors;
+    }
+    capabilities.dynamicRenderingSupported = probe.dynamicRenderingSupported;
+    capabilities.graphicsPipelineLibrarySupported = graphicsPipelineLibrarySupported;
+    capabilities.graphicsPipelineLibraryFastLinking = false;
+    if(graphicsPipelineLibrarySupported)
+    {
+      VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT graphicsPipelineLibraryProperties = {};
+      graphicsPipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+      VkPhysicalDeviceProperties2 properties2 = {};
+      properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      properties2.pNext = &graphicsPipelineLibraryProperties;
+      vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+      capabilities.graphicsPipelineLibraryFastLinking = graphicsPipelineLibraryProperties.graphicsPipelineLibraryFastLinking;
+    }
+    capabilities.storageImageWriteWithoutFormatSupported = probe.storageImageWriteWithoutFormatSupported;
+    capabilities.pipelineStatisticsQuerySupported = probe.pipelineStatisticsQuerySupported;
+    capabilities.occlusionQueryPreciseSupported = probe.occlusionQueryPreciseSupported;
+    capabilities.multiDrawIndirectSupported = probe.multiDrawIndirectSupported;
+    capabilities.drawIndirectFirstInstanceSupported = probe.drawIndirectFirstInstanceSupported;
+    capabilities.sparseResidencyImage2DSupported = probe.sparseResidencyImage2DSupported;
+    capabilities.fragmentStoresAndAtomicsSupported = probe.fragmentStoresAndAtomicsSupported;
+    capabilities.minImportedHostPointerAlignment = 0;
+    if(externalMemoryHostSupported)
+    {
+      VkPhysicalDeviceExternalMemoryHostPropertiesEXT externalMemoryHostProperties = {};
+      externalMemoryHostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+      VkPhysicalDeviceProperties2 properties2 = {};
+      properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      properties2.pNext = &externalMemoryHostProperties;
+      vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+      capabilities.minImportedHostPointerAlignment = externalMemoryHostProperties.minImportedHostPointerAlignment;
+    }
     return true;
   }
 
   return false;
 }
 
-bool createPresentationSurface(VkInstance instance, WindowParameters windowParameters, VkSurfaceKHR presentationSurface)
+bool createPresentationSurface(VkInstance instance, WindowParameters windowParameters, VkSurfaceKHR &presentationSurface)
 {
+  PROFILE_FUNCTION();
+
   VkResult result = VK_RESULT_MAX_ENUM;
 
 #ifdef VK_USE_PLATFORM_WIN32_KHR
@@ -503,8 +831,8 @@ bool createPresentationSurface(VkInstance instance, WindowParameters windowParam
     VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR,    // VkStructureType                 sType
     nullptr,                                          // const void                    * pNext
     0,                                                // VkXcbSurfaceCreateFlagsKHR      flags
-    window_parameters.Connection,                     // xcb_connection_t              * connection
-    window_parameters.Window                          // xcb_window_t                    window
+    windowParameters.Connection,                      // xcb_connection_t              * connection
+    windowParameters.Window                           // xcb_window_t                    window
   };
   result = vkCreateXcbSurfaceKHR(instance, &surfaceCreateInfo, nullptr, &presentationSurface);
 #endif
@@ -622,6 +950,8 @@ bool createSwapchain(VkPhysicalDevice physicalDevice, VkSurfaceKHR presentationS
                       VkExtent2D &imageSize, VkFormat &imageFormat, VkSwapchainKHR &oldSwapchain, VkSwapchainKHR &swapchain, 
                       std::vector<VkImage> &swapchainImages)
 {
+  PROFILE_FUNCTION();
+
   VkPresentModeKHR presentMode;
   if (!selectPresentationMode(physicalDevice, presentationSurface, desiredMode, presentMode))
     return false;
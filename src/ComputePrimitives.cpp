@@ -0,0 +1,434 @@
+#include <algorithm>
+#include <numeric>
+
+#include "ComputePrimitives.h"
+#include "Profiler.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t WORKGROUP_SIZE       = 256;
+  const uint32_t BLOCK_SIZE           = 1024;  // WORKGROUP_SIZE * ITEMS_PER_THREAD in the shaders
+  const uint32_t RADIX                = 256;
+  const VkDeviceSize SCRATCH_ALIGNMENT = 16;
+
+  // Flags shared with scan_reduce.comp, scan_downsweep.comp and radix_scatter.comp
+  const uint32_t SCAN_FLAG_PREDICATE     = 1;
+  const uint32_t SCAN_FLAG_BLOCK_OFFSETS = 2;
+  const uint32_t SCAN_FLAG_COMPACT       = 4;
+  const uint32_t SCAN_FLAG_WRITE_TOTAL   = 8;
+  const uint32_t SCATTER_FLAG_PAYLOADS   = 1;
+
+  // Push constant blocks, laid out like the shader declarations
+  struct ReduceConstants
+  {
+    VkDeviceAddress source;
+    VkDeviceAddress blockSums;
+    uint32_t        count;
+    uint32_t        flags;
+  };
+
+  struct ScanConstants
+  {
+    VkDeviceAddress source;
+    VkDeviceAddress destination;
+    VkDeviceAddress blockOffsets;
+    VkDeviceAddress payloads;
+    VkDeviceAddress total;
+    uint32_t        count;
+    uint32_t        flags;
+  };
+
+  struct CountConstants
+  {
+    VkDeviceAddress keys;
+    VkDeviceAddress histogram;
+    uint32_t        count;
+    uint32_t        blockCount;
+    uint32_t        keyWords;
+    uint32_t        word;
+    uint32_t        shift;
+  };
+
+  struct ScatterConstants
+  {
+    VkDeviceAddress keys;
+    VkDeviceAddress payloads;
+    VkDeviceAddress sortedKeys;
+    VkDeviceAddress sortedPayloads;
+    VkDeviceAddress histogram;
+    uint32_t        count;
+    uint32_t        blockCount;
+    uint32_t        keyWords;
+    uint32_t        word;
+    uint32_t        shift;
+    uint32_t        flags;
+  };
+
+  char const * const SHADER_NAMES[] = { "scan_reduce.comp", "scan_downsweep.comp", "radix_count.comp", "radix_scatter.comp" };
+
+  uint32_t getBlockCount(uint32_t count)
+  {
+    return std::max<uint32_t>((count + BLOCK_SIZE - 1) / BLOCK_SIZE, 1);
+  }
+
+  VkDeviceSize alignScratch(VkDeviceSize size)
+  {
+    return (size + SCRATCH_ALIGNMENT - 1) & ~(SCRATCH_ALIGNMENT - 1);
+  }
+}
+
+ComputePrimitives::ComputePrimitives()
+{
+    mLogicalDevice   = VK_NULL_HANDLE;
+    mMaxElementCount = 0;
+    mPipelineLayout  = VK_NULL_HANDLE;
+    for(auto &pipeline : mPipelines)
+        pipeline = VK_NULL_HANDLE;
+    mScratchBuffer   = VK_NULL_HANDLE;
+    mScratchMemory   = VK_NULL_HANDLE;
+    mRadixHistogram  = 0;
+    mRadixKeys       = 0;
+    mRadixPayloads   = 0;
+}
+
+ComputePrimitives::~ComputePrimitives()
+{
+    destroy();
+}
+
+bool ComputePrimitives::isSupported(DeviceCapabilities const &capabilities)
+{
+    VkSubgroupFeatureFlags requiredOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    VkPhysicalDeviceLimits const &limits = capabilities.properties.limits;
+    return capabilities.bufferDeviceAddressSupported && capabilities.timelineSynchronizationSupported &&
+           (capabilities.subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+           ((capabilities.subgroupProperties.supportedOperations & requiredOperations) == requiredOperations) &&
+           (limits.maxComputeWorkGroupInvocations >= WORKGROUP_SIZE) && (limits.maxComputeWorkGroupSize[0] >= WORKGROUP_SIZE) &&
+           (limits.maxPushConstantsSize >= sizeof(ScatterConstants));
+}
+
+bool ComputePrimitives::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t maxElementCount,
+                               VkPipelineCache pipelineCache)
+{
+    destroy();
+    mLogicalDevice = logicalDevice;
+
+    if(!isSupported(capabilities))
+    {
+        std::cerr << "Compute primitives require buffer device addresses, synchronization2 and subgroup arithmetic." << std::endl;
+        return false;
+    }
+
+    if(getBlockCount(maxElementCount) > capabilities.properties.limits.maxComputeWorkGroupCount[0])
+    {
+        std::cerr << "Compute primitives cannot process " << maxElementCount << " elements in one dispatch." << std::endl;
+        return false;
+    }
+    mMaxElementCount = maxElementCount;
+
+    VkPushConstantRange pushConstantRange = {
+        VK_SHADER_STAGE_COMPUTE_BIT,            // VkShaderStageFlags     stageFlags
+        0,                                      // uint32_t               offset
+        sizeof(ScatterConstants)                // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+        nullptr,                                        // const void                     * pNext
+        0,                                              // VkPipelineLayoutCreateFlags      flags
+        0,                                              // uint32_t                         setLayoutCount
+        nullptr,                                        // const VkDescriptorSetLayout    * pSetLayouts
+        1,                                              // uint32_t                         pushConstantRangeCount
+        &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    VkResult result = vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &mPipelineLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create compute primitives pipeline layout." << std::endl;
+        destroy();
+        return false;
+    }
+
+    for(uint32_t pipeline = 0; pipeline < PIPELINE_COUNT; ++pipeline)
+    {
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        bool created = createShaderModuleFromFile(mLogicalDevice, SHADER_NAMES[pipeline], shaderModule) &&
+                       createComputePipeline(mLogicalDevice, shaderModule, mPipelineLayout, nullptr, pipelineCache,
+                                             mPipelines[pipeline]);
+        destroyShaderModule(mLogicalDevice, shaderModule);
+        if(!created)
+        {
+            destroy();
+            return false;
+        }
+    }
+
+    // Scratch: block sums of every scan level (sized for the largest scan, the radix histogram
+    // or the input), the radix histogram and the radix sort ping-pong buffers
+    uint32_t blockCount = getBlockCount(maxElementCount);
+    uint32_t largestScan = std::max(maxElementCount, RADIX * blockCount);
+    std::vector<VkDeviceSize> levelOffsets;
+    VkDeviceSize scratchSize = 0;
+    for(uint32_t count = largestScan; count > BLOCK_SIZE; count = getBlockCount(count))
+    {
+        levelOffsets.push_back(scratchSize);
+        scratchSize += alignScratch(getBlockCount(count) * sizeof(uint32_t));
+    }
+    VkDeviceSize histogramOffset = scratchSize;
+    scratchSize += alignScratch(RADIX * blockCount * sizeof(uint32_t));
+    VkDeviceSize keysOffset = scratchSize;
+    scratchSize += alignScratch(static_cast<VkDeviceSize>(maxElementCount) * 2 * sizeof(uint32_t));
+    VkDeviceSize payloadsOffset = scratchSize;
+    scratchSize += alignScratch(static_cast<VkDeviceSize>(maxElementCount) * sizeof(uint32_t));
+
+    VkDeviceAddress scratchAddress;
+    if(!createDeviceAddressBuffer(capabilities.memoryProperties, mLogicalDevice, scratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mScratchBuffer, mScratchMemory, scratchAddress))
+    {
+        destroy();
+        return false;
+    }
+
+    for(VkDeviceSize offset : levelOffsets)
+        mScanLevels.push_back(scratchAddress + offset);
+    mRadixHistogram = scratchAddress + histogramOffset;
+    mRadixKeys      = scratchAddress + keysOffset;
+    mRadixPayloads  = scratchAddress + payloadsOffset;
+    return true;
+}
+
+void ComputePrimitives::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    for(auto &pipeline : mPipelines)
+        destroyPipeline(mLogicalDevice, pipeline);
+    destroyPipelineLayout(mLogicalDevice, mPipelineLayout);
+    destroyBuffer(mLogicalDevice, mScratchBuffer);
+    freeMemoryObject(mLogicalDevice, mScratchMemory);
+
+    mScanLevels.clear();
+    mRadixHistogram  = 0;
+    mRadixKeys       = 0;
+    mRadixPayloads   = 0;
+    mMaxElementCount = 0;
+}
+
+void ComputePrimitives::recordReduce(VkCommandBuffer commandBuffer, VkDeviceAddress values, uint32_t count, VkDeviceAddress result)
+{
+    PROFILE_FUNCTION();
+
+    if(count > mMaxElementCount)
+    {
+        std::cerr << "Reduction of " << count << " elements exceeds the compute primitives scratch." << std::endl;
+        return;
+    }
+
+    recordBarrier(commandBuffer);
+    for(uint32_t level = 0;; ++level)
+    {
+        uint32_t blockCount = getBlockCount(count);
+        ReduceConstants constants = { values, blockCount == 1 ? result : mScanLevels[level], count, 0 };
+        recordDispatch(commandBuffer, PIPELINE_SCAN_REDUCE, &constants, sizeof(constants), blockCount);
+        if(blockCount == 1)
+            break;
+
+        recordBarrier(commandBuffer);
+        values = constants.blockSums;
+        count = blockCount;
+    }
+}
+
+void ComputePrimitives::recordExclusiveScan(VkCommandBuffer commandBuffer, VkDeviceAddress source, VkDeviceAddress destination,
+                                            uint32_t count)
+{
+    PROFILE_FUNCTION();
+
+    if(count > mMaxElementCount)
+    {
+        std::cerr << "Scan of " << count << " elements exceeds the compute primitives scratch." << std::endl;
+        return;
+    }
+
+    recordBarrier(commandBuffer);
+    recordScan(commandBuffer, source, destination, 0, 0, count, 0, 0);
+}
+
+void ComputePrimitives::recordCompact(VkCommandBuffer commandBuffer, VkDeviceAddress values, VkDeviceAddress flags, uint32_t count,
+                                      VkDeviceAddress destination, VkDeviceAddress keptCount)
+{
+    PROFILE_FUNCTION();
+
+    if(count > mMaxElementCount)
+    {
+        std::cerr << "Compaction of " << count << " elements exceeds the compute primitives scratch." << std::endl;
+        return;
+    }
+
+    recordBarrier(commandBuffer);
+    recordScan(commandBuffer, flags, destination, values, keptCount, count,
+               SCAN_FLAG_PREDICATE | SCAN_FLAG_COMPACT | SCAN_FLAG_WRITE_TOTAL, 0);
+}
+
+void ComputePrimitives::recordRadixSort(VkCommandBuffer commandBuffer, RadixSortKeyType keyType, VkDeviceAddress keys,
+                                        VkDeviceAddress payloads, uint32_t count)
+{
+    PROFILE_FUNCTION();
+
+    if(count > mMaxElementCount)
+    {
+        std::cerr << "Radix sort of " << count << " elements exceeds the compute primitives scratch." << std::endl;
+        return;
+    }
+    if(count < 2)
+        return;
+
+    uint32_t keyWords = static_cast<uint32_t>(keyType);
+    uint32_t blockCount = getBlockCount(count);
+    VkDeviceAddress sourceKeys = keys, sourcePayloads = payloads;
+    VkDeviceAddress destinationKeys = mRadixKeys, destinationPayloads = mRadixPayloads;
+
+    // An even number of passes ends in the caller's buffers
+    recordBarrier(commandBuffer);
+    for(uint32_t pass = 0; pass < 4 * keyWords; ++pass)
+    {
+        uint32_t word = pass / 4;
+        uint32_t shift = (pass % 4) * 8;
+
+        CountConstants countConstants = { sourceKeys, mRadixHistogram, count, blockCount, keyWords, word, shift };
+        recordDispatch(commandBuffer, PIPELINE_RADIX_COUNT, &countConstants, sizeof(countConstants), blockCount);
+        recordBarrier(commandBuffer);
+
+        recordScan(commandBuffer, mRadixHistogram, mRadixHistogram, 0, 0, RADIX * blockCount, 0, 0);
+        recordBarrier(commandBuffer);
+
+        ScatterConstants scatterConstants = {
+            sourceKeys, sourcePayloads, destinationKeys, destinationPayloads, mRadixHistogram,
+            count, blockCount, keyWords, word, shift, payloads != 0 ? SCATTER_FLAG_PAYLOADS : 0
+        };
+        recordDispatch(commandBuffer, PIPELINE_RADIX_SCATTER, &scatterConstants, sizeof(scatterConstants), blockCount);
+        if(pass + 1 < 4 * keyWords)
+            recordBarrier(commandBuffer);
+
+        std::swap(sourceKeys, destinationKeys);
+        std::swap(sourcePayloads, destinationPayloads);
+    }
+}
+
+// Reduce-then-scan: block sums are scanned recursively, one scratch level per recursion
+void ComputePrimitives::recordScan(VkCommandBuffer commandBuffer, VkDeviceAddress source, VkDeviceAddress destination,
+                                   VkDeviceAddress payloads, VkDeviceAddress total, uint32_t count, uint32_t flags, uint32_t level)
+{
+    uint32_t blockCount = getBlockCount(count);
+    ScanConstants constants = { source, destination, 0, payloads, total, count, flags };
+    if(blockCount > 1)
+    {
+        VkDeviceAddress blockSums = mScanLevels[level];
+        ReduceConstants reduceConstants = { source, blockSums, count, flags & SCAN_FLAG_PREDICATE };
+        recordDispatch(commandBuffer, PIPELINE_SCAN_REDUCE, &reduceConstants, sizeof(reduceConstants), blockCount);
+        recordBarrier(commandBuffer);
+
+        recordScan(commandBuffer, blockSums, blockSums, 0, 0, blockCount, 0, level + 1);
+        recordBarrier(commandBuffer);
+
+        constants.blockOffsets = blockSums;
+        constants.flags |= SCAN_FLAG_BLOCK_OFFSETS;
+    }
+    recordDispatch(commandBuffer, PIPELINE_SCAN_DOWNSWEEP, &constants, sizeof(constants), blockCount);
+}
+
+void ComputePrimitives::recordDispatch(VkCommandBuffer commandBuffer, Pipeline pipeline, void const *constants, uint32_t size,
+                                       uint32_t groupCount)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelines[pipeline]);
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, constants);
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+}
+
+void ComputePrimitives::recordBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier2 memoryBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,                               // VkStructureType          sType
+        nullptr,                                                          // const void             * pNext
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,                           // VkPipelineStageFlags2    srcStageMask
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT, // VkAccessFlags2 srcAccessMask
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,                           // VkPipelineStageFlags2    dstStageMask
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT  // VkAccessFlags2 dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+        nullptr,                                // const void                     * pNext
+        0,                                      // VkDependencyFlags                dependencyFlags
+        1,                                      // uint32_t                         memoryBarrierCount
+        &memoryBarrier,                         // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                      // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        0,                                      // uint32_t                         imageMemoryBarrierCount
+        nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+uint32_t referenceReduce(std::vector<uint32_t> const &values)
+{
+    return std::accumulate(values.begin(), values.end(), 0u);
+}
+
+void referenceExclusiveScan(std::vector<uint32_t> const &values, std::vector<uint32_t> &prefixSums)
+{
+    prefixSums.resize(values.size());
+    uint32_t sum = 0;
+    for(size_t index = 0; index < values.size(); ++index)
+    {
+        prefixSums[index] = sum;
+        sum += values[index];
+    }
+}
+
+void referenceCompact(std::vector<uint32_t> const &values, std::vector<uint32_t> const &flags, std::vector<uint32_t> &kept)
+{
+    kept.clear();
+    for(size_t index = 0; index < values.size(); ++index)
+    {
+        if(flags[index] != 0)
+            kept.push_back(values[index]);
+    }
+}
+
+void referenceRadixSort(RadixSortKeyType keyType, std::vector<uint32_t> &keys, std::vector<uint32_t> &payloads)
+{
+    size_t keyWords = static_cast<size_t>(keyType);
+    size_t count = keys.size() / keyWords;
+    auto getKey = [&keys, keyWords](size_t index)
+    {
+        uint64_t key = keys[index * keyWords];
+        if(keyWords == 2)
+            key |= static_cast<uint64_t>(keys[index * keyWords + 1]) << 32;
+        return key;
+    };
+
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&getKey](size_t lhs, size_t rhs) { return getKey(lhs) < getKey(rhs); });
+
+    std::vector<uint32_t> sortedKeys(keys.size());
+    std::vector<uint32_t> sortedPayloads(payloads.size());
+    for(size_t index = 0; index < count; ++index)
+    {
+        for(size_t word = 0; word < keyWords; ++word)
+            sortedKeys[index * keyWords + word] = keys[order[index] * keyWords + word];
+        if(!payloads.empty())
+            sortedPayloads[index] = payloads[order[index]];
+    }
+    keys.swap(sortedKeys);
+    payloads.swap(sortedPayloads);
+}
+
+} // namespace VulkanSample
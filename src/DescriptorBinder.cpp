@@ -0,0 +1,462 @@
+#include <algorithm>
+
+#include "DescriptorBinder.h"
+#include "Profiler.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t SETS_PER_POOL = 64;
+
+  bool isBufferDescriptor(VkDescriptorType type)
+  {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+           type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+  }
+
+  bool isTexelBufferDescriptor(VkDescriptorType type)
+  {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+  }
+
+  void hashCombine(uint64_t &hash, uint64_t value)
+  {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+
+  // Only the fields the descriptor type uses take part, the rest of the union may be garbage
+  uint64_t hashDescriptors(std::vector<VkDescriptorType> const &types, DescriptorInfo const *descriptors)
+  {
+    uint64_t hash = types.size();
+    for(size_t index = 0; index < types.size(); ++index)
+    {
+      DescriptorInfo const &descriptor = descriptors[index];
+      if(isBufferDescriptor(types[index]))
+      {
+        hashCombine(hash, reinterpret_cast<uint64_t>(descriptor.buffer.buffer));
+        hashCombine(hash, descriptor.buffer.offset);
+        hashCombine(hash, descriptor.buffer.range);
+      }
+      else if(isTexelBufferDescriptor(types[index]))
+      {
+        hashCombine(hash, reinterpret_cast<uint64_t>(descriptor.texelBuffer));
+      }
+      else
+      {
+        hashCombine(hash, reinterpret_cast<uint64_t>(descriptor.image.sampler));
+        hashCombine(hash, reinterpret_cast<uint64_t>(descriptor.image.imageView));
+        hashCombine(hash, descriptor.image.imageLayout);
+      }
+    }
+    return hash;
+  }
+
+  bool equalDescriptors(std::vector<VkDescriptorType> const &types, DescriptorInfo const *lhs, DescriptorInfo const *rhs)
+  {
+    for(size_t index = 0; index < types.size(); ++index)
+    {
+      if(isBufferDescriptor(types[index]))
+      {
+        if(lhs[index].buffer.buffer != rhs[index].buffer.buffer || lhs[index].buffer.offset != rhs[index].buffer.offset ||
+           lhs[index].buffer.range != rhs[index].buffer.range)
+          return false;
+      }
+      else if(isTexelBufferDescriptor(types[index]))
+      {
+        if(lhs[index].texelBuffer != rhs[index].texelBuffer)
+          return false;
+      }
+      else if(lhs[index].image.sampler != rhs[index].image.sampler || lhs[index].image.imageView != rhs[index].image.imageView ||
+              lhs[index].image.imageLayout != rhs[index].image.imageLayout)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+DescriptorInfo DescriptorInfo::fromBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    DescriptorInfo info = {};
+    info.buffer = { buffer, offset, range };
+    return info;
+}
+
+DescriptorInfo DescriptorInfo::fromImage(VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout)
+{
+    DescriptorInfo info = {};
+    info.image = { sampler, imageView, imageLayout };
+    return info;
+}
+
+DescriptorInfo DescriptorInfo::fromTexelBuffer(VkBufferView texelBuffer)
+{
+    DescriptorInfo info = {};
+    info.texelBuffer = texelBuffer;
+    return info;
+}
+
+DescriptorBinder::DescriptorBinder()
+{
+    mLogicalDevice           = VK_NULL_HANDLE;
+    mPushDescriptorSupported = false;
+    mMaxPushDescriptors      = 0;
+    mFramesInFlight          = 0;
+    mFrame                   = 0;
+    mStats                   = {};
+}
+
+DescriptorBinder::~DescriptorBinder()
+{
+    destroy();
+}
+
+bool DescriptorBinder::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight)
+{
+    destroy();
+
+    if(capabilities.properties.apiVersion < VK_API_VERSION_1_1)
+    {
+        std::cerr << "Descriptor update templates require Vulkan 1.1." << std::endl;
+        return false;
+    }
+
+    mLogicalDevice           = logicalDevice;
+    mPushDescriptorSupported = capabilities.pushDescriptorSupported;
+    mMaxPushDescriptors      = capabilities.maxPushDescriptors;
+    mFramesInFlight          = std::max(framesInFlight, 1u);
+    mFrame                   = 0;
+    mStats                   = {};
+    return true;
+}
+
+void DescriptorBinder::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    for(auto &layout : mLayouts)
+    {
+        for(auto &pushTemplate : layout.pushTemplates)
+            vkDestroyDescriptorUpdateTemplate(mLogicalDevice, pushTemplate.updateTemplate, nullptr);
+        if(layout.updateTemplate != VK_NULL_HANDLE)
+            vkDestroyDescriptorUpdateTemplate(mLogicalDevice, layout.updateTemplate, nullptr);
+        for(auto &pool : layout.pools)
+            destroyDescriptorPool(mLogicalDevice, pool);
+        destroyDescriptorSetLayout(mLogicalDevice, layout.setLayout);
+    }
+    mLayouts.clear();
+    mLogicalDevice = VK_NULL_HANDLE;
+}
+
+bool DescriptorBinder::createLayout(std::vector<DescriptorBinding> const &bindings, bool pushDescriptors, uint32_t &layoutIndex)
+{
+    PROFILE_FUNCTION();
+
+    mLayouts.emplace_back();
+    Layout &layout = mLayouts.back();
+    layout.bindings        = bindings;
+    layout.setLayout       = VK_NULL_HANDLE;
+    layout.updateTemplate  = VK_NULL_HANDLE;
+    layout.poolSetsLeft    = 0;
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    for(auto &binding : bindings)
+    {
+        size_t offset = layout.descriptorTypes.size() * sizeof(DescriptorInfo);
+        layoutBindings.push_back({ binding.binding, binding.type, binding.descriptorCount, binding.stages, nullptr });
+        templateEntries.push_back({
+            binding.binding,                                    // uint32_t            dstBinding
+            0,                                                  // uint32_t            dstArrayElement
+            binding.descriptorCount,                            // uint32_t            descriptorCount
+            binding.type,                                       // VkDescriptorType    descriptorType
+            offset,                                             // size_t              offset
+            sizeof(DescriptorInfo)                              // size_t              stride
+        });
+        layout.descriptorTypes.insert(layout.descriptorTypes.end(), binding.descriptorCount, binding.type);
+    }
+
+    // Dynamic buffers cannot be pushed
+    bool pushable = mPushDescriptorSupported && layout.descriptorTypes.size() <= mMaxPushDescriptors;
+    for(auto type : layout.descriptorTypes)
+        pushable &= type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    layout.pushDescriptors = pushDescriptors && pushable;
+    VkDescriptorSetLayoutCreateFlags flags = layout.pushDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,  // VkStructureType                        sType
+        nullptr,                                              // const void                           * pNext
+        flags,                                                // VkDescriptorSetLayoutCreateFlags       flags
+        static_cast<uint32_t>(layoutBindings.size()),         // uint32_t                               bindingCount
+        layoutBindings.data()                                 // const VkDescriptorSetLayoutBinding   * pBindings
+    };
+
+    layoutIndex = static_cast<uint32_t>(mLayouts.size() - 1);
+    VkResult result = vkCreateDescriptorSetLayout(mLogicalDevice, &descriptorSetLayoutCreateInfo, nullptr, &layout.setLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create descriptor set layout." << std::endl;
+        return false;
+    }
+
+    // Push templates depend on the pipeline layout and are created on first use
+    if(layout.pushDescriptors)
+        return true;
+
+    VkDescriptorUpdateTemplateCreateInfo templateCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO, // VkStructureType                          sType
+        nullptr,                                            // const void                             * pNext
+        0,                                                  // VkDescriptorUpdateTemplateCreateFlags    flags
+        static_cast<uint32_t>(templateEntries.size()),      // uint32_t                                 descriptorUpdateEntryCount
+        templateEntries.data(),                             // const VkDescriptorUpdateTemplateEntry  * pDescriptorUpdateEntries
+        VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,  // VkDescriptorUpdateTemplateType           templateType
+        layout.setLayout,                                   // VkDescriptorSetLayout                    descriptorSetLayout
+        VK_PIPELINE_BIND_POINT_GRAPHICS,                    // VkPipelineBindPoint                      pipelineBindPoint
+        VK_NULL_HANDLE,                                     // VkPipelineLayout                         pipelineLayout
+        0                                                   // uint32_t                                 set
+    };
+
+    result = vkCreateDescriptorUpdateTemplate(mLogicalDevice, &templateCreateInfo, nullptr, &layout.updateTemplate);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create descriptor update template." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+VkDescriptorSetLayout DescriptorBinder::getSetLayout(uint32_t layoutIndex) const
+{
+    return mLayouts[layoutIndex].setLayout;
+}
+
+bool DescriptorBinder::usesPushDescriptors(uint32_t layoutIndex) const
+{
+    return mLayouts[layoutIndex].pushDescriptors;
+}
+
+void DescriptorBinder::beginFrame()
+{
+    ++mFrame;
+    if(mFrame < mFramesInFlight)
+        return;
+
+    for(auto &layout : mLayouts)
+    {
+        for(uint32_t setIndex = 0; setIndex < layout.sets.size(); ++setIndex)
+        {
+            if(layout.sets[setIndex].cached && layout.sets[setIndex].lastUsedFrame + mFramesInFlight <= mFrame)
+                uncacheSet(layout, setIndex);
+        }
+    }
+}
+
+void DescriptorBinder::invalidate()
+{
+    // Sets stay out of the free list until the frames using them are done
+    for(auto &layout : mLayouts)
+    {
+        layout.lookup.clear();
+        for(auto &cachedSet : layout.sets)
+            cachedSet.stale = cachedSet.cached;
+    }
+}
+
+bool DescriptorBinder::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout,
+                            uint32_t set, uint32_t layoutIndex, DescriptorInfo const *descriptors, uint32_t dynamicOffsetCount,
+                            uint32_t const *dynamicOffsets)
+{
+    Layout &layout = mLayouts[layoutIndex];
+    if(layout.pushDescriptors)
+    {
+        VkDescriptorUpdateTemplate updateTemplate;
+        if(!getPushTemplate(layout, bindPoint, pipelineLayout, set, updateTemplate))
+            return false;
+
+        vkCmdPushDescriptorSetWithTemplateKHR(commandBuffer, updateTemplate, pipelineLayout, set, descriptors);
+        mStats.pushedDescriptors += layout.descriptorTypes.size();
+        return true;
+    }
+
+    VkDescriptorSet descriptorSet;
+    if(!getDescriptorSet(layoutIndex, descriptors, descriptorSet))
+        return false;
+
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &descriptorSet, dynamicOffsetCount, dynamicOffsets);
+    return true;
+}
+
+bool DescriptorBinder::getDescriptorSet(uint32_t layoutIndex, DescriptorInfo const *descriptors, VkDescriptorSet &descriptorSet)
+{
+    Layout &layout = mLayouts[layoutIndex];
+    if(layout.updateTemplate == VK_NULL_HANDLE)
+    {
+        std::cerr << "Push descriptor layouts have no descriptor sets." << std::endl;
+        return false;
+    }
+
+    uint64_t hash = hashDescriptors(layout.descriptorTypes, descriptors);
+    auto range = layout.lookup.equal_range(hash);
+    for(auto entry = range.first; entry != range.second; ++entry)
+    {
+        CachedSet &cachedSet = layout.sets[entry->second];
+        if(equalDescriptors(layout.descriptorTypes, cachedSet.descriptors.data(), descriptors))
+        {
+            cachedSet.lastUsedFrame = mFrame;
+            descriptorSet = cachedSet.descriptorSet;
+            ++mStats.cacheHits;
+            mStats.avoidedDescriptorWrites += layout.descriptorTypes.size();
+            return true;
+        }
+    }
+
+    uint32_t setIndex;
+    if(!allocateSet(layout, setIndex))
+        return false;
+
+    CachedSet &cachedSet = layout.sets[setIndex];
+    vkUpdateDescriptorSetWithTemplate(mLogicalDevice, cachedSet.descriptorSet, layout.updateTemplate, descriptors);
+    cachedSet.hash          = hash;
+    cachedSet.lastUsedFrame = mFrame;
+    cachedSet.cached        = true;
+    cachedSet.stale         = false;
+    cachedSet.descriptors.assign(descriptors, descriptors + layout.descriptorTypes.size());
+    layout.lookup.emplace(hash, setIndex);
+
+    descriptorSet = cachedSet.descriptorSet;
+    ++mStats.cacheMisses;
+    ++mStats.cachedSets;
+    mStats.descriptorWrites += layout.descriptorTypes.size();
+    return true;
+}
+
+DescriptorBinderStats const &DescriptorBinder::getStats() const
+{
+    return mStats;
+}
+
+bool DescriptorBinder::getPushTemplate(Layout &layout, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout,
+                                       uint32_t set, VkDescriptorUpdateTemplate &updateTemplate)
+{
+    for(auto &pushTemplate : layout.pushTemplates)
+    {
+        if(pushTemplate.bindPoint == bindPoint && pushTemplate.pipelineLayout == pipelineLayout && pushTemplate.set == set)
+        {
+            updateTemplate = pushTemplate.updateTemplate;
+            return true;
+        }
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    size_t offset = 0;
+    for(auto &binding : layout.bindings)
+    {
+        templateEntries.push_back({ binding.binding, 0, binding.descriptorCount, binding.type, offset, sizeof(DescriptorInfo) });
+        offset += binding.descriptorCount * sizeof(DescriptorInfo);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO, // VkStructureType                          sType
+        nullptr,                                            // const void                             * pNext
+        0,                                                  // VkDescriptorUpdateTemplateCreateFlags    flags
+        static_cast<uint32_t>(templateEntries.size()),      // uint32_t                                 descriptorUpdateEntryCount
+        templateEntries.data(),                             // const VkDescriptorUpdateTemplateEntry  * pDescriptorUpdateEntries
+        VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR, // VkDescriptorUpdateTemplateType      templateType
+        layout.setLayout,                                   // VkDescriptorSetLayout                    descriptorSetLayout
+        bindPoint,                                          // VkPipelineBindPoint                      pipelineBindPoint
+        pipelineLayout,                                     // VkPipelineLayout                         pipelineLayout
+        set                                                 // uint32_t                                 set
+    };
+
+    VkResult result = vkCreateDescriptorUpdateTemplate(mLogicalDevice, &templateCreateInfo, nullptr, &updateTemplate);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create push descriptor update template." << std::endl;
+        return false;
+    }
+    layout.pushTemplates.push_back({ bindPoint, pipelineLayout, set, updateTemplate });
+    return true;
+}
+
+bool DescriptorBinder::allocateSet(Layout &layout, uint32_t &setIndex)
+{
+    if(!layout.freeSets.empty())
+    {
+        setIndex = layout.freeSets.back();
+        layout.freeSets.pop_back();
+        return true;
+    }
+
+    if(layout.poolSetsLeft == 0)
+    {
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        for(auto &binding : layout.bindings)
+            poolSizes.push_back({ binding.type, binding.descriptorCount * SETS_PER_POOL });
+
+        VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+            VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,  // VkStructureType                sType
+            nullptr,                                        // const void                   * pNext
+            0,                                              // VkDescriptorPoolCreateFlags    flags
+            SETS_PER_POOL,                                  // uint32_t                       maxSets
+            static_cast<uint32_t>(poolSizes.size()),        // uint32_t                       poolSizeCount
+            poolSizes.data()                                // const VkDescriptorPoolSize   * pPoolSizes
+        };
+
+        VkDescriptorPool pool;
+        VkResult result = vkCreateDescriptorPool(mLogicalDevice, &descriptorPoolCreateInfo, nullptr, &pool);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not create descriptor pool." << std::endl;
+            return false;
+        }
+        layout.pools.push_back(pool);
+        layout.poolSetsLeft = SETS_PER_POOL;
+    }
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,   // VkStructureType                  sType
+        nullptr,                                          // const void                     * pNext
+        layout.pools.back(),                              // VkDescriptorPool                 descriptorPool
+        1,                                                // uint32_t                         descriptorSetCount
+        &layout.setLayout                                 // const VkDescriptorSetLayout    * pSetLayouts
+    };
+
+    VkDescriptorSet descriptorSet;
+    VkResult result = vkAllocateDescriptorSets(mLogicalDevice, &descriptorSetAllocateInfo, &descriptorSet);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not allocate descriptor set." << std::endl;
+        return false;
+    }
+    --layout.poolSetsLeft;
+
+    setIndex = static_cast<uint32_t>(layout.sets.size());
+    layout.sets.push_back({ descriptorSet, 0, 0, false, false, {} });
+    ++mStats.allocatedSets;
+    return true;
+}
+
+void DescriptorBinder::uncacheSet(Layout &layout, uint32_t setIndex)
+{
+    CachedSet &cachedSet = layout.sets[setIndex];
+    auto range = layout.lookup.equal_range(cachedSet.hash);
+    for(auto entry = range.first; entry != range.second && !cachedSet.stale; ++entry)
+    {
+        if(entry->second == setIndex)
+        {
+            layout.lookup.erase(entry);
+            break;
+        }
+    }
+    --mStats.cachedSets;
+    cachedSet.cached = false;
+    cachedSet.stale = false;
+    layout.freeSets.push_back(setIndex);
+}
+
+} // namespace VulkanSample
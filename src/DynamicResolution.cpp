@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <cmath>
+
+#include "DynamicResolution.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  // Render extents are multiples of this, so the scale does not change every frame by a pixel
+  const uint32_t RENDER_EXTENT_GRANULARITY = 8;
+  const uint32_t UPSCALE_GROUP_SIZE        = 8;
+  const float    DERIVATIVE_SMOOTHING      = 0.5f;
+
+  // Laid out like the push constant block of upscale.comp
+  struct UpscaleConstants
+  {
+    float    uvScale[2];
+    float    uvMax[2];
+    uint32_t outputSize[2];
+    float    sharpness;
+  };
+
+  VkImageMemoryBarrier2 makeImageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                         VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess,
+                                         VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess)
+  {
+    return {
+      VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,   // VkStructureType            sType
+      nullptr,                                    // const void               * pNext
+      srcStages,                                  // VkPipelineStageFlags2      srcStageMask
+      srcAccess,                                  // VkAccessFlags2             srcAccessMask
+      dstStages,                                  // VkPipelineStageFlags2      dstStageMask
+      dstAccess,                                  // VkAccessFlags2             dstAccessMask
+      oldLayout,                                  // VkImageLayout              oldLayout
+      newLayout,                                  // VkImageLayout              newLayout
+      VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   srcQueueFamilyIndex
+      VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   dstQueueFamilyIndex
+      image,                                      // VkImage                    image
+      {                                           // VkImageSubresourceRange    subresourceRange
+        VK_IMAGE_ASPECT_COLOR_BIT,                  // VkImageAspectFlags         aspectMask
+        0,                                          // uint32_t                   baseMipLevel
+        1,                                          // uint32_t                   levelCount
+        0,                                          // uint32_t                   baseArrayLayer
+        1                                           // uint32_t                   layerCount
+      }
+    };
+  }
+
+  void recordImageBarriers(VkCommandBuffer commandBuffer, VkImageMemoryBarrier2 const *barriers, uint32_t barrierCount)
+  {
+    VkDependencyInfo dependencyInfo = {
+      VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+      nullptr,                                // const void                     * pNext
+      0,                                      // VkDependencyFlags                dependencyFlags
+      0,                                      // uint32_t                         memoryBarrierCount
+      nullptr,                                // const VkMemoryBarrier2         * pMemoryBarriers
+      0,                                      // uint32_t                         bufferMemoryBarrierCount
+      nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+      barrierCount,                           // uint32_t                         imageMemoryBarrierCount
+      barriers                                // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+  }
+
+  uint32_t scaleExtent(uint32_t extent, float scale)
+  {
+    uint32_t scaled = static_cast<uint32_t>(std::lround(extent * scale / RENDER_EXTENT_GRANULARITY)) * RENDER_EXTENT_GRANULARITY;
+    return std::max(scaled, RENDER_EXTENT_GRANULARITY);
+  }
+}
+
+DynamicResolution::DynamicResolution()
+{
+    mLogicalDevice         = VK_NULL_HANDLE;
+    mCapabilities          = {};
+    mFramesInFlight        = 0;
+    mRenderFormat          = VK_FORMAT_UNDEFINED;
+    mOutputExtent          = {};
+    mTargetExtent          = {};
+    mRenderExtent          = {};
+    mRenderTarget          = VK_NULL_HANDLE;
+    mRenderTargetMemory    = VK_NULL_HANDLE;
+    mRenderTargetView      = VK_NULL_HANDLE;
+    mTimestampsSupported   = false;
+    mTimestampMask         = 0;
+    mQueryPool             = VK_NULL_HANDLE;
+    mFrameSlot             = 0;
+    mScale                 = 1.0f;
+    mIntegral              = 0.0f;
+    mLastError             = 0.0f;
+    mDerivative            = 0.0f;
+    mFrameTimeHead         = 0;
+    mUpscaleLayoutIndex    = 0;
+    mUpscalePipelineLayout = VK_NULL_HANDLE;
+    mUpscalePipeline       = VK_NULL_HANDLE;
+    mSampler               = VK_NULL_HANDLE;
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    destroy();
+}
+
+bool DynamicResolution::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t queueFamilyIndex,
+                               uint32_t framesInFlight, VkExtent2D outputExtent, VkFormat renderFormat, VkFormat outputFormat,
+                               DynamicResolutionParameters const &parameters, VkPipelineCache pipelineCache)
+{
+    destroy();
+    mLogicalDevice  = logicalDevice;
+    mCapabilities   = capabilities;
+    mFramesInFlight = framesInFlight;
+    mRenderFormat   = renderFormat;
+    mOutputExtent   = outputExtent;
+
+    if(!capabilities.timelineSynchronizationSupported || !capabilities.storageImageWriteWithoutFormatSupported)
+    {
+        std::cerr << "Dynamic resolution requires synchronization2 and storage image writes without format." << std::endl;
+        return false;
+    }
+    if(parameters.minScale <= 0.0f || parameters.minScale > parameters.maxScale)
+    {
+        std::cerr << "Dynamic resolution scale range is invalid." << std::endl;
+        return false;
+    }
+    if(!isFormatFeatureSupported(capabilities.physicalDevice, renderFormat,
+                                 VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+    {
+        std::cerr << "Dynamic resolution render format cannot be rendered to and filtered." << std::endl;
+        return false;
+    }
+    if(!isFormatFeatureSupported(capabilities.physicalDevice, outputFormat, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+    {
+        std::cerr << "Dynamic resolution output format has no storage support, upscale into a UNORM view instead." << std::endl;
+        return false;
+    }
+    mParameters = parameters;
+    mScale      = parameters.maxScale;
+
+    VkPhysicalDeviceLimits const &limits = capabilities.properties.limits;
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(capabilities.physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(capabilities.physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+    mTimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+    mTimestampsSupported = limits.timestampComputeAndGraphics && limits.timestampPeriod > 0.0f && validBits > 0;
+    if(mTimestampsSupported)
+    {
+        VkQueryPoolCreateInfo queryPoolCreateInfo = {
+            VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,     // VkStructureType                  sType
+            nullptr,                                      // const void                     * pNext
+            0,                                            // VkQueryPoolCreateFlags           flags
+            VK_QUERY_TYPE_TIMESTAMP,                      // VkQueryType                      queryType
+            2 * framesInFlight,                           // uint32_t                         queryCount
+            0                                             // VkQueryPipelineStatisticFlags    pipelineStatistics
+        };
+
+        if(vkCreateQueryPool(mLogicalDevice, &queryPoolCreateInfo, nullptr, &mQueryPool) != VK_SUCCESS)
+        {
+            std::cerr << "Could not create dynamic resolution query pool." << std::endl;
+            destroy();
+            return false;
+        }
+        mQueriesWritten.assign(framesInFlight, false);
+    }
+
+    if(!createRenderTarget() || !createUpscalePipeline(pipelineCache))
+    {
+        destroy();
+        return false;
+    }
+    updateRenderExtent();
+    return true;
+}
+
+bool DynamicResolution::createRenderTarget()
+{
+    mTargetExtent = {
+        static_cast<uint32_t>(std::ceil(mOutputExtent.width * mParameters.maxScale)),
+        static_cast<uint32_t>(std::ceil(mOutputExtent.height * mParameters.maxScale))
+    };
+    mTargetExtent.width  = std::max(mTargetExtent.width, RENDER_EXTENT_GRANULARITY);
+    mTargetExtent.height = std::max(mTargetExtent.height, RENDER_EXTENT_GRANULARITY);
+
+    VkImageCreateInfo imageCreateInfo = {
+        VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,              // VkStructureType          sType
+        nullptr,                                          // const void             * pNext
+        0,                                                // VkImageCreateFlags       flags
+        VK_IMAGE_TYPE_2D,                                 // VkImageType              imageType
+        mRenderFormat,                                    // VkFormat                 format
+        { mTargetExtent.width, mTargetExtent.height, 1 }, // VkExtent3D               extent
+        1,                                                // uint32_t                 mipLevels
+        1,                                                // uint32_t                 arrayLayers
+        VK_SAMPLE_COUNT_1_BIT,                            // VkSampleCountFlagBits    samples
+        VK_IMAGE_TILING_OPTIMAL,                          // VkImageTiling            tiling
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // VkImageUsageFlags usage
+        VK_SHARING_MODE_EXCLUSIVE,                        // VkSharingMode            sharingMode
+        0,                                                // uint32_t                 queueFamilyIndexCount
+        nullptr,                                          // const uint32_t         * pQueueFamilyIndices
+        VK_IMAGE_LAYOUT_UNDEFINED                         // VkImageLayout            initialLayout
+    };
+
+    if(vkCreateImage(mLogicalDevice, &imageCreateInfo, nullptr, &mRenderTarget) != VK_SUCCESS)
+    {
+        std::cerr << "Could not create dynamic resolution render target." << std::endl;
+        return false;
+    }
+    return allocateAndBindMemoryObjectToImage(mCapabilities.memoryProperties, mLogicalDevice, mRenderTarget,
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mRenderTargetMemory) &&
+           createImageView(mLogicalDevice, mRenderTarget, mRenderFormat, 0, 1, mRenderTargetView);
+}
+
+bool DynamicResolution::createUpscalePipeline(VkPipelineCache pipelineCache)
+{
+    if(!mDescriptorBinder.create(mLogicalDevice, mCapabilities, mFramesInFlight))
+        return false;
+
+    std::vector<DescriptorBinding> bindings = {
+        { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          1, VK_SHADER_STAGE_COMPUTE_BIT }
+    };
+    if(!mDescriptorBinder.createLayout(bindings, true, mUpscaleLayoutIndex))
+        return false;
+    VkDescriptorSetLayout setLayout = mDescriptorBinder.getSetLayout(mUpscaleLayoutIndex);
+
+    VkPushConstantRange pushConstantRange = {
+        VK_SHADER_STAGE_COMPUTE_BIT,            // VkShaderStageFlags     stageFlags
+        0,                                      // uint32_t               offset
+        sizeof(UpscaleConstants)                // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+        nullptr,                                        // const void                     * pNext
+        0,                                              // VkPipelineLayoutCreateFlags      flags
+        1,                                              // uint32_t                         setLayoutCount
+        &setLayout,                                     // const VkDescriptorSetLayout    * pSetLayouts
+        1,                                              // uint32_t                         pushConstantRangeCount
+        &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    if(vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &mUpscalePipelineLayout) != VK_SUCCESS)
+    {
+        std::cerr << "Could not create upscale pipeline layout." << std::endl;
+        return false;
+    }
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    bool created = createShaderModuleFromFile(mLogicalDevice, "upscale.comp", shaderModule) &&
+                   createComputePipeline(mLogicalDevice, shaderModule, mUpscalePipelineLayout, nullptr, pipelineCache,
+                                         mUpscalePipeline);
+    destroyShaderModule(mLogicalDevice, shaderModule);
+    return created && createSampler(mLogicalDevice, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, mSampler);
+}
+
+void DynamicResolution::destroyRenderTarget()
+{
+    destroyImageView(mLogicalDevice, mRenderTargetView);
+    destroyImage(mLogicalDevice, mRenderTarget);
+    freeMemoryObject(mLogicalDevice, mRenderTargetMemory);
+}
+
+void DynamicResolution::destroy()
+{
+    destroyRenderTarget();
+    if(mQueryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(mLogicalDevice, mQueryPool, nullptr);
+        mQueryPool = VK_NULL_HANDLE;
+    }
+    destroySampler(mLogicalDevice, mSampler);
+    destroyPipeline(mLogicalDevice, mUpscalePipeline);
+    destroyPipelineLayout(mLogicalDevice, mUpscalePipelineLayout);
+    mDescriptorBinder.destroy();
+
+    mQueriesWritten.clear();
+    mFrameTimes.clear();
+    mFrameTimeHead = 0;
+    mIntegral      = 0.0f;
+    mLastError     = 0.0f;
+    mDerivative    = 0.0f;
+}
+
+bool DynamicResolution::resize(VkExtent2D outputExtent)
+{
+    // Cached descriptor sets reference the old target and swapchain views
+    mDescriptorBinder.invalidate();
+    destroyRenderTarget();
+    mOutputExtent = outputExtent;
+    if(!createRenderTarget())
+        return false;
+    updateRenderExtent();
+    return true;
+}
+
+void DynamicResolution::setParameters(DynamicResolutionParameters const &parameters)
+{
+    // A larger maxScale is limited by the render target until the next resize()
+    mParameters = parameters;
+    mParameters.minScale = std::min(mParameters.minScale, mParameters.maxScale);
+    mScale = std::min(std::max(mScale, mParameters.minScale), mParameters.maxScale);
+    updateRenderExtent();
+}
+
+void DynamicResolution::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    mFrameSlot = frameIndex % mFramesInFlight;
+    mDescriptorBinder.beginFrame();
+    if(mTimestampsSupported)
+    {
+        // The frame that used this slot has finished, its results are available without waiting
+        uint32_t firstQuery = 2 * mFrameSlot;
+        if(mQueriesWritten[mFrameSlot])
+        {
+            uint64_t timestamps[2];
+            VkResult result = vkGetQueryPoolResults(mLogicalDevice, mQueryPool, firstQuery, 2, sizeof(timestamps), timestamps,
+                                                    sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+            if(result == VK_SUCCESS)
+            {
+                // Only the valid bits count, the difference stays right when the counter wrapped between the two
+                uint64_t ticks = (timestamps[1] - timestamps[0]) & mTimestampMask;
+                float period = mCapabilities.properties.limits.timestampPeriod;
+                updateController(static_cast<float>(ticks * static_cast<double>(period) * 1e-6));
+                updateRenderExtent();
+            }
+            mQueriesWritten[mFrameSlot] = false;
+        }
+        vkCmdResetQueryPool(commandBuffer, mQueryPool, firstQuery, 2);
+        vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, mQueryPool, firstQuery);
+    }
+
+    // Contents of the previous frame are not needed, only the upscale read has to finish
+    VkImageMemoryBarrier2 barrier = makeImageBarrier(mRenderTarget, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                     VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+                                                     VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                                     VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+    recordImageBarriers(commandBuffer, &barrier, 1);
+}
+
+void DynamicResolution::updateController(float frameMs)
+{
+    if(mFrameTimes.size() < FRAME_TIME_WINDOW)
+        mFrameTimes.push_back(frameMs);
+    else
+        mFrameTimes[mFrameTimeHead] = frameMs;
+    mFrameTimeHead = (mFrameTimeHead + 1) % FRAME_TIME_WINDOW;
+
+    // Normalized error, positive when the frame was over budget. The controller output lowers the
+    // scale from maxScale; the integral term carries the steady reduction a heavy scene needs.
+    float error = (frameMs - mParameters.targetFrameMs) / mParameters.targetFrameMs;
+    mDerivative = DERIVATIVE_SMOOTHING * mDerivative + (1.0f - DERIVATIVE_SMOOTHING) * (error - mLastError);
+    mLastError  = error;
+
+    float integral = mIntegral + error;
+    float output = mParameters.proportionalGain * error + mParameters.integralGain * integral +
+                   mParameters.derivativeGain * mDerivative;
+    float unclamped = mParameters.maxScale - output;
+    mScale = std::min(std::max(unclamped, mParameters.minScale), mParameters.maxScale);
+
+    // Anti-windup: stop integrating while saturated, unless the error pulls back into range
+    bool saturatedHigh = unclamped > mParameters.maxScale;
+    bool saturatedLow  = unclamped < mParameters.minScale;
+    if((!saturatedHigh && !saturatedLow) || (saturatedHigh && error > 0.0f) || (saturatedLow && error < 0.0f))
+        mIntegral = integral;
+}
+
+void DynamicResolution::updateRenderExtent()
+{
+    mRenderExtent.width  = std::min(scaleExtent(mOutputExtent.width, mScale), mTargetExtent.width);
+    mRenderExtent.height = std::min(scaleExtent(mOutputExtent.height, mScale), mTargetExtent.height);
+}
+
+VkExtent2D DynamicResolution::getRenderExtent() const
+{
+    return mRenderExtent;
+}
+
+VkImage DynamicResolution::getRenderTarget() const
+{
+    return mRenderTarget;
+}
+
+VkImageView DynamicResolution::getRenderTargetView() const
+{
+    return mRenderTargetView;
+}
+
+bool DynamicResolution::recordUpscale(VkCommandBuffer commandBuffer, VkImage outputImage, VkImageView outputView,
+                                      VkImageLayout finalLayout)
+{
+    VkImageMemoryBarrier2 barriers[2] = {
+        makeImageBarrier(mRenderTarget, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT),
+        makeImageBarrier(outputImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+    };
+    recordImageBarriers(commandBuffer, barriers, 2);
+
+    DescriptorInfo descriptors[2] = {
+        DescriptorInfo::fromImage(mSampler, mRenderTargetView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+        DescriptorInfo::fromImage(VK_NULL_HANDLE, outputView, VK_IMAGE_LAYOUT_GENERAL)
+    };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mUpscalePipeline);
+    if(!mDescriptorBinder.bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mUpscalePipelineLayout, 0, mUpscaleLayoutIndex,
+                               descriptors))
+        return false;
+
+    UpscaleConstants constants = {
+        { static_cast<float>(mRenderExtent.width) / (mTargetExtent.width * mOutputExtent.width),
+          static_cast<float>(mRenderExtent.height) / (mTargetExtent.height * mOutputExtent.height) },
+        { (mRenderExtent.width - 0.5f) / mTargetExtent.width,
+          (mRenderExtent.height - 0.5f) / mTargetExtent.height },
+        { mOutputExtent.width, mOutputExtent.height },
+        mParameters.sharpness
+    };
+    vkCmdPushConstants(commandBuffer, mUpscalePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (mOutputExtent.width + UPSCALE_GROUP_SIZE - 1) / UPSCALE_GROUP_SIZE,
+                  (mOutputExtent.height + UPSCALE_GROUP_SIZE - 1) / UPSCALE_GROUP_SIZE, 1);
+
+    VkImageMemoryBarrier2 outputBarrier = makeImageBarrier(outputImage, VK_IMAGE_LAYOUT_GENERAL, finalLayout,
+                                                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                                           VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                                                           VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT);
+    recordImageBarriers(commandBuffer, &outputBarrier, 1);
+
+    if(mTimestampsSupported)
+    {
+        vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mQueryPool, 2 * mFrameSlot + 1);
+        mQueriesWritten[mFrameSlot] = true;
+    }
+    return true;
+}
+
+DynamicResolutionStats DynamicResolution::getStats() const
+{
+    DynamicResolutionStats stats = {};
+    stats.parameters          = mParameters;
+    stats.scale               = mScale;
+    stats.renderExtent        = mRenderExtent;
+    stats.outputExtent        = mOutputExtent;
+    stats.timestampsSupported = mTimestampsSupported;
+    stats.sampleCount         = static_cast<uint32_t>(mFrameTimes.size());
+    stats.error               = mLastError;
+    stats.integral            = mIntegral;
+    stats.derivative          = mDerivative;
+    if(mFrameTimes.empty())
+        return stats;
+
+    stats.lastFrameMs = mFrameTimes[(mFrameTimeHead + FRAME_TIME_WINDOW - 1) % FRAME_TIME_WINDOW];
+    std::vector<float> sorted = mFrameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](float fraction)
+    {
+        return sorted[std::min(static_cast<size_t>(fraction * sorted.size()), sorted.size() - 1)];
+    };
+    stats.frameMsP50 = percentile(0.50f);
+    stats.frameMsP95 = percentile(0.95f);
+    stats.frameMsP99 = percentile(0.99f);
+    return stats;
+}
+
+} // namespace VulkanSample
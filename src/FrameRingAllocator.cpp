@@ -0,0 +1,201 @@
+#include <algorithm>
+
+#include "FrameRingAllocator.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  // Without resizable BAR the DEVICE_LOCAL | HOST_VISIBLE heap is a 256 MB window the driver uses
+  // as well, so it is only taken when the ring needs a small part of it
+  const VkDeviceSize DEVICE_LOCAL_HEAP_FRACTION = 4;
+
+  bool selectRingMemoryType(VkPhysicalDeviceMemoryProperties const &memoryProperties, uint32_t memoryTypeBits,
+                            VkMemoryPropertyFlags desiredProperties, VkDeviceSize heapUsage, uint32_t &memoryTypeIndex)
+  {
+    for(uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type)
+    {
+      VkMemoryType const &memoryType = memoryProperties.memoryTypes[type];
+      if((memoryTypeBits & (1u << type)) && ((memoryType.propertyFlags & desiredProperties) == desiredProperties) &&
+         (heapUsage <= memoryProperties.memoryHeaps[memoryType.heapIndex].size / DEVICE_LOCAL_HEAP_FRACTION))
+      {
+        memoryTypeIndex = type;
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+FrameRingAllocator::FrameRingAllocator()
+{
+    mLogicalDevice = VK_NULL_HANDLE;
+    mMemory        = VK_NULL_HANDLE;
+    mAlignment     = 1;
+    mCapacity      = 0;
+    mCurrent       = nullptr;
+    mHead          = 0;
+    mStats         = {};
+}
+
+FrameRingAllocator::~FrameRingAllocator()
+{
+    destroy();
+}
+
+bool FrameRingAllocator::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, VkDeviceSize sizePerFrame,
+                                uint32_t framesInFlight, VkBufferUsageFlags usage)
+{
+    destroy();
+    mLogicalDevice = logicalDevice;
+
+    if(sizePerFrame == 0 || framesInFlight == 0)
+    {
+        std::cerr << "Frame ring allocator requires a non-zero size and frame count." << std::endl;
+        return false;
+    }
+
+    VkPhysicalDeviceLimits const &limits = capabilities.properties.limits;
+    mAlignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 16);
+    if(usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+        mAlignment = std::max(mAlignment, limits.minStorageBufferOffsetAlignment);
+    mCapacity = (sizePerFrame + mAlignment - 1) & ~(mAlignment - 1);
+    if(mCapacity > UINT32_MAX)
+    {
+        std::cerr << "Frame ring allocator does not fit into 32-bit dynamic offsets." << std::endl;
+        return false;
+    }
+
+    bool deviceAddress = capabilities.bufferDeviceAddressSupported;
+    if(deviceAddress)
+        usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    mFrames.resize(framesInFlight);
+    for(auto &frame : mFrames)
+    {
+        frame = {};
+        if(!createBuffer(mLogicalDevice, mCapacity, usage, frame.buffer))
+        {
+            destroy();
+            return false;
+        }
+    }
+
+    // All buffers share one allocation, each starts at a multiple of the buffer's alignment
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(mLogicalDevice, mFrames[0].buffer, &memoryRequirements);
+    VkDeviceSize stride = (memoryRequirements.size + memoryRequirements.alignment - 1) & ~(memoryRequirements.alignment - 1);
+    VkDeviceSize allocationSize = stride * framesInFlight;
+
+    VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo = {
+      VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,   // VkStructureType          sType
+      nullptr,                                        // const void             * pNext
+      VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,          // VkMemoryAllocateFlags    flags
+      0                                               // uint32_t                 deviceMask
+    };
+
+    VkMemoryPropertyFlags const candidates[] = {
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+    for(VkMemoryPropertyFlags properties : candidates)
+    {
+        uint32_t memoryTypeIndex;
+        VkDeviceSize heapUsage = (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? allocationSize : 0;
+        if(!selectRingMemoryType(capabilities.memoryProperties, memoryRequirements.memoryTypeBits, properties, heapUsage,
+                                 memoryTypeIndex))
+            continue;
+
+        VkMemoryAllocateInfo memoryAllocateInfo = {
+          VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,                     // VkStructureType    sType
+          deviceAddress ? &memoryAllocateFlagsInfo : nullptr,         // const void       * pNext
+          allocationSize,                                             // VkDeviceSize       allocationSize
+          memoryTypeIndex                                             // uint32_t           memoryTypeIndex
+        };
+
+        // Device local host visible memory may be exhausted even when the heap looked large enough
+        if(vkAllocateMemory(mLogicalDevice, &memoryAllocateInfo, nullptr, &mMemory) == VK_SUCCESS)
+        {
+            VkMemoryPropertyFlags propertyFlags = capabilities.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+            mStats.deviceLocal = (propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+            break;
+        }
+        mMemory = VK_NULL_HANDLE;
+    }
+    if(mMemory == VK_NULL_HANDLE)
+    {
+        std::cerr << "Could not allocate memory for a frame ring allocator." << std::endl;
+        destroy();
+        return false;
+    }
+
+    void *mapping;
+    if(vkMapMemory(mLogicalDevice, mMemory, 0, VK_WHOLE_SIZE, 0, &mapping) != VK_SUCCESS)
+    {
+        std::cerr << "Could not map memory object." << std::endl;
+        destroy();
+        return false;
+    }
+
+    for(size_t index = 0; index < mFrames.size(); ++index)
+    {
+        Frame &frame = mFrames[index];
+        if(vkBindBufferMemory(mLogicalDevice, frame.buffer, mMemory, stride * index) != VK_SUCCESS)
+        {
+            std::cerr << "Could not bind memory object to a buffer." << std::endl;
+            destroy();
+            return false;
+        }
+        frame.data = static_cast<unsigned char *>(mapping) + stride * index;
+
+        if(deviceAddress)
+            frame.deviceAddress = getBufferDeviceAddress(mLogicalDevice, frame.buffer);
+    }
+
+    mStats.capacity = mCapacity;
+    return true;
+}
+
+void FrameRingAllocator::destroy()
+{
+    for(auto &frame : mFrames)
+        destroyBuffer(mLogicalDevice, frame.buffer);
+    mFrames.clear();
+
+    // Freeing a mapped allocation unmaps it
+    freeMemoryObject(mLogicalDevice, mMemory);
+
+    mCurrent = nullptr;
+    mHead    = 0;
+    mStats   = {};
+}
+
+void FrameRingAllocator::beginFrame(uint32_t frameIndex)
+{
+    mStats.highWaterMark = std::max(mStats.highWaterMark, mHead);
+    mCurrent = &mFrames[frameIndex % mFrames.size()];
+    mHead = 0;
+    mStats.allocations = 0;
+}
+
+VkBuffer FrameRingAllocator::getBuffer(uint32_t frameIndex) const
+{
+    return mFrames[frameIndex % mFrames.size()].buffer;
+}
+
+VkDeviceSize FrameRingAllocator::getAlignment() const
+{
+    return mAlignment;
+}
+
+FrameRingAllocatorStats FrameRingAllocator::getStats() const
+{
+    FrameRingAllocatorStats stats = mStats;
+    stats.used          = mHead;
+    stats.highWaterMark = std::max(stats.highWaterMark, mHead);
+    return stats;
+}
+
+} // namespace VulkanSample
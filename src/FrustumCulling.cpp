@@ -0,0 +1,238 @@
+#include "FrustumCulling.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CULLING_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CULLING_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(CULLING_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace VulkanSample
+{
+
+namespace
+{
+  inline bool isSphereVisible(Frustum const &frustum, float x, float y, float z, float radius)
+  {
+    for(auto &plane : frustum.planes)
+    {
+      if(plane.x * x + plane.y * y + plane.z * z + plane.w < -radius)
+        return false;
+    }
+    return true;
+  }
+
+  // Appends begin + lane for every set bit of the mask without branching on the bits themselves
+  inline uint32_t appendMask(uint32_t mask, uint32_t laneCount, uint32_t base, uint32_t *outIndices, uint32_t written)
+  {
+    for(uint32_t lane = 0; lane < laneCount; ++lane)
+    {
+      outIndices[written] = base + lane;
+      written += (mask >> lane) & 1u;
+    }
+    return written;
+  }
+
+  uint32_t cullTail(Frustum const &frustum, SphereArrays const &spheres, uint32_t begin, uint32_t end,
+                    uint32_t *outIndices, uint32_t written)
+  {
+    for(uint32_t i = begin; i < end; ++i)
+    {
+      if(isSphereVisible(frustum, spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]))
+        outIndices[written++] = i;
+    }
+    return written;
+  }
+
+#ifdef CULLING_X86
+  uint32_t cullSpheresSSE(Frustum const &frustum, SphereArrays const &spheres, uint32_t begin, uint32_t end, uint32_t *outIndices)
+  {
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for(uint32_t p = 0; p < 6; ++p)
+    {
+      planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+      planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+      planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+      planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    uint32_t written = 0;
+    uint32_t i = begin;
+    for(; i + 4 <= end; i += 4)
+    {
+      __m128 x = _mm_loadu_ps(spheres.centerX + i);
+      __m128 y = _mm_loadu_ps(spheres.centerY + i);
+      __m128 z = _mm_loadu_ps(spheres.centerZ + i);
+      __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for(uint32_t p = 0; p < 6; ++p)
+      {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                                     _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+      }
+
+      written = appendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), 4, i, outIndices, written);
+    }
+    return cullTail(frustum, spheres, i, end, outIndices, written);
+  }
+
+  TARGET_AVX2
+  uint32_t cullSpheresAVX2(Frustum const &frustum, SphereArrays const &spheres, uint32_t begin, uint32_t end, uint32_t *outIndices)
+  {
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for(uint32_t p = 0; p < 6; ++p)
+    {
+      planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+      planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+      planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+      planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+    }
+
+    uint32_t written = 0;
+    uint32_t i = begin;
+    for(; i + 8 <= end; i += 8)
+    {
+      __m256 x = _mm256_loadu_ps(spheres.centerX + i);
+      __m256 y = _mm256_loadu_ps(spheres.centerY + i);
+      __m256 z = _mm256_loadu_ps(spheres.centerZ + i);
+      __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+
+      __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+      for(uint32_t p = 0; p < 6; ++p)
+      {
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+                                        _mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+      }
+
+      written = appendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), 8, i, outIndices, written);
+    }
+    return cullTail(frustum, spheres, i, end, outIndices, written);
+  }
+
+  bool isAVX2Supported()
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+      return false;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    return avx2 && osxsave && ((_xgetbv(0) & 0x6) == 0x6);
+#else
+    return false;
+#endif
+  }
+#endif // CULLING_X86
+
+#ifdef CULLING_NEON
+  uint32_t cullSpheresNEON(Frustum const &frustum, SphereArrays const &spheres, uint32_t begin, uint32_t end, uint32_t *outIndices)
+  {
+    float32x4_t planeX[6], planeY[6], planeZ[6], planeW[6];
+    for(uint32_t p = 0; p < 6; ++p)
+    {
+      planeX[p] = vdupq_n_f32(frustum.planes[p].x);
+      planeY[p] = vdupq_n_f32(frustum.planes[p].y);
+      planeZ[p] = vdupq_n_f32(frustum.planes[p].z);
+      planeW[p] = vdupq_n_f32(frustum.planes[p].w);
+    }
+
+    uint32_t const laneBitsData[4] = { 1, 2, 4, 8 };
+    uint32x4_t laneBits = vld1q_u32(laneBitsData);
+
+    uint32_t written = 0;
+    uint32_t i = begin;
+    for(; i + 4 <= end; i += 4)
+    {
+      float32x4_t x = vld1q_f32(spheres.centerX + i);
+      float32x4_t y = vld1q_f32(spheres.centerY + i);
+      float32x4_t z = vld1q_f32(spheres.centerZ + i);
+      float32x4_t negativeRadius = vnegq_f32(vld1q_f32(spheres.radius + i));
+
+      uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+      for(uint32_t p = 0; p < 6; ++p)
+      {
+        float32x4_t distance = vmlaq_f32(vmlaq_f32(vmlaq_f32(planeW[p], planeX[p], x), planeY[p], y), planeZ[p], z);
+        inside = vandq_u32(inside, vcgeq_f32(distance, negativeRadius));
+      }
+
+      uint32x4_t bits = vandq_u32(inside, laneBits);
+      uint32x2_t pairs = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+      uint32_t mask = vget_lane_u32(pairs, 0) | vget_lane_u32(pairs, 1);
+      written = appendMask(mask, 4, i, outIndices, written);
+    }
+    return cullTail(frustum, spheres, i, end, outIndices, written);
+  }
+#endif // CULLING_NEON
+}
+
+uint32_t cullSpheresScalar(Frustum const &frustum, SphereArrays const &spheres, uint32_t begin, uint32_t end, uint32_t *outIndices)
+{
+  return cullTail(frustum, spheres, begin, end, outIndices, 0);
+}
+
+CullingKernel selectCullingKernel()
+{
+#ifdef CULLING_X86
+  if(isAVX2Supported())
+    return CullingKernel::AVX2;
+  return CullingKernel::SSE;
+#elif defined CULLING_NEON
+  return CullingKernel::NEON;
+#else
+  return CullingKernel::Scalar;
+#endif
+}
+
+CullSpheresFunction getCullSpheresFunction(CullingKernel kernel)
+{
+  switch(kernel)
+  {
+#ifdef CULLING_X86
+    case CullingKernel::SSE:
+      return cullSpheresSSE;
+    case CullingKernel::AVX2:
+      return isAVX2Supported() ? cullSpheresAVX2 : cullSpheresSSE;
+#endif
+#ifdef CULLING_NEON
+    case CullingKernel::NEON:
+      return cullSpheresNEON;
+#endif
+    default:
+      return cullSpheresScalar;
+  }
+}
+
+char const *getCullingKernelName(CullingKernel kernel)
+{
+  switch(kernel)
+  {
+    case CullingKernel::SSE:
+      return "SSE";
+    case CullingKernel::AVX2:
+      return "AVX2";
+    case CullingKernel::NEON:
+      return "NEON";
+    default:
+      return "Scalar";
+  }
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,427 @@
+#include "GeometryPool.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  // Start of every mesh in the vertex buffer, keeps the vec4-sized reads of drivers aligned
+  const VkDeviceSize VERTEX_ALIGNMENT = 16;
+
+  // Push constant block of geometry_pull.vert
+  struct PullConstants
+  {
+    Float4x4        viewProjection;
+    VkDeviceAddress instances;
+    VkDeviceAddress meshes;
+  };
+
+  bool isValidOffset(uint32_t offset, uint32_t size, uint32_t stride)
+  {
+    return (offset % 4 == 0) && (offset + size <= stride);
+  }
+}
+
+GeometryPool::GeometryPool()
+{
+    mLogicalDevice     = VK_NULL_HANDLE;
+    mMemoryProperties  = {};
+    mParameters        = {};
+    mMultiDrawIndirect = false;
+    mVertexBuffer      = VK_NULL_HANDLE;
+    mVertexMemory      = VK_NULL_HANDLE;
+    mVertexAddress     = 0;
+    mIndexBuffer       = VK_NULL_HANDLE;
+    mIndexMemory       = VK_NULL_HANDLE;
+    mMeshBuffer        = VK_NULL_HANDLE;
+    mMeshMemory        = VK_NULL_HANDLE;
+    mMeshAddress       = 0;
+    mVertexBytes       = 0;
+    mIndexCount        = 0;
+    mPipelineLayout    = VK_NULL_HANDLE;
+    mFrameIndex        = 0;
+    mDrawCount         = 0;
+    mStats             = {};
+}
+
+GeometryPool::~GeometryPool()
+{
+    destroy();
+}
+
+bool GeometryPool::isSupported(DeviceCapabilities const &capabilities)
+{
+    return capabilities.bufferDeviceAddressSupported && capabilities.drawIndirectFirstInstanceSupported &&
+           capabilities.timelineSynchronizationSupported;
+}
+
+bool GeometryPool::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight,
+                          GeometryPoolParameters const &parameters)
+{
+    destroy();
+    mLogicalDevice = logicalDevice;
+
+    if(!isSupported(capabilities))
+    {
+        std::cerr << "Vertex pulling requires buffer device addresses, drawIndirectFirstInstance and synchronization2." << std::endl;
+        return false;
+    }
+    if((parameters.vertexBytes == 0) || (parameters.maxIndices == 0) || (parameters.maxMeshes == 0) ||
+       (parameters.maxDrawsPerFrame == 0) || (framesInFlight == 0))
+    {
+        std::cerr << "Invalid geometry pool parameters." << std::endl;
+        return false;
+    }
+
+    mMemoryProperties  = capabilities.memoryProperties;
+    mParameters        = parameters;
+    mMultiDrawIndirect = capabilities.multiDrawIndirectSupported &&
+                         (capabilities.properties.limits.maxDrawIndirectCount >= parameters.maxDrawsPerFrame);
+
+    VkBufferUsageFlags transferDst = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if(!createDeviceAddressBuffer(mMemoryProperties, mLogicalDevice, parameters.vertexBytes,
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | transferDst, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  mVertexBuffer, mVertexMemory, mVertexAddress) ||
+       !createBuffer(mLogicalDevice, VkDeviceSize(parameters.maxIndices) * sizeof(uint32_t),
+                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT | transferDst, mIndexBuffer) ||
+       !allocateAndBindMemoryObjectToBuffer(mMemoryProperties, mLogicalDevice, mIndexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                            mIndexMemory) ||
+       !createDeviceAddressBuffer(mMemoryProperties, mLogicalDevice, VkDeviceSize(parameters.maxMeshes) * sizeof(GpuMesh),
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | transferDst, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  mMeshBuffer, mMeshMemory, mMeshAddress))
+    {
+        destroy();
+        return false;
+    }
+
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    mFrames.resize(framesInFlight);
+    for(auto &frame : mFrames)
+    {
+        frame = {};
+        void *instanceData = nullptr;
+        void *commandData = nullptr;
+        if(!createDeviceAddressBuffer(mMemoryProperties, mLogicalDevice, VkDeviceSize(parameters.maxDrawsPerFrame) * sizeof(GpuInstance),
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, frame.instanceBuffer, frame.instanceMemory,
+                                      frame.instanceAddress) ||
+           !createHostVisibleBuffer(mMemoryProperties, mLogicalDevice,
+                                    VkDeviceSize(parameters.maxDrawsPerFrame) * sizeof(VkDrawIndexedIndirectCommand),
+                                    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, nullptr, frame.commandBuffer, frame.commandMemory))
+        {
+            destroy();
+            return false;
+        }
+
+        if((vkMapMemory(mLogicalDevice, frame.instanceMemory, 0, VK_WHOLE_SIZE, 0, &instanceData) != VK_SUCCESS) ||
+           (vkMapMemory(mLogicalDevice, frame.commandMemory, 0, VK_WHOLE_SIZE, 0, &commandData) != VK_SUCCESS))
+        {
+            std::cerr << "Could not map geometry pool draw buffers." << std::endl;
+            destroy();
+            return false;
+        }
+        frame.instances = static_cast<GpuInstance*>(instanceData);
+        frame.commands = static_cast<VkDrawIndexedIndirectCommand*>(commandData);
+    }
+
+    VkPushConstantRange pushConstantRange = {
+        VK_SHADER_STAGE_VERTEX_BIT,             // VkShaderStageFlags     stageFlags
+        0,                                      // uint32_t               offset
+        sizeof(PullConstants)                   // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+        nullptr,                                        // const void                     * pNext
+        0,                                              // VkPipelineLayoutCreateFlags      flags
+        0,                                              // uint32_t                         setLayoutCount
+        nullptr,                                        // const VkDescriptorSetLayout    * pSetLayouts
+        1,                                              // uint32_t                         pushConstantRangeCount
+        &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    VkResult result = vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &mPipelineLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create geometry pool pipeline layout." << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void GeometryPool::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    releaseTransferResources();
+    for(auto &shaderModule : mShaderModules)
+        destroyShaderModule(mLogicalDevice, shaderModule);
+    mShaderModules.clear();
+    destroyPipelineLayout(mLogicalDevice, mPipelineLayout);
+
+    for(auto &frame : mFrames)
+    {
+        destroyBuffer(mLogicalDevice, frame.instanceBuffer);
+        freeMemoryObject(mLogicalDevice, frame.instanceMemory);
+        destroyBuffer(mLogicalDevice, frame.commandBuffer);
+        freeMemoryObject(mLogicalDevice, frame.commandMemory);
+    }
+    mFrames.clear();
+
+    destroyBuffer(mLogicalDevice, mMeshBuffer);
+    freeMemoryObject(mLogicalDevice, mMeshMemory);
+    destroyBuffer(mLogicalDevice, mIndexBuffer);
+    freeMemoryObject(mLogicalDevice, mIndexMemory);
+    destroyBuffer(mLogicalDevice, mVertexBuffer);
+    freeMemoryObject(mLogicalDevice, mVertexMemory);
+
+    mMeshes.clear();
+    mPendingData.clear();
+    mPendingCopies.clear();
+    mVertexAddress = 0;
+    mMeshAddress   = 0;
+    mVertexBytes   = 0;
+    mIndexCount    = 0;
+    mDrawCount     = 0;
+    mStats         = {};
+    mLogicalDevice = VK_NULL_HANDLE;
+}
+
+void GeometryPool::queueCopy(VkBuffer dstBuffer, VkDeviceSize dstOffset, void const *data, VkDeviceSize size)
+{
+    VkDeviceSize srcOffset = mPendingData.size();
+    auto bytes = static_cast<unsigned char const*>(data);
+    mPendingData.insert(mPendingData.end(), bytes, bytes + size);
+    mPendingCopies.push_back({ dstBuffer, srcOffset, dstOffset, size });
+}
+
+bool GeometryPool::addMesh(VertexLayout const &layout, void const *vertexData, uint32_t vertexCount,
+                           std::vector<uint32_t> const &indices, uint32_t &meshIndex)
+{
+    bool normals = layout.normalOffset != VertexLayout::ABSENT;
+    bool texCoords = layout.texCoordOffset != VertexLayout::ABSENT;
+    if((layout.stride == 0) || (layout.stride % 4 != 0) ||
+       !isValidOffset(layout.positionOffset, 3 * sizeof(float), layout.stride) ||
+       (normals && !isValidOffset(layout.normalOffset, 3 * sizeof(float), layout.stride)) ||
+       (texCoords && !isValidOffset(layout.texCoordOffset, 2 * sizeof(float), layout.stride)))
+    {
+        std::cerr << "Invalid vertex layout, attributes must be 4-byte aligned and inside the stride." << std::endl;
+        return false;
+    }
+    for(uint32_t index : indices)
+    {
+        if(index >= vertexCount)
+        {
+            std::cerr << "Mesh index " << index << " exceeds its " << vertexCount << " vertices." << std::endl;
+            return false;
+        }
+    }
+
+    VkDeviceSize vertexOffset = (mVertexBytes + VERTEX_ALIGNMENT - 1) & ~(VERTEX_ALIGNMENT - 1);
+    VkDeviceSize vertexSize = VkDeviceSize(vertexCount) * layout.stride;
+    if((mMeshes.size() >= mParameters.maxMeshes) || (vertexOffset + vertexSize > mParameters.vertexBytes) ||
+       (uint64_t(mIndexCount) + indices.size() > mParameters.maxIndices))
+    {
+        std::cerr << "Geometry pool is full." << std::endl;
+        return false;
+    }
+
+    meshIndex = static_cast<uint32_t>(mMeshes.size());
+    GpuMesh mesh = {
+        mVertexAddress + vertexOffset,
+        layout.stride / 4,
+        layout.positionOffset / 4,
+        normals ? layout.normalOffset / 4 : VertexLayout::ABSENT,
+        texCoords ? layout.texCoordOffset / 4 : VertexLayout::ABSENT
+    };
+    queueCopy(mVertexBuffer, vertexOffset, vertexData, vertexSize);
+    queueCopy(mIndexBuffer, VkDeviceSize(mIndexCount) * sizeof(uint32_t), indices.data(), indices.size() * sizeof(uint32_t));
+    queueCopy(mMeshBuffer, VkDeviceSize(meshIndex) * sizeof(GpuMesh), &mesh, sizeof(mesh));
+
+    mMeshes.push_back({ mIndexCount, static_cast<uint32_t>(indices.size()) });
+    mVertexBytes = vertexOffset + vertexSize;
+    mIndexCount += static_cast<uint32_t>(indices.size());
+    return true;
+}
+
+bool GeometryPool::recordUpload(VkCommandBuffer commandBuffer)
+{
+    if(mPendingCopies.empty())
+        return true;
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    if(!createHostVisibleBuffer(mMemoryProperties, mLogicalDevice, mPendingData.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                mPendingData.data(), stagingBuffer, stagingMemory))
+    {
+        destroyBuffer(mLogicalDevice, stagingBuffer);
+        freeMemoryObject(mLogicalDevice, stagingMemory);
+        return false;
+    }
+    mTransferBuffers.push_back(stagingBuffer);
+    mTransferMemories.push_back(stagingMemory);
+
+    for(auto const &copy : mPendingCopies)
+    {
+        if(copy.size == 0)
+            continue;
+        VkBufferCopy region = { copy.srcOffset, copy.dstOffset, copy.size };
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, copy.dstBuffer, 1, &region);
+    }
+    mPendingData.clear();
+    mPendingCopies.clear();
+
+    // Vertices and mesh records are pulled through buffer device addresses, which are storage reads
+    VkMemoryBarrier2 uploadBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,                         // VkStructureType          sType
+        nullptr,                                                    // const void             * pNext
+        VK_PIPELINE_STAGE_2_COPY_BIT,                               // VkPipelineStageFlags2    srcStageMask
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,                             // VkAccessFlags2           srcAccessMask
+        VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT |                       // VkPipelineStageFlags2    dstStageMask
+        VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+        VK_ACCESS_2_INDEX_READ_BIT |                                // VkAccessFlags2           dstAccessMask
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,                          // VkStructureType                  sType
+        nullptr,                                                    // const void                     * pNext
+        0,                                                          // VkDependencyFlags                dependencyFlags
+        1,                                                          // uint32_t                         memoryBarrierCount
+        &uploadBarrier,                                             // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                                          // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                                    // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        0,                                                          // uint32_t                         imageMemoryBarrierCount
+        nullptr                                                     // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    return true;
+}
+
+void GeometryPool::releaseTransferResources()
+{
+    for(auto &buffer : mTransferBuffers)
+        destroyBuffer(mLogicalDevice, buffer);
+    for(auto &memory : mTransferMemories)
+        freeMemoryObject(mLogicalDevice, memory);
+    mTransferBuffers.clear();
+    mTransferMemories.clear();
+}
+
+VkPipelineLayout GeometryPool::getPipelineLayout() const
+{
+    return mPipelineLayout;
+}
+
+bool GeometryPool::createShaderStages(std::vector<VkPipelineShaderStageCreateInfo> &shaderStages)
+{
+    struct StageSource
+    {
+        VkShaderStageFlagBits stage;
+        char const           *name;
+    };
+    StageSource sources[] = {
+        { VK_SHADER_STAGE_VERTEX_BIT,   "geometry_pull.vert" },
+        { VK_SHADER_STAGE_FRAGMENT_BIT, "meshlet.frag" }
+    };
+
+    // The modules are created by the first call and shared by all pipelines built afterwards
+    if(mShaderModules.empty())
+    {
+        for(auto &source : sources)
+        {
+            VkShaderModule shaderModule = VK_NULL_HANDLE;
+            if(!createShaderModuleFromFile(mLogicalDevice, source.name, shaderModule))
+            {
+                for(auto &created : mShaderModules)
+                    destroyShaderModule(mLogicalDevice, created);
+                mShaderModules.clear();
+                return false;
+            }
+            mShaderModules.push_back(shaderModule);
+        }
+    }
+
+    shaderStages.clear();
+    for(uint32_t index = 0; index < mShaderModules.size(); ++index)
+    {
+        StageSource const &source = sources[index];
+        VkShaderModule shaderModule = mShaderModules[index];
+        shaderStages.push_back({
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,  // VkStructureType                    sType
+            nullptr,                                              // const void                       * pNext
+            0,                                                    // VkPipelineShaderStageCreateFlags   flags
+            source.stage,                                         // VkShaderStageFlagBits              stage
+            shaderModule,                                         // VkShaderModule                     module
+            "main",                                               // const char                       * pName
+            nullptr                                               // const VkSpecializationInfo       * pSpecializationInfo
+        });
+    }
+    return true;
+}
+
+void GeometryPool::beginFrame(uint32_t frameIndex)
+{
+    mFrameIndex = frameIndex % static_cast<uint32_t>(mFrames.size());
+    mDrawCount = 0;
+}
+
+bool GeometryPool::addDraw(uint32_t meshIndex, Float4x4 const &model)
+{
+    if((mDrawCount >= mParameters.maxDrawsPerFrame) || (meshIndex >= mMeshes.size()))
+        return false;
+
+    FrameResources &frame = mFrames[mFrameIndex];
+    GpuInstance &instance = frame.instances[mDrawCount];
+    instance.model = model;
+    instance.mesh = meshIndex;
+
+    // Indices stay relative to their mesh, the vertex shader adds the mesh's vertex address
+    MeshRange const &mesh = mMeshes[meshIndex];
+    frame.commands[mDrawCount] = {
+        mesh.indexCount,                        // uint32_t    indexCount
+        1,                                      // uint32_t    instanceCount
+        mesh.firstIndex,                        // uint32_t    firstIndex
+        0,                                      // int32_t     vertexOffset
+        mDrawCount                              // uint32_t    firstInstance
+    };
+    ++mDrawCount;
+    return true;
+}
+
+void GeometryPool::recordDraws(VkCommandBuffer commandBuffer, Float4x4 const &viewProjection)
+{
+    mStats.draws = mDrawCount;
+    mStats.indirectCalls = 0;
+    if(mDrawCount == 0)
+        return;
+
+    FrameResources const &frame = mFrames[mFrameIndex];
+    PullConstants constants = { viewProjection, frame.instanceAddress, mMeshAddress };
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if(mMultiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, frame.commandBuffer, 0, mDrawCount, stride);
+        mStats.indirectCalls = 1;
+        return;
+    }
+    for(uint32_t draw = 0; draw < mDrawCount; ++draw)
+        vkCmdDrawIndexedIndirect(commandBuffer, frame.commandBuffer, VkDeviceSize(draw) * stride, 1, stride);
+    mStats.indirectCalls = mDrawCount;
+}
+
+GeometryPoolStats GeometryPool::getStats() const
+{
+    GeometryPoolStats stats = mStats;
+    stats.meshes = static_cast<uint32_t>(mMeshes.size());
+    stats.vertexBytes = mVertexBytes;
+    stats.indices = mIndexCount;
+    return stats;
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Ktx2File.h"
+
+#ifdef VULKANSAMPLE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+  // Basic block of the data format descriptor: a 24 byte header, then 16 bytes per sample
+  const uint32_t DFD_BASIC_HEADER_SIZE    = 24;
+  const uint32_t DFD_SAMPLE_SIZE          = 16;
+  const uint8_t  KHR_DF_MODEL_ETC1S       = 163;
+  const uint8_t  KHR_DF_MODEL_UASTC       = 166;
+  const uint8_t  KHR_DF_TRANSFER_SRGB     = 2;
+  const uint8_t  KHR_DF_CHANNEL_ETC1S_AAA = 15;
+
+  struct Ktx2Header
+  {
+    uint8_t  identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+  };
+}
+
+Ktx2File::Ktx2File()
+{
+    mFormat           = VK_FORMAT_UNDEFINED;
+    mWidth            = 0;
+    mHeight           = 0;
+    mSupercompression = Ktx2Supercompression::None;
+    mSrgb             = false;
+    mAlpha            = false;
+    mTarget           = BasisTarget::RGBA8;
+    mKernel           = TranscodeKernel::Scalar;
+}
+
+bool Ktx2File::open(std::string const &filename)
+{
+    close();
+    if(!mFile.open(filename))
+        return false;
+    mFilename = filename;
+
+    Ktx2Header header;
+    if(mFile.getSize() < sizeof(header))
+    {
+        std::cerr << "'" << filename << "' is too small for a KTX2 file." << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&header, mFile.getData(), sizeof(header));
+
+    if(std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        std::cerr << "'" << filename << "' is not a KTX2 file." << std::endl;
+        close();
+        return false;
+    }
+
+    if(header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1)
+    {
+        std::cerr << "'" << filename << "' is not a 2D texture." << std::endl;
+        close();
+        return false;
+    }
+
+    // levelCount 0 asks the loader to generate the mip chain from the single stored level
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    size_t levelIndexEnd = sizeof(header) + levelCount * sizeof(Ktx2Level);
+    if(mFile.getSize() < levelIndexEnd)
+    {
+        std::cerr << "'" << filename << "' has a truncated level index." << std::endl;
+        close();
+        return false;
+    }
+
+    mLevels.resize(levelCount);
+    std::memcpy(mLevels.data(), mFile.getData() + sizeof(header), levelCount * sizeof(Ktx2Level));
+    for(auto &level : mLevels)
+    {
+        if(level.byteOffset + level.byteLength > mFile.getSize() || level.byteOffset + level.byteLength < level.byteOffset)
+        {
+            std::cerr << "'" << filename << "' has a level outside of the file." << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    mFormat           = static_cast<VkFormat>(header.vkFormat);
+    mWidth            = header.pixelWidth;
+    mHeight           = header.pixelHeight;
+    mSupercompression = static_cast<Ktx2Supercompression>(header.supercompressionScheme);
+
+    if(mSupercompression != Ktx2Supercompression::None && mSupercompression != Ktx2Supercompression::Zstd &&
+       mSupercompression != Ktx2Supercompression::BasisLZ)
+    {
+        std::cerr << "'" << filename << "' uses an unsupported supercompression scheme." << std::endl;
+        close();
+        return false;
+    }
+    if(mFormat != VK_FORMAT_UNDEFINED && mSupercompression != Ktx2Supercompression::BasisLZ)
+        return true;
+
+    // The data format descriptor tells ETC1S from UASTC and holds the transfer function and alpha
+    uint8_t const *descriptor = mFile.getData() + header.dfdByteOffset;
+    uint16_t blockSize = 0;
+    if(static_cast<uint64_t>(header.dfdByteOffset) + header.dfdByteLength <= mFile.getSize() &&
+       header.dfdByteLength >= 4 + DFD_BASIC_HEADER_SIZE)
+        std::memcpy(&blockSize, descriptor + 4 + 6, sizeof(blockSize));
+    if(blockSize < DFD_BASIC_HEADER_SIZE || 4u + blockSize > header.dfdByteLength)
+    {
+        std::cerr << "'" << filename << "' has a truncated data format descriptor." << std::endl;
+        close();
+        return false;
+    }
+
+    uint8_t const *basicBlock = descriptor + 4;
+    if(basicBlock[8] == KHR_DF_MODEL_UASTC)
+    {
+        std::cerr << "'" << filename << "' holds UASTC data, only ETC1S is transcoded." << std::endl;
+        close();
+        return false;
+    }
+    if(basicBlock[8] != KHR_DF_MODEL_ETC1S || mFormat != VK_FORMAT_UNDEFINED ||
+       mSupercompression != Ktx2Supercompression::BasisLZ)
+    {
+        std::cerr << "'" << filename << "' has no Vulkan format and no BasisLZ supercompressed ETC1S data." << std::endl;
+        close();
+        return false;
+    }
+    mSrgb = basicBlock[10] == KHR_DF_TRANSFER_SRGB;
+    for(uint32_t sample = 0; sample < (blockSize - DFD_BASIC_HEADER_SIZE) / DFD_SAMPLE_SIZE; ++sample)
+        mAlpha |= (basicBlock[DFD_BASIC_HEADER_SIZE + sample * DFD_SAMPLE_SIZE + 3] & 0x0F) == KHR_DF_CHANNEL_ETC1S_AAA;
+
+    if(header.sgdByteOffset + header.sgdByteLength > mFile.getSize() || header.sgdByteOffset + header.sgdByteLength < header.sgdByteOffset)
+    {
+        std::cerr << "'" << filename << "' has its supercompression global data outside of the file." << std::endl;
+        close();
+        return false;
+    }
+    if(!mTranscoder.create(mFile.getData() + header.sgdByteOffset, static_cast<size_t>(header.sgdByteLength), levelCount))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Ktx2File::close()
+{
+    mFile.close();
+    mLevels.clear();
+    mTranscoder.destroy();
+    mFormat = VK_FORMAT_UNDEFINED;
+    mWidth  = 0;
+    mHeight = 0;
+    mSrgb   = false;
+    mAlpha  = false;
+}
+
+VkFormat Ktx2File::getFormat() const
+{
+    return mFormat;
+}
+
+uint32_t Ktx2File::getWidth() const
+{
+    return mWidth;
+}
+
+uint32_t Ktx2File::getHeight() const
+{
+    return mHeight;
+}
+
+uint32_t Ktx2File::getLevelCount() const
+{
+    return static_cast<uint32_t>(mLevels.size());
+}
+
+bool Ktx2File::isBasisUniversal() const
+{
+    return mSupercompression == Ktx2Supercompression::BasisLZ;
+}
+
+bool Ktx2File::hasAlpha() const
+{
+    return mAlpha;
+}
+
+bool Ktx2File::setTranscodeTarget(BasisTarget target, TranscodeKernel kernel)
+{
+    if(!isBasisUniversal())
+    {
+        std::cerr << "'" << mFilename << "' holds no Basis Universal data to transcode." << std::endl;
+        return false;
+    }
+    if(target == BasisTarget::ASTC && mAlpha)
+    {
+        std::cerr << "'" << mFilename << "' has alpha, which the ASTC transcoding does not support." << std::endl;
+        return false;
+    }
+
+    mTarget = target;
+    mKernel = kernel;
+    mFormat = getBasisTargetFormat(target, mAlpha, mSrgb);
+    return true;
+}
+
+bool Ktx2File::getLevelData(uint32_t level, std::vector<uint8_t> &scratch, uint8_t const *&data, size_t &size) const
+{
+    Ktx2Level const &entry = mLevels[level];
+    uint8_t const *source = mFile.getData() + entry.byteOffset;
+    if(isBasisUniversal())
+    {
+        FormatBlockInfo blockInfo;
+        if(mFormat == VK_FORMAT_UNDEFINED || !getFormatBlockInfo(mFormat, blockInfo))
+        {
+            std::cerr << "'" << mFilename << "' needs a transcode target before its levels are read." << std::endl;
+            return false;
+        }
+
+        // Every level is one image of the global data
+        uint32_t width = std::max(mWidth >> level, 1u);
+        uint32_t height = std::max(mHeight >> level, 1u);
+        scratch.resize(getLevelByteSize(blockInfo, width, height));
+        if(!mTranscoder.transcode(mTarget, mKernel, level, mAlpha, source, static_cast<size_t>(entry.byteLength), width,
+                                  height, scratch.data()))
+        {
+            std::cerr << "Could not transcode level " << level << " of '" << mFilename << "'." << std::endl;
+            return false;
+        }
+        data = scratch.data();
+        size = scratch.size();
+        return true;
+    }
+
+    if(mSupercompression == Ktx2Supercompression::None)
+    {
+        data = source;
+        size = static_cast<size_t>(entry.byteLength);
+        return true;
+    }
+
+#ifdef VULKANSAMPLE_WITH_ZSTD
+    scratch.resize(static_cast<size_t>(entry.uncompressedByteLength));
+    size_t read = ZSTD_decompress(scratch.data(), scratch.size(), source, static_cast<size_t>(entry.byteLength));
+    if(ZSTD_isError(read) || read != scratch.size())
+    {
+        std::cerr << "Could not decompress level " << level << " of '" << mFilename << "'." << std::endl;
+        return false;
+    }
+    data = scratch.data();
+    size = scratch.size();
+    return true;
+#else
+    (void)scratch;
+    std::cerr << "'" << mFilename << "' is zstd supercompressed, but zstd support is not built in." << std::endl;
+    return false;
+#endif
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,140 @@
+#include <iostream>
+
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanSample
+{
+
+MappedFile::MappedFile()
+{
+    mData = nullptr;
+    mSize = 0;
+#ifdef _WIN32
+    mFile    = INVALID_HANDLE_VALUE;
+    mMapping = nullptr;
+#else
+    mFile = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(std::string const &filename)
+{
+    close();
+
+#ifdef _WIN32
+    mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(mFile == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Could not open '" << filename << "' file." << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+    {
+        std::cerr << "Could not get the size of '" << filename << "' file." << std::endl;
+        close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mMapping == nullptr)
+    {
+        std::cerr << "Could not create a mapping of '" << filename << "' file." << std::endl;
+        close();
+        return false;
+    }
+
+    mData = static_cast<uint8_t const *>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    mFile = ::open(filename.c_str(), O_RDONLY);
+    if(mFile < 0)
+    {
+        std::cerr << "Could not open '" << filename << "' file." << std::endl;
+        return false;
+    }
+
+    struct stat fileStatus;
+    if(fstat(mFile, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+        std::cerr << "Could not get the size of '" << filename << "' file." << std::endl;
+        close();
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+    if(mapping != MAP_FAILED)
+    {
+        mData = static_cast<uint8_t const *>(mapping);
+        mSize = static_cast<size_t>(fileStatus.st_size);
+        madvise(mapping, mSize, MADV_WILLNEED);
+    }
+#endif
+
+    if(mData == nullptr)
+    {
+        std::cerr << "Could not map '" << filename << "' file." << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if(mData != nullptr)
+        UnmapViewOfFile(mData);
+    if(mMapping != nullptr)
+        CloseHandle(mMapping);
+    if(mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+    mMapping = nullptr;
+    mFile    = INVALID_HANDLE_VALUE;
+#else
+    if(mData != nullptr)
+        munmap(const_cast<uint8_t *>(mData), mSize);
+    if(mFile >= 0)
+        ::close(mFile);
+    mFile = -1;
+#endif
+    mData = nullptr;
+    mSize = 0;
+}
+
+uint8_t const *MappedFile::getData() const
+{
+    return mData;
+}
+
+size_t MappedFile::getSize() const
+{
+    return mSize;
+}
+
+size_t MappedFile::getPageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+} // namespace VulkanSample
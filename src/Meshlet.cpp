@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "Meshlet.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t UNUSED_SLOT = 0xFFFFFFFFu;
+
+  struct Vec3
+  {
+    float x, y, z;
+  };
+
+  Vec3 operator-(Vec3 a, Vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+  Vec3 operator+(Vec3 a, Vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+  Vec3 operator*(Vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+  float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+  Vec3 cross(Vec3 a, Vec3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+  float length(Vec3 a) { return std::sqrt(dot(a, a)); }
+
+  Vec3 positionOf(std::vector<MeshVertex> const &vertices, uint32_t index)
+  {
+    return { vertices[index].position[0], vertices[index].position[1], vertices[index].position[2] };
+  }
+
+  void computeBounds(std::vector<MeshVertex> const &vertices, MeshletData const &meshletData, Meshlet &meshlet)
+  {
+    uint32_t const *meshletVertices = meshletData.vertices.data() + meshlet.vertexOffset;
+    uint32_t const *meshletTriangles = meshletData.triangles.data() + meshlet.triangleOffset;
+
+    // Bounding sphere around the AABB center, good enough for cluster culling
+    Vec3 minimum = positionOf(vertices, meshletVertices[0]);
+    Vec3 maximum = minimum;
+    for(uint32_t i = 1; i < meshlet.vertexCount; ++i)
+    {
+      Vec3 p = positionOf(vertices, meshletVertices[i]);
+      minimum = { std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z) };
+      maximum = { std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z) };
+    }
+    Vec3 center = (minimum + maximum) * 0.5f;
+    float radius = 0.0f;
+    for(uint32_t i = 0; i < meshlet.vertexCount; ++i)
+      radius = std::max(radius, length(positionOf(vertices, meshletVertices[i]) - center));
+
+    meshlet.center[0] = center.x;
+    meshlet.center[1] = center.y;
+    meshlet.center[2] = center.z;
+    meshlet.radius = radius;
+
+    // Normal cone: average the triangle normals, the cone is usable only when all normals
+    // stay within 90 degrees of the axis
+    std::vector<Vec3> normals;
+    std::vector<Vec3> corners;
+    normals.reserve(meshlet.triangleCount);
+    corners.reserve(meshlet.triangleCount);
+    Vec3 axis = { 0.0f, 0.0f, 0.0f };
+    for(uint32_t i = 0; i < meshlet.triangleCount; ++i)
+    {
+      uint32_t packed = meshletTriangles[i];
+      Vec3 p0 = positionOf(vertices, meshletVertices[packed & 0xFF]);
+      Vec3 p1 = positionOf(vertices, meshletVertices[(packed >> 8) & 0xFF]);
+      Vec3 p2 = positionOf(vertices, meshletVertices[(packed >> 16) & 0xFF]);
+      Vec3 normal = cross(p1 - p0, p2 - p0);
+      float area = length(normal);
+      if(area == 0.0f)
+        continue;
+
+      normal = normal * (1.0f / area);
+      normals.push_back(normal);
+      corners.push_back(p0);
+      axis = axis + normal;
+    }
+
+    meshlet.coneApex[0] = center.x;
+    meshlet.coneApex[1] = center.y;
+    meshlet.coneApex[2] = center.z;
+    meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+    meshlet.coneCutoff = 1.0f;
+
+    float axisLength = length(axis);
+    if(normals.empty() || axisLength == 0.0f)
+      return;
+    axis = axis * (1.0f / axisLength);
+
+    float minimumDot = 1.0f;
+    for(auto &normal : normals)
+      minimumDot = std::min(minimumDot, dot(normal, axis));
+
+    // A cone wider than ~84 degrees rejects almost nothing, keep it disabled
+    if(minimumDot <= 0.1f)
+      return;
+
+    // Move the apex back along the axis until every triangle plane is in front of it
+    float maximumT = 0.0f;
+    for(size_t i = 0; i < normals.size(); ++i)
+    {
+      float denominator = dot(normals[i], axis);
+      float t = dot(center - corners[i], normals[i]) / denominator;
+      maximumT = std::max(maximumT, t);
+    }
+    Vec3 apex = center - axis * maximumT;
+
+    meshlet.coneApex[0] = apex.x;
+    meshlet.coneApex[1] = apex.y;
+    meshlet.coneApex[2] = apex.z;
+    meshlet.coneAxis[0] = axis.x;
+    meshlet.coneAxis[1] = axis.y;
+    meshlet.coneAxis[2] = axis.z;
+    meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+  }
+}
+
+bool buildMeshlets(std::vector<MeshVertex> const &vertices, std::vector<uint32_t> const &indices, MeshletData &meshletData)
+{
+  if(indices.size() % 3 != 0)
+  {
+    std::cerr << "Index count must be a multiple of three to build meshlets." << std::endl;
+    return false;
+  }
+
+  meshletData.meshlets.clear();
+  meshletData.vertices.clear();
+  meshletData.triangles.clear();
+  meshletData.meshlets.reserve(indices.size() / 3 / MESHLET_MAX_TRIANGLES + 1);
+  meshletData.triangles.reserve(indices.size() / 3);
+
+  // Mesh vertex -> slot in the meshlet being built
+  std::vector<uint32_t> localIndex(vertices.size(), UNUSED_SLOT);
+
+  Meshlet current = {};
+  auto flush = [&]()
+  {
+    if(current.triangleCount == 0)
+      return;
+
+    for(uint32_t i = 0; i < current.vertexCount; ++i)
+      localIndex[meshletData.vertices[current.vertexOffset + i]] = UNUSED_SLOT;
+
+    computeBounds(vertices, meshletData, current);
+    meshletData.meshlets.push_back(current);
+
+    current = {};
+    current.vertexOffset = static_cast<uint32_t>(meshletData.vertices.size());
+    current.triangleOffset = static_cast<uint32_t>(meshletData.triangles.size());
+  };
+
+  for(size_t triangle = 0; triangle < indices.size(); triangle += 3)
+  {
+    uint32_t corner[3] = { indices[triangle], indices[triangle + 1], indices[triangle + 2] };
+    for(auto index : corner)
+    {
+      if(index >= vertices.size())
+      {
+        std::cerr << "Index " << index << " is out of the vertex range." << std::endl;
+        return false;
+      }
+    }
+
+    uint32_t newVertices = 0;
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+      bool duplicate = (i > 0 && corner[i] == corner[0]) || (i > 1 && corner[i] == corner[1]);
+      if(localIndex[corner[i]] == UNUSED_SLOT && !duplicate)
+        ++newVertices;
+    }
+
+    if(current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+      flush();
+
+    uint32_t slots[3];
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+      if(localIndex[corner[i]] == UNUSED_SLOT)
+      {
+        localIndex[corner[i]] = current.vertexCount++;
+        meshletData.vertices.push_back(corner[i]);
+      }
+      slots[i] = localIndex[corner[i]];
+    }
+
+    meshletData.triangles.push_back(packMeshletTriangle(slots[0], slots[1], slots[2]));
+    ++current.triangleCount;
+  }
+  flush();
+
+  return true;
+}
+
+} // namespace VulkanSample
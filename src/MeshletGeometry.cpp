@@ -0,0 +1,424 @@
+#include <algorithm>
+
+#include "MeshletGeometry.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t TASK_WORKGROUP_SIZE = 32;
+  const uint32_t MAX_WORKGROUPS_X    = 65535;
+
+  enum MeshletBinding
+  {
+    MESHLET_BINDING_MESHLETS          = 0,
+    MESHLET_BINDING_MESHLET_VERTICES  = 1,
+    MESHLET_BINDING_MESHLET_TRIANGLES = 2,
+    MESHLET_BINDING_VERTICES          = 3,
+    MESHLET_BINDING_EXPANDED_INDICES  = 4,
+    MESHLET_BINDING_DRAW_COMMAND      = 5
+  };
+
+  VkShaderStageFlags getMeshletStages(bool useMeshShader)
+  {
+    return useMeshShader ? (VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT)
+                         : (VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT);
+  }
+}
+
+MeshletGeometry::MeshletGeometry()
+{
+    mLogicalDevice         = VK_NULL_HANDLE;
+    mUseMeshShader         = false;
+    mMeshletCount          = 0;
+    mTaskGroupCountX       = 0;
+    mTaskGroupCountY       = 0;
+    mIndexCount            = 0;
+    mMeshletBuffer         = VK_NULL_HANDLE;
+    mMeshletMemory         = VK_NULL_HANDLE;
+    mMeshletVertexBuffer   = VK_NULL_HANDLE;
+    mMeshletVertexMemory   = VK_NULL_HANDLE;
+    mMeshletTriangleBuffer = VK_NULL_HANDLE;
+    mMeshletTriangleMemory = VK_NULL_HANDLE;
+    mVertexBuffer          = VK_NULL_HANDLE;
+    mVertexMemory          = VK_NULL_HANDLE;
+    mExpandedIndexBuffer   = VK_NULL_HANDLE;
+    mExpandedIndexMemory   = VK_NULL_HANDLE;
+    mDrawCommandBuffer     = VK_NULL_HANDLE;
+    mDrawCommandMemory     = VK_NULL_HANDLE;
+    mDescriptorSetLayout   = VK_NULL_HANDLE;
+    mDescriptorPool        = VK_NULL_HANDLE;
+    mDescriptorSet         = VK_NULL_HANDLE;
+    mPipelineLayout        = VK_NULL_HANDLE;
+    mExpansionPipeline     = VK_NULL_HANDLE;
+}
+
+MeshletGeometry::~MeshletGeometry()
+{
+    destroy();
+}
+
+bool MeshletGeometry::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities,
+                             std::vector<MeshVertex> const &vertices, MeshletData const &meshletData)
+{
+    destroy();
+
+    if(meshletData.meshlets.empty())
+    {
+        std::cerr << "Meshlet geometry requires at least one meshlet." << std::endl;
+        return false;
+    }
+
+    mLogicalDevice = logicalDevice;
+    mUseMeshShader = capabilities.meshShaderSupported;
+    mMeshletCount  = static_cast<uint32_t>(meshletData.meshlets.size());
+    mIndexCount    = static_cast<uint32_t>(meshletData.triangles.size() * 3);
+
+    // Task workgroups form a 2D grid within the device limits, meshes that exceed even those are
+    // expanded by the compute path instead
+    if(mUseMeshShader)
+    {
+        uint32_t groups = (mMeshletCount + TASK_WORKGROUP_SIZE - 1) / TASK_WORKGROUP_SIZE;
+        mTaskGroupCountX = std::min(groups, capabilities.maxTaskWorkGroupCount[0]);
+        mTaskGroupCountY = mTaskGroupCountX > 0 ? (groups + mTaskGroupCountX - 1) / mTaskGroupCountX : 0;
+        mUseMeshShader = mTaskGroupCountY != 0 && mTaskGroupCountY <= capabilities.maxTaskWorkGroupCount[1] &&
+                         static_cast<uint64_t>(mTaskGroupCountX) * mTaskGroupCountY <= capabilities.maxTaskWorkGroupTotalCount;
+    }
+
+    auto const &memoryProperties = capabilities.memoryProperties;
+    VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    if(!createHostVisibleBuffer(memoryProperties, mLogicalDevice, meshletData.meshlets.size() * sizeof(Meshlet),
+                                storage, meshletData.meshlets.data(), mMeshletBuffer, mMeshletMemory) ||
+       !createHostVisibleBuffer(memoryProperties, mLogicalDevice, meshletData.vertices.size() * sizeof(uint32_t),
+                                storage, meshletData.vertices.data(), mMeshletVertexBuffer, mMeshletVertexMemory) ||
+       !createHostVisibleBuffer(memoryProperties, mLogicalDevice, meshletData.triangles.size() * sizeof(uint32_t),
+                                storage, meshletData.triangles.data(), mMeshletTriangleBuffer, mMeshletTriangleMemory) ||
+       !createHostVisibleBuffer(memoryProperties, mLogicalDevice, vertices.size() * sizeof(MeshVertex),
+                                storage | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices.data(), mVertexBuffer, mVertexMemory))
+    {
+        destroy();
+        return false;
+    }
+
+    if(!mUseMeshShader)
+    {
+        VkDrawIndexedIndirectCommand drawCommand = { 0, 1, 0, 0, 0 };
+        if(!createHostVisibleBuffer(memoryProperties, mLogicalDevice, mIndexCount * sizeof(uint32_t),
+                                    storage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, nullptr,
+                                    mExpandedIndexBuffer, mExpandedIndexMemory) ||
+           !createHostVisibleBuffer(memoryProperties, mLogicalDevice, sizeof(drawCommand),
+                                    storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    &drawCommand, mDrawCommandBuffer, mDrawCommandMemory))
+        {
+            destroy();
+            return false;
+        }
+    }
+
+    if(!createDescriptors())
+    {
+        destroy();
+        return false;
+    }
+
+    if(!mUseMeshShader)
+    {
+        VkShaderModule expansionShader = VK_NULL_HANDLE;
+        bool created = createShaderModuleFromFile(mLogicalDevice, "meshlet_expand.comp", expansionShader) &&
+                       createComputePipeline(mLogicalDevice, expansionShader, mPipelineLayout, nullptr, VK_NULL_HANDLE,
+                                             mExpansionPipeline);
+        destroyShaderModule(mLogicalDevice, expansionShader);
+        if(!created)
+        {
+            destroy();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MeshletGeometry::createDescriptors()
+{
+    uint32_t bindingCount = mUseMeshShader ? MESHLET_BINDING_VERTICES + 1 : MESHLET_BINDING_DRAW_COMMAND + 1;
+    VkShaderStageFlags stages = getMeshletStages(mUseMeshShader);
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for(uint32_t binding = 0; binding < bindingCount; ++binding)
+    {
+        bindings.push_back({
+            binding,                              // uint32_t              binding
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,    // VkDescriptorType      descriptorType
+            1,                                    // uint32_t              descriptorCount
+            stages,                               // VkShaderStageFlags    stageFlags
+            nullptr                               // const VkSampler     * pImmutableSamplers
+        });
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,  // VkStructureType                        sType
+        nullptr,                                              // const void                           * pNext
+        0,                                                    // VkDescriptorSetLayoutCreateFlags       flags
+        bindingCount,                                         // uint32_t                               bindingCount
+        bindings.data()                                       // const VkDescriptorSetLayoutBinding   * pBindings
+    };
+
+    VkResult result = vkCreateDescriptorSetLayout(mLogicalDevice, &descriptorSetLayoutCreateInfo, nullptr, &mDescriptorSetLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create a layout for meshlet descriptor set." << std::endl;
+        return false;
+    }
+
+    VkPushConstantRange pushConstantRanges[] = {
+        {
+            stages,                                 // VkShaderStageFlags     stageFlags
+            0,                                      // uint32_t               offset
+            sizeof(MeshletDrawConstants)            // uint32_t               size
+        },
+        {
+            VK_SHADER_STAGE_FRAGMENT_BIT,           // VkShaderStageFlags     stageFlags
+            sizeof(MeshletDrawConstants),           // uint32_t               offset
+            sizeof(VkDeviceAddress)                 // uint32_t               size
+        }
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+        nullptr,                                        // const void                     * pNext
+        0,                                              // VkPipelineLayoutCreateFlags      flags
+        1,                                              // uint32_t                         setLayoutCount
+        &mDescriptorSetLayout,                          // const VkDescriptorSetLayout    * pSetLayouts
+        2,                                              // uint32_t                         pushConstantRangeCount
+        pushConstantRanges                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    result = vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &mPipelineLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create meshlet pipeline layout." << std::endl;
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bindingCount };
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,  // VkStructureType                sType
+        nullptr,                                        // const void                   * pNext
+        0,                                              // VkDescriptorPoolCreateFlags    flags
+        1,                                              // uint32_t                       maxSets
+        1,                                              // uint32_t                       poolSizeCount
+        &poolSize                                       // const VkDescriptorPoolSize   * pPoolSizes
+    };
+
+    result = vkCreateDescriptorPool(mLogicalDevice, &descriptorPoolCreateInfo, nullptr, &mDescriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create meshlet descriptor pool." << std::endl;
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,   // VkStructureType                  sType
+        nullptr,                                          // const void                     * pNext
+        mDescriptorPool,                                  // VkDescriptorPool                 descriptorPool
+        1,                                                // uint32_t                         descriptorSetCount
+        &mDescriptorSetLayout                             // const VkDescriptorSetLayout    * pSetLayouts
+    };
+
+    result = vkAllocateDescriptorSets(mLogicalDevice, &descriptorSetAllocateInfo, &mDescriptorSet);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not allocate meshlet descriptor set." << std::endl;
+        return false;
+    }
+
+    VkBuffer buffers[] = { mMeshletBuffer, mMeshletVertexBuffer, mMeshletTriangleBuffer, mVertexBuffer,
+                           mExpandedIndexBuffer, mDrawCommandBuffer };
+    std::vector<VkDescriptorBufferInfo> bufferInfos(bindingCount);
+    std::vector<VkWriteDescriptorSet> writes(bindingCount);
+    for(uint32_t binding = 0; binding < bindingCount; ++binding)
+    {
+        bufferInfos[binding] = { buffers[binding], 0, VK_WHOLE_SIZE };
+        writes[binding] = {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,   // VkStructureType                  sType
+            nullptr,                                  // const void                     * pNext
+            mDescriptorSet,                           // VkDescriptorSet                  dstSet
+            binding,                                  // uint32_t                         dstBinding
+            0,                                        // uint32_t                         dstArrayElement
+            1,                                        // uint32_t                         descriptorCount
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,        // VkDescriptorType                 descriptorType
+            nullptr,                                  // const VkDescriptorImageInfo    * pImageInfo
+            &bufferInfos[binding],                    // const VkDescriptorBufferInfo   * pBufferInfo
+            nullptr                                   // const VkBufferView             * pTexelBufferView
+        };
+    }
+    vkUpdateDescriptorSets(mLogicalDevice, bindingCount, writes.data(), 0, nullptr);
+
+    return true;
+}
+
+void MeshletGeometry::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    for(auto &shaderModule : mShaderModules)
+        destroyShaderModule(mLogicalDevice, shaderModule);
+    mShaderModules.clear();
+
+    destroyPipeline(mLogicalDevice, mExpansionPipeline);
+    destroyPipelineLayout(mLogicalDevice, mPipelineLayout);
+    destroyDescriptorPool(mLogicalDevice, mDescriptorPool);
+    destroyDescriptorSetLayout(mLogicalDevice, mDescriptorSetLayout);
+    mDescriptorSet = VK_NULL_HANDLE;
+
+    destroyBuffer(mLogicalDevice, mDrawCommandBuffer);
+    freeMemoryObject(mLogicalDevice, mDrawCommandMemory);
+    destroyBuffer(mLogicalDevice, mExpandedIndexBuffer);
+    freeMemoryObject(mLogicalDevice, mExpandedIndexMemory);
+    destroyBuffer(mLogicalDevice, mVertexBuffer);
+    freeMemoryObject(mLogicalDevice, mVertexMemory);
+    destroyBuffer(mLogicalDevice, mMeshletTriangleBuffer);
+    freeMemoryObject(mLogicalDevice, mMeshletTriangleMemory);
+    destroyBuffer(mLogicalDevice, mMeshletVertexBuffer);
+    freeMemoryObject(mLogicalDevice, mMeshletVertexMemory);
+    destroyBuffer(mLogicalDevice, mMeshletBuffer);
+    freeMemoryObject(mLogicalDevice, mMeshletMemory);
+
+    mLogicalDevice = VK_NULL_HANDLE;
+}
+
+bool MeshletGeometry::usesMeshShader() const
+{
+    return mUseMeshShader;
+}
+
+uint32_t MeshletGeometry::getMeshletCount() const
+{
+    return mMeshletCount;
+}
+
+VkDescriptorSetLayout MeshletGeometry::getDescriptorSetLayout() const
+{
+    return mDescriptorSetLayout;
+}
+
+VkPipelineLayout MeshletGeometry::getPipelineLayout() const
+{
+    return mPipelineLayout;
+}
+
+bool MeshletGeometry::createShaderStages(std::vector<VkPipelineShaderStageCreateInfo> &shaderStages, bool clusteredLighting)
+{
+    struct StageSource
+    {
+        VkShaderStageFlagBits stage;
+        char const           *name;
+    };
+    std::vector<StageSource> sources;
+    if(mUseMeshShader)
+    {
+        sources.push_back({ VK_SHADER_STAGE_TASK_BIT_EXT, "meshlet.task" });
+        sources.push_back({ VK_SHADER_STAGE_MESH_BIT_EXT, "meshlet.mesh" });
+    }
+    else
+    {
+        sources.push_back({ VK_SHADER_STAGE_VERTEX_BIT, "meshlet_fallback.vert" });
+    }
+    sources.push_back({ VK_SHADER_STAGE_FRAGMENT_BIT, clusteredLighting ? "meshlet_clustered.frag" : "meshlet.frag" });
+
+    shaderStages.clear();
+    for(auto &source : sources)
+    {
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        if(!createShaderModuleFromFile(mLogicalDevice, source.name, shaderModule))
+            return false;
+        mShaderModules.push_back(shaderModule);
+
+        shaderStages.push_back({
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,  // VkStructureType                    sType
+            nullptr,                                              // const void                       * pNext
+            0,                                                    // VkPipelineShaderStageCreateFlags   flags
+            source.stage,                                         // VkShaderStageFlagBits              stage
+            shaderModule,                                         // VkShaderModule                     module
+            "main",                                               // const char                       * pName
+            nullptr                                               // const VkSpecializationInfo       * pSpecializationInfo
+        });
+    }
+    return true;
+}
+
+void MeshletGeometry::getFallbackVertexInput(VkVertexInputBindingDescription &binding,
+                                             std::vector<VkVertexInputAttributeDescription> &attributes)
+{
+    binding = { 0, sizeof(MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX };
+    attributes = {
+        { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(MeshVertex, position)) },
+        { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(MeshVertex, normal)) },
+        { 2, 0, VK_FORMAT_R32G32_SFLOAT,    static_cast<uint32_t>(offsetof(MeshVertex, texCoord)) }
+    };
+}
+
+void MeshletGeometry::recordIndexExpansion(VkCommandBuffer commandBuffer, MeshletDrawConstants const &constants)
+{
+    if(mUseMeshShader)
+        return;
+
+    // Reset indexCount, the first member of VkDrawIndexedIndirectCommand
+    vkCmdFillBuffer(commandBuffer, mDrawCommandBuffer, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER,                           // VkStructureType    sType
+        nullptr,                                                    // const void       * pNext
+        VK_ACCESS_TRANSFER_WRITE_BIT,                               // VkAccessFlags      srcAccessMask
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT      // VkAccessFlags      dstAccessMask
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mExpansionPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, getMeshletStages(false), 0, sizeof(constants), &constants);
+
+    uint32_t groupsX = mMeshletCount < MAX_WORKGROUPS_X ? mMeshletCount : MAX_WORKGROUPS_X;
+    uint32_t groupsY = (mMeshletCount + MAX_WORKGROUPS_X - 1) / MAX_WORKGROUPS_X;
+    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+
+    VkMemoryBarrier expansionBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER,                           // VkStructureType    sType
+        nullptr,                                                    // const void       * pNext
+        VK_ACCESS_SHADER_WRITE_BIT,                                 // VkAccessFlags      srcAccessMask
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT  // VkAccessFlags  dstAccessMask
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                         1, &expansionBarrier, 0, nullptr, 0, nullptr);
+}
+
+void MeshletGeometry::recordDraw(VkCommandBuffer commandBuffer, MeshletDrawConstants const &constants)
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &mDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, getMeshletStages(mUseMeshShader), 0, sizeof(constants), &constants);
+
+    if(mUseMeshShader)
+    {
+        vkCmdDrawMeshTasksEXT(commandBuffer, mTaskGroupCountX, mTaskGroupCountY, 1);
+        return;
+    }
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mVertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, mExpandedIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexedIndirect(commandBuffer, mDrawCommandBuffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void MeshletGeometry::recordLightingData(VkCommandBuffer commandBuffer, VkDeviceAddress shadingData)
+{
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(MeshletDrawConstants),
+                       sizeof(shadingData), &shadingData);
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "MultiDeviceCompute.h"
+#include "Profiler.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  // Weight of the latest run in the throughput estimate
+  const double THROUGHPUT_SMOOTHING = 0.5;
+}
+
+MultiDeviceCompute::MultiDeviceCompute()
+{
+    mFailed = false;
+    mSeconds = 0.0;
+}
+
+MultiDeviceCompute::~MultiDeviceCompute()
+{
+    destroy();
+}
+
+bool MultiDeviceCompute::create(std::vector<PhysicalDeviceProbe> const &physicalDevices, uint32_t devicesPerPhysicalDevice)
+{
+    PROFILE_FUNCTION();
+
+    destroy();
+    setMultiDeviceDispatch(true);
+
+    for(auto &probe : physicalDevices)
+    {
+        if(!probe.suitable || !probe.timelineSemaphoreSupported || !probe.synchronization2Supported)
+        {
+            continue;
+        }
+        for(uint32_t replica = 0; replica < std::max(devicesPerPhysicalDevice, 1u); ++replica)
+        {
+            std::unique_ptr<ComputeDevice> device(new ComputeDevice());
+            if(!createDevice(probe, *device))
+            {
+                destroy();
+                return false;
+            }
+            device->stats.name = probe.properties.deviceName;
+            if(devicesPerPhysicalDevice > 1)
+            {
+                device->stats.name += " #" + std::to_string(replica);
+            }
+            mDevices.push_back(std::move(device));
+        }
+    }
+    if(mDevices.empty())
+    {
+        std::cerr << "No physical device supports multi-device compute." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MultiDeviceCompute::createDevice(PhysicalDeviceProbe const &probe, ComputeDevice &device)
+{
+    device.logicalDevice = VK_NULL_HANDLE;
+    device.timelineSemaphore = VK_NULL_HANDLE;
+    device.timelineValue = 0;
+    std::fill(std::begin(device.commandPools), std::end(device.commandPools), VkCommandPool(VK_NULL_HANDLE));
+    device.stats = ComputeDeviceStats();
+
+    QueueParameters graphicsQueue;
+    QueueParameters presentQueue;
+    if(!createLogicalDevice({ probe }, device.logicalDevice, {}, VK_NULL_HANDLE, graphicsQueue, device.queue, presentQueue,
+                            device.capabilities))
+    {
+        return false;
+    }
+    if(!device.capabilities.timelineSynchronizationSupported)
+    {
+        std::cerr << "Timeline semaphores were not enabled on " << probe.properties.deviceName << "." << std::endl;
+        destroyDevice(device);
+        return false;
+    }
+
+    for(uint32_t slot = 0; slot < SLOTS_PER_DEVICE; ++slot)
+    {
+        VkCommandPoolCreateInfo commandPoolCreateInfo = {
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,     // VkStructureType              sType
+            nullptr,                                        // const void                 * pNext
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,           // VkCommandPoolCreateFlags     flags
+            device.queue.familyIndex                        // uint32_t                     queueFamilyIndex
+        };
+
+        VkResult result = vkCreateCommandPool(device.logicalDevice, &commandPoolCreateInfo, nullptr, &device.commandPools[slot]);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not create a command pool." << std::endl;
+            destroyDevice(device);
+            return false;
+        }
+
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // VkStructureType          sType
+            nullptr,                                        // const void             * pNext
+            device.commandPools[slot],                      // VkCommandPool            commandPool
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // VkCommandBufferLevel     level
+            1                                               // uint32_t                 commandBufferCount
+        };
+
+        result = vkAllocateCommandBuffers(device.logicalDevice, &commandBufferAllocateInfo, &device.commandBuffers[slot]);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not allocate a command buffer." << std::endl;
+            destroyDevice(device);
+            return false;
+        }
+    }
+
+    VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {
+        VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,   // VkStructureType    sType
+        nullptr,                                        // const void       * pNext
+        VK_SEMAPHORE_TYPE_TIMELINE,                     // VkSemaphoreType    semaphoreType
+        0                                               // uint64_t           initialValue
+    };
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo = {
+        VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,        // VkStructureType          sType
+        &semaphoreTypeCreateInfo,                       // const void             * pNext
+        0                                               // VkSemaphoreCreateFlags   flags
+    };
+
+    VkResult result = vkCreateSemaphore(device.logicalDevice, &semaphoreCreateInfo, nullptr, &device.timelineSemaphore);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create a timeline semaphore." << std::endl;
+        destroyDevice(device);
+        return false;
+    }
+    return true;
+}
+
+void MultiDeviceCompute::destroyDevice(ComputeDevice &device)
+{
+    if(device.logicalDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkDeviceWaitIdle(device.logicalDevice);
+    if(device.timelineSemaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(device.logicalDevice, device.timelineSemaphore, nullptr);
+        device.timelineSemaphore = VK_NULL_HANDLE;
+    }
+    for(auto &commandPool : device.commandPools)
+    {
+        if(commandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device.logicalDevice, commandPool, nullptr);
+            commandPool = VK_NULL_HANDLE;
+        }
+    }
+    vkDestroyDevice(device.logicalDevice, nullptr);
+    device.logicalDevice = VK_NULL_HANDLE;
+}
+
+void MultiDeviceCompute::destroy()
+{
+    for(auto &device : mDevices)
+    {
+        destroyDevice(*device);
+    }
+    mDevices.clear();
+    mSeconds = 0.0;
+}
+
+uint32_t MultiDeviceCompute::getDeviceCount() const
+{
+    return static_cast<uint32_t>(mDevices.size());
+}
+
+DeviceCapabilities const & MultiDeviceCompute::getDeviceCapabilities(uint32_t device) const
+{
+    return mDevices[device]->capabilities;
+}
+
+void MultiDeviceCompute::distributeChunks(MultiDeviceJob const &job)
+{
+    // Devices without a measurement yet count as fast as the average of the measured ones, or all
+    // the same on the first run
+    double measuredSum = 0.0;
+    uint32_t measuredCount = 0;
+    for(auto &device : mDevices)
+    {
+        if(device->stats.throughput > 0.0)
+        {
+            measuredSum += device->stats.throughput;
+            ++measuredCount;
+        }
+    }
+    double fallback = measuredCount > 0 ? measuredSum / measuredCount : 1.0;
+
+    std::vector<double> weights(mDevices.size());
+    double weightSum = 0.0;
+    for(size_t device = 0; device < mDevices.size(); ++device)
+    {
+        weights[device] = mDevices[device]->stats.throughput > 0.0 ? mDevices[device]->stats.throughput : fallback;
+        weightSum += weights[device];
+    }
+
+    // Contiguous ranges per device, so stealing from the back takes work the owner reaches last
+    uint64_t chunkCount = (job.elementCount + job.chunkElements - 1) / job.chunkElements;
+    uint64_t nextChunk = 0;
+    double accumulated = 0.0;
+    for(size_t device = 0; device < mDevices.size(); ++device)
+    {
+        accumulated += weights[device];
+        uint64_t lastChunk = device + 1 == mDevices.size() ? chunkCount :
+                             static_cast<uint64_t>(std::llround(chunkCount * accumulated / weightSum));
+        auto &chunks = mDevices[device]->chunks;
+        chunks.clear();
+        for(; nextChunk < lastChunk; ++nextChunk)
+        {
+            uint64_t first = nextChunk * job.chunkElements;
+            chunks.push_back({ first, static_cast<uint32_t>(std::min<uint64_t>(job.chunkElements, job.elementCount - first)) });
+        }
+    }
+}
+
+bool MultiDeviceCompute::takeChunk(uint32_t device, Chunk &chunk, bool &stolen)
+{
+    if(mFailed)
+    {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mDevices[device]->mutex);
+        auto &chunks = mDevices[device]->chunks;
+        if(!chunks.empty())
+        {
+            chunk = chunks.front();
+            chunks.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    // Queue sizes only shrink during a run, retry until every queue was seen empty
+    while(true)
+    {
+        ComputeDevice *victim = nullptr;
+        size_t victimSize = 0;
+        for(auto &other : mDevices)
+        {
+            std::lock_guard<std::mutex> lock(other->mutex);
+            if(other->chunks.size() > victimSize)
+            {
+                victim = other.get();
+                victimSize = other->chunks.size();
+            }
+        }
+        if(victim == nullptr)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if(!victim->chunks.empty())
+        {
+            chunk = victim->chunks.back();
+            victim->chunks.pop_back();
+            stolen = true;
+            return true;
+        }
+    }
+}
+
+bool MultiDeviceCompute::submitChunk(uint32_t device, MultiDeviceJob const &job, uint32_t slot, Chunk const &chunk)
+{
+    ComputeDevice &computeDevice = *mDevices[device];
+    VkCommandBuffer commandBuffer = computeDevice.commandBuffers[slot];
+
+    VkCommandBufferBeginInfo beginInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,    // VkStructureType                        sType
+        nullptr,                                        // const void                           * pNext
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,    // VkCommandBufferUsageFlags              flags
+        nullptr                                         // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+    };
+
+    if((vkResetCommandPool(computeDevice.logicalDevice, computeDevice.commandPools[slot], 0) != VK_SUCCESS) ||
+       (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS))
+    {
+        std::cerr << "Could not begin a command buffer on " << computeDevice.stats.name << "." << std::endl;
+        return false;
+    }
+    if(!job.record(device, slot, commandBuffer, chunk.first, chunk.count))
+    {
+        return false;
+    }
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        std::cerr << "Could not end a command buffer on " << computeDevice.stats.name << "." << std::endl;
+        return false;
+    }
+
+    VkCommandBufferSubmitInfo commandBufferInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,   // VkStructureType    sType
+        nullptr,                                        // const void       * pNext
+        commandBuffer,                                  // VkCommandBuffer    commandBuffer
+        0                                               // uint32_t           deviceMask
+    };
+
+    VkSemaphoreSubmitInfo signalInfo = {
+        VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,        // VkStructureType          sType
+        nullptr,                                        // const void             * pNext
+        computeDevice.timelineSemaphore,                // VkSemaphore              semaphore
+        computeDevice.timelineValue + 1,                // uint64_t                 value
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,           // VkPipelineStageFlags2    stageMask
+        0                                               // uint32_t                 deviceIndex
+    };
+
+    VkSubmitInfo2 submitInfo = {
+        VK_STRUCTURE_TYPE_SUBMIT_INFO_2,                // VkStructureType                    sType
+        nullptr,                                        // const void                       * pNext
+        0,                                              // VkSubmitFlags                      flags
+        0,                                              // uint32_t                           waitSemaphoreInfoCount
+        nullptr,                                        // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+        1,                                              // uint32_t                           commandBufferInfoCount
+        &commandBufferInfo,                             // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+        1,                                              // uint32_t                           signalSemaphoreInfoCount
+        &signalInfo                                     // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+    };
+
+    if(vkQueueSubmit2(computeDevice.queue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        std::cerr << "Could not submit a chunk to " << computeDevice.stats.name << "." << std::endl;
+        return false;
+    }
+    ++computeDevice.timelineValue;
+    return true;
+}
+
+bool MultiDeviceCompute::waitForChunk(uint32_t device, uint64_t timelineValue)
+{
+    ComputeDevice &computeDevice = *mDevices[device];
+
+    VkSemaphoreWaitInfo semaphoreWaitInfo = {
+        VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,          // VkStructureType          sType
+        nullptr,                                        // const void             * pNext
+        0,                                              // VkSemaphoreWaitFlags     flags
+        1,                                              // uint32_t                 semaphoreCount
+        &computeDevice.timelineSemaphore,               // const VkSemaphore      * pSemaphores
+        &timelineValue                                  // const uint64_t         * pValues
+    };
+    if(vkWaitSemaphores(computeDevice.logicalDevice, &semaphoreWaitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        std::cerr << "Could not wait for a chunk on " << computeDevice.stats.name << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MultiDeviceCompute::work(uint32_t device, MultiDeviceJob const &job)
+{
+    PROFILE_THREAD_NAME("Compute device");
+
+    struct InFlight
+    {
+        Chunk    chunk;
+        uint32_t slot;
+        uint64_t timelineValue;
+    };
+
+    ComputeDevice &computeDevice = *mDevices[device];
+    ComputeDeviceStats &stats = computeDevice.stats;
+    stats.elements = 0;
+    stats.chunks = 0;
+    stats.stolenChunks = 0;
+    stats.busySeconds = 0.0;
+
+    if(job.prepare && !job.prepare(device, computeDevice.logicalDevice, computeDevice.capabilities))
+    {
+        mFailed = true;
+        if(job.release)
+        {
+            job.release(device);
+        }
+        return;
+    }
+
+    // Chunks complete in submission order on the single queue, so slots are reused round robin
+    auto start = std::chrono::steady_clock::now();
+    std::deque<InFlight> inFlight;
+    uint32_t nextSlot = 0;
+    bool success = true;
+    while(success)
+    {
+        Chunk chunk;
+        bool stolen;
+        if(inFlight.size() < SLOTS_PER_DEVICE && takeChunk(device, chunk, stolen))
+        {
+            success = submitChunk(device, job, nextSlot, chunk);
+            if(success)
+            {
+                inFlight.push_back({ chunk, nextSlot, computeDevice.timelineValue });
+                nextSlot = (nextSlot + 1) % SLOTS_PER_DEVICE;
+                stats.stolenChunks += stolen ? 1 : 0;
+            }
+            continue;
+        }
+        if(inFlight.empty())
+        {
+            break;
+        }
+
+        InFlight const &oldest = inFlight.front();
+        success = waitForChunk(device, oldest.timelineValue) &&
+                  job.gather(device, oldest.slot, oldest.chunk.first, oldest.chunk.count);
+        if(success)
+        {
+            stats.elements += oldest.chunk.count;
+            ++stats.chunks;
+            inFlight.pop_front();
+        }
+    }
+    stats.busySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(!success)
+    {
+        mFailed = true;
+        vkQueueWaitIdle(computeDevice.queue.handle);
+    }
+    else if(stats.elements > 0 && stats.busySeconds > 0.0)
+    {
+        double measured = stats.elements / stats.busySeconds;
+        stats.throughput = stats.throughput > 0.0 ?
+                           stats.throughput + THROUGHPUT_SMOOTHING * (measured - stats.throughput) : measured;
+    }
+    if(job.release)
+    {
+        job.release(device);
+    }
+}
+
+bool MultiDeviceCompute::run(MultiDeviceJob const &job)
+{
+    PROFILE_FUNCTION();
+
+    if(mDevices.empty() || job.chunkElements == 0 || !job.record || !job.gather)
+    {
+        std::cerr << "Multi-device compute job is incomplete." << std::endl;
+        return false;
+    }
+    if(job.elementCount == 0)
+    {
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    mFailed = false;
+    distributeChunks(job);
+
+    // Dedicated threads rather than the thread pool: the workers spend most of their time blocked
+    // in semaphore waits
+    std::vector<std::thread> workers;
+    for(uint32_t device = 0; device < mDevices.size(); ++device)
+    {
+        workers.emplace_back(&MultiDeviceCompute::work, this, device, std::cref(job));
+    }
+    for(auto &worker : workers)
+    {
+        worker.join();
+    }
+    mSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for(auto &device : mDevices)
+    {
+        device->chunks.clear();
+    }
+    if(mFailed)
+    {
+        std::cerr << "Multi-device compute job failed." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MultiDeviceComputeStats MultiDeviceCompute::getStats() const
+{
+    MultiDeviceComputeStats stats;
+    for(auto &device : mDevices)
+    {
+        stats.devices.push_back(device->stats);
+    }
+    stats.seconds = mSeconds;
+    return stats;
+}
+
+} // namespace VulkanSample
@@ -1,54 +1,123 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
 #include "OSspecific.h"
+#include "WindowEventQueue.h"
+
+#ifdef VK_USE_PLATFORM_XCB_KHR
+#include <X11/keysym.h>
+#include <xcb/xcb_keysyms.h>
+#endif
 
 namespace VulkanSample
 {
 
 namespace
 {
-  enum UserMessage
+  WindowEvent makeEvent(WindowEventType type)
   {
-    USER_MESSAGE_RESIZE = WM_USER + 1,
-    USER_MESSAGE_QUIT,
-    USER_MESSAGE_MOUSE_CLICK,
-    USER_MESSAGE_MOUSE_MOVE,
-    USER_MESSAGE_MOUSE_WHEEL
-  };
+    WindowEvent event = {};
+    event.type = type;
+    return event;
+  }
+
+  WindowEvent makeMouseMove(int32_t x, int32_t y)
+  {
+    WindowEvent event = makeEvent(WindowEventType::MouseMove);
+    event.x = x;
+    event.y = y;
+    return event;
+  }
+
+  WindowEvent makeMouseClick(uint32_t button, bool pressed)
+  {
+    WindowEvent event = makeEvent(WindowEventType::MouseClick);
+    event.button = button;
+    event.pressed = pressed;
+    return event;
+  }
+
+  WindowEvent makeMouseWheel(float delta)
+  {
+    WindowEvent event = makeEvent(WindowEventType::MouseWheel);
+    event.wheelDelta = delta;
+    return event;
+  }
+
+  WindowEvent makeResize(uint32_t width, uint32_t height)
+  {
+    WindowEvent event = makeEvent(WindowEventType::Resize);
+    event.width = width;
+    event.height = height;
+    return event;
+  }
+
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+  const UINT USER_MESSAGE_EXIT = WM_USER + 1;
+
+  // Windows hands messages over one at a time, also from inside the modal loop that runs while
+  // the window is dragged or resized, so there is no batch to merge: every event is flushed at
+  // once. WM_MOUSEMOVE is already coalesced by the OS, the render thread merges the rest.
+  void postEvent(HWND hWnd, WindowEvent const &event)
+  {
+    WindowEventQueue *events = reinterpret_cast<WindowEventQueue*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    if(events != nullptr)
+    {
+      events->post(event);
+      events->flush();
+    }
+  }
+#endif
 }
 
+#ifdef VK_USE_PLATFORM_WIN32_KHR
 LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
   switch(message)
   {
     case WM_LBUTTONDOWN:
-      PostMessage(hWnd, USER_MESSAGE_MOUSE_CLICK, 0, 1);
+      postEvent(hWnd, makeMouseClick(0, true));
       break;
     case WM_LBUTTONUP:
-      PostMessage(hWnd, USER_MESSAGE_MOUSE_CLICK, 0, 0);
+      postEvent(hWnd, makeMouseClick(0, false));
       break;
     case WM_RBUTTONDOWN:
-      PostMessage(hWnd, USER_MESSAGE_MOUSE_CLICK, 1, 1);
+      postEvent(hWnd, makeMouseClick(1, true));
       break;
     case WM_RBUTTONUP:
-      PostMessage(hWnd, USER_MESSAGE_MOUSE_CLICK, 1, 0);
+      postEvent(hWnd, makeMouseClick(1, false));
       break;
     case WM_MOUSEMOVE:
-      PostMessage(hWnd, USER_MESSAGE_MOUSE_MOVE, LOWORD(lParam), HIWORD(lParam));
+      postEvent(hWnd, makeMouseMove(static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam))));
       break;
     case WM_MOUSEWHEEL:
-      PostMessage(hWnd, USER_MESSAGE_MOUSE_WHEEL, HIWORD(wParam), 0);
+      postEvent(hWnd, makeMouseWheel(static_cast<float>(GET_WHEEL_DELTA_WPARAM(wParam)) / WHEEL_DELTA));
       break;
     case WM_SIZE:
+      if(wParam == SIZE_MINIMIZED)
+        postEvent(hWnd, makeResize(0, 0));
+      else
+        postEvent(hWnd, makeResize(LOWORD(lParam), HIWORD(lParam)));
+      break;
     case WM_EXITSIZEMOVE:
-      PostMessage(hWnd, USER_MESSAGE_RESIZE, wParam, lParam);
+      {
+        RECT clientRect;
+        if(GetClientRect(hWnd, &clientRect))
+          postEvent(hWnd, makeResize(clientRect.right - clientRect.left, clientRect.bottom - clientRect.top));
+      }
       break;
     case WM_KEYDOWN:
       if(VK_ESCAPE == wParam)
       {
-        PostMessage(hWnd, USER_MESSAGE_QUIT, wParam, lParam);
+        postEvent(hWnd, makeEvent(WindowEventType::Quit));
       }
       break;
     case WM_CLOSE:
-      PostMessage(hWnd, USER_MESSAGE_QUIT, wParam, lParam);
+      postEvent(hWnd, makeEvent(WindowEventType::Quit));
+      break;
+    case USER_MESSAGE_EXIT:
+      PostQuitMessage(0);
       break;
     default:
       return DefWindowProc(hWnd, message, wParam, lParam);
@@ -56,7 +125,6 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
   return 0;
 };
 
-#ifdef VK_USE_PLATFORM_WIN32_KHR
 bool createWindowHandle(WindowParameters &windowParameters, const char* title, int startX, int startY,
                         int width, int height)
 {
@@ -88,6 +156,7 @@ bool createWindowHandle(WindowParameters &windowParameters, const char* title, i
   if(!windowParameters.HWnd)
     return false;
 
+  ShowWindow(windowParameters.HWnd, SW_SHOWNORMAL);
   return true;
 }
 
@@ -102,17 +171,231 @@ void destroyWindowHandle(WindowParameters &windowParameters)
   if(windowParameters.HInstance)
     UnregisterClass("VulkanSample", windowParameters.HInstance);
 }
+
+void runWindowEventLoop(WindowParameters &windowParameters, WindowEventQueue &events)
+{
+  SetWindowLongPtr(windowParameters.HWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&events));
+
+  MSG message;
+  while(GetMessage(&message, nullptr, 0, 0) > 0)
+  {
+    TranslateMessage(&message);
+    DispatchMessage(&message);
+  }
+
+  SetWindowLongPtr(windowParameters.HWnd, GWLP_USERDATA, 0);
+}
+
+void exitWindowEventLoop(WindowParameters &windowParameters)
+{
+  PostMessage(windowParameters.HWnd, USER_MESSAGE_EXIT, 0, 0);
+}
+#elif defined VK_USE_PLATFORM_XCB_KHR
+namespace
+{
+  bool internAtom(xcb_connection_t *connection, char const *name, bool onlyIfExists, xcb_atom_t &atom)
+  {
+    xcb_intern_atom_cookie_t cookie = xcb_intern_atom(connection, onlyIfExists ? 1 : 0, static_cast<uint16_t>(std::strlen(name)), name);
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(connection, cookie, nullptr);
+    if(reply == nullptr)
+    {
+      std::cerr << "Could not get the X11 atom " << name << "." << std::endl;
+      return false;
+    }
+    atom = reply->atom;
+    std::free(reply);
+    return true;
+  }
+
+  // Returns false when the loop was asked to exit
+  bool handleEvent(WindowParameters const &windowParameters, xcb_generic_event_t const &event, xcb_key_symbols_t *keySymbols,
+                   WindowEventQueue &events, uint32_t &width, uint32_t &height)
+  {
+    switch(event.response_type & 0x7F)
+    {
+      case XCB_MOTION_NOTIFY:
+        {
+          auto &motion = reinterpret_cast<xcb_motion_notify_event_t const &>(event);
+          events.post(makeMouseMove(motion.event_x, motion.event_y));
+        }
+        break;
+      case XCB_BUTTON_PRESS:
+      case XCB_BUTTON_RELEASE:
+        {
+          // Buttons 4 and 5 are the wheel, they send a press and a release per notch
+          auto &button = reinterpret_cast<xcb_button_press_event_t const &>(event);
+          bool pressed = (event.response_type & 0x7F) == XCB_BUTTON_PRESS;
+          if(button.detail == XCB_BUTTON_INDEX_1)
+            events.post(makeMouseClick(0, pressed));
+          else if(button.detail == XCB_BUTTON_INDEX_3)
+            events.post(makeMouseClick(1, pressed));
+          else if(pressed && (button.detail == XCB_BUTTON_INDEX_4 || button.detail == XCB_BUTTON_INDEX_5))
+            events.post(makeMouseWheel(button.detail == XCB_BUTTON_INDEX_4 ? 1.0f : -1.0f));
+        }
+        break;
+      case XCB_KEY_PRESS:
+        {
+          // Keycodes depend on the server's keymap, the unshifted keysym does not
+          auto &key = reinterpret_cast<xcb_key_press_event_t const &>(event);
+          if(keySymbols != nullptr && xcb_key_symbols_get_keysym(keySymbols, key.detail, 0) == XK_Escape)
+            events.post(makeEvent(WindowEventType::Quit));
+        }
+        break;
+      case XCB_MAPPING_NOTIFY:
+        if(keySymbols != nullptr)
+          xcb_refresh_keyboard_mapping(keySymbols, const_cast<xcb_mapping_notify_event_t *>(
+                                                     reinterpret_cast<xcb_mapping_notify_event_t const *>(&event)));
+        break;
+      case XCB_CONFIGURE_NOTIFY:
+        {
+          // Also sent when the window only moves
+          auto &configure = reinterpret_cast<xcb_configure_notify_event_t const &>(event);
+          if(configure.width != width || configure.height != height)
+          {
+            width = configure.width;
+            height = configure.height;
+            events.post(makeResize(width, height));
+          }
+        }
+        break;
+      case XCB_CLIENT_MESSAGE:
+        {
+          auto &message = reinterpret_cast<xcb_client_message_event_t const &>(event);
+          if(message.type == windowParameters.ProtocolsAtom && message.data.data32[0] == windowParameters.DeleteWindowAtom)
+            events.post(makeEvent(WindowEventType::Quit));
+          else if(message.type == windowParameters.DeleteWindowAtom)
+            return false;
+        }
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+}
+
+bool createWindowHandle(WindowParameters &windowParameters, const char* title, int startX, int startY,
+                        int width, int height)
+{
+  int screenIndex = 0;
+  windowParameters.Connection = xcb_connect(nullptr, &screenIndex);
+  if(xcb_connection_has_error(windowParameters.Connection))
+  {
+    std::cerr << "Could not connect to the X server." << std::endl;
+    xcb_disconnect(windowParameters.Connection);
+    windowParameters.Connection = nullptr;
+    return false;
+  }
+
+  xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(windowParameters.Connection));
+  for(; screenIndex > 0; --screenIndex)
+    xcb_screen_next(&screens);
+  xcb_screen_t *screen = screens.data;
+
+  uint32_t valueList[] = {
+    screen->white_pixel,
+    XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
+    XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_STRUCTURE_NOTIFY
+  };
+
+  windowParameters.Window = xcb_generate_id(windowParameters.Connection);
+  xcb_create_window(windowParameters.Connection, XCB_COPY_FROM_PARENT, windowParameters.Window, screen->root,
+                    static_cast<int16_t>(startX), static_cast<int16_t>(startY), static_cast<uint16_t>(width),
+                    static_cast<uint16_t>(height), 0, XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                    XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, valueList);
+
+  xcb_change_property(windowParameters.Connection, XCB_PROP_MODE_REPLACE, windowParameters.Window, XCB_ATOM_WM_NAME,
+                      XCB_ATOM_STRING, 8, static_cast<uint32_t>(std::strlen(title)), title);
+
+  // Lets the close button send a client message instead of the server killing the connection
+  if(!internAtom(windowParameters.Connection, "WM_PROTOCOLS", true, windowParameters.ProtocolsAtom) ||
+     !internAtom(windowParameters.Connection, "WM_DELETE_WINDOW", false, windowParameters.DeleteWindowAtom))
+  {
+    destroyWindowHandle(windowParameters);
+    return false;
+  }
+  xcb_change_property(windowParameters.Connection, XCB_PROP_MODE_REPLACE, windowParameters.Window,
+                      windowParameters.ProtocolsAtom, XCB_ATOM_ATOM, 32, 1, &windowParameters.DeleteWindowAtom);
+
+  xcb_map_window(windowParameters.Connection, windowParameters.Window);
+  xcb_flush(windowParameters.Connection);
+  return true;
+}
+
+void destroyWindowHandle(WindowParameters &windowParameters)
+{
+  if(windowParameters.Connection)
+  {
+    xcb_destroy_window(windowParameters.Connection, windowParameters.Window);
+    xcb_disconnect(windowParameters.Connection);
+    windowParameters.Connection = nullptr;
+  }
+}
+
+void runWindowEventLoop(WindowParameters &windowParameters, WindowEventQueue &events)
+{
+  xcb_key_symbols_t *keySymbols = xcb_key_symbols_alloc(windowParameters.Connection);
+  if(keySymbols == nullptr)
+    std::cerr << "Could not get the X11 keyboard mapping, keys are ignored." << std::endl;
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  bool running = true;
+  while(running)
+  {
+    // Blocks for the first event of a batch, then takes the ones already queued without
+    // blocking; the moves and resizes of the batch reach the render thread as one event each
+    xcb_generic_event_t *event = xcb_wait_for_event(windowParameters.Connection);
+    if(event == nullptr)
+    {
+      std::cerr << "Lost the connection to the X server." << std::endl;
+      events.post(makeEvent(WindowEventType::Quit));
+      break;
+    }
+    while(event != nullptr)
+    {
+      running &= handleEvent(windowParameters, *event, keySymbols, events, width, height);
+      std::free(event);
+      event = xcb_poll_for_queued_event(windowParameters.Connection);
+    }
+    events.flush();
+  }
+
+  if(keySymbols != nullptr)
+    xcb_key_symbols_free(keySymbols);
+}
+
+void exitWindowEventLoop(WindowParameters &windowParameters)
+{
+  // Without an event mask the message goes to the client that created the window, i.e. the loop
+  xcb_client_message_event_t message = {};
+  message.response_type = XCB_CLIENT_MESSAGE;
+  message.format = 32;
+  message.window = windowParameters.Window;
+  message.type = windowParameters.DeleteWindowAtom;
+  xcb_send_event(windowParameters.Connection, 0, windowParameters.Window, XCB_EVENT_MASK_NO_EVENT,
+                 reinterpret_cast<char const *>(&message));
+  xcb_flush(windowParameters.Connection);
+}
 #else
-bool createWindowHandle(WindowParameters &windowParameters, const char* title, int startX, int startY, 
+bool createWindowHandle(WindowParameters &windowParameters, const char* title, int startX, int startY,
                         int width, int height)
 {
-    return false; // not implemented yet and probably will not be ever
+  std::cerr << "Windows are only implemented for Win32 and XCB." << std::endl;
+  return false;
 }
 
 void destroyWindowHandle(WindowParameters &windowParameters)
 {
-    // not implemented yet and probably will not be ever
+}
+
+void runWindowEventLoop(WindowParameters &windowParameters, WindowEventQueue &events)
+{
+}
+
+void exitWindowEventLoop(WindowParameters &windowParameters)
+{
 }
 #endif
 
-} // namespace VulkanSample
\ No newline at end of file
+} // namespace VulkanSample
@@ -0,0 +1,294 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "PackedAssetFormat.h"
+
+#ifdef VULKANSAMPLE_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef VULKANSAMPLE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace VulkanSample
+{
+
+namespace
+{
+  uint64_t alignUp(uint64_t value, uint64_t alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  bool compress(AssetCompression compression, uint8_t const *source, size_t sourceSize, std::vector<uint8_t> &compressed)
+  {
+    (void)source;
+    (void)sourceSize;
+    (void)compressed;
+
+    switch(compression)
+    {
+#ifdef VULKANSAMPLE_WITH_LZ4
+      case AssetCompression::LZ4:
+      {
+        if(sourceSize > static_cast<size_t>(LZ4_MAX_INPUT_SIZE))
+          return false;
+        compressed.resize(static_cast<size_t>(LZ4_compressBound(static_cast<int>(sourceSize))));
+        int written = LZ4_compress_default(reinterpret_cast<char const *>(source), reinterpret_cast<char *>(compressed.data()),
+                                           static_cast<int>(sourceSize), static_cast<int>(compressed.size()));
+        if(written <= 0)
+          return false;
+        compressed.resize(static_cast<size_t>(written));
+        return true;
+      }
+#endif
+#ifdef VULKANSAMPLE_WITH_ZSTD
+      case AssetCompression::Zstd:
+      {
+        compressed.resize(ZSTD_compressBound(sourceSize));
+        size_t written = ZSTD_compress(compressed.data(), compressed.size(), source, sourceSize, 19);
+        if(ZSTD_isError(written))
+          return false;
+        compressed.resize(written);
+        return true;
+      }
+#endif
+      default:
+        return false;
+    }
+  }
+}
+
+bool isCompressionAvailable(AssetCompression compression)
+{
+  switch(compression)
+  {
+    case AssetCompression::None:
+      return true;
+#ifdef VULKANSAMPLE_WITH_LZ4
+    case AssetCompression::LZ4:
+      return true;
+#endif
+#ifdef VULKANSAMPLE_WITH_ZSTD
+    case AssetCompression::Zstd:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+char const *getSectionTypeName(AssetSectionType type)
+{
+  switch(type)
+  {
+    case AssetSectionType::Vertices:
+      return "vertices";
+    case AssetSectionType::Indices:
+      return "indices";
+    case AssetSectionType::Meshlets:
+      return "meshlets";
+    case AssetSectionType::MeshletVertices:
+      return "meshlet vertices";
+    case AssetSectionType::MeshletTriangles:
+      return "meshlet triangles";
+    default:
+      return "unknown";
+  }
+}
+
+void PackedAssetWriter::addSection(AssetSectionType type, uint32_t elementSize, uint32_t elementCount, void const *data,
+                                   AssetCompression compression)
+{
+  PendingSection section = {};
+  section.description.type = type;
+  section.description.compression = AssetCompression::None;
+  section.description.elementSize = elementSize;
+  section.description.elementCount = elementCount;
+  section.description.size = static_cast<uint64_t>(elementSize) * elementCount;
+
+  uint8_t const *source = static_cast<uint8_t const *>(data);
+  size_t size = static_cast<size_t>(section.description.size);
+
+  std::vector<uint8_t> compressed;
+  if(compression != AssetCompression::None && compress(compression, source, size, compressed) && compressed.size() < size)
+  {
+    section.description.compression = compression;
+    section.payload = std::move(compressed);
+  }
+  else
+  {
+    section.payload.assign(source, source + size);
+  }
+  section.description.storedSize = section.payload.size();
+
+  mSections.push_back(std::move(section));
+}
+
+bool PackedAssetWriter::write(std::string const &filename) const
+{
+  PackedAssetHeader header = {};
+  header.magic = PACKED_ASSET_MAGIC;
+  header.version = PACKED_ASSET_VERSION;
+  header.sectionCount = static_cast<uint32_t>(mSections.size());
+
+  std::vector<PackedAssetSection> table;
+  uint64_t offset = alignUp(sizeof(PackedAssetHeader) + sizeof(PackedAssetSection) * mSections.size(),
+                            PACKED_ASSET_SECTION_ALIGNMENT);
+  for(auto &section : mSections)
+  {
+    table.push_back(section.description);
+    table.back().offset = offset;
+    offset = alignUp(offset + section.description.storedSize, PACKED_ASSET_SECTION_ALIGNMENT);
+  }
+  header.fileSize = offset;
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if(file.fail())
+  {
+    std::cerr << "Could not create '" << filename << "' file." << std::endl;
+    return false;
+  }
+
+  file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+  file.write(reinterpret_cast<char const *>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(PackedAssetSection)));
+
+  std::vector<char> padding(PACKED_ASSET_SECTION_ALIGNMENT, 0);
+  for(size_t i = 0; i < mSections.size(); ++i)
+  {
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(padding.data(), static_cast<std::streamsize>(table[i].offset - position));
+    file.write(reinterpret_cast<char const *>(mSections[i].payload.data()), static_cast<std::streamsize>(mSections[i].payload.size()));
+  }
+  uint64_t position = static_cast<uint64_t>(file.tellp());
+  file.write(padding.data(), static_cast<std::streamsize>(header.fileSize - position));
+
+  if(file.fail())
+  {
+    std::cerr << "Could not write '" << filename << "' file." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool PackedAsset::open(std::string const &filename)
+{
+  close();
+
+  if(!mFile.open(filename))
+    return false;
+
+  uint8_t const *data = mFile.getData();
+  size_t size = mFile.getSize();
+
+  PackedAssetHeader header;
+  if(size < sizeof(header))
+  {
+    std::cerr << "File '" << filename << "' is too small to be a packed asset." << std::endl;
+    close();
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+
+  if(header.magic != PACKED_ASSET_MAGIC || header.version != PACKED_ASSET_VERSION || header.fileSize != size ||
+     sizeof(header) + static_cast<uint64_t>(header.sectionCount) * sizeof(PackedAssetSection) > size)
+  {
+    std::cerr << "File '" << filename << "' is not a valid packed asset." << std::endl;
+    close();
+    return false;
+  }
+
+  mSections.resize(header.sectionCount);
+  std::memcpy(mSections.data(), data + sizeof(header), header.sectionCount * sizeof(PackedAssetSection));
+
+  for(auto &section : mSections)
+  {
+    // Uncompressed sections are copied with their decompressed size, it must be what the file stores
+    if(section.offset % PACKED_ASSET_SECTION_ALIGNMENT != 0 || section.offset + section.storedSize < section.offset ||
+       section.offset + section.storedSize > size ||
+       section.size != static_cast<uint64_t>(section.elementSize) * section.elementCount ||
+       (section.compression == AssetCompression::None && section.storedSize != section.size))
+    {
+      std::cerr << "Packed asset '" << filename << "' has a corrupted " << getSectionTypeName(section.type)
+                << " section." << std::endl;
+      close();
+      return false;
+    }
+    if(!isCompressionAvailable(section.compression))
+    {
+      std::cerr << "Packed asset '" << filename << "' uses a compression codec this build does not support." << std::endl;
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void PackedAsset::close()
+{
+  mSections.clear();
+  mFile.close();
+}
+
+PackedAssetSection const *PackedAsset::findSection(AssetSectionType type) const
+{
+  for(auto &section : mSections)
+  {
+    if(section.type == type)
+      return &section;
+  }
+  return nullptr;
+}
+
+std::vector<PackedAssetSection> const &PackedAsset::getSections() const
+{
+  return mSections;
+}
+
+uint8_t const *PackedAsset::getStoredData(PackedAssetSection const &section) const
+{
+  return mFile.getData() + section.offset;
+}
+
+bool PackedAsset::readSection(PackedAssetSection const &section, void *destination) const
+{
+  uint8_t const *source = getStoredData(section);
+
+  switch(section.compression)
+  {
+    case AssetCompression::None:
+      std::memcpy(destination, source, static_cast<size_t>(section.size));
+      return true;
+#ifdef VULKANSAMPLE_WITH_LZ4
+    case AssetCompression::LZ4:
+    {
+      int read = LZ4_decompress_safe(reinterpret_cast<char const *>(source), static_cast<char *>(destination),
+                                     static_cast<int>(section.storedSize), static_cast<int>(section.size));
+      if(read < 0 || static_cast<uint64_t>(read) != section.size)
+      {
+        std::cerr << "Could not decompress " << getSectionTypeName(section.type) << " section." << std::endl;
+        return false;
+      }
+      return true;
+    }
+#endif
+#ifdef VULKANSAMPLE_WITH_ZSTD
+    case AssetCompression::Zstd:
+    {
+      size_t read = ZSTD_decompress(destination, static_cast<size_t>(section.size), source, static_cast<size_t>(section.storedSize));
+      if(ZSTD_isError(read) || read != section.size)
+      {
+        std::cerr << "Could not decompress " << getSectionTypeName(section.type) << " section." << std::endl;
+        return false;
+      }
+      return true;
+    }
+#endif
+    default:
+      std::cerr << "Unsupported compression of " << getSectionTypeName(section.type) << " section." << std::endl;
+      return false;
+  }
+}
+
+} // namespace VulkanSample
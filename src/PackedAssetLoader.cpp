@@ -0,0 +1,281 @@
+#include <chrono>
+
+#include "PackedAssetLoader.h"
+#include "Profiler.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const VkDeviceSize STAGING_ALIGNMENT = 16;
+  const VkDeviceSize NOT_STAGED        = ~VkDeviceSize(0);
+
+  VkBufferUsageFlags getSectionUsage(AssetSectionType type)
+  {
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if(type == AssetSectionType::Vertices)
+      usage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    else if(type == AssetSectionType::Indices)
+      usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    return usage;
+  }
+
+  VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+PackedAssetLoader::PackedAssetLoader()
+{
+    mLogicalDevice = VK_NULL_HANDLE;
+    mStats = {};
+}
+
+PackedAssetLoader::~PackedAssetLoader()
+{
+    releaseTransferResources();
+}
+
+bool PackedAssetLoader::importSection(DeviceCapabilities const &capabilities, PackedAsset const &asset,
+                                      PackedAssetSection const &section, VkBuffer &sourceBuffer)
+{
+    VkDeviceSize alignment = capabilities.minImportedHostPointerAlignment;
+    if(!capabilities.externalMemoryHostSupported || section.compression != AssetCompression::None ||
+       alignment == 0 || alignment > PACKED_ASSET_SECTION_ALIGNMENT)
+        return false;
+
+    // Sections start on and are padded to PACKED_ASSET_SECTION_ALIGNMENT, so the rounded
+    // range never leaves the mapping
+    void *pointer = const_cast<uint8_t *>(asset.getStoredData(section));
+    VkDeviceSize importSize = alignUp(section.storedSize, alignment);
+    if(reinterpret_cast<uintptr_t>(pointer) % alignment != 0)
+        return false;
+
+    VkExternalMemoryHandleTypeFlagBits handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    VkMemoryHostPointerPropertiesEXT hostPointerProperties = {};
+    hostPointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if(vkGetMemoryHostPointerPropertiesEXT(mLogicalDevice, handleType, pointer, &hostPointerProperties) != VK_SUCCESS ||
+       hostPointerProperties.memoryTypeBits == 0)
+        return false;
+
+    VkExternalMemoryBufferCreateInfo externalMemoryBufferCreateInfo = {
+        VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,   // VkStructureType                    sType
+        nullptr,                                                // const void                       * pNext
+        static_cast<VkExternalMemoryHandleTypeFlags>(handleType) // VkExternalMemoryHandleTypeFlags   handleTypes
+    };
+
+    VkBufferCreateInfo bufferCreateInfo = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,   // VkStructureType        sType
+        &externalMemoryBufferCreateInfo,        // const void           * pNext
+        0,                                      // VkBufferCreateFlags    flags
+        importSize,                             // VkDeviceSize           size
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,       // VkBufferUsageFlags     usage
+        VK_SHARING_MODE_EXCLUSIVE,              // VkSharingMode          sharingMode
+        0,                                      // uint32_t               queueFamilyIndexCount
+        nullptr                                 // const uint32_t       * pQueueFamilyIndices
+    };
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    if(vkCreateBuffer(mLogicalDevice, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+        return false;
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(mLogicalDevice, buffer, &memoryRequirements);
+
+    uint32_t memoryTypeIndex;
+    if(memoryRequirements.size > importSize ||
+       !selectMemoryType(capabilities.memoryProperties, memoryRequirements.memoryTypeBits & hostPointerProperties.memoryTypeBits,
+                         0, memoryTypeIndex))
+    {
+        destroyBuffer(mLogicalDevice, buffer);
+        return false;
+    }
+
+    VkImportMemoryHostPointerInfoEXT importMemoryHostPointerInfo = {
+        VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,  // VkStructureType                      sType
+        nullptr,                                                // const void                         * pNext
+        handleType,                                             // VkExternalMemoryHandleTypeFlagBits   handleType
+        pointer                                                 // void                               * pHostPointer
+    };
+
+    VkMemoryAllocateInfo memoryAllocateInfo = {
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,   // VkStructureType    sType
+        &importMemoryHostPointerInfo,             // const void       * pNext
+        importSize,                               // VkDeviceSize       allocationSize
+        memoryTypeIndex                           // uint32_t           memoryTypeIndex
+    };
+
+    VkDeviceMemory memoryObject = VK_NULL_HANDLE;
+    if(vkAllocateMemory(mLogicalDevice, &memoryAllocateInfo, nullptr, &memoryObject) != VK_SUCCESS ||
+       vkBindBufferMemory(mLogicalDevice, buffer, memoryObject, 0) != VK_SUCCESS)
+    {
+        // Read-only file pages are rejected by some drivers, the staging path handles those
+        freeMemoryObject(mLogicalDevice, memoryObject);
+        destroyBuffer(mLogicalDevice, buffer);
+        return false;
+    }
+
+    mTransferBuffers.push_back(buffer);
+    mTransferMemoryObjects.push_back(memoryObject);
+    sourceBuffer = buffer;
+    return true;
+}
+
+bool PackedAssetLoader::recordUpload(VkDevice logicalDevice, DeviceCapabilities const &capabilities, PackedAsset const &asset,
+                                     VkCommandBuffer commandBuffer, GpuMeshBuffers &mesh)
+{
+    PROFILE_FUNCTION();
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    releaseTransferResources();
+    mLogicalDevice = logicalDevice;
+    mStats = {};
+    mesh = {};
+
+    auto const &sections = asset.getSections();
+    std::vector<VkBuffer> sourceBuffers(sections.size(), VK_NULL_HANDLE);
+    std::vector<VkDeviceSize> stagingOffsets(sections.size(), NOT_STAGED);
+    VkDeviceSize stagingSize = 0;
+
+    for(size_t i = 0; i < sections.size(); ++i)
+    {
+        auto const &section = sections[i];
+        uint32_t slot = static_cast<uint32_t>(section.type);
+        if(slot >= static_cast<uint32_t>(AssetSectionType::Count) || section.size == 0 || mesh.buffers[slot] != VK_NULL_HANDLE)
+            continue;
+
+        if(!createBuffer(mLogicalDevice, section.size, getSectionUsage(section.type), mesh.buffers[slot]) ||
+           !allocateAndBindMemoryObjectToBuffer(capabilities.memoryProperties, mLogicalDevice, mesh.buffers[slot],
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.memoryObjects[slot]))
+        {
+            destroyMeshBuffers(mLogicalDevice, mesh);
+            releaseTransferResources();
+            return false;
+        }
+        mesh.elementCounts[slot] = section.elementCount;
+
+        if(importSection(capabilities, asset, section, sourceBuffers[i]))
+        {
+            ++mStats.importedSections;
+            mStats.importedBytes += section.size;
+            continue;
+        }
+
+        stagingOffsets[i] = stagingSize;
+        stagingSize = alignUp(stagingSize + section.size, STAGING_ALIGNMENT);
+    }
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    if(stagingSize > 0)
+    {
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+        bool created = createHostVisibleBuffer(capabilities.memoryProperties, mLogicalDevice, stagingSize,
+                                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, stagingBuffer, stagingMemory);
+        mTransferBuffers.push_back(stagingBuffer);
+        mTransferMemoryObjects.push_back(stagingMemory);
+
+        void *mapping = nullptr;
+        if(!created || vkMapMemory(mLogicalDevice, stagingMemory, 0, stagingSize, 0, &mapping) != VK_SUCCESS)
+        {
+            std::cerr << "Could not prepare a staging buffer for packed asset upload." << std::endl;
+            destroyMeshBuffers(mLogicalDevice, mesh);
+            releaseTransferResources();
+            return false;
+        }
+
+        // Decompression writes straight into the mapped staging memory, no intermediate copy
+        bool read = true;
+        for(size_t i = 0; i < sections.size() && read; ++i)
+        {
+            if(sourceBuffers[i] != VK_NULL_HANDLE || stagingOffsets[i] == NOT_STAGED)
+                continue;
+
+            read = asset.readSection(sections[i], static_cast<uint8_t *>(mapping) + stagingOffsets[i]);
+            sourceBuffers[i] = stagingBuffer;
+            ++mStats.stagedSections;
+            mStats.stagedBytes += sections[i].size;
+            if(sections[i].compression != AssetCompression::None)
+                mStats.decompressedBytes += sections[i].size;
+        }
+        vkUnmapMemory(mLogicalDevice, stagingMemory);
+
+        if(!read)
+        {
+            destroyMeshBuffers(mLogicalDevice, mesh);
+            releaseTransferResources();
+            return false;
+        }
+    }
+
+    std::vector<VkBufferMemoryBarrier> barriers;
+    for(size_t i = 0; i < sections.size(); ++i)
+    {
+        if(sourceBuffers[i] == VK_NULL_HANDLE)
+            continue;
+
+        VkBuffer destination = mesh.buffers[static_cast<uint32_t>(sections[i].type)];
+        VkDeviceSize sourceOffset = sourceBuffers[i] == stagingBuffer ? stagingOffsets[i] : 0;
+        VkBufferCopy region = { sourceOffset, 0, sections[i].size };
+        vkCmdCopyBuffer(commandBuffer, sourceBuffers[i], destination, 1, &region);
+
+        VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        barriers.push_back({
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,      // VkStructureType    sType
+            nullptr,                                      // const void       * pNext
+            VK_ACCESS_TRANSFER_WRITE_BIT,                 // VkAccessFlags      srcAccessMask
+            dstAccess,                                    // VkAccessFlags      dstAccessMask
+            VK_QUEUE_FAMILY_IGNORED,                      // uint32_t           srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                      // uint32_t           dstQueueFamilyIndex
+            destination,                                  // VkBuffer           buffer
+            0,                                            // VkDeviceSize       offset
+            VK_WHOLE_SIZE                                 // VkDeviceSize       size
+        });
+    }
+
+    VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    if(capabilities.meshShaderSupported)
+        dstStages |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+
+    if(!barriers.empty())
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+    mStats.cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+void PackedAssetLoader::releaseTransferResources()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    for(auto &buffer : mTransferBuffers)
+        destroyBuffer(mLogicalDevice, buffer);
+    for(auto &memoryObject : mTransferMemoryObjects)
+        freeMemoryObject(mLogicalDevice, memoryObject);
+    mTransferBuffers.clear();
+    mTransferMemoryObjects.clear();
+}
+
+PackedAssetLoadStats const &PackedAssetLoader::getStats() const
+{
+    return mStats;
+}
+
+void PackedAssetLoader::destroyMeshBuffers(VkDevice logicalDevice, GpuMeshBuffers &mesh)
+{
+    for(uint32_t slot = 0; slot < static_cast<uint32_t>(AssetSectionType::Count); ++slot)
+    {
+        destroyBuffer(logicalDevice, mesh.buffers[slot]);
+        freeMemoryObject(logicalDevice, mesh.memoryObjects[slot]);
+        mesh.elementCounts[slot] = 0;
+    }
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,354 @@
+#include <fstream>
+
+#include "PassQueries.h"
+#include "Profiler.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+  void writeJsonString(std::ofstream &file, std::string const &text)
+  {
+    file << '"';
+    for(char character : text)
+    {
+      if(character == '"' || character == '\\')
+        file << '\\' << character;
+      else if(static_cast<unsigned char>(character) >= 0x20)
+        file << character;
+    }
+    file << '"';
+  }
+
+  double ratio(uint64_t numerator, uint64_t denominator)
+  {
+    return denominator > 0 ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+  }
+}
+
+PassQueries::PassQueries()
+{
+    mLogicalDevice       = VK_NULL_HANDLE;
+    mMaxPasses           = 0;
+    mStatisticsSupported = false;
+    mOcclusionFlags      = 0;
+    mStatisticsPool      = VK_NULL_HANDLE;
+    mOcclusionPool       = VK_NULL_HANDLE;
+    mReadbackBuffer      = VK_NULL_HANDLE;
+    mReadbackMemory      = VK_NULL_HANDLE;
+    mReadbackData        = nullptr;
+    mSlotIndex           = 0;
+    mPassActive          = false;
+    mFrame               = 0;
+    mStats               = {};
+}
+
+PassQueries::~PassQueries()
+{
+    destroy();
+}
+
+bool PassQueries::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight, uint32_t maxPasses)
+{
+    destroy();
+    mLogicalDevice       = logicalDevice;
+    mMaxPasses           = maxPasses;
+    mStatisticsSupported = capabilities.pipelineStatisticsQuerySupported;
+    mOcclusionFlags      = capabilities.occlusionQueryPreciseSupported ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+
+    if(framesInFlight == 0 || maxPasses == 0)
+    {
+        std::cerr << "Pass queries need at least one frame in flight and one pass." << std::endl;
+        return false;
+    }
+
+    uint32_t queryCount = framesInFlight * maxPasses;
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,     // VkStructureType                  sType
+        nullptr,                                      // const void                     * pNext
+        0,                                            // VkQueryPoolCreateFlags           flags
+        VK_QUERY_TYPE_OCCLUSION,                      // VkQueryType                      queryType
+        queryCount,                                   // uint32_t                         queryCount
+        0                                             // VkQueryPipelineStatisticFlags    pipelineStatistics
+    };
+    if(vkCreateQueryPool(mLogicalDevice, &queryPoolCreateInfo, nullptr, &mOcclusionPool) != VK_SUCCESS)
+    {
+        std::cerr << "Could not create occlusion query pool." << std::endl;
+        destroy();
+        return false;
+    }
+
+    if(mStatisticsSupported)
+    {
+        queryPoolCreateInfo.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolCreateInfo.pipelineStatistics = STATISTICS_FLAGS;
+        if(vkCreateQueryPool(mLogicalDevice, &queryPoolCreateInfo, nullptr, &mStatisticsPool) != VK_SUCCESS)
+        {
+            std::cerr << "Could not create pipeline statistics query pool." << std::endl;
+            destroy();
+            return false;
+        }
+    }
+
+    // Per slot: the statistics of every pass, then their occlusion results
+    VkDeviceSize slotSize = VkDeviceSize(maxPasses) * (STATISTICS_COUNT + 1) * sizeof(uint64_t);
+    if(!createHostVisibleBuffer(capabilities.memoryProperties, mLogicalDevice, slotSize * framesInFlight,
+                                VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr, mReadbackBuffer, mReadbackMemory))
+    {
+        destroy();
+        return false;
+    }
+    void *readbackData = nullptr;
+    if(vkMapMemory(mLogicalDevice, mReadbackMemory, 0, VK_WHOLE_SIZE, 0, &readbackData) != VK_SUCCESS)
+    {
+        std::cerr << "Could not map pass query readback buffer." << std::endl;
+        destroy();
+        return false;
+    }
+    mReadbackData = static_cast<uint64_t*>(readbackData);
+
+    FrameSlot unused;
+    unused.frame    = 0;
+    unused.resolved = false;
+    mSlots.assign(framesInFlight, unused);
+    return true;
+}
+
+void PassQueries::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    if(mStatisticsPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(mLogicalDevice, mStatisticsPool, nullptr);
+        mStatisticsPool = VK_NULL_HANDLE;
+    }
+    if(mOcclusionPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(mLogicalDevice, mOcclusionPool, nullptr);
+        mOcclusionPool = VK_NULL_HANDLE;
+    }
+    destroyBuffer(mLogicalDevice, mReadbackBuffer);
+    freeMemoryObject(mLogicalDevice, mReadbackMemory);
+    mReadbackData = nullptr;
+
+    mSlots.clear();
+    mCounters.clear();
+    mPassActive = false;
+    mStats      = {};
+}
+
+void PassQueries::readResults(FrameSlot &slot, uint32_t slotIndex)
+{
+    uint32_t passCount = static_cast<uint32_t>(slot.passNames.size());
+    uint64_t const *statistics = mReadbackData + size_t(slotIndex) * mMaxPasses * (STATISTICS_COUNT + 1);
+    uint64_t const *occlusion = statistics + size_t(mMaxPasses) * STATISTICS_COUNT;
+
+    mCounters.resize(passCount);
+    for(uint32_t pass = 0; pass < passCount; ++pass)
+    {
+        PassQueryCounters &counters = mCounters[pass];
+        counters = {};
+        counters.name  = slot.passNames[pass];
+        counters.frame = slot.frame;
+
+        uint64_t const *values = statistics + size_t(pass) * STATISTICS_COUNT;
+        counters.statisticsValid = mStatisticsSupported;
+        if(counters.statisticsValid)
+        {
+            counters.inputVertices       = values[0];
+            counters.inputPrimitives     = values[1];
+            counters.vertexInvocations   = values[2];
+            counters.clippingInvocations = values[3];
+            counters.clippingPrimitives  = values[4];
+            counters.fragmentInvocations = values[5];
+            counters.computeInvocations  = values[6];
+        }
+
+        counters.samplesPassed = occlusion[pass];
+    }
+    mStats.passes = passCount;
+    ++mStats.resolvedFrames;
+}
+
+void PassQueries::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    PROFILE_FUNCTION();
+
+    ++mFrame;
+    mSlotIndex = frameIndex % static_cast<uint32_t>(mSlots.size());
+    FrameSlot &slot = mSlots[mSlotIndex];
+
+    // The frame that used this slot has finished, its copy of the results is in the readback buffer
+    if(slot.resolved && !slot.passNames.empty())
+        readResults(slot, mSlotIndex);
+
+    slot.passNames.clear();
+    slot.frame      = mFrame;
+    slot.resolved   = false;
+    mPassActive     = false;
+
+    uint32_t firstQuery = mSlotIndex * mMaxPasses;
+    vkCmdResetQueryPool(commandBuffer, mOcclusionPool, firstQuery, mMaxPasses);
+    if(mStatisticsSupported)
+        vkCmdResetQueryPool(commandBuffer, mStatisticsPool, firstQuery, mMaxPasses);
+}
+
+void PassQueries::beginPass(VkCommandBuffer commandBuffer, char const *name)
+{
+    FrameSlot &slot = mSlots[mSlotIndex];
+    if(mPassActive)
+    {
+        std::cerr << "Pass queries of '" << name << "' begin before the previous pass ended." << std::endl;
+        return;
+    }
+    if(slot.passNames.size() >= mMaxPasses)
+    {
+        ++mStats.droppedPasses;
+        return;
+    }
+
+    uint32_t query = mSlotIndex * mMaxPasses + static_cast<uint32_t>(slot.passNames.size());
+    slot.passNames.emplace_back(name);
+    vkCmdBeginQuery(commandBuffer, mOcclusionPool, query, mOcclusionFlags);
+    if(mStatisticsSupported)
+        vkCmdBeginQuery(commandBuffer, mStatisticsPool, query, 0);
+    mPassActive = true;
+}
+
+void PassQueries::endPass(VkCommandBuffer commandBuffer)
+{
+    if(!mPassActive)
+        return;
+
+    uint32_t query = mSlotIndex * mMaxPasses + static_cast<uint32_t>(mSlots[mSlotIndex].passNames.size()) - 1;
+    if(mStatisticsSupported)
+        vkCmdEndQuery(commandBuffer, mStatisticsPool, query);
+    vkCmdEndQuery(commandBuffer, mOcclusionPool, query);
+    mPassActive = false;
+}
+
+void PassQueries::recordResolve(VkCommandBuffer commandBuffer)
+{
+    PROFILE_FUNCTION();
+
+    FrameSlot &slot = mSlots[mSlotIndex];
+    if(mPassActive)
+    {
+        std::cerr << "Pass queries are resolved while pass '" << slot.passNames.back() << "' is still active." << std::endl;
+        return;
+    }
+    uint32_t passCount = static_cast<uint32_t>(slot.passNames.size());
+    if(passCount == 0)
+        return;
+
+    // Without WAIT_BIT the copy may run before the queries' results are written. The wait is part of
+    // the copy command and only orders it on the GPU timeline, the CPU never blocks on it. Every query
+    // of the range was begun and ended in this frame, so none needs an availability word.
+    uint32_t firstQuery = mSlotIndex * mMaxPasses;
+    VkDeviceSize slotOffset = VkDeviceSize(mSlotIndex) * mMaxPasses * (STATISTICS_COUNT + 1) * sizeof(uint64_t);
+    VkQueryResultFlags resultFlags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT;
+    if(mStatisticsSupported)
+    {
+        vkCmdCopyQueryPoolResults(commandBuffer, mStatisticsPool, firstQuery, passCount, mReadbackBuffer, slotOffset,
+                                  STATISTICS_COUNT * sizeof(uint64_t), resultFlags);
+    }
+    vkCmdCopyQueryPoolResults(commandBuffer, mOcclusionPool, firstQuery, passCount, mReadbackBuffer,
+                              slotOffset + VkDeviceSize(mMaxPasses) * STATISTICS_COUNT * sizeof(uint64_t),
+                              sizeof(uint64_t), resultFlags);
+
+    VkMemoryBarrier2 hostBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,                               // VkStructureType          sType
+        nullptr,                                                          // const void             * pNext
+        VK_PIPELINE_STAGE_2_COPY_BIT,                                     // VkPipelineStageFlags2    srcStageMask
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,                                   // VkAccessFlags2           srcAccessMask
+        VK_PIPELINE_STAGE_2_HOST_BIT,                                     // VkPipelineStageFlags2    dstStageMask
+        VK_ACCESS_2_HOST_READ_BIT                                         // VkAccessFlags2           dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+        nullptr,                                // const void                     * pNext
+        0,                                      // VkDependencyFlags                dependencyFlags
+        1,                                      // uint32_t                         memoryBarrierCount
+        &hostBarrier,                           // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                      // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        0,                                      // uint32_t                         imageMemoryBarrierCount
+        nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    slot.resolved = true;
+}
+
+std::vector<PassQueryCounters> const &PassQueries::getCounters() const
+{
+    return mCounters;
+}
+
+PassQueryStats PassQueries::getStats() const
+{
+    return mStats;
+}
+
+bool PassQueries::exportJson(std::string const &filename) const
+{
+    std::ofstream file(filename, std::ios::trunc);
+    if(file.fail())
+    {
+        std::cerr << "Could not create '" << filename << "' file." << std::endl;
+        return false;
+    }
+
+    file << std::fixed;
+    file.precision(3);
+    file << "{\"frame\":" << (mCounters.empty() ? 0 : mCounters.front().frame)
+         << ",\"pipelineStatistics\":" << (mStatisticsSupported ? "true" : "false")
+         << ",\"preciseOcclusion\":" << (mOcclusionFlags != 0 ? "true" : "false") << ",\"passes\":[";
+    bool first = true;
+    for(auto &counters : mCounters)
+    {
+        file << (first ? "" : ",") << "\n{\"name\":";
+        writeJsonString(file, counters.name);
+        if(counters.statisticsValid)
+        {
+            file << ",\"inputVertices\":" << counters.inputVertices
+                 << ",\"inputPrimitives\":" << counters.inputPrimitives
+                 << ",\"vertexInvocations\":" << counters.vertexInvocations
+                 << ",\"clippingInvocations\":" << counters.clippingInvocations
+                 << ",\"clippingPrimitives\":" << counters.clippingPrimitives
+                 << ",\"fragmentInvocations\":" << counters.fragmentInvocations
+                 << ",\"computeInvocations\":" << counters.computeInvocations
+                 << ",\"primitivesKept\":" << ratio(counters.clippingPrimitives, counters.clippingInvocations)
+                 << ",\"fragmentsPerPrimitive\":" << ratio(counters.fragmentInvocations, counters.clippingPrimitives);
+        }
+        file << ",\"samplesPassed\":" << counters.samplesPassed;
+        // Shaded fragments per visible sample, well above 1 means overdraw that early depth did not reject
+        if(counters.statisticsValid)
+            file << ",\"fragmentsPerSamplePassed\":" << ratio(counters.fragmentInvocations, counters.samplesPassed);
+        file << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+
+    if(file.fail())
+    {
+        std::cerr << "Could not write '" << filename << "' file." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,596 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "PipelineManager.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const VkGraphicsPipelineLibraryFlagsEXT LIBRARY_FLAGS[] = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+  };
+
+  // State create infos of one pipeline, filled in place because they point at each other
+  struct PipelineCreateInfos
+  {
+    std::vector<VkPipelineShaderStageCreateInfo>     stages;
+    VkPipelineVertexInputStateCreateInfo             vertexInput;
+    VkPipelineInputAssemblyStateCreateInfo           inputAssembly;
+    VkPipelineViewportStateCreateInfo                viewport;
+    VkPipelineRasterizationStateCreateInfo           rasterization;
+    VkPipelineMultisampleStateCreateInfo             multisample;
+    VkPipelineDepthStencilStateCreateInfo            depthStencil;
+    std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+    VkPipelineColorBlendStateCreateInfo              colorBlend;
+    VkDynamicState                                   dynamicStates[2];
+    VkPipelineDynamicStateCreateInfo                 dynamicState;
+    VkPipelineRenderingCreateInfo                    rendering;
+  };
+
+  bool usesMeshShader(GraphicsPipelineState const &state)
+  {
+    for(auto &stage : state.preRasterizationStages)
+    {
+      if(stage.stage == VK_SHADER_STAGE_MESH_BIT_EXT)
+        return true;
+    }
+    return false;
+  }
+
+  void fillCreateInfos(GraphicsPipelineState const &state, PipelineCreateInfos &infos)
+  {
+    infos.stages = state.preRasterizationStages;
+    if(state.fragmentStage.module != VK_NULL_HANDLE)
+      infos.stages.push_back(state.fragmentStage);
+
+    infos.vertexInput = {};
+    infos.vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    infos.vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(state.vertexBindings.size());
+    infos.vertexInput.pVertexBindingDescriptions = state.vertexBindings.data();
+    infos.vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.vertexAttributes.size());
+    infos.vertexInput.pVertexAttributeDescriptions = state.vertexAttributes.data();
+
+    infos.inputAssembly = {};
+    infos.inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    infos.inputAssembly.topology = state.topology;
+
+    infos.viewport = {};
+    infos.viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    infos.viewport.viewportCount = 1;
+    infos.viewport.scissorCount = 1;
+
+    infos.rasterization = {};
+    infos.rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    infos.rasterization.polygonMode = state.polygonMode;
+    infos.rasterization.cullMode = state.cullMode;
+    infos.rasterization.frontFace = state.frontFace;
+    infos.rasterization.lineWidth = 1.0f;
+
+    infos.multisample = {};
+    infos.multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    infos.multisample.rasterizationSamples = state.samples;
+
+    infos.depthStencil = {};
+    infos.depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    infos.depthStencil.depthTestEnable = state.depthTest;
+    infos.depthStencil.depthWriteEnable = state.depthWrite;
+    infos.depthStencil.depthCompareOp = state.depthCompareOp;
+
+    VkPipelineColorBlendAttachmentState blendAttachment = {
+      state.blendEnable,                    // VkBool32                 blendEnable
+      VK_BLEND_FACTOR_ONE,                  // VkBlendFactor            srcColorBlendFactor
+      VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,  // VkBlendFactor            dstColorBlendFactor
+      VK_BLEND_OP_ADD,                      // VkBlendOp                colorBlendOp
+      VK_BLEND_FACTOR_ONE,                  // VkBlendFactor            srcAlphaBlendFactor
+      VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,  // VkBlendFactor            dstAlphaBlendFactor
+      VK_BLEND_OP_ADD,                      // VkBlendOp                alphaBlendOp
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT   // VkColorComponentFlags colorWriteMask
+    };
+    infos.blendAttachments.assign(state.colorFormats.size(), blendAttachment);
+
+    infos.colorBlend = {};
+    infos.colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    infos.colorBlend.attachmentCount = static_cast<uint32_t>(infos.blendAttachments.size());
+    infos.colorBlend.pAttachments = infos.blendAttachments.data();
+
+    infos.dynamicStates[0] = VK_DYNAMIC_STATE_VIEWPORT;
+    infos.dynamicStates[1] = VK_DYNAMIC_STATE_SCISSOR;
+    infos.dynamicState = {};
+    infos.dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    infos.dynamicState.dynamicStateCount = 2;
+    infos.dynamicState.pDynamicStates = infos.dynamicStates;
+
+    infos.rendering = {};
+    infos.rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    infos.rendering.colorAttachmentCount = static_cast<uint32_t>(state.colorFormats.size());
+    infos.rendering.pColorAttachmentFormats = state.colorFormats.data();
+    infos.rendering.depthAttachmentFormat = state.depthFormat;
+  }
+
+  void hashCombine(uint64_t &hash, uint64_t value)
+  {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+
+  uint64_t hashKey(std::vector<uint8_t> const &key)
+  {
+    uint64_t hash = key.size();
+    for(uint8_t byte : key)
+      hashCombine(hash, byte);
+    return hash;
+  }
+
+  template<typename T>
+  void appendValue(std::vector<uint8_t> &key, T const &value)
+  {
+    uint8_t const *bytes = reinterpret_cast<uint8_t const*>(&value);
+    key.insert(key.end(), bytes, bytes + sizeof(value));
+  }
+
+  void appendBytes(std::vector<uint8_t> &key, void const *data, size_t size)
+  {
+    appendValue(key, static_cast<uint64_t>(size));
+    uint8_t const *bytes = static_cast<uint8_t const*>(data);
+    key.insert(key.end(), bytes, bytes + size);
+  }
+
+  void appendShaderStage(std::vector<uint8_t> &key, VkPipelineShaderStageCreateInfo const &stage)
+  {
+    appendValue(key, stage.flags);
+    appendValue(key, stage.stage);
+    appendValue(key, reinterpret_cast<uint64_t>(stage.module));
+    appendBytes(key, stage.pName, stage.pName != nullptr ? std::strlen(stage.pName) : 0);
+    appendValue(key, static_cast<uint32_t>(stage.pSpecializationInfo != nullptr));
+    if(stage.pSpecializationInfo != nullptr)
+    {
+      VkSpecializationInfo const &specialization = *stage.pSpecializationInfo;
+      appendValue(key, specialization.mapEntryCount);
+      for(uint32_t entry = 0; entry < specialization.mapEntryCount; ++entry)
+      {
+        appendValue(key, specialization.pMapEntries[entry].constantID);
+        appendValue(key, specialization.pMapEntries[entry].offset);
+        appendValue(key, static_cast<uint64_t>(specialization.pMapEntries[entry].size));
+      }
+      appendBytes(key, specialization.pData, specialization.dataSize);
+    }
+  }
+
+  // Canonical bytes of the state a library part depends on. Equal keys mean interchangeable
+  // libraries; the hash of the key only narrows the lookup, entries are compared by key.
+  void appendLibraryKey(uint32_t part, GraphicsPipelineState const &state, std::vector<uint8_t> &key)
+  {
+    appendValue(key, part);
+    switch(part)
+    {
+    case 0:   // vertex input
+      appendValue(key, static_cast<uint32_t>(state.vertexBindings.size()));
+      for(auto &binding : state.vertexBindings)
+      {
+        appendValue(key, binding.binding);
+        appendValue(key, binding.stride);
+        appendValue(key, binding.inputRate);
+      }
+      appendValue(key, static_cast<uint32_t>(state.vertexAttributes.size()));
+      for(auto &attribute : state.vertexAttributes)
+      {
+        appendValue(key, attribute.location);
+        appendValue(key, attribute.binding);
+        appendValue(key, attribute.format);
+        appendValue(key, attribute.offset);
+      }
+      appendValue(key, state.topology);
+      break;
+    case 1:   // pre-rasterization
+      appendValue(key, static_cast<uint32_t>(state.preRasterizationStages.size()));
+      for(auto &stage : state.preRasterizationStages)
+        appendShaderStage(key, stage);
+      appendValue(key, reinterpret_cast<uint64_t>(state.pipelineLayout));
+      appendValue(key, state.polygonMode);
+      appendValue(key, state.cullMode);
+      appendValue(key, state.frontFace);
+      appendValue(key, static_cast<uint32_t>(state.colorFormats.size()));   // view mask and attachment formats of the rendering info
+      appendValue(key, state.depthFormat);
+      break;
+    case 2:   // fragment shader
+      appendShaderStage(key, state.fragmentStage);
+      appendValue(key, reinterpret_cast<uint64_t>(state.pipelineLayout));
+      appendValue(key, static_cast<uint32_t>(state.depthTest));
+      appendValue(key, static_cast<uint32_t>(state.depthWrite));
+      appendValue(key, state.depthCompareOp);
+      appendValue(key, state.samples);
+      appendValue(key, state.depthFormat);
+      break;
+    default:  // fragment output
+      appendValue(key, static_cast<uint32_t>(state.colorFormats.size()));
+      for(auto format : state.colorFormats)
+        appendValue(key, format);
+      appendValue(key, state.depthFormat);
+      appendValue(key, static_cast<uint32_t>(state.blendEnable));
+      appendValue(key, state.samples);
+      break;
+    }
+  }
+
+  void getPipelineKey(GraphicsPipelineState const &state, std::vector<uint8_t> &key)
+  {
+    key.clear();
+    for(uint32_t part = usesMeshShader(state) ? 1 : 0; part < 4; ++part)
+      appendLibraryKey(part, state, key);
+  }
+}
+
+PipelineManager::PipelineManager()
+{
+    mLogicalDevice        = VK_NULL_HANDLE;
+    mPipelineCache        = VK_NULL_HANDLE;
+    mThreadPool           = nullptr;
+    mUsePipelineLibraries = false;
+    mFramesInFlight       = 0;
+    mFrame                = 0;
+    mStats                = {};
+    mPendingOptimizations = 0;
+}
+
+PipelineManager::~PipelineManager()
+{
+    destroy();
+}
+
+bool PipelineManager::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, VkPipelineCache pipelineCache,
+                             uint32_t framesInFlight, ThreadPool *threadPool)
+{
+    destroy();
+
+    if(!capabilities.dynamicRenderingSupported)
+    {
+        std::cerr << "Graphics pipelines require dynamic rendering." << std::endl;
+        return false;
+    }
+
+    mLogicalDevice        = logicalDevice;
+    mPipelineCache        = pipelineCache;
+    mThreadPool           = threadPool;
+    mFramesInFlight       = std::max(framesInFlight, 1u);
+    mFrame                = 0;
+    mStats                = {};
+
+    // Without fast linking a library link may cost as much as a full compile
+    mUsePipelineLibraries = capabilities.graphicsPipelineLibrarySupported && capabilities.graphicsPipelineLibraryFastLinking;
+    return true;
+}
+
+void PipelineManager::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this]() { return mPendingOptimizations == 0; });
+    }
+
+    for(auto &optimized : mOptimizedPipelines)
+        vkDestroyPipeline(mLogicalDevice, optimized.second, nullptr);
+    for(auto &retired : mRetiredPipelines)
+        vkDestroyPipeline(mLogicalDevice, retired.pipeline, nullptr);
+    for(auto &pipeline : mPipelines)
+        vkDestroyPipeline(mLogicalDevice, pipeline.pipeline, nullptr);
+    for(auto &libraries : mLibraries)
+    {
+        for(auto &library : libraries)
+            vkDestroyPipeline(mLogicalDevice, library.second.library, nullptr);
+        libraries.clear();
+    }
+
+    mOptimizedPipelines.clear();
+    mRetiredPipelines.clear();
+    mPipelines.clear();
+    mPipelineLookup.clear();
+    mLogicalDevice = VK_NULL_HANDLE;
+}
+
+bool PipelineManager::usesPipelineLibraries() const
+{
+    return mUsePipelineLibraries;
+}
+
+bool PipelineManager::precompile(GraphicsPipelineState const &state)
+{
+    PROFILE_FUNCTION();
+
+    if(!mUsePipelineLibraries)
+    {
+        uint32_t pipelineIndex;
+        return requestPipeline(state, pipelineIndex);
+    }
+
+    VkPipeline libraries[LIBRARY_PART_COUNT];
+    return createLibraries(state, libraries);
+}
+
+bool PipelineManager::requestPipeline(GraphicsPipelineState const &state, uint32_t &pipelineIndex)
+{
+    getPipelineKey(state, mKeyScratch);
+    uint64_t hash = hashKey(mKeyScratch);
+    auto range = mPipelineLookup.equal_range(hash);
+    for(auto existing = range.first; existing != range.second; ++existing)
+    {
+        if(mPipelines[existing->second].key == mKeyScratch)
+        {
+            pipelineIndex = existing->second;
+            return true;
+        }
+    }
+
+    PROFILE_ZONE("Create graphics pipeline");
+    auto start = std::chrono::steady_clock::now();
+
+    Pipeline pipeline = {};
+    pipeline.key = mKeyScratch;
+    pipeline.pipelineLayout = state.pipelineLayout;
+    if(mUsePipelineLibraries)
+    {
+        if(!createLibraries(state, pipeline.libraries))
+            return false;
+
+        // Without a thread pool there is nothing to hide the optimization behind
+        pipeline.optimized = mThreadPool == nullptr;
+        if(!linkPipeline(pipeline.libraries, pipeline.pipelineLayout, pipeline.optimized, pipeline.pipeline))
+            return false;
+        ++(pipeline.optimized ? mStats.optimizedPipelines : mStats.fastLinkedPipelines);
+    }
+    else
+    {
+        PipelineCreateInfos infos;
+        fillCreateInfos(state, infos);
+
+        VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {
+            VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,    // VkStructureType                                sType
+            &infos.rendering,                                   // const void                                   * pNext
+            0,                                                  // VkPipelineCreateFlags                          flags
+            static_cast<uint32_t>(infos.stages.size()),         // uint32_t                                       stageCount
+            infos.stages.data(),                                // const VkPipelineShaderStageCreateInfo        * pStages
+            &infos.vertexInput,                                 // const VkPipelineVertexInputStateCreateInfo   * pVertexInputState
+            &infos.inputAssembly,                               // const VkPipelineInputAssemblyStateCreateInfo * pInputAssemblyState
+            nullptr,                                            // const VkPipelineTessellationStateCreateInfo  * pTessellationState
+            &infos.viewport,                                    // const VkPipelineViewportStateCreateInfo      * pViewportState
+            &infos.rasterization,                               // const VkPipelineRasterizationStateCreateInfo * pRasterizationState
+            &infos.multisample,                                 // const VkPipelineMultisampleStateCreateInfo   * pMultisampleState
+            &infos.depthStencil,                                // const VkPipelineDepthStencilStateCreateInfo  * pDepthStencilState
+            &infos.colorBlend,                                  // const VkPipelineColorBlendStateCreateInfo    * pColorBlendState
+            &infos.dynamicState,                                // const VkPipelineDynamicStateCreateInfo       * pDynamicState
+            state.pipelineLayout,                               // VkPipelineLayout                               layout
+            VK_NULL_HANDLE,                                     // VkRenderPass                                   renderPass
+            0,                                                  // uint32_t                                       subpass
+            VK_NULL_HANDLE,                                     // VkPipeline                                     basePipelineHandle
+            -1                                                  // int32_t                                        basePipelineIndex
+        };
+
+        VkResult result = vkCreateGraphicsPipelines(mLogicalDevice, mPipelineCache, 1, &graphicsPipelineCreateInfo, nullptr,
+                                                    &pipeline.pipeline);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not create graphics pipeline." << std::endl;
+            return false;
+        }
+        pipeline.optimized = true;
+        ++mStats.monolithicPipelines;
+    }
+
+    pipelineIndex = static_cast<uint32_t>(mPipelines.size());
+    bool optimized = pipeline.optimized;
+    mPipelines.push_back(std::move(pipeline));
+    mPipelineLookup.emplace(hash, pipelineIndex);
+    if(!optimized)
+        optimizeInBackground(pipelineIndex);
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    mStats.slowestCreateMs = std::max(mStats.slowestCreateMs, milliseconds);
+    return true;
+}
+
+VkPipeline PipelineManager::getPipeline(uint32_t pipelineIndex) const
+{
+    return mPipelines[pipelineIndex].pipeline;
+}
+
+void PipelineManager::beginFrame()
+{
+    ++mFrame;
+
+    std::vector<std::pair<uint32_t, VkPipeline>> optimizedPipelines;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        optimizedPipelines.swap(mOptimizedPipelines);
+    }
+
+    // Frames recorded from now on use the optimized variant
+    for(auto &optimized : optimizedPipelines)
+    {
+        Pipeline &pipeline = mPipelines[optimized.first];
+        mRetiredPipelines.push_back({ pipeline.pipeline, mFrame });
+        pipeline.pipeline = optimized.second;
+        pipeline.optimized = true;
+        --mStats.fastLinkedPipelines;
+        ++mStats.optimizedPipelines;
+    }
+
+    auto retired = mRetiredPipelines.begin();
+    while(retired != mRetiredPipelines.end())
+    {
+        if(retired->frame + mFramesInFlight <= mFrame)
+        {
+            vkDestroyPipeline(mLogicalDevice, retired->pipeline, nullptr);
+            retired = mRetiredPipelines.erase(retired);
+        }
+        else
+        {
+            ++retired;
+        }
+    }
+}
+
+PipelineManagerStats PipelineManager::getStats() const
+{
+    PipelineManagerStats stats = mStats;
+    stats.libraries = 0;
+    for(auto &libraries : mLibraries)
+        stats.libraries += static_cast<uint32_t>(libraries.size());
+    return stats;
+}
+
+bool PipelineManager::getLibrary(LibraryPart part, GraphicsPipelineState const &state, VkPipeline &library)
+{
+    // Libraries are created while a pipeline key may still be in mKeyScratch
+    std::vector<uint8_t> key;
+    appendLibraryKey(part, state, key);
+    uint64_t hash = hashKey(key);
+    auto range = mLibraries[part].equal_range(hash);
+    for(auto existing = range.first; existing != range.second; ++existing)
+    {
+        if(existing->second.key == key)
+        {
+            library = existing->second.library;
+            return true;
+        }
+    }
+
+    PipelineCreateInfos infos;
+    fillCreateInfos(state, infos);
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryCreateInfo = {
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,  // VkStructureType                      sType
+        &infos.rendering,                                             // void                               * pNext
+        LIBRARY_FLAGS[part]                                           // VkGraphicsPipelineLibraryFlagsEXT    flags
+    };
+
+    // Every library only receives the state that belongs to its part
+    bool vertexInput = part == LIBRARY_VERTEX_INPUT;
+    bool preRasterization = part == LIBRARY_PRE_RASTERIZATION;
+    bool fragmentShader = part == LIBRARY_FRAGMENT_SHADER;
+    bool fragmentOutput = part == LIBRARY_FRAGMENT_OUTPUT;
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    if(preRasterization)
+        stages = state.preRasterizationStages;
+    if(fragmentShader && state.fragmentStage.module != VK_NULL_HANDLE)
+        stages.push_back(state.fragmentStage);
+
+    VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,                  // VkStructureType                                sType
+        &libraryCreateInfo,                                               // const void                                   * pNext
+        VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+        VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT,    // VkPipelineCreateFlags                          flags
+        static_cast<uint32_t>(stages.size()),                             // uint32_t                                       stageCount
+        stages.data(),                                                    // const VkPipelineShaderStageCreateInfo        * pStages
+        vertexInput ? &infos.vertexInput : nullptr,                       // const VkPipelineVertexInputStateCreateInfo   * pVertexInputState
+        vertexInput ? &infos.inputAssembly : nullptr,                     // const VkPipelineInputAssemblyStateCreateInfo * pInputAssemblyState
+        nullptr,                                                          // const VkPipelineTessellationStateCreateInfo  * pTessellationState
+        preRasterization ? &infos.viewport : nullptr,                     // const VkPipelineViewportStateCreateInfo      * pViewportState
+        preRasterization ? &infos.rasterization : nullptr,                // const VkPipelineRasterizationStateCreateInfo * pRasterizationState
+        fragmentShader || fragmentOutput ? &infos.multisample : nullptr,  // const VkPipelineMultisampleStateCreateInfo   * pMultisampleState
+        fragmentShader ? &infos.depthStencil : nullptr,                   // const VkPipelineDepthStencilStateCreateInfo  * pDepthStencilState
+        fragmentOutput ? &infos.colorBlend : nullptr,                     // const VkPipelineColorBlendStateCreateInfo    * pColorBlendState
+        preRasterization ? &infos.dynamicState : nullptr,                 // const VkPipelineDynamicStateCreateInfo       * pDynamicState
+        preRasterization || fragmentShader ? state.pipelineLayout : VK_NULL_HANDLE, // VkPipelineLayout                   layout
+        VK_NULL_HANDLE,                                                   // VkRenderPass                                   renderPass
+        0,                                                                // uint32_t                                       subpass
+        VK_NULL_HANDLE,                                                   // VkPipeline                                     basePipelineHandle
+        -1                                                                // int32_t                                        basePipelineIndex
+    };
+
+    VkResult result = vkCreateGraphicsPipelines(mLogicalDevice, mPipelineCache, 1, &graphicsPipelineCreateInfo, nullptr, &library);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create graphics pipeline library." << std::endl;
+        return false;
+    }
+    mLibraries[part].emplace(hash, Library{ std::move(key), library });
+    return true;
+}
+
+bool PipelineManager::createLibraries(GraphicsPipelineState const &state, VkPipeline (&libraries)[LIBRARY_PART_COUNT])
+{
+    // Mesh shading pipelines have no vertex input interface
+    libraries[LIBRARY_VERTEX_INPUT] = VK_NULL_HANDLE;
+    if(!usesMeshShader(state) && !getLibrary(LIBRARY_VERTEX_INPUT, state, libraries[LIBRARY_VERTEX_INPUT]))
+        return false;
+
+    return getLibrary(LIBRARY_PRE_RASTERIZATION, state, libraries[LIBRARY_PRE_RASTERIZATION]) &&
+           getLibrary(LIBRARY_FRAGMENT_SHADER, state, libraries[LIBRARY_FRAGMENT_SHADER]) &&
+           getLibrary(LIBRARY_FRAGMENT_OUTPUT, state, libraries[LIBRARY_FRAGMENT_OUTPUT]);
+}
+
+// Only reads immutable members, runs on the thread pool as well
+bool PipelineManager::linkPipeline(VkPipeline const (&libraries)[LIBRARY_PART_COUNT], VkPipelineLayout pipelineLayout,
+                                   bool optimize, VkPipeline &pipeline)
+{
+    std::vector<VkPipeline> linkedLibraries;
+    for(auto library : libraries)
+    {
+        if(library != VK_NULL_HANDLE)
+            linkedLibraries.push_back(library);
+    }
+
+    VkPipelineLibraryCreateInfoKHR libraryCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,   // VkStructureType      sType
+        nullptr,                                              // const void         * pNext
+        static_cast<uint32_t>(linkedLibraries.size()),        // uint32_t             libraryCount
+        linkedLibraries.data()                                // const VkPipeline   * pLibraries
+    };
+
+    VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+    graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    graphicsPipelineCreateInfo.pNext = &libraryCreateInfo;
+    graphicsPipelineCreateInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    graphicsPipelineCreateInfo.layout = pipelineLayout;
+    graphicsPipelineCreateInfo.basePipelineIndex = -1;
+
+    VkResult result = vkCreateGraphicsPipelines(mLogicalDevice, mPipelineCache, 1, &graphicsPipelineCreateInfo, nullptr, &pipeline);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not link graphics pipeline." << std::endl;
+        pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+void PipelineManager::optimizeInBackground(uint32_t pipelineIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mPendingOptimizations;
+    }
+
+    Pipeline const &pipeline = mPipelines[pipelineIndex];
+    VkPipelineLayout pipelineLayout = pipeline.pipelineLayout;
+    VkPipeline libraries[LIBRARY_PART_COUNT];
+    std::copy(std::begin(pipeline.libraries), std::end(pipeline.libraries), libraries);
+
+    mThreadPool->submit([this, pipelineIndex, pipelineLayout, libraries]()
+    {
+        PROFILE_ZONE("Optimize graphics pipeline");
+
+        // A failed optimization keeps the fast-linked pipeline
+        VkPipeline optimized;
+        bool linked = linkPipeline(libraries, pipelineLayout, true, optimized);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(linked)
+            mOptimizedPipelines.emplace_back(pipelineIndex, optimized);
+        --mPendingOptimizations;
+        mCondition.notify_all();
+    });
+}
+
+} // namespace VulkanSample
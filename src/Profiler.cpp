@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Profiler.h"
+
+#ifdef VULKANSAMPLE_PROFILING
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace VulkanSample
+{
+
+#ifdef VULKANSAMPLE_PROFILING
+
+namespace
+{
+  const uint32_t PROFILE_MAGIC     = 0x46505356; // "VSPF"
+  const uint32_t PROFILE_VERSION   = 1;
+  const uint32_t ZONES_PER_CHUNK   = 4096;
+
+  struct ZoneRecord
+  {
+    char const *name;
+    uint64_t    begin;
+    uint64_t    end;
+  };
+
+  // Written by the owning thread only, count and next are published with release stores
+  struct ZoneChunk
+  {
+    ZoneRecord               zones[ZONES_PER_CHUNK];
+    std::atomic<uint32_t>    count;
+    std::atomic<ZoneChunk *> next;
+
+    ZoneChunk() : count(0), next(nullptr)
+    {
+    }
+  };
+
+  struct ThreadProfile
+  {
+    uint32_t    threadIndex;
+    std::string name;        // guarded by the registry mutex
+    ZoneChunk  *first;
+    ZoneChunk  *current;     // owning thread only
+
+    ~ThreadProfile()
+    {
+      while(first != nullptr)
+      {
+        ZoneChunk *next = first->next.load();
+        delete first;
+        first = next;
+      }
+    }
+  };
+
+  // Thread profiles outlive their threads, so zones of finished threads can still be exported
+  struct ProfileRegistry
+  {
+    std::mutex                                  mutex;
+    std::vector<std::unique_ptr<ThreadProfile>> threads;
+    uint64_t                                    startTimestamp;
+    std::chrono::steady_clock::time_point       startTime;
+
+    ProfileRegistry()
+    {
+      startTimestamp = readProfileTimestamp();
+      startTime = std::chrono::steady_clock::now();
+    }
+  };
+
+  ProfileRegistry &getRegistry()
+  {
+    static ProfileRegistry registry;
+    return registry;
+  }
+
+  thread_local ThreadProfile *currentThreadProfile = nullptr;
+
+  ThreadProfile &getThreadProfile()
+  {
+    if(currentThreadProfile == nullptr)
+    {
+      ProfileRegistry &registry = getRegistry();
+      std::unique_ptr<ThreadProfile> profile(new ThreadProfile());
+      profile->first = new ZoneChunk();
+      profile->current = profile->first;
+
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      profile->threadIndex = static_cast<uint32_t>(registry.threads.size());
+      profile->name = "Thread " + std::to_string(profile->threadIndex);
+      currentThreadProfile = profile.get();
+      registry.threads.push_back(std::move(profile));
+    }
+    return *currentThreadProfile;
+  }
+
+  struct ExportedThread
+  {
+    uint32_t                threadIndex;
+    std::string             name;
+    std::vector<ZoneRecord> zones;
+  };
+
+  // Copies everything published so far and measures the tick rate against steady_clock
+  void collectZones(std::vector<ExportedThread> &threads, uint64_t &origin, uint64_t &ticksPerSecond)
+  {
+    ProfileRegistry &registry = getRegistry();
+
+#ifdef VULKANSAMPLE_PROFILING_RDTSC
+    auto elapsed = std::chrono::steady_clock::now() - registry.startTime;
+    if(elapsed < std::chrono::milliseconds(10))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+    }
+    uint64_t ticks = readProfileTimestamp() - registry.startTimestamp;
+    elapsed = std::chrono::steady_clock::now() - registry.startTime;
+    uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    ticksPerSecond = static_cast<uint64_t>(static_cast<double>(ticks) * 1e9 / static_cast<double>(nanoseconds));
+#else
+    ticksPerSecond = 1000000000ull;
+#endif
+
+    origin = UINT64_MAX;
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for(auto &profile : registry.threads)
+    {
+      ExportedThread thread;
+      thread.threadIndex = profile->threadIndex;
+      thread.name = profile->name;
+      for(ZoneChunk *chunk = profile->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire))
+      {
+        uint32_t count = chunk->count.load(std::memory_order_acquire);
+        thread.zones.insert(thread.zones.end(), chunk->zones, chunk->zones + count);
+      }
+      for(auto &zone : thread.zones)
+        origin = std::min(origin, zone.begin);
+      threads.push_back(std::move(thread));
+    }
+    if(origin == UINT64_MAX)
+      origin = 0;
+  }
+
+  void writeJsonString(std::ofstream &file, std::string const &text)
+  {
+    file << '"';
+    for(char character : text)
+    {
+      if(character == '"' || character == '\\')
+        file << '\\' << character;
+      else if(static_cast<unsigned char>(character) >= 0x20)
+        file << character;
+    }
+    file << '"';
+  }
+
+  template<typename Type>
+  void writeBinary(std::ofstream &file, Type value)
+  {
+    file.write(reinterpret_cast<char const *>(&value), sizeof(value));
+  }
+
+  void writeBinaryString(std::ofstream &file, std::string const &text)
+  {
+    uint16_t length = static_cast<uint16_t>(std::min<size_t>(text.size(), UINT16_MAX));
+    writeBinary(file, length);
+    file.write(text.data(), length);
+  }
+}
+
+void recordProfileZone(char const *name, uint64_t begin, uint64_t end)
+{
+  ThreadProfile &profile = getThreadProfile();
+  ZoneChunk *chunk = profile.current;
+  uint32_t count = chunk->count.load(std::memory_order_relaxed);
+  if(count == ZONES_PER_CHUNK)
+  {
+    ZoneChunk *next = new ZoneChunk();
+    chunk->next.store(next, std::memory_order_release);
+    profile.current = next;
+    chunk = next;
+    count = 0;
+  }
+
+  chunk->zones[count] = { name, begin, end };
+  chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void setProfileThreadName(char const *name)
+{
+  ThreadProfile &profile = getThreadProfile();
+  std::lock_guard<std::mutex> lock(getRegistry().mutex);
+  profile.name = name;
+}
+
+bool exportProfileChromeTrace(std::string const &filename)
+{
+  std::vector<ExportedThread> threads;
+  uint64_t origin, ticksPerSecond;
+  collectZones(threads, origin, ticksPerSecond);
+  double microsecondsPerTick = 1e6 / static_cast<double>(ticksPerSecond);
+
+  std::ofstream file(filename, std::ios::trunc);
+  if(file.fail())
+  {
+    std::cerr << "Could not create '" << filename << "' file." << std::endl;
+    return false;
+  }
+
+  file << std::fixed;
+  file.precision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for(auto &thread : threads)
+  {
+    file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.threadIndex
+         << ",\"args\":{\"name\":";
+    writeJsonString(file, thread.name);
+    file << "}}";
+    first = false;
+
+    for(auto &zone : thread.zones)
+    {
+      file << ",\n{\"name\":";
+      writeJsonString(file, zone.name);
+      file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.threadIndex
+           << ",\"ts\":" << static_cast<double>(zone.begin - origin) * microsecondsPerTick
+           << ",\"dur\":" << static_cast<double>(zone.end - zone.begin) * microsecondsPerTick << "}";
+    }
+  }
+  file << "\n]}\n";
+
+  if(file.fail())
+  {
+    std::cerr << "Could not write '" << filename << "' file." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool exportProfileBinary(std::string const &filename)
+{
+  std::vector<ExportedThread> threads;
+  uint64_t origin, ticksPerSecond;
+  collectZones(threads, origin, ticksPerSecond);
+
+  // Zone names are deduplicated by content, the same literal may live at several addresses
+  std::vector<std::string> names;
+  std::unordered_map<std::string, uint32_t> nameIndices;
+  std::unordered_map<char const *, uint32_t> pointerIndices;
+  for(auto &thread : threads)
+  {
+    for(auto &zone : thread.zones)
+    {
+      if(pointerIndices.count(zone.name) != 0)
+        continue;
+      auto inserted = nameIndices.emplace(zone.name, static_cast<uint32_t>(names.size()));
+      if(inserted.second)
+        names.push_back(zone.name);
+      pointerIndices[zone.name] = inserted.first->second;
+    }
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if(file.fail())
+  {
+    std::cerr << "Could not create '" << filename << "' file." << std::endl;
+    return false;
+  }
+
+  writeBinary(file, PROFILE_MAGIC);
+  writeBinary(file, PROFILE_VERSION);
+  writeBinary(file, ticksPerSecond);
+  writeBinary(file, static_cast<uint32_t>(names.size()));
+  writeBinary(file, static_cast<uint32_t>(threads.size()));
+  for(auto &name : names)
+    writeBinaryString(file, name);
+
+  for(auto &thread : threads)
+  {
+    writeBinary(file, thread.threadIndex);
+    writeBinaryString(file, thread.name);
+    writeBinary(file, static_cast<uint32_t>(thread.zones.size()));
+    for(auto &zone : thread.zones)
+    {
+      writeBinary(file, pointerIndices[zone.name]);
+      writeBinary(file, zone.begin - origin);
+      writeBinary(file, zone.end - zone.begin);
+    }
+  }
+
+  if(file.fail())
+  {
+    std::cerr << "Could not write '" << filename << "' file." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+#else
+
+void setProfileThreadName(char const *)
+{
+}
+
+bool exportProfileChromeTrace(std::string const &)
+{
+  std::cerr << "Profiling is disabled in this build." << std::endl;
+  return false;
+}
+
+bool exportProfileBinary(std::string const &)
+{
+  std::cerr << "Profiling is disabled in this build." << std::endl;
+  return false;
+}
+
+#endif
+
+} // namespace VulkanSample
@@ -0,0 +1,266 @@
+#include "Profiler.h"
+#include "QueueSubmitter.h"
+
+namespace VulkanSample
+{
+
+QueueSubmitter::QueueSubmitter()
+{
+    mQueue          = VK_NULL_HANDLE;
+    mSleeping       = false;
+    mStopping       = false;
+    mEnqueuedCount  = 0;
+    mIssuedCount    = 0;
+    mPresentResult  = VK_SUCCESS;
+    mFailed         = false;
+    mSubmissions    = 0;
+    mSubmitCalls    = 0;
+    mSubmitInfos    = 0;
+    mCommandBuffers = 0;
+    mPresents       = 0;
+}
+
+QueueSubmitter::~QueueSubmitter()
+{
+    destroy();
+}
+
+bool QueueSubmitter::create(VkQueue queue)
+{
+    destroy();
+
+    if(queue == VK_NULL_HANDLE)
+    {
+        std::cerr << "Queue submitter requires a valid queue." << std::endl;
+        return false;
+    }
+
+    mQueue    = queue;
+    mStopping = false;
+    mFailed   = false;
+    mThread   = std::thread(&QueueSubmitter::threadLoop, this);
+    return true;
+}
+
+void QueueSubmitter::destroy()
+{
+    if(!mThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeUp.notify_all();
+    mThread.join();
+    mQueue = VK_NULL_HANDLE;
+}
+
+VkQueue QueueSubmitter::getQueue() const
+{
+    return mQueue;
+}
+
+void QueueSubmitter::submit(QueueSubmission submission)
+{
+    Work work = {};
+    work.isPresent  = false;
+    work.submission = std::move(submission);
+    enqueue(std::move(work));
+}
+
+void QueueSubmitter::present(QueuePresentation presentation)
+{
+    Work work = {};
+    work.isPresent    = true;
+    work.presentation = std::move(presentation);
+    enqueue(std::move(work));
+}
+
+void QueueSubmitter::enqueue(Work work)
+{
+    mEnqueuedCount.fetch_add(1);
+    mWork.push(std::move(work));
+
+    // The submission thread publishes mSleeping before its final emptiness check, so either
+    // it sees this work or we see it sleeping and wake it up
+    if(mSleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWakeUp.notify_one();
+    }
+}
+
+void QueueSubmitter::flush()
+{
+    uint64_t target = mEnqueuedCount.load();
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIssued.wait(lock, [this, target]() { return mIssuedCount.load() >= target; });
+}
+
+VkResult QueueSubmitter::takePresentResult()
+{
+    return mPresentResult.exchange(VK_SUCCESS);
+}
+
+bool QueueSubmitter::hasFailed() const
+{
+    return mFailed.load();
+}
+
+QueueSubmitterStats QueueSubmitter::getStats() const
+{
+    QueueSubmitterStats stats;
+    stats.submissions        = mSubmissions.load();
+    stats.submitCalls        = mSubmitCalls.load();
+    stats.submitInfos        = mSubmitInfos.load();
+    stats.commandBuffers     = mCommandBuffers.load();
+    stats.presents           = mPresents.load();
+    stats.submissionsPerCall = stats.submitCalls > 0 ? static_cast<double>(stats.submissions) / stats.submitCalls : 0.0;
+    return stats;
+}
+
+void QueueSubmitter::threadLoop()
+{
+    PROFILE_THREAD_NAME("Queue submitter");
+
+    std::vector<Work> pending;
+    for(;;)
+    {
+        Work work;
+        while(mWork.pop(work))
+            pending.push_back(std::move(work));
+
+        if(!pending.empty())
+        {
+            issue(pending);
+            mIssuedCount.fetch_add(pending.size());
+            pending.clear();
+
+            // Taking the lock orders the counter update with waiters checking it in flush()
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+            }
+            mIssued.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        if(mStopping.load())
+            break;
+        mSleeping = true;
+        mWakeUp.wait(lock, [this]() { return !mWork.empty() || mStopping.load(); });
+        mSleeping = false;
+    }
+}
+
+// Presents and fences split the pending work into separate vkQueueSubmit2 calls, everything else goes into one
+void QueueSubmitter::issue(std::vector<Work> &pending)
+{
+    PROFILE_FUNCTION();
+
+    size_t begin = 0;
+    for(size_t index = 0; index < pending.size(); ++index)
+    {
+        Work &work = pending[index];
+        if(work.isPresent)
+        {
+            issueSubmissions(pending, begin, index, VK_NULL_HANDLE);
+            begin = index + 1;
+
+            QueuePresentation &presentation = work.presentation;
+            VkPresentInfoKHR presentInfo = {
+                VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,                       // VkStructureType          sType
+                nullptr,                                                  // const void*              pNext
+                static_cast<uint32_t>(presentation.waitSemaphores.size()), // uint32_t                 waitSemaphoreCount
+                presentation.waitSemaphores.data(),                       // const VkSemaphore      * pWaitSemaphores
+                1,                                                        // uint32_t                 swapchainCount
+                &presentation.swapchain,                                  // const VkSwapchainKHR   * pSwapchains
+                &presentation.imageIndex,                                 // const uint32_t         * pImageIndices
+                nullptr                                                   // VkResult*                pResults
+            };
+
+            VkResult result = vkQueuePresentKHR(mQueue, &presentInfo);
+            if(result != VK_SUCCESS)
+                mPresentResult = result;
+            ++mPresents;
+        }
+        else if(work.submission.fence != VK_NULL_HANDLE)
+        {
+            issueSubmissions(pending, begin, index + 1, work.submission.fence);
+            begin = index + 1;
+        }
+    }
+    issueSubmissions(pending, begin, pending.size(), VK_NULL_HANDLE);
+}
+
+void QueueSubmitter::issueSubmissions(std::vector<Work> &pending, size_t begin, size_t end, VkFence fence)
+{
+    if(begin == end)
+        return;
+
+    // Reserve up front so pointers into the scratch arrays stay valid while they grow
+    size_t waitCount = 0, commandBufferCount = 0, signalCount = 0;
+    for(size_t index = begin; index < end; ++index)
+    {
+        waitCount          += pending[index].submission.waitSemaphores.size();
+        commandBufferCount += pending[index].submission.commandBuffers.size();
+        signalCount        += pending[index].submission.signalSemaphores.size();
+    }
+    mWaitScratch.clear();
+    mCommandBufferScratch.clear();
+    mSignalScratch.clear();
+    mSubmitScratch.clear();
+    mWaitScratch.reserve(waitCount);
+    mCommandBufferScratch.reserve(commandBufferCount);
+    mSignalScratch.reserve(signalCount);
+
+    for(size_t index = begin; index < end; ++index)
+    {
+        QueueSubmission const &submission = pending[index].submission;
+        VkSemaphoreSubmitInfo const *waits = mWaitScratch.data() + mWaitScratch.size();
+        VkCommandBufferSubmitInfo const *commandBuffers = mCommandBufferScratch.data() + mCommandBufferScratch.size();
+        VkSemaphoreSubmitInfo const *signals = mSignalScratch.data() + mSignalScratch.size();
+        mWaitScratch.insert(mWaitScratch.end(), submission.waitSemaphores.begin(), submission.waitSemaphores.end());
+        mCommandBufferScratch.insert(mCommandBufferScratch.end(), submission.commandBuffers.begin(), submission.commandBuffers.end());
+        mSignalScratch.insert(mSignalScratch.end(), submission.signalSemaphores.begin(), submission.signalSemaphores.end());
+
+        // Merging keeps the semantics: nothing waits for the first one's (absent) signals
+        // and the second one's command buffers had nothing to wait for
+        if(!mSubmitScratch.empty() && mSubmitScratch.back().signalSemaphoreInfoCount == 0 && submission.waitSemaphores.empty())
+        {
+            VkSubmitInfo2 &previous = mSubmitScratch.back();
+            previous.commandBufferInfoCount  += static_cast<uint32_t>(submission.commandBuffers.size());
+            previous.signalSemaphoreInfoCount = static_cast<uint32_t>(submission.signalSemaphores.size());
+            previous.pSignalSemaphoreInfos    = signals;
+            continue;
+        }
+
+        VkSubmitInfo2 submitInfo = {
+            VK_STRUCTURE_TYPE_SUBMIT_INFO_2,                              // VkStructureType                    sType
+            nullptr,                                                      // const void                       * pNext
+            0,                                                            // VkSubmitFlags                      flags
+            static_cast<uint32_t>(submission.waitSemaphores.size()),      // uint32_t                           waitSemaphoreInfoCount
+            waits,                                                        // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+            static_cast<uint32_t>(submission.commandBuffers.size()),      // uint32_t                           commandBufferInfoCount
+            commandBuffers,                                               // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+            static_cast<uint32_t>(submission.signalSemaphores.size()),    // uint32_t                           signalSemaphoreInfoCount
+            signals                                                       // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+        };
+        mSubmitScratch.push_back(submitInfo);
+    }
+
+    VkResult result = vkQueueSubmit2(mQueue, static_cast<uint32_t>(mSubmitScratch.size()), mSubmitScratch.data(), fence);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not submit command buffers to a queue." << std::endl;
+        mFailed = true;
+    }
+
+    mSubmissions    += end - begin;
+    mSubmitInfos    += mSubmitScratch.size();
+    mCommandBuffers += commandBufferCount;
+    ++mSubmitCalls;
+}
+
+} // namespace VulkanSample
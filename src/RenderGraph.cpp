@@ -0,0 +1,1442 @@
+#include <algorithm>
+
+#include "Profiler.h"
+#include "RenderGraph.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t GRAPH_QUEUE_COUNT = static_cast<uint32_t>(RenderGraphQueue::Count);
+  const uint32_t UNUSED_POSITION   = 0xFFFFFFFF;
+
+  const VkMemoryPropertyFlags LAZY_MEMORY_PROPERTIES = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+  VkMemoryPropertyFlags getTransientMemoryProperties(bool lazy)
+  {
+    return lazy ? LAZY_MEMORY_PROPERTIES : static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+  const uint64_t FNV_OFFSET_BASIS  = 14695981039346656037ull;
+  const uint64_t FNV_PRIME         = 1099511628211ull;
+
+  void hashValue(uint64_t &hash, uint64_t value)
+  {
+    for(uint32_t byte = 0; byte < 8; ++byte)
+    {
+      hash ^= (value >> (byte * 8)) & 0xFF;
+      hash *= FNV_PRIME;
+    }
+  }
+
+  // Synchronization state of one resource while barriers are planned, positions index planned passes
+  struct HazardState
+  {
+    bool                  touched;
+    VkImageLayout         layout;
+    int32_t               lastPass;
+    int32_t               writerPass;
+    uint32_t              writerQueue;
+    VkPipelineStageFlags2 writerStages;
+    VkAccessFlags2        writerAccess;
+    int32_t               readerPasses[GRAPH_QUEUE_COUNT];    // latest reader since the last write
+    VkPipelineStageFlags2 readerStages[GRAPH_QUEUE_COUNT];
+    VkPipelineStageFlags2 visibleStages[GRAPH_QUEUE_COUNT];   // reads already synchronized with the last write
+    VkAccessFlags2        visibleAccess[GRAPH_QUEUE_COUNT];
+  };
+
+  void clearReaders(HazardState &state)
+  {
+    for(uint32_t queue = 0; queue < GRAPH_QUEUE_COUNT; ++queue)
+    {
+      state.readerPasses[queue]  = -1;
+      state.readerStages[queue]  = 0;
+      state.visibleStages[queue] = 0;
+      state.visibleAccess[queue] = 0;
+    }
+  }
+
+  HazardState getInitialHazardState()
+  {
+    HazardState state = {};
+    state.layout       = VK_IMAGE_LAYOUT_UNDEFINED;
+    state.lastPass     = -1;
+    state.writerPass   = -1;
+    clearReaders(state);
+    return state;
+  }
+
+  template<typename Type>
+  void pushUnique(std::vector<Type> &vec, Type value)
+  {
+    if(std::find(vec.begin(), vec.end(), value) == vec.end())
+      vec.push_back(value);
+  }
+
+  VkSemaphoreSubmitInfo getSemaphoreSubmitInfo(VkSemaphore semaphore, uint64_t value)
+  {
+    VkSemaphoreSubmitInfo submitInfo = {
+      VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,        // VkStructureType          sType
+      nullptr,                                        // const void             * pNext
+      semaphore,                                      // VkSemaphore              semaphore
+      value,                                          // uint64_t                 value
+      VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,           // VkPipelineStageFlags2    stageMask
+      0                                               // uint32_t                 deviceIndex
+    };
+    return submitInfo;
+  }
+
+  // Waits on one timeline semaphore collapse into a wait on the highest value
+  void addTimelineWait(std::vector<VkSemaphoreSubmitInfo> &waits, VkSemaphore semaphore, uint64_t value)
+  {
+    for(auto &wait : waits)
+    {
+      if(wait.semaphore == semaphore)
+      {
+        wait.value = std::max(wait.value, value);
+        return;
+      }
+    }
+    waits.push_back(getSemaphoreSubmitInfo(semaphore, value));
+  }
+}
+
+RenderGraph::RenderGraph()
+{
+    mLogicalDevice    = VK_NULL_HANDLE;
+    mCapabilities     = {};
+    mSharedQueue      = false;
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+    {
+        mQueues[queue]             = { VK_NULL_HANDLE, 0 };
+        mSubmitters[queue]         = nullptr;
+        mTimelineSemaphores[queue] = VK_NULL_HANDLE;
+        mTimelineValues[queue]     = 0;
+    }
+    mDeclarationError = false;
+    mCompiled         = false;
+    mTopologyHash     = 0;
+    mStats            = {};
+}
+
+RenderGraph::~RenderGraph()
+{
+    destroy();
+}
+
+bool RenderGraph::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, QueueParameters const &graphicsQueue,
+                         QueueParameters const &computeQueue, uint32_t framesInFlight)
+{
+    destroy();
+
+    if(!capabilities.timelineSynchronizationSupported)
+    {
+        std::cerr << "Render graph requires timeline semaphores and synchronization2 support." << std::endl;
+        return false;
+    }
+    if(framesInFlight == 0)
+    {
+        std::cerr << "Render graph requires at least one frame in flight." << std::endl;
+        return false;
+    }
+
+    mLogicalDevice = logicalDevice;
+    mCapabilities  = capabilities;
+    mQueues[static_cast<uint32_t>(RenderGraphQueue::Graphics)] = graphicsQueue;
+    mQueues[static_cast<uint32_t>(RenderGraphQueue::Compute)]  = computeQueue;
+    // Without a separate compute queue, compute passes are scheduled on the graphics queue
+    mSharedQueue   = graphicsQueue.handle == computeQueue.handle;
+
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+    {
+        VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {
+            VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO, // VkStructureType    sType
+            nullptr,                                      // const void       * pNext
+            VK_SEMAPHORE_TYPE_TIMELINE,                   // VkSemaphoreType    semaphoreType
+            0                                             // uint64_t           initialValue
+        };
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo = {
+            VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,      // VkStructureType          sType
+            &semaphoreTypeCreateInfo,                     // const void             * pNext
+            0                                             // VkSemaphoreCreateFlags   flags
+        };
+
+        VkResult result = vkCreateSemaphore(mLogicalDevice, &semaphoreCreateInfo, nullptr, &mTimelineSemaphores[queue]);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not create a timeline semaphore." << std::endl;
+            destroy();
+            return false;
+        }
+    }
+
+    mFrames.resize(framesInFlight);
+    for(auto &frame : mFrames)
+    {
+        for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+        {
+            frame.commandPools[queue]     = VK_NULL_HANDLE;
+            frame.completionValues[queue] = 0;
+        }
+        frame.currentPlan = false;
+    }
+
+    for(auto &frame : mFrames)
+    {
+        for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+        {
+            VkCommandPoolCreateInfo commandPoolCreateInfo = {
+                VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, // VkStructureType            sType
+                nullptr,                                    // const void               * pNext
+                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,       // VkCommandPoolCreateFlags   flags
+                mQueues[queue].familyIndex                  // uint32_t                   queueFamilyIndex
+            };
+
+            VkResult result = vkCreateCommandPool(mLogicalDevice, &commandPoolCreateInfo, nullptr, &frame.commandPools[queue]);
+            if(result != VK_SUCCESS)
+            {
+                std::cerr << "Could not create a command pool for the render graph." << std::endl;
+                destroy();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void RenderGraph::destroy()
+{
+    if(mLogicalDevice != VK_NULL_HANDLE)
+    {
+        waitIdle();
+        destroyTransientObjects();
+
+        for(auto &frame : mFrames)
+        {
+            for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+            {
+                if(frame.commandPools[queue] != VK_NULL_HANDLE)
+                    vkDestroyCommandPool(mLogicalDevice, frame.commandPools[queue], nullptr);
+            }
+        }
+
+        for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+        {
+            if(mTimelineSemaphores[queue] != VK_NULL_HANDLE)
+                vkDestroySemaphore(mLogicalDevice, mTimelineSemaphores[queue], nullptr);
+            mTimelineSemaphores[queue] = VK_NULL_HANDLE;
+            mTimelineValues[queue]     = 0;
+        }
+    }
+
+    mFrames.clear();
+    mPasses.clear();
+    mResources.clear();
+    mPassAlive.clear();
+    mPlannedPasses.clear();
+    mBatches.clear();
+    mCompiled      = false;
+    mLogicalDevice = VK_NULL_HANDLE;
+}
+
+void RenderGraph::setQueueSubmitters(QueueSubmitter *graphicsSubmitter, QueueSubmitter *computeSubmitter)
+{
+    mSubmitters[static_cast<uint32_t>(RenderGraphQueue::Graphics)] = graphicsSubmitter;
+    mSubmitters[static_cast<uint32_t>(RenderGraphQueue::Compute)]  = computeSubmitter;
+}
+
+void RenderGraph::reset()
+{
+    mPasses.clear();
+    mResources.clear();
+    mDeclarationError = false;
+}
+
+RenderGraphResource RenderGraph::createTransientImage(char const *name, RenderGraphImageDesc const &desc)
+{
+    Resource resource = {};
+    resource.name          = name;
+    resource.isImage       = true;
+    resource.imageDesc     = desc;
+    resource.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.finalLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createTransientBuffer(char const *name, RenderGraphBufferDesc const &desc)
+{
+    Resource resource = {};
+    resource.name          = name;
+    resource.bufferDesc    = desc;
+    resource.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.finalLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createTransientAttachment(char const *name, RenderGraphImageDesc const &desc)
+{
+    VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                        VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    if((desc.usage & ~attachmentUsage) != 0)
+    {
+        std::cerr << "Transient attachment '" << name << "' may only be used as an attachment." << std::endl;
+        mDeclarationError = true;
+    }
+
+    RenderGraphResource resource = createTransientImage(name, desc);
+    mResources[resource].transientAttachment = true;
+    return resource;
+}
+
+RenderGraphResource RenderGraph::importImage(char const *name, VkImage image, VkImageView view, RenderGraphImageDesc const &desc,
+                                             VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+    Resource resource = {};
+    resource.name          = name;
+    resource.isImage       = true;
+    resource.imported      = true;
+    resource.imageDesc     = desc;
+    resource.initialLayout = initialLayout;
+    resource.finalLayout   = finalLayout;
+    resource.image         = image;
+    resource.view          = view;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(char const *name, VkBuffer buffer, VkDeviceSize size)
+{
+    Resource resource = {};
+    resource.name            = name;
+    resource.imported        = true;
+    resource.bufferDesc.size = size;
+    resource.initialLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.finalLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.buffer          = buffer;
+    mResources.push_back(resource);
+    return static_cast<RenderGraphResource>(mResources.size() - 1);
+}
+
+void RenderGraph::markOutput(RenderGraphResource resource)
+{
+    if(resource >= mResources.size())
+    {
+        std::cerr << "Render graph output is not a declared resource." << std::endl;
+        mDeclarationError = true;
+        return;
+    }
+    mResources[resource].output = true;
+}
+
+uint32_t RenderGraph::addPass(char const *name, RenderGraphQueue queue, RenderGraphPassFunction const &function)
+{
+    Pass pass;
+    pass.name        = name;
+    pass.queue       = queue;
+    pass.function    = function;
+    pass.sideEffects = false;
+    mPasses.push_back(pass);
+    return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void RenderGraph::readResource(uint32_t pass, RenderGraphResource resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                               VkImageLayout layout)
+{
+    addAccess(pass, resource, stages, access, layout, false);
+}
+
+void RenderGraph::writeResource(uint32_t pass, RenderGraphResource resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                                VkImageLayout layout)
+{
+    addAccess(pass, resource, stages, access, layout, true);
+}
+
+void RenderGraph::setSideEffects(uint32_t pass)
+{
+    if(pass < mPasses.size())
+        mPasses[pass].sideEffects = true;
+}
+
+void RenderGraph::addAccess(uint32_t pass, RenderGraphResource resource, VkPipelineStageFlags2 stages, VkAccessFlags2 access,
+                            VkImageLayout layout, bool write)
+{
+    if(pass >= mPasses.size() || resource >= mResources.size())
+    {
+        std::cerr << "Render graph access refers to an undeclared pass or resource." << std::endl;
+        mDeclarationError = true;
+        return;
+    }
+    if(!mResources[resource].isImage)
+        layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // Accesses of one resource within a pass are merged, a single barrier covers all of them
+    for(auto &existing : mPasses[pass].accesses)
+    {
+        if(existing.resource == resource)
+        {
+            if(existing.layout != layout)
+            {
+                std::cerr << "Pass '" << mPasses[pass].name << "' uses '" << mResources[resource].name
+                          << "' in two different layouts." << std::endl;
+                mDeclarationError = true;
+                return;
+            }
+            existing.stages |= stages;
+            existing.access |= access;
+            existing.write   = existing.write || write;
+            return;
+        }
+    }
+
+    ResourceAccess resourceAccess = { resource, stages, access, layout, write };
+    mPasses[pass].accesses.push_back(resourceAccess);
+}
+
+RenderGraphQueue RenderGraph::getExecutionQueue(RenderGraphQueue queue) const
+{
+    return mSharedQueue ? RenderGraphQueue::Graphics : queue;
+}
+
+// Work handed to submission threads is not known to the device until the threads issue it
+void RenderGraph::waitIdle()
+{
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+    {
+        if(mSubmitters[queue] != nullptr)
+            mSubmitters[queue]->flush();
+    }
+    vkDeviceWaitIdle(mLogicalDevice);
+}
+
+// Hash of everything the plan depends on, resource handles and pass callbacks are excluded
+uint64_t RenderGraph::computeTopologyHash() const
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    hashValue(hash, mResources.size());
+    for(auto &resource : mResources)
+    {
+        hashValue(hash, (resource.isImage ? 1u : 0u) | (resource.imported ? 2u : 0u) | (resource.output ? 4u : 0u) |
+                        (resource.transientAttachment ? 8u : 0u));
+        if(resource.isImage)
+        {
+            hashValue(hash, resource.imageDesc.format);
+            hashValue(hash, resource.imageDesc.extent.width);
+            hashValue(hash, resource.imageDesc.extent.height);
+            hashValue(hash, resource.imageDesc.mipLevels);
+            hashValue(hash, resource.imageDesc.samples);
+            hashValue(hash, resource.imageDesc.usage);
+            hashValue(hash, resource.imageDesc.aspect);
+            hashValue(hash, resource.initialLayout);
+            hashValue(hash, resource.finalLayout);
+        }
+        else
+        {
+            hashValue(hash, resource.bufferDesc.size);
+            hashValue(hash, resource.bufferDesc.usage);
+        }
+    }
+
+    hashValue(hash, mPasses.size());
+    for(auto &pass : mPasses)
+    {
+        hashValue(hash, static_cast<uint32_t>(pass.queue));
+        hashValue(hash, pass.sideEffects ? 1u : 0u);
+        hashValue(hash, pass.accesses.size());
+        for(auto &access : pass.accesses)
+        {
+            hashValue(hash, access.resource);
+            hashValue(hash, access.stages);
+            hashValue(hash, access.access);
+            hashValue(hash, access.layout);
+            hashValue(hash, access.write ? 1u : 0u);
+        }
+    }
+    return hash;
+}
+
+bool RenderGraph::compile()
+{
+    PROFILE_FUNCTION();
+
+    if(mLogicalDevice == VK_NULL_HANDLE)
+    {
+        std::cerr << "Render graph has not been created." << std::endl;
+        return false;
+    }
+    if(mDeclarationError)
+    {
+        std::cerr << "Could not compile a render graph with invalid declarations." << std::endl;
+        return false;
+    }
+
+    uint64_t hash = computeTopologyHash();
+    if(mCompiled && hash == mTopologyHash)
+    {
+        ++mStats.cacheHits;
+        return true;
+    }
+    ++mStats.cacheMisses;
+
+    // Transient objects of the previous plan may still be in use by frames in flight
+    mCompiled = false;
+    waitIdle();
+    destroyTransientObjects();
+    for(auto &frame : mFrames)
+        frame.currentPlan = false;
+
+    mStats.declaredPasses          = static_cast<uint32_t>(mPasses.size());
+    mStats.imageBarriers           = 0;
+    mStats.memoryBarriers          = 0;
+    mStats.barrierCalls            = 0;
+    mStats.transientBytesRequested = 0;
+    mStats.transientBytesAllocated = 0;
+    mStats.transientBytesLazy      = 0;
+    mStats.transientBytesCommitted = 0;
+    mStats.transientBytesSaved     = 0;
+
+    cullPasses();
+    if(!createTransientObjects())
+    {
+        destroyTransientObjects();
+        return false;
+    }
+    assignTransientMemory();
+    planBarriers();
+    buildBatches();
+    if(!allocateTransientMemory())
+    {
+        destroyTransientObjects();
+        return false;
+    }
+
+    // Lazy memory is not backed before the GPU has used it, no savings are claimed until then
+    mStats.transientBytesCommitted = mStats.transientBytesAllocated;
+    mStats.transientBytesSaved     = mStats.transientBytesRequested > mStats.transientBytesAllocated ?
+                                     mStats.transientBytesRequested - mStats.transientBytesAllocated : 0;
+
+    mTopologyHash = hash;
+    mCompiled     = true;
+    return true;
+}
+
+// Walks the passes backwards from the outputs, a pass survives when a later surviving pass or an output needs
+// something it writes. Writes may be partial, so a written resource keeps its earlier writers alive as well.
+void RenderGraph::cullPasses()
+{
+    std::vector<bool> needed(mResources.size(), false);
+    for(size_t resource = 0; resource < mResources.size(); ++resource)
+        needed[resource] = mResources[resource].output;
+
+    mPassAlive.assign(mPasses.size(), false);
+    for(size_t index = mPasses.size(); index-- > 0;)
+    {
+        Pass const &pass = mPasses[index];
+        bool alive = pass.sideEffects;
+        for(auto &access : pass.accesses)
+        {
+            if(access.write && needed[access.resource])
+                alive = true;
+        }
+        if(!alive)
+            continue;
+
+        mPassAlive[index] = true;
+        for(auto &access : pass.accesses)
+            needed[access.resource] = true;
+    }
+
+    mPlannedPasses.clear();
+    for(uint32_t index = 0; index < mPasses.size(); ++index)
+    {
+        if(!mPassAlive[index])
+            continue;
+
+        PlannedPass planned;
+        planned.pass          = index;
+        planned.queue         = getExecutionQueue(mPasses[index].queue);
+        planned.memoryBarrier = {
+            VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,           // VkStructureType          sType
+            nullptr,                                      // const void             * pNext
+            0,                                            // VkPipelineStageFlags2    srcStageMask
+            0,                                            // VkAccessFlags2           srcAccessMask
+            0,                                            // VkPipelineStageFlags2    dstStageMask
+            0                                             // VkAccessFlags2           dstAccessMask
+        };
+        mPlannedPasses.push_back(planned);
+    }
+    mStats.culledPasses = static_cast<uint32_t>(mPasses.size() - mPlannedPasses.size());
+}
+
+bool RenderGraph::createTransientObjects()
+{
+    TransientObject unused = {};
+    unused.firstUse    = UNUSED_POSITION;
+    unused.lastUse     = UNUSED_POSITION;
+    unused.predecessor = INVALID_RENDER_GRAPH_RESOURCE;
+    mTransients.assign(mResources.size(), unused);
+
+    std::vector<uint32_t> queueMasks(mResources.size(), 0);
+    for(uint32_t position = 0; position < mPlannedPasses.size(); ++position)
+    {
+        PlannedPass const &planned = mPlannedPasses[position];
+        for(auto &access : mPasses[planned.pass].accesses)
+        {
+            TransientObject &transient = mTransients[access.resource];
+            transient.firstUse = std::min(transient.firstUse, position);
+            transient.lastUse  = position;
+            queueMasks[access.resource] |= 1u << static_cast<uint32_t>(planned.queue);
+        }
+    }
+
+    uint32_t queueFamilies[] = {
+        mQueues[static_cast<uint32_t>(RenderGraphQueue::Graphics)].familyIndex,
+        mQueues[static_cast<uint32_t>(RenderGraphQueue::Compute)].familyIndex
+    };
+    bool differentFamilies = queueFamilies[0] != queueFamilies[1];
+
+    for(uint32_t index = 0; index < mResources.size(); ++index)
+    {
+        Resource const &resource = mResources[index];
+        TransientObject &transient = mTransients[index];
+        if(resource.imported || transient.firstUse == UNUSED_POSITION)
+            continue;
+
+        // Concurrent sharing instead of queue family ownership transfers
+        bool concurrent = differentFamilies && queueMasks[index] == 3u;
+        VkSharingMode sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        uint32_t queueFamilyCount = concurrent ? 2 : 0;
+
+        if(resource.isImage)
+        {
+            RenderGraphImageDesc const &desc = resource.imageDesc;
+            VkImageUsageFlags usage = desc.usage;
+            if(resource.transientAttachment)
+                usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            VkImageCreateInfo imageCreateInfo = {
+                VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,          // VkStructureType          sType
+                nullptr,                                      // const void             * pNext
+                0,                                            // VkImageCreateFlags       flags
+                VK_IMAGE_TYPE_2D,                             // VkImageType              imageType
+                desc.format,                                  // VkFormat                 format
+                { desc.extent.width, desc.extent.height, 1 }, // VkExtent3D               extent
+                desc.mipLevels,                               // uint32_t                 mipLevels
+                1,                                            // uint32_t                 arrayLayers
+                desc.samples,                                 // VkSampleCountFlagBits    samples
+                VK_IMAGE_TILING_OPTIMAL,                      // VkImageTiling            tiling
+                usage,                                        // VkImageUsageFlags        usage
+                sharingMode,                                  // VkSharingMode            sharingMode
+                queueFamilyCount,                             // uint32_t                 queueFamilyIndexCount
+                queueFamilies,                                // const uint32_t         * pQueueFamilyIndices
+                VK_IMAGE_LAYOUT_UNDEFINED                     // VkImageLayout            initialLayout
+            };
+
+            VkResult result = vkCreateImage(mLogicalDevice, &imageCreateInfo, nullptr, &transient.image);
+            if(result != VK_SUCCESS)
+            {
+                std::cerr << "Could not create transient image '" << resource.name << "'." << std::endl;
+                return false;
+            }
+            vkGetImageMemoryRequirements(mLogicalDevice, transient.image, &transient.requirements);
+
+            // Without a lazily allocated memory type the attachment is aliased like any other image
+            uint32_t memoryTypeIndex;
+            transient.lazy = resource.transientAttachment &&
+                             selectMemoryType(mCapabilities.memoryProperties, transient.requirements.memoryTypeBits,
+                                              LAZY_MEMORY_PROPERTIES, memoryTypeIndex);
+        }
+        else
+        {
+            VkBufferCreateInfo bufferCreateInfo = {
+                VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,         // VkStructureType        sType
+                nullptr,                                      // const void           * pNext
+                0,                                            // VkBufferCreateFlags    flags
+                resource.bufferDesc.size,                     // VkDeviceSize           size
+                resource.bufferDesc.usage,                    // VkBufferUsageFlags     usage
+                sharingMode,                                  // VkSharingMode          sharingMode
+                queueFamilyCount,                             // uint32_t               queueFamilyIndexCount
+                queueFamilies                                 // const uint32_t       * pQueueFamilyIndices
+            };
+
+            VkResult result = vkCreateBuffer(mLogicalDevice, &bufferCreateInfo, nullptr, &transient.buffer);
+            if(result != VK_SUCCESS)
+            {
+                std::cerr << "Could not create transient buffer '" << resource.name << "'." << std::endl;
+                return false;
+            }
+            vkGetBufferMemoryRequirements(mLogicalDevice, transient.buffer, &transient.requirements);
+        }
+        mStats.transientBytesRequested += transient.requirements.size;
+    }
+    return true;
+}
+
+// Greedy interval packing: resources sorted by first use take over a memory block whose previous
+// occupant is no longer used, preferring the block closest in size. All aliases start at offset 0.
+// Lazily allocated blocks only hold transient attachments, which alias each other the same way.
+void RenderGraph::assignTransientMemory()
+{
+    mMemoryBlocks.clear();
+
+    std::vector<RenderGraphResource> order;
+    for(uint32_t index = 0; index < mResources.size(); ++index)
+    {
+        if(!mResources[index].imported && mTransients[index].firstUse != UNUSED_POSITION)
+            order.push_back(index);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](RenderGraphResource lhs, RenderGraphResource rhs)
+    {
+        return mTransients[lhs].firstUse < mTransients[rhs].firstUse;
+    });
+
+    for(auto index : order)
+    {
+        TransientObject &transient = mTransients[index];
+        VkDeviceSize size = transient.requirements.size;
+
+        uint32_t bestBlock = UNUSED_POSITION;
+        VkDeviceSize bestDifference = 0;
+        for(uint32_t block = 0; block < mMemoryBlocks.size(); ++block)
+        {
+            MemoryBlock const &candidate = mMemoryBlocks[block];
+            uint32_t memoryTypeIndex;
+            if(candidate.lastUse >= transient.firstUse || candidate.lazy != transient.lazy ||
+               !selectMemoryType(mCapabilities.memoryProperties, candidate.memoryTypeBits & transient.requirements.memoryTypeBits,
+                                 getTransientMemoryProperties(candidate.lazy), memoryTypeIndex))
+              continue;
+
+            VkDeviceSize difference = candidate.size > size ? candidate.size - size : size - candidate.size;
+            if(bestBlock == UNUSED_POSITION || difference < bestDifference)
+            {
+                bestBlock      = block;
+                bestDifference = difference;
+            }
+        }
+
+        if(bestBlock == UNUSED_POSITION)
+        {
+            MemoryBlock block = {};
+            block.memory         = VK_NULL_HANDLE;
+            block.alignment      = 1;
+            block.memoryTypeBits = transient.requirements.memoryTypeBits;
+            block.lastResource   = INVALID_RENDER_GRAPH_RESOURCE;
+            block.lazy           = transient.lazy;
+            mMemoryBlocks.push_back(block);
+            bestBlock = static_cast<uint32_t>(mMemoryBlocks.size() - 1);
+        }
+
+        MemoryBlock &block = mMemoryBlocks[bestBlock];
+        transient.block       = bestBlock;
+        transient.predecessor = block.lastResource;
+        block.lastResource    = index;
+        block.lastUse         = transient.lastUse;
+        block.size            = std::max(block.size, size);
+        block.alignment       = std::max(block.alignment, transient.requirements.alignment);
+        block.memoryTypeBits &= transient.requirements.memoryTypeBits;
+    }
+}
+
+// Tracks the last writer and the readers since then for every resource. Same queue hazards become
+// barriers merged per pass, hazards against another queue become timeline semaphore waits.
+void RenderGraph::planBarriers()
+{
+    std::vector<HazardState> states(mResources.size(), getInitialHazardState());
+
+    for(uint32_t position = 0; position < mPlannedPasses.size(); ++position)
+    {
+        PlannedPass &planned = mPlannedPasses[position];
+        uint32_t queue = static_cast<uint32_t>(planned.queue);
+        int32_t current = static_cast<int32_t>(position);
+
+        for(auto &access : mPasses[planned.pass].accesses)
+        {
+            Resource const &resource = mResources[access.resource];
+            HazardState &state = states[access.resource];
+
+            bool firstUse = !state.touched;
+            bool unknownHistory = false;
+            if(firstUse)
+            {
+                // Aliased memory has to wait for the previous occupant, its contents are discarded
+                RenderGraphResource predecessor = resource.imported ? INVALID_RENDER_GRAPH_RESOURCE
+                                                                    : mTransients[access.resource].predecessor;
+                if(predecessor != INVALID_RENDER_GRAPH_RESOURCE)
+                    state = states[predecessor];
+                else
+                    unknownHistory = true;
+                state.layout = resource.imported ? resource.initialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+
+            VkImageLayout oldLayout = state.layout;
+            bool layoutChange = resource.isImage && oldLayout != access.layout;
+            VkPipelineStageFlags2 srcStages = 0;
+            VkAccessFlags2 srcAccess = 0;
+
+            if(firstUse || access.write || layoutChange)
+            {
+                if(unknownHistory)
+                {
+                    // Previous frame or work outside of the graph
+                    srcStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+                    srcAccess = VK_ACCESS_2_MEMORY_WRITE_BIT;
+                }
+                else
+                {
+                    if(state.writerPass >= 0)
+                    {
+                        if(state.writerQueue == queue)
+                        {
+                            srcStages |= state.writerStages;
+                            srcAccess |= state.writerAccess;
+                        }
+                        else
+                            pushUnique(planned.waitPasses, static_cast<uint32_t>(state.writerPass));
+                    }
+                    for(uint32_t readerQueue = 0; readerQueue < GRAPH_QUEUE_COUNT; ++readerQueue)
+                    {
+                        if(state.readerPasses[readerQueue] < 0)
+                            continue;
+                        if(readerQueue == queue)
+                            srcStages |= state.readerStages[readerQueue];
+                        else
+                            pushUnique(planned.waitPasses, static_cast<uint32_t>(state.readerPasses[readerQueue]));
+                    }
+                }
+                // A layout transition following a semaphore wait still has to be chained to it
+                if(srcStages == 0 && layoutChange)
+                    srcStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+                clearReaders(state);
+                state.writerPass   = current;
+                state.writerQueue  = queue;
+                state.writerStages = access.stages;
+                state.writerAccess = access.write ? access.access : 0;
+                if(!access.write)
+                {
+                    state.readerPasses[queue]  = current;
+                    state.readerStages[queue]  = access.stages;
+                    state.visibleStages[queue] = access.stages;
+                    state.visibleAccess[queue] = access.access;
+                }
+            }
+            else
+            {
+                if(state.writerPass >= 0)
+                {
+                    if(state.writerQueue != queue)
+                    {
+                        if(state.visibleStages[queue] == 0)
+                        {
+                            // The semaphore wait makes all writes visible to every later stage
+                            pushUnique(planned.waitPasses, static_cast<uint32_t>(state.writerPass));
+                            state.visibleStages[queue] = ~0ull;
+                            state.visibleAccess[queue] = ~0ull;
+                        }
+                    }
+                    else if((access.stages & ~state.visibleStages[queue]) != 0 || (access.access & ~state.visibleAccess[queue]) != 0)
+                    {
+                        srcStages = state.writerStages;
+                        srcAccess = state.writerAccess;
+                        state.visibleStages[queue] |= access.stages;
+                        state.visibleAccess[queue] |= access.access;
+                    }
+                }
+                state.readerPasses[queue]  = current;
+                state.readerStages[queue] |= access.stages;
+            }
+
+            if(srcStages != 0 || layoutChange)
+            {
+                if(resource.isImage)
+                {
+                    PlannedImageBarrier imageBarrier;
+                    imageBarrier.resource = access.resource;
+                    imageBarrier.barrier  = {
+                        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,   // VkStructureType            sType
+                        nullptr,                                    // const void               * pNext
+                        srcStages,                                  // VkPipelineStageFlags2      srcStageMask
+                        srcAccess,                                  // VkAccessFlags2             srcAccessMask
+                        access.stages,                              // VkPipelineStageFlags2      dstStageMask
+                        access.access,                              // VkAccessFlags2             dstAccessMask
+                        oldLayout,                                  // VkImageLayout              oldLayout
+                        access.layout,                              // VkImageLayout              newLayout
+                        VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   srcQueueFamilyIndex
+                        VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   dstQueueFamilyIndex
+                        VK_NULL_HANDLE,                             // VkImage                    image
+                        {                                           // VkImageSubresourceRange    subresourceRange
+                          resource.imageDesc.aspect,                  // VkImageAspectFlags         aspectMask
+                          0,                                          // uint32_t                   baseMipLevel
+                          VK_REMAINING_MIP_LEVELS,                    // uint32_t                   levelCount
+                          0,                                          // uint32_t                   baseArrayLayer
+                          VK_REMAINING_ARRAY_LAYERS                   // uint32_t                   layerCount
+                        }
+                    };
+                    planned.imageBarriers.push_back(imageBarrier);
+                    ++mStats.imageBarriers;
+                }
+                else
+                {
+                    planned.memoryBarrier.srcStageMask  |= srcStages;
+                    planned.memoryBarrier.srcAccessMask |= srcAccess;
+                    planned.memoryBarrier.dstStageMask  |= access.stages;
+                    planned.memoryBarrier.dstAccessMask |= access.access;
+                }
+            }
+
+            if(resource.isImage)
+                state.layout = access.layout;
+            state.touched  = true;
+            state.lastPass = current;
+        }
+
+        if(planned.memoryBarrier.srcStageMask != 0)
+            ++mStats.memoryBarriers;
+        if(!planned.imageBarriers.empty() || planned.memoryBarrier.srcStageMask != 0)
+            ++mStats.barrierCalls;
+    }
+
+    // Imported images are returned to their final layout right after their last use
+    for(uint32_t index = 0; index < mResources.size(); ++index)
+    {
+        Resource const &resource = mResources[index];
+        HazardState const &state = states[index];
+        if(!resource.imported || !resource.isImage || !state.touched ||
+           resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout)
+          continue;
+
+        PlannedPass &planned = mPlannedPasses[state.lastPass];
+        uint32_t queue = static_cast<uint32_t>(planned.queue);
+        VkPipelineStageFlags2 srcStages = 0;
+        VkAccessFlags2 srcAccess = 0;
+        if(state.writerPass >= 0)
+        {
+            if(state.writerQueue == queue)
+            {
+                srcStages |= state.writerStages;
+                srcAccess |= state.writerAccess;
+            }
+            else
+                pushUnique(planned.waitPasses, static_cast<uint32_t>(state.writerPass));
+        }
+        for(uint32_t readerQueue = 0; readerQueue < GRAPH_QUEUE_COUNT; ++readerQueue)
+        {
+            if(state.readerPasses[readerQueue] < 0)
+                continue;
+            if(readerQueue == queue)
+                srcStages |= state.readerStages[readerQueue];
+            else
+                pushUnique(planned.waitPasses, static_cast<uint32_t>(state.readerPasses[readerQueue]));
+        }
+        if(srcStages == 0)
+            srcStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+        PlannedImageBarrier imageBarrier;
+        imageBarrier.resource = index;
+        imageBarrier.barrier  = {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,   // VkStructureType            sType
+            nullptr,                                    // const void               * pNext
+            srcStages,                                  // VkPipelineStageFlags2      srcStageMask
+            srcAccess,                                  // VkAccessFlags2             srcAccessMask
+            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,       // VkPipelineStageFlags2      dstStageMask
+            0,                                          // VkAccessFlags2             dstAccessMask
+            state.layout,                               // VkImageLayout              oldLayout
+            resource.finalLayout,                       // VkImageLayout              newLayout
+            VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   dstQueueFamilyIndex
+            VK_NULL_HANDLE,                             // VkImage                    image
+            {                                           // VkImageSubresourceRange    subresourceRange
+              resource.imageDesc.aspect,                  // VkImageAspectFlags         aspectMask
+              0,                                          // uint32_t                   baseMipLevel
+              VK_REMAINING_MIP_LEVELS,                    // uint32_t                   levelCount
+              0,                                          // uint32_t                   baseArrayLayer
+              VK_REMAINING_ARRAY_LAYERS                   // uint32_t                   layerCount
+            }
+        };
+        if(planned.finalBarriers.empty())
+            ++mStats.barrierCalls;
+        planned.finalBarriers.push_back(imageBarrier);
+        ++mStats.imageBarriers;
+    }
+}
+
+// Consecutive passes of one queue form a batch. Every wait refers to an earlier pass of another queue,
+// which always lives in an earlier batch, so waiting at the start of a batch never delays anything.
+void RenderGraph::buildBatches()
+{
+    mBatches.clear();
+    std::vector<uint32_t> passBatches(mPlannedPasses.size());
+    for(uint32_t position = 0; position < mPlannedPasses.size(); ++position)
+    {
+        if(mBatches.empty() || mBatches.back().queue != mPlannedPasses[position].queue)
+        {
+            Batch batch;
+            batch.queue     = mPlannedPasses[position].queue;
+            batch.firstPass = position;
+            batch.passCount = 0;
+            batch.externalWaits = false;
+            mBatches.push_back(batch);
+        }
+        ++mBatches.back().passCount;
+        passBatches[position] = static_cast<uint32_t>(mBatches.size() - 1);
+    }
+
+    for(auto &batch : mBatches)
+    {
+        for(uint32_t position = batch.firstPass; position < batch.firstPass + batch.passCount; ++position)
+        {
+            for(auto waitPass : mPlannedPasses[position].waitPasses)
+                pushUnique(batch.waitBatches, passBatches[waitPass]);
+        }
+    }
+
+    // Waits for imported images, e.g. the swapchain acquire, may be binary semaphores that can only be
+    // waited on once. The first batch touching an imported resource takes them, the first batch of the
+    // other queue touching one waits for that batch; batches after it on either queue are ordered behind.
+    std::vector<bool> touchesImported(mBatches.size(), false);
+    for(uint32_t index = 0; index < mBatches.size(); ++index)
+    {
+        Batch const &batch = mBatches[index];
+        for(uint32_t position = batch.firstPass; position < batch.firstPass + batch.passCount; ++position)
+        {
+            for(auto const &access : mPasses[mPlannedPasses[position].pass].accesses)
+            {
+                if(mResources[access.resource].imported)
+                    touchesImported[index] = true;
+            }
+        }
+    }
+    uint32_t externalBatch = 0;
+    while(externalBatch < mBatches.size() && !touchesImported[externalBatch])
+        ++externalBatch;
+    if(externalBatch == mBatches.size())
+        externalBatch = 0;
+    if(!mBatches.empty())
+    {
+        mBatches[externalBatch].externalWaits = true;
+        for(uint32_t index = externalBatch + 1; index < mBatches.size(); ++index)
+        {
+            if(touchesImported[index] && mBatches[index].queue != mBatches[externalBatch].queue)
+            {
+                pushUnique(mBatches[index].waitBatches, externalBatch);
+                break;
+            }
+        }
+    }
+
+    // The last batch completes after all others, so external signals cover the whole frame
+    if(mBatches.size() > 1)
+    {
+        uint32_t lastBatch = static_cast<uint32_t>(mBatches.size() - 1);
+        for(uint32_t queue = 0; queue < GRAPH_QUEUE_COUNT; ++queue)
+        {
+            if(static_cast<RenderGraphQueue>(queue) == mBatches[lastBatch].queue)
+                continue;
+            for(uint32_t batch = lastBatch; batch-- > 0;)
+            {
+                if(mBatches[batch].queue == static_cast<RenderGraphQueue>(queue))
+                {
+                    pushUnique(mBatches[lastBatch].waitBatches, batch);
+                    break;
+                }
+            }
+        }
+    }
+
+    mStats.submitBatches   = static_cast<uint32_t>(mBatches.size());
+    mStats.crossQueueWaits = 0;
+    for(auto &batch : mBatches)
+        mStats.crossQueueWaits += static_cast<uint32_t>(batch.waitBatches.size());
+}
+
+bool RenderGraph::allocateTransientMemory()
+{
+    for(auto &block : mMemoryBlocks)
+    {
+        uint32_t memoryTypeIndex;
+        if(!selectMemoryType(mCapabilities.memoryProperties, block.memoryTypeBits,
+                             getTransientMemoryProperties(block.lazy), memoryTypeIndex))
+        {
+            std::cerr << "Could not find a device local memory type for transient resources." << std::endl;
+            return false;
+        }
+
+        VkMemoryAllocateInfo memoryAllocateInfo = {
+            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,                             // VkStructureType    sType
+            nullptr,                                                            // const void       * pNext
+            (block.size + block.alignment - 1) / block.alignment * block.alignment, // VkDeviceSize       allocationSize
+            memoryTypeIndex                                                     // uint32_t           memoryTypeIndex
+        };
+
+        VkResult result = vkAllocateMemory(mLogicalDevice, &memoryAllocateInfo, nullptr, &block.memory);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not allocate memory for transient resources." << std::endl;
+            return false;
+        }
+        mStats.transientBytesAllocated += memoryAllocateInfo.allocationSize;
+        if(block.lazy)
+            mStats.transientBytesLazy += memoryAllocateInfo.allocationSize;
+    }
+
+    for(uint32_t index = 0; index < mResources.size(); ++index)
+    {
+        Resource const &resource = mResources[index];
+        TransientObject &transient = mTransients[index];
+        if(resource.imported || transient.firstUse == UNUSED_POSITION)
+            continue;
+
+        VkDeviceMemory memory = mMemoryBlocks[transient.block].memory;
+        if(!resource.isImage)
+        {
+            if(vkBindBufferMemory(mLogicalDevice, transient.buffer, memory, 0) != VK_SUCCESS)
+            {
+                std::cerr << "Could not bind memory to transient buffer '" << resource.name << "'." << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        if(vkBindImageMemory(mLogicalDevice, transient.image, memory, 0) != VK_SUCCESS)
+        {
+            std::cerr << "Could not bind memory to transient image '" << resource.name << "'." << std::endl;
+            return false;
+        }
+
+        VkImageViewCreateInfo imageViewCreateInfo = {
+            VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,       // VkStructureType            sType
+            nullptr,                                        // const void               * pNext
+            0,                                              // VkImageViewCreateFlags     flags
+            transient.image,                                // VkImage                    image
+            VK_IMAGE_VIEW_TYPE_2D,                          // VkImageViewType            viewType
+            resource.imageDesc.format,                      // VkFormat                   format
+            {                                               // VkComponentMapping         components
+              VK_COMPONENT_SWIZZLE_IDENTITY,                  // VkComponentSwizzle         r
+              VK_COMPONENT_SWIZZLE_IDENTITY,                  // VkComponentSwizzle         g
+              VK_COMPONENT_SWIZZLE_IDENTITY,                  // VkComponentSwizzle         b
+              VK_COMPONENT_SWIZZLE_IDENTITY                   // VkComponentSwizzle         a
+            },
+            {                                               // VkImageSubresourceRange    subresourceRange
+              resource.imageDesc.aspect,                      // VkImageAspectFlags         aspectMask
+              0,                                              // uint32_t                   baseMipLevel
+              VK_REMAINING_MIP_LEVELS,                        // uint32_t                   levelCount
+              0,                                              // uint32_t                   baseArrayLayer
+              VK_REMAINING_ARRAY_LAYERS                       // uint32_t                   layerCount
+            }
+        };
+
+        if(vkCreateImageView(mLogicalDevice, &imageViewCreateInfo, nullptr, &transient.view) != VK_SUCCESS)
+        {
+            std::cerr << "Could not create a view of transient image '" << resource.name << "'." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenderGraph::destroyTransientObjects()
+{
+    for(auto &transient : mTransients)
+    {
+        destroyImageView(mLogicalDevice, transient.view);
+        destroyImage(mLogicalDevice, transient.image);
+        destroyBuffer(mLogicalDevice, transient.buffer);
+    }
+    for(auto &block : mMemoryBlocks)
+        freeMemoryObject(mLogicalDevice, block.memory);
+
+    mTransients.clear();
+    mMemoryBlocks.clear();
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, std::vector<PlannedImageBarrier> const &imageBarriers,
+                                 VkMemoryBarrier2 const *memoryBarrier)
+{
+    mBarrierScratch.clear();
+    for(auto &imageBarrier : imageBarriers)
+    {
+        mBarrierScratch.push_back(imageBarrier.barrier);
+        mBarrierScratch.back().image = getImage(imageBarrier.resource);
+    }
+    if(mBarrierScratch.empty() && memoryBarrier == nullptr)
+        return;
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,                // VkStructureType                  sType
+        nullptr,                                          // const void                     * pNext
+        0,                                                // VkDependencyFlags                dependencyFlags
+        memoryBarrier != nullptr ? 1u : 0u,               // uint32_t                         memoryBarrierCount
+        memoryBarrier,                                    // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                                // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                          // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        static_cast<uint32_t>(mBarrierScratch.size()),    // uint32_t                         imageMemoryBarrierCount
+        mBarrierScratch.data()                            // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+bool RenderGraph::execute(uint32_t frameIndex, std::vector<VkSemaphoreSubmitInfo> const &waitSemaphores,
+                          std::vector<VkSemaphoreSubmitInfo> const &signalSemaphores)
+{
+    PROFILE_FUNCTION();
+
+    if(!mCompiled)
+    {
+        std::cerr << "Render graph has to be compiled before it is executed." << std::endl;
+        return false;
+    }
+
+    FrameResources &frame = mFrames[frameIndex % mFrames.size()];
+
+    // Command buffers of this frame slot may be reused once the GPU has finished with them
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+    {
+        if(frame.completionValues[queue] > 0)
+        {
+            semaphores.push_back(mTimelineSemaphores[queue]);
+            values.push_back(frame.completionValues[queue]);
+        }
+    }
+    if(!semaphores.empty())
+    {
+        VkSemaphoreWaitInfo semaphoreWaitInfo = {
+            VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,          // VkStructureType          sType
+            nullptr,                                        // const void             * pNext
+            0,                                              // VkSemaphoreWaitFlags     flags
+            static_cast<uint32_t>(semaphores.size()),       // uint32_t                 semaphoreCount
+            semaphores.data(),                              // const VkSemaphore      * pSemaphores
+            values.data()                                   // const uint64_t         * pValues
+        };
+        if(vkWaitSemaphores(mLogicalDevice, &semaphoreWaitInfo, UINT64_MAX) != VK_SUCCESS)
+        {
+            std::cerr << "Could not wait for a previous frame of the render graph." << std::endl;
+            return false;
+        }
+    }
+    // A finished frame of this plan has touched the lazy memory, its commitment is meaningful now
+    if(frame.currentPlan)
+        queryTransientCommitment();
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+    {
+        if(vkResetCommandPool(mLogicalDevice, frame.commandPools[queue], 0) != VK_SUCCESS)
+        {
+            std::cerr << "Could not reset a render graph command pool." << std::endl;
+            return false;
+        }
+    }
+
+    uint64_t previousValues[QUEUE_COUNT];
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+        previousValues[queue] = mTimelineValues[queue];
+
+    std::vector<uint64_t> signalValues(mBatches.size());
+    std::vector<VkCommandBufferSubmitInfo> commandBufferInfos(mBatches.size());
+    uint32_t usedCommandBuffers[QUEUE_COUNT] = {};
+    for(uint32_t index = 0; index < mBatches.size(); ++index)
+    {
+        Batch const &batch = mBatches[index];
+        uint32_t queue = static_cast<uint32_t>(batch.queue);
+
+        auto &commandBuffers = frame.commandBuffers[queue];
+        if(usedCommandBuffers[queue] == commandBuffers.size())
+        {
+            VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // VkStructureType          sType
+                nullptr,                                        // const void             * pNext
+                frame.commandPools[queue],                      // VkCommandPool            commandPool
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // VkCommandBufferLevel     level
+                1                                               // uint32_t                 commandBufferCount
+            };
+
+            VkCommandBuffer commandBuffer;
+            if(vkAllocateCommandBuffers(mLogicalDevice, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS)
+            {
+                std::cerr << "Could not allocate a render graph command buffer." << std::endl;
+                return false;
+            }
+            commandBuffers.push_back(commandBuffer);
+        }
+        VkCommandBuffer commandBuffer = commandBuffers[usedCommandBuffers[queue]++];
+
+        VkCommandBufferBeginInfo commandBufferBeginInfo = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,    // VkStructureType                        sType
+            nullptr,                                        // const void                           * pNext
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,    // VkCommandBufferUsageFlags              flags
+            nullptr                                         // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+        };
+        if(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+        {
+            std::cerr << "Could not begin a render graph command buffer." << std::endl;
+            return false;
+        }
+
+        for(uint32_t position = batch.firstPass; position < batch.firstPass + batch.passCount; ++position)
+        {
+            PlannedPass const &planned = mPlannedPasses[position];
+            recordBarriers(commandBuffer, planned.imageBarriers,
+                           planned.memoryBarrier.srcStageMask != 0 ? &planned.memoryBarrier : nullptr);
+            if(mPasses[planned.pass].function)
+                mPasses[planned.pass].function(commandBuffer);
+            recordBarriers(commandBuffer, planned.finalBarriers, nullptr);
+        }
+
+        if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            std::cerr << "Could not end a render graph command buffer." << std::endl;
+            return false;
+        }
+
+        signalValues[index] = ++mTimelineValues[queue];
+        commandBufferInfos[index] = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,   // VkStructureType    sType
+            nullptr,                                        // const void       * pNext
+            commandBuffer,                                  // VkCommandBuffer    commandBuffer
+            0                                               // uint32_t           deviceMask
+        };
+    }
+
+    std::vector<std::vector<VkSemaphoreSubmitInfo>> batchWaits(mBatches.size());
+    std::vector<std::vector<VkSemaphoreSubmitInfo>> batchSignals(mBatches.size());
+    bool queueStarted[QUEUE_COUNT] = {};
+    for(uint32_t index = 0; index < mBatches.size(); ++index)
+    {
+        Batch const &batch = mBatches[index];
+        uint32_t queue = static_cast<uint32_t>(batch.queue);
+
+        if(!queueStarted[queue])
+        {
+            // Transient memory is shared between frames, so the previous frame has to finish on the other queues
+            queueStarted[queue] = true;
+            for(uint32_t other = 0; other < QUEUE_COUNT; ++other)
+            {
+                if(other != queue && previousValues[other] > 0)
+                    addTimelineWait(batchWaits[index], mTimelineSemaphores[other], previousValues[other]);
+            }
+        }
+        for(auto waitBatch : batch.waitBatches)
+        {
+            uint32_t waitQueue = static_cast<uint32_t>(mBatches[waitBatch].queue);
+            addTimelineWait(batchWaits[index], mTimelineSemaphores[waitQueue], signalValues[waitBatch]);
+        }
+        if(batch.externalWaits)
+            batchWaits[index].insert(batchWaits[index].end(), waitSemaphores.begin(), waitSemaphores.end());
+
+        batchSignals[index].push_back(getSemaphoreSubmitInfo(mTimelineSemaphores[queue], signalValues[index]));
+        if(index + 1 == mBatches.size())
+            batchSignals[index].insert(batchSignals[index].end(), signalSemaphores.begin(), signalSemaphores.end());
+    }
+
+    // One submission per queue, timeline semaphores allow waits on values signalled by a later submission
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+    {
+        if(mSubmitters[queue] != nullptr)
+        {
+            // The submission thread coalesces these with work handed in from other threads
+            for(uint32_t index = 0; index < mBatches.size(); ++index)
+            {
+                if(static_cast<uint32_t>(mBatches[index].queue) != queue)
+                    continue;
+
+                QueueSubmission submission;
+                submission.waitSemaphores   = std::move(batchWaits[index]);
+                submission.commandBuffers   = { commandBufferInfos[index] };
+                submission.signalSemaphores = std::move(batchSignals[index]);
+                submission.fence            = VK_NULL_HANDLE;
+                mSubmitters[queue]->submit(std::move(submission));
+            }
+            continue;
+        }
+
+        std::vector<VkSubmitInfo2> submitInfos;
+        for(uint32_t index = 0; index < mBatches.size(); ++index)
+        {
+            if(static_cast<uint32_t>(mBatches[index].queue) != queue)
+                continue;
+
+            VkSubmitInfo2 submitInfo = {
+                VK_STRUCTURE_TYPE_SUBMIT_INFO_2,                        // VkStructureType                    sType
+                nullptr,                                                // const void                       * pNext
+                0,                                                      // VkSubmitFlags                      flags
+                static_cast<uint32_t>(batchWaits[index].size()),        // uint32_t                           waitSemaphoreInfoCount
+                batchWaits[index].data(),                               // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+                1,                                                      // uint32_t                           commandBufferInfoCount
+                &commandBufferInfos[index],                             // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+                static_cast<uint32_t>(batchSignals[index].size()),      // uint32_t                           signalSemaphoreInfoCount
+                batchSignals[index].data()                              // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+            };
+            submitInfos.push_back(submitInfo);
+        }
+        if(submitInfos.empty())
+            continue;
+
+        VkResult result = vkQueueSubmit2(mQueues[queue].handle, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), VK_NULL_HANDLE);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Could not submit render graph command buffers." << std::endl;
+            return false;
+        }
+    }
+
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; ++queue)
+        frame.completionValues[queue] = mTimelineValues[queue];
+    frame.currentPlan = true;
+    return true;
+}
+
+VkImage RenderGraph::getImage(RenderGraphResource resource) const
+{
+    if(resource >= mResources.size())
+        return VK_NULL_HANDLE;
+    if(mResources[resource].imported)
+        return mResources[resource].image;
+    return resource < mTransients.size() ? mTransients[resource].image : VK_NULL_HANDLE;
+}
+
+VkImageView RenderGraph::getImageView(RenderGraphResource resource) const
+{
+    if(resource >= mResources.size())
+        return VK_NULL_HANDLE;
+    if(mResources[resource].imported)
+        return mResources[resource].view;
+    return resource < mTransients.size() ? mTransients[resource].view : VK_NULL_HANDLE;
+}
+
+VkBuffer RenderGraph::getBuffer(RenderGraphResource resource) const
+{
+    if(resource >= mResources.size())
+        return VK_NULL_HANDLE;
+    if(mResources[resource].imported)
+        return mResources[resource].buffer;
+    return resource < mTransients.size() ? mTransients[resource].buffer : VK_NULL_HANDLE;
+}
+
+void RenderGraph::queryTransientCommitment()
+{
+    VkDeviceSize committed = mStats.transientBytesAllocated - mStats.transientBytesLazy;
+    for(auto &block : mMemoryBlocks)
+    {
+        if(!block.lazy || block.memory == VK_NULL_HANDLE)
+            continue;
+
+        VkDeviceSize commitment = 0;
+        vkGetDeviceMemoryCommitment(mLogicalDevice, block.memory, &commitment);
+        block.peakCommitment = std::max(block.peakCommitment, commitment);
+        committed += block.peakCommitment;
+    }
+
+    mStats.transientBytesCommitted = committed;
+    mStats.transientBytesSaved     = mStats.transientBytesRequested > committed ? mStats.transientBytesRequested - committed : 0;
+}
+
+RenderGraphStats const &RenderGraph::getStats() const
+{
+    return mStats;
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <iostream>
+
+#include "Profiler.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t TRANSFORM_GRAIN_SIZE = 4096;
+  const uint32_t CULL_GRAIN_SIZE      = 16384;
+}
+
+Scene::Scene()
+{
+    mLevelsDirty = false;
+    mStaticVersion = 0;
+    setCullingKernel(selectCullingKernel());
+}
+
+void Scene::reserve(uint32_t nodeCount)
+{
+    mParents.reserve(nodeCount);
+    mDepths.reserve(nodeCount);
+    mLocalTransforms.reserve(nodeCount);
+    mWorldTransforms.reserve(nodeCount);
+    mLocalSpheres.reserve(nodeCount);
+    mWorldCenterX.reserve(nodeCount);
+    mWorldCenterY.reserve(nodeCount);
+    mWorldCenterZ.reserve(nodeCount);
+    mWorldRadius.reserve(nodeCount);
+    mFlags.reserve(nodeCount);
+    mStaticDescendants.reserve(nodeCount);
+    mMeshIds.reserve(nodeCount);
+}
+
+void Scene::clear()
+{
+    mParents.clear();
+    mDepths.clear();
+    mLocalTransforms.clear();
+    mWorldTransforms.clear();
+    mLocalSpheres.clear();
+    mWorldCenterX.clear();
+    mWorldCenterY.clear();
+    mWorldCenterZ.clear();
+    mWorldRadius.clear();
+    mFlags.clear();
+    mStaticDescendants.clear();
+    mMeshIds.clear();
+    mLevelNodes.clear();
+    mLevelOffsets.clear();
+    mLevelsDirty = false;
+    ++mStaticVersion;
+}
+
+uint32_t Scene::createNode(uint32_t parent, Float4x4 const &localTransform, Float4 const &localBoundingSphere,
+                           uint32_t meshId, uint32_t flags)
+{
+    uint32_t node = getNodeCount();
+    if(parent != INVALID_SCENE_NODE && parent >= node)
+    {
+        std::cerr << "Scene node parent must be created before its children." << std::endl;
+        return INVALID_SCENE_NODE;
+    }
+
+    mParents.push_back(parent);
+    mDepths.push_back(parent == INVALID_SCENE_NODE ? 0 : mDepths[parent] + 1);
+    mLocalTransforms.push_back(localTransform);
+    mWorldTransforms.push_back(localTransform);
+    mLocalSpheres.push_back(localBoundingSphere);
+    mWorldCenterX.push_back(localBoundingSphere.x);
+    mWorldCenterY.push_back(localBoundingSphere.y);
+    mWorldCenterZ.push_back(localBoundingSphere.z);
+    mWorldRadius.push_back(localBoundingSphere.w);
+    mFlags.push_back(flags);
+    mStaticDescendants.push_back(0);
+    mMeshIds.push_back(meshId);
+
+    mLevelsDirty = true;
+    if(flags & SCENE_NODE_STATIC_BIT)
+    {
+        addStaticDescendant(parent, 1);
+        ++mStaticVersion;
+    }
+    return node;
+}
+
+// Moving any ancestor moves a static node as well
+void Scene::setLocalTransform(uint32_t node, Float4x4 const &localTransform)
+{
+    mLocalTransforms[node] = localTransform;
+    if((mFlags[node] & SCENE_NODE_STATIC_BIT) || mStaticDescendants[node] != 0)
+        ++mStaticVersion;
+}
+
+void Scene::setFlags(uint32_t node, uint32_t flags)
+{
+    uint32_t changed = mFlags[node] ^ flags;
+    if(changed & SCENE_NODE_STATIC_BIT)
+        addStaticDescendant(mParents[node], (flags & SCENE_NODE_STATIC_BIT) ? 1 : -1);
+    if((mFlags[node] | flags) & SCENE_NODE_STATIC_BIT)
+        ++mStaticVersion;
+    mFlags[node] = flags;
+}
+
+void Scene::addStaticDescendant(uint32_t ancestor, int32_t delta)
+{
+    for(; ancestor != INVALID_SCENE_NODE; ancestor = mParents[ancestor])
+        mStaticDescendants[ancestor] += delta;
+}
+
+void Scene::rebuildLevels()
+{
+    // Counting sort by depth is a topological order: every parent lands in an earlier level
+    uint32_t levelCount = 0;
+    for(auto depth : mDepths)
+        levelCount = std::max(levelCount, depth + 1);
+
+    mLevelOffsets.assign(levelCount + 1, 0);
+    for(auto depth : mDepths)
+        ++mLevelOffsets[depth + 1];
+    for(uint32_t level = 0; level < levelCount; ++level)
+        mLevelOffsets[level + 1] += mLevelOffsets[level];
+
+    std::vector<uint32_t> cursor(mLevelOffsets.begin(), mLevelOffsets.end() - 1);
+    mLevelNodes.resize(mDepths.size());
+    for(uint32_t node = 0; node < static_cast<uint32_t>(mDepths.size()); ++node)
+        mLevelNodes[cursor[mDepths[node]]++] = node;
+
+    mLevelsDirty = false;
+}
+
+void Scene::updateNodes(uint32_t const *nodes, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t node = nodes[i];
+        uint32_t parent = mParents[node];
+
+        Float4x4 &world = mWorldTransforms[node];
+        if(parent == INVALID_SCENE_NODE)
+            world = mLocalTransforms[node];
+        else
+            world = multiply(mWorldTransforms[parent], mLocalTransforms[node]);
+
+        Float4 const &sphere = mLocalSpheres[node];
+        Float3 center = transformPoint(world, { sphere.x, sphere.y, sphere.z });
+        mWorldCenterX[node] = center.x;
+        mWorldCenterY[node] = center.y;
+        mWorldCenterZ[node] = center.z;
+        mWorldRadius[node] = sphere.w * maxScale(world);
+    }
+}
+
+void Scene::updateTransforms(ThreadPool *threadPool)
+{
+    PROFILE_FUNCTION();
+
+    if(mLevelsDirty)
+        rebuildLevels();
+
+    uint32_t levelCount = getLevelCount();
+    for(uint32_t level = 0; level < levelCount; ++level)
+    {
+        uint32_t const *levelNodes = mLevelNodes.data() + mLevelOffsets[level];
+        uint32_t levelSize = mLevelOffsets[level + 1] - mLevelOffsets[level];
+
+        if(threadPool == nullptr || levelSize <= TRANSFORM_GRAIN_SIZE)
+        {
+            updateNodes(levelNodes, levelSize);
+            continue;
+        }
+
+        threadPool->parallelFor(levelSize, TRANSFORM_GRAIN_SIZE, [this, levelNodes](uint32_t begin, uint32_t end)
+        {
+            updateNodes(levelNodes + begin, end - begin);
+        });
+    }
+}
+
+void Scene::cull(Frustum const &frustum, VisibleList &visibleList, ThreadPool *threadPool)
+{
+    PROFILE_FUNCTION();
+
+    uint32_t nodeCount = getNodeCount();
+    uint32_t chunkCount = (nodeCount + CULL_GRAIN_SIZE - 1) / CULL_GRAIN_SIZE;
+
+    if(mCullScratch.size() < chunkCount)
+    {
+        mCullCandidates.resize(chunkCount);
+        mCullScratch.resize(chunkCount);
+    }
+    mCullCounts.assign(chunkCount, 0);
+
+    SphereArrays spheres = { mWorldCenterX.data(), mWorldCenterY.data(), mWorldCenterZ.data(), mWorldRadius.data() };
+
+    auto cullChunks = [&](uint32_t firstChunk, uint32_t lastChunk)
+    {
+        for(uint32_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+        {
+            uint32_t begin = chunk * CULL_GRAIN_SIZE;
+            uint32_t end = std::min(begin + CULL_GRAIN_SIZE, nodeCount);
+            auto &candidates = mCullCandidates[chunk];
+            auto &scratch = mCullScratch[chunk];
+            candidates.resize(end - begin);
+            scratch.resize(end - begin);
+
+            uint32_t candidateCount = mCullFunction(frustum, spheres, begin, end, candidates.data());
+
+            // Geometric test first, flags second: the SIMD kernel stays branch free
+            uint32_t written = 0;
+            uint32_t candidate = 0;
+            for(uint32_t node = begin; node < end; ++node)
+            {
+                bool inFrustum = candidate < candidateCount && candidates[candidate] == node;
+                candidate += inFrustum ? 1 : 0;
+
+                uint32_t flags = mFlags[node];
+                if((flags & SCENE_NODE_VISIBLE_BIT) && (inFrustum || (flags & SCENE_NODE_NEVER_CULLED_BIT)))
+                    scratch[written++] = node;
+            }
+            mCullCounts[chunk] = written;
+        }
+    };
+
+    if(threadPool == nullptr || chunkCount <= 1)
+        cullChunks(0, chunkCount);
+    else
+        threadPool->parallelFor(chunkCount, 1, cullChunks);
+
+    uint32_t visibleCount = 0;
+    for(uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+        visibleCount += mCullCounts[chunk];
+
+    visibleList.nodes.resize(visibleCount);
+    visibleList.meshIds.resize(visibleCount);
+
+    uint32_t offset = 0;
+    for(uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        std::copy_n(mCullScratch[chunk].begin(), mCullCounts[chunk], visibleList.nodes.begin() + offset);
+        offset += mCullCounts[chunk];
+    }
+    for(uint32_t i = 0; i < visibleCount; ++i)
+        visibleList.meshIds[i] = mMeshIds[visibleList.nodes[i]];
+}
+
+void Scene::setCullingKernel(CullingKernel kernel)
+{
+    mCullingKernel = kernel;
+    mCullFunction = getCullSpheresFunction(kernel);
+}
+
+CullingKernel Scene::getCullingKernel() const
+{
+    return mCullingKernel;
+}
+
+uint32_t Scene::getNodeCount() const
+{
+    return static_cast<uint32_t>(mParents.size());
+}
+
+uint32_t Scene::getLevelCount() const
+{
+    return mLevelOffsets.empty() ? 0 : static_cast<uint32_t>(mLevelOffsets.size() - 1);
+}
+
+std::vector<Float4x4> const &Scene::getWorldTransforms() const
+{
+    return mWorldTransforms;
+}
+
+std::vector<uint32_t> const &Scene::getMeshIds() const
+{
+    return mMeshIds;
+}
+
+uint64_t Scene::getStaticVersion() const
+{
+    return mStaticVersion;
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,296 @@
+#include <chrono>
+
+#include "Profiler.h"
+#include "SecondaryCommandCache.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  void hashCombine(uint64_t &hash, uint64_t value)
+  {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+
+  uint64_t hashEntrySlot(SecondaryCommandKey const &key)
+  {
+    uint64_t hash = key.pass;
+    hashCombine(hash, reinterpret_cast<uint64_t>(key.pipeline));
+    return hash;
+  }
+
+  uint64_t hashRenderingInfo(SecondaryRenderingInfo const &renderingInfo)
+  {
+    uint64_t hash = renderingInfo.colorFormats.size();
+    for(VkFormat format : renderingInfo.colorFormats)
+      hashCombine(hash, format);
+    hashCombine(hash, renderingInfo.depthFormat);
+    hashCombine(hash, renderingInfo.stencilFormat);
+    hashCombine(hash, renderingInfo.samples);
+    hashCombine(hash, (uint64_t(renderingInfo.extent.width) << 32) | renderingInfo.extent.height);
+    hashCombine(hash, renderingInfo.flags);
+    return hash;
+  }
+}
+
+SecondaryCommandCache::SecondaryCommandCache()
+{
+    mLogicalDevice  = VK_NULL_HANDLE;
+    mFramesInFlight = 0;
+    mFrame          = 0;
+    mCommandPool    = VK_NULL_HANDLE;
+    mStats          = {};
+}
+
+SecondaryCommandCache::~SecondaryCommandCache()
+{
+    destroy();
+}
+
+bool SecondaryCommandCache::create(VkDevice logicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight)
+{
+    destroy();
+    mLogicalDevice = logicalDevice;
+    mFramesInFlight = framesInFlight;
+
+    // Buffers are reset individually by vkBeginCommandBuffer when a stale recording is replaced
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,         // VkStructureType              sType
+        nullptr,                                            // const void                 * pNext
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,    // VkCommandPoolCreateFlags     flags
+        queueFamilyIndex                                    // uint32_t                     queueFamilyIndex
+    };
+
+    VkResult result = vkCreateCommandPool(mLogicalDevice, &commandPoolCreateInfo, nullptr, &mCommandPool);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create the secondary command buffer pool." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SecondaryCommandCache::destroy()
+{
+    // Destroying the pool frees all of its command buffers
+    if(mCommandPool != VK_NULL_HANDLE)
+    {
+        vkDestroyCommandPool(mLogicalDevice, mCommandPool, nullptr);
+        mCommandPool = VK_NULL_HANDLE;
+    }
+    mEntries.clear();
+    mRetiredCommandBuffers.clear();
+    mFreeCommandBuffers.clear();
+    mFrame = 0;
+    mStats = {};
+}
+
+void SecondaryCommandCache::beginFrame()
+{
+    ++mFrame;
+    mStats.frameHits = 0;
+    mStats.frameMisses = 0;
+    mStats.frameRecordMs = 0.0;
+    mStats.frameSavedMs = 0.0;
+
+    // Entries of passes that stopped drawing, e.g. a pipeline that was replaced
+    auto entry = mEntries.begin();
+    while(entry != mEntries.end())
+    {
+        if(entry->second.lastUsedFrame + EVICTION_FRAMES <= mFrame)
+        {
+            retire(entry->second);
+            entry = mEntries.erase(entry);
+            ++mStats.evictions;
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    auto retired = mRetiredCommandBuffers.begin();
+    while(retired != mRetiredCommandBuffers.end())
+    {
+        if(retired->frame + mFramesInFlight <= mFrame)
+        {
+            mFreeCommandBuffers.push_back(retired->commandBuffer);
+            retired = mRetiredCommandBuffers.erase(retired);
+        }
+        else
+        {
+            ++retired;
+        }
+    }
+}
+
+bool SecondaryCommandCache::acquireCommandBuffer(VkCommandBuffer &commandBuffer)
+{
+    if(!mFreeCommandBuffers.empty())
+    {
+        commandBuffer = mFreeCommandBuffers.back();
+        mFreeCommandBuffers.pop_back();
+        return true;
+    }
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,     // VkStructureType          sType
+        nullptr,                                            // const void             * pNext
+        mCommandPool,                                       // VkCommandPool            commandPool
+        VK_COMMAND_BUFFER_LEVEL_SECONDARY,                  // VkCommandBufferLevel     level
+        1                                                   // uint32_t                 commandBufferCount
+    };
+
+    VkResult result = vkAllocateCommandBuffers(mLogicalDevice, &commandBufferAllocateInfo, &commandBuffer);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not allocate a secondary command buffer." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SecondaryCommandCache::retire(Entry const &entry)
+{
+    if(entry.commandBuffer != VK_NULL_HANDLE)
+    {
+        mRetiredCommandBuffers.push_back({ entry.commandBuffer, entry.lastUsedFrame });
+    }
+}
+
+bool SecondaryCommandCache::recordEntry(Entry &entry, SecondaryRenderingInfo const &renderingInfo,
+                                        std::function<void(VkCommandBuffer)> const &record)
+{
+    PROFILE_FUNCTION();
+
+    auto start = std::chrono::steady_clock::now();
+    if(!acquireCommandBuffer(entry.commandBuffer))
+    {
+        return false;
+    }
+
+    VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,    // VkStructureType          sType
+        nullptr,                                                        // const void             * pNext
+        renderingInfo.flags &                                           // VkRenderingFlags         flags
+        ~VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT,
+        0,                                                              // uint32_t                 viewMask
+        static_cast<uint32_t>(renderingInfo.colorFormats.size()),       // uint32_t                 colorAttachmentCount
+        renderingInfo.colorFormats.data(),                              // const VkFormat         * pColorAttachmentFormats
+        renderingInfo.depthFormat,                                      // VkFormat                 depthAttachmentFormat
+        renderingInfo.stencilFormat,                                    // VkFormat                 stencilAttachmentFormat
+        renderingInfo.samples                                           // VkSampleCountFlagBits    rasterizationSamples
+    };
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,  // VkStructureType                  sType
+        &inheritanceRenderingInfo,                          // const void                     * pNext
+        VK_NULL_HANDLE,                                     // VkRenderPass                     renderPass
+        0,                                                  // uint32_t                         subpass
+        VK_NULL_HANDLE,                                     // VkFramebuffer                    framebuffer
+        VK_FALSE,                                           // VkBool32                         occlusionQueryEnable
+        0,                                                  // VkQueryControlFlags              queryFlags
+        0                                                   // VkQueryPipelineStatisticFlags    pipelineStatistics
+    };
+
+    VkCommandBufferBeginInfo beginInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,        // VkStructureType                        sType
+        nullptr,                                            // const void                           * pNext
+        VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |  // VkCommandBufferUsageFlags              flags
+        VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+        &inheritanceInfo                                    // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+    };
+
+    if(vkBeginCommandBuffer(entry.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        std::cerr << "Could not begin a secondary command buffer." << std::endl;
+        mFreeCommandBuffers.push_back(entry.commandBuffer);
+        entry.commandBuffer = VK_NULL_HANDLE;
+        return false;
+    }
+    record(entry.commandBuffer);
+    if(vkEndCommandBuffer(entry.commandBuffer) != VK_SUCCESS)
+    {
+        std::cerr << "Could not end a secondary command buffer." << std::endl;
+        mFreeCommandBuffers.push_back(entry.commandBuffer);
+        entry.commandBuffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    entry.recordMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    mStats.frameRecordMs += entry.recordMs;
+    return true;
+}
+
+bool SecondaryCommandCache::execute(VkCommandBuffer primaryCommandBuffer, SecondaryCommandKey const &key,
+                                    SecondaryRenderingInfo const &renderingInfo, std::function<void(VkCommandBuffer)> const &record)
+{
+    uint64_t renderingHash = hashRenderingInfo(renderingInfo);
+    auto inserted = mEntries.emplace(hashEntrySlot(key), Entry());
+    Entry &entry = inserted.first->second;
+
+    bool valid = !inserted.second && entry.commandBuffer != VK_NULL_HANDLE && entry.key.pass == key.pass &&
+                 entry.key.pipeline == key.pipeline && entry.key.sceneVersion == key.sceneVersion &&
+                 entry.renderingHash == renderingHash;
+    if(valid)
+    {
+        ++mStats.frameHits;
+        ++mStats.totalHits;
+        mStats.frameSavedMs += entry.recordMs;
+        mStats.totalSavedMs += entry.recordMs;
+    }
+    else
+    {
+        // Frames in flight may still execute the stale recording
+        if(!inserted.second)
+        {
+            retire(entry);
+            ++mStats.invalidations;
+        }
+        entry.key = key;
+        entry.renderingHash = renderingHash;
+        entry.commandBuffer = VK_NULL_HANDLE;
+        entry.recordMs = 0.0;
+        ++mStats.frameMisses;
+        ++mStats.totalMisses;
+        if(!recordEntry(entry, renderingInfo, record))
+        {
+            mEntries.erase(inserted.first);
+            return false;
+        }
+    }
+
+    entry.lastUsedFrame = mFrame;
+    vkCmdExecuteCommands(primaryCommandBuffer, 1, &entry.commandBuffer);
+    return true;
+}
+
+void SecondaryCommandCache::invalidate(uint32_t pass)
+{
+    auto entry = mEntries.begin();
+    while(entry != mEntries.end())
+    {
+        if(pass == UINT32_MAX || entry->second.key.pass == pass)
+        {
+            retire(entry->second);
+            entry = mEntries.erase(entry);
+            ++mStats.invalidations;
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+}
+
+SecondaryCommandCacheStats SecondaryCommandCache::getStats() const
+{
+    SecondaryCommandCacheStats stats = mStats;
+    stats.entries = static_cast<uint32_t>(mEntries.size());
+    uint64_t lookups = stats.totalHits + stats.totalMisses;
+    stats.hitRate = lookups > 0 ? static_cast<float>(static_cast<double>(stats.totalHits) / lookups) : 0.0f;
+    return stats;
+}
+
+} // namespace VulkanSample
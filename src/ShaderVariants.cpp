@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include "Profiler.h"
+#include "ShaderVariants.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  // Families and keys fit into one exact lookup value, equal variants always collide
+  uint64_t getVariantHash(uint32_t familyIndex, ShaderFeatureKey key)
+  {
+    return (static_cast<uint64_t>(familyIndex) << 32) | key;
+  }
+
+  bool isUsageName(std::string const &name)
+  {
+    if(name.empty() || (name[0] == '#'))
+      return false;
+    return std::none_of(name.begin(), name.end(), [](char character) { return std::isspace(static_cast<unsigned char>(character)); });
+  }
+}
+
+ShaderVariantCache::ShaderVariantCache()
+{
+    mPipelineManager = nullptr;
+    mPrewarmCursor   = 0;
+    mStats           = {};
+}
+
+ShaderVariantCache::~ShaderVariantCache()
+{
+    destroy();
+}
+
+bool ShaderVariantCache::create(PipelineManager *pipelineManager)
+{
+    destroy();
+    mPipelineManager = pipelineManager;
+    return true;
+}
+
+void ShaderVariantCache::destroy()
+{
+    if(mPipelineManager == nullptr)
+        return;
+
+    mFamilies.clear();
+    mFamilyLookup.clear();
+    mVariants.clear();
+    mVariantLookup.clear();
+    mUsage.clear();
+    mPrewarmCursor   = 0;
+    mStats           = {};
+    mPipelineManager = nullptr;
+}
+
+bool ShaderVariantCache::registerFamily(ShaderFamilyInfo const &info, uint32_t &familyIndex)
+{
+    if(!isUsageName(info.name) || (mFamilyLookup.count(info.name) != 0))
+    {
+        std::cerr << "Shader family '" << info.name << "' needs a unique name without whitespace." << std::endl;
+        return false;
+    }
+    if(info.features.size() > MAX_FEATURES)
+    {
+        std::cerr << "Shader family '" << info.name << "' has more than " << MAX_FEATURES << " features." << std::endl;
+        return false;
+    }
+
+    Family family;
+    family.info = info;
+    family.featureMask = info.features.size() == MAX_FEATURES ? ~0u : (1u << info.features.size()) - 1;
+
+    std::vector<VkShaderStageFlagBits> stages;
+    for(auto &stage : info.state.preRasterizationStages)
+        stages.push_back(stage.stage);
+    stages.push_back(VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    for(VkShaderStageFlagBits stage : stages)
+    {
+        StageSpecialization specialization;
+        for(uint32_t feature = 0; feature < info.features.size(); ++feature)
+        {
+            ShaderFeature const &description = info.features[feature];
+            for(uint32_t other = 0; other < feature; ++other)
+            {
+                if(info.features[other].name == description.name)
+                {
+                    std::cerr << "Shader family '" << info.name << "' lists feature '" << description.name << "' twice." << std::endl;
+                    return false;
+                }
+            }
+            if(!isUsageName(description.name))
+            {
+                std::cerr << "Shader family '" << info.name << "' has a feature name with whitespace." << std::endl;
+                return false;
+            }
+            if(!(description.stages & stage))
+                continue;
+
+            VkSpecializationMapEntry mapEntry = {
+                description.constantId,                                               // uint32_t    constantID
+                static_cast<uint32_t>(specialization.mapEntries.size() * sizeof(VkBool32)), // uint32_t    offset
+                sizeof(VkBool32)                                                      // size_t      size
+            };
+            specialization.mapEntries.push_back(mapEntry);
+            specialization.features.push_back(feature);
+        }
+        family.stages.push_back(specialization);
+    }
+
+    familyIndex = static_cast<uint32_t>(mFamilies.size());
+    mFamilyLookup[info.name] = familyIndex;
+    mFamilies.push_back(std::move(family));
+    mStats.families = static_cast<uint32_t>(mFamilies.size());
+    return true;
+}
+
+bool ShaderVariantCache::findFamily(std::string const &name, uint32_t &familyIndex) const
+{
+    auto existing = mFamilyLookup.find(name);
+    if(existing == mFamilyLookup.end())
+        return false;
+    familyIndex = existing->second;
+    return true;
+}
+
+bool ShaderVariantCache::requestVariant(uint32_t familyIndex, ShaderFeatureKey key, uint32_t &pipelineIndex)
+{
+    ++mStats.requests;
+    key &= mFamilies[familyIndex].featureMask;
+
+    uint32_t variantIndex;
+    auto existing = mVariantLookup.find(getVariantHash(familyIndex, key));
+    if(existing != mVariantLookup.end())
+    {
+        variantIndex = existing->second;
+        ++mStats.cacheHits;
+    }
+    else if(!createVariant(familyIndex, key, variantIndex))
+        return false;
+
+    Variant &variant = mVariants[variantIndex];
+    variant.used = true;
+    pipelineIndex = variant.pipelineIndex;
+    return true;
+}
+
+bool ShaderVariantCache::createVariant(uint32_t familyIndex, ShaderFeatureKey key, uint32_t &variantIndex)
+{
+    Family const &family = mFamilies[familyIndex];
+
+    mVariants.emplace_back();
+    Variant &variant = mVariants.back();
+    variant.family        = familyIndex;
+    variant.key           = key;
+    variant.pipelineIndex = 0;
+    variant.used          = false;
+    variant.values.resize(family.stages.size());
+    variant.specializations.resize(family.stages.size());
+
+    GraphicsPipelineState state = family.info.state;
+    for(size_t stage = 0; stage < family.stages.size(); ++stage)
+    {
+        StageSpecialization const &specialization = family.stages[stage];
+        std::vector<VkBool32> &values = variant.values[stage];
+        for(uint32_t feature : specialization.features)
+            values.push_back((key >> feature) & 1 ? VK_TRUE : VK_FALSE);
+
+        variant.specializations[stage] = {
+            static_cast<uint32_t>(specialization.mapEntries.size()),  // uint32_t                           mapEntryCount
+            specialization.mapEntries.data(),                         // const VkSpecializationMapEntry   * pMapEntries
+            values.size() * sizeof(VkBool32),                         // size_t                             dataSize
+            values.data()                                             // const void                       * pData
+        };
+
+        // Stages without features stay unspecialized and keep matching the libraries of other variants
+        VkSpecializationInfo const *info = values.empty() ? nullptr : &variant.specializations[stage];
+        if(stage < state.preRasterizationStages.size())
+            state.preRasterizationStages[stage].pSpecializationInfo = info;
+        else
+            state.fragmentStage.pSpecializationInfo = info;
+    }
+
+    if(!mPipelineManager->requestPipeline(state, variant.pipelineIndex))
+    {
+        mVariants.pop_back();
+        return false;
+    }
+
+    variantIndex = static_cast<uint32_t>(mVariants.size() - 1);
+    mVariantLookup[getVariantHash(familyIndex, key)] = variantIndex;
+    mStats.variants = static_cast<uint32_t>(mVariants.size());
+    return true;
+}
+
+bool ShaderVariantCache::loadUsage(std::string const &filename)
+{
+    mUsage.clear();
+    mPrewarmCursor = 0;
+
+    std::ifstream file(filename);
+    if(file.fail())
+        return true;
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty() || (line[0] == '#'))
+            continue;
+
+        std::istringstream stream(line);
+        UsageEntry entry;
+        if(!(stream >> entry.runsSinceUse >> entry.family))
+        {
+            ++mStats.discardedUsageEntries;
+            continue;
+        }
+        std::string feature;
+        while(stream >> feature)
+            entry.features.push_back(feature);
+        std::sort(entry.features.begin(), entry.features.end());
+        mUsage.push_back(std::move(entry));
+    }
+
+    if(file.bad())
+    {
+        std::cerr << "Could not read '" << filename << "' file." << std::endl;
+        mUsage.clear();
+        return false;
+    }
+
+    // Variants used most recently are the most likely to be needed again, they go first
+    std::stable_sort(mUsage.begin(), mUsage.end(),
+                     [](UsageEntry const &left, UsageEntry const &right) { return left.runsSinceUse < right.runsSinceUse; });
+    return true;
+}
+
+bool ShaderVariantCache::prewarm(uint32_t maxVariants, uint32_t &remaining)
+{
+    PROFILE_FUNCTION();
+
+    uint32_t created = 0;
+    while((mPrewarmCursor < mUsage.size()) && (created < maxVariants))
+    {
+        UsageEntry const &entry = mUsage[mPrewarmCursor++];
+        uint32_t familyIndex;
+        ShaderFeatureKey key;
+        if(!resolveUsage(entry, familyIndex, key))
+        {
+            ++mStats.discardedUsageEntries;
+            continue;
+        }
+        if(mVariantLookup.count(getVariantHash(familyIndex, key)) != 0)
+            continue;
+
+        uint32_t variantIndex;
+        if(!createVariant(familyIndex, key, variantIndex))
+            return false;
+        ++created;
+        ++mStats.prewarmedVariants;
+    }
+
+    remaining = static_cast<uint32_t>(mUsage.size() - mPrewarmCursor);
+    return true;
+}
+
+bool ShaderVariantCache::resolveUsage(UsageEntry const &entry, uint32_t &familyIndex, ShaderFeatureKey &key) const
+{
+    if(!findFamily(entry.family, familyIndex))
+        return false;
+
+    std::vector<ShaderFeature> const &features = mFamilies[familyIndex].info.features;
+    key = 0;
+    for(auto &name : entry.features)
+    {
+        auto feature = std::find_if(features.begin(), features.end(),
+                                    [&name](ShaderFeature const &candidate) { return candidate.name == name; });
+        if(feature == features.end())
+            return false;
+        key |= 1u << static_cast<uint32_t>(feature - features.begin());
+    }
+    return true;
+}
+
+std::string ShaderVariantCache::getUsageLine(uint32_t familyIndex, ShaderFeatureKey key) const
+{
+    Family const &family = mFamilies[familyIndex];
+    std::vector<std::string> names;
+    for(uint32_t feature = 0; feature < family.info.features.size(); ++feature)
+    {
+        if((key >> feature) & 1)
+            names.push_back(family.info.features[feature].name);
+    }
+    std::sort(names.begin(), names.end());
+
+    std::string line = family.info.name;
+    for(auto &name : names)
+        line += " " + name;
+    return line;
+}
+
+bool ShaderVariantCache::saveUsage(std::string const &filename) const
+{
+    std::vector<std::string> used;
+    std::unordered_set<std::string> usedLines;
+    for(auto &variant : mVariants)
+    {
+        if(!variant.used)
+            continue;
+        std::string line = getUsageLine(variant.family, variant.key);
+        if(usedLines.insert(line).second)
+            used.push_back(line);
+    }
+
+    std::ofstream file(filename, std::ios::trunc);
+    file << "# Shader variants: runs since last use, family, enabled features" << std::endl;
+    for(auto &line : used)
+        file << 0 << " " << line << std::endl;
+
+    // Loaded entries this run did not use age by one run, families it never registered included
+    std::unordered_set<std::string> keptLines;
+    for(auto &entry : mUsage)
+    {
+        std::string line = entry.family;
+        for(auto &feature : entry.features)
+            line += " " + feature;
+        if((entry.runsSinceUse + 1 > USAGE_RETENTION_RUNS) || (usedLines.count(line) != 0) || !keptLines.insert(line).second)
+            continue;
+        file << entry.runsSinceUse + 1 << " " << line << std::endl;
+    }
+
+    if(file.fail())
+    {
+        std::cerr << "Could not write '" << filename << "' file." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ShaderVariantStats ShaderVariantCache::getStats() const
+{
+    return mStats;
+}
+
+std::vector<ShaderFeature> getMaterialFeatures()
+{
+    return {
+        { "lighting",           0, VK_SHADER_STAGE_FRAGMENT_BIT },
+        { "checker",            1, VK_SHADER_STAGE_FRAGMENT_BIT },
+        { "hemisphere_ambient", 2, VK_SHADER_STAGE_FRAGMENT_BIT },
+        { "height_fog",         3, VK_SHADER_STAGE_FRAGMENT_BIT }
+    };
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "StartupTimeline.h"
+
+namespace VulkanSample
+{
+
+StartupTimeline::StartupTimeline()
+{
+    mOrigin   = Clock::now();
+    mFinish   = mOrigin;
+    mFinished = false;
+}
+
+void StartupTimeline::record(std::string const &stage, Clock::time_point begin, Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::thread::id id = std::this_thread::get_id();
+    auto thread = std::find(mThreads.begin(), mThreads.end(), id);
+    if(thread == mThreads.end())
+        thread = mThreads.insert(mThreads.end(), id);
+
+    Stage record;
+    record.name     = stage;
+    record.thread   = static_cast<uint32_t>(thread - mThreads.begin());
+    record.begin    = toMilliseconds(begin - mOrigin);
+    record.duration = toMilliseconds(end - begin);
+    mStages.push_back(record);
+}
+
+void StartupTimeline::finish()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFinish   = Clock::now();
+    mFinished = true;
+}
+
+void StartupTimeline::print(std::ostream &stream) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<Stage> stages = mStages;
+    std::stable_sort(stages.begin(), stages.end(), [](Stage const &lhs, Stage const &rhs) { return lhs.begin < rhs.begin; });
+
+    std::ios::fmtflags flags = stream.flags();
+    std::streamsize precision = stream.precision();
+    stream << std::fixed << std::setprecision(2);
+
+    stream << "Start-up timeline (ms):" << std::endl;
+    stream << "  thread     start  duration  stage" << std::endl;
+    double serial = 0.0;
+    for(auto &stage : stages)
+    {
+        stream << "  " << std::setw(6) << stage.thread << std::setw(10) << stage.begin << std::setw(10) << stage.duration
+               << "  " << stage.name << std::endl;
+        serial += stage.duration;
+    }
+
+    if(mFinished)
+    {
+        double wall = toMilliseconds(mFinish - mOrigin);
+        stream << "Stages took " << serial << " ms in total, start-up finished after " << wall << " ms ("
+               << std::max(serial - wall, 0.0) << " ms saved by overlapping stages)" << std::endl;
+    }
+
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+double StartupTimeline::toMilliseconds(Clock::duration duration) const
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace VulkanSample
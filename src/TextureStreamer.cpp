@@ -0,0 +1,675 @@
+#include <algorithm>
+#include <cstring>
+
+#include "TextureStreamer.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  // Must match mip_downsample.comp
+  const uint32_t MAX_GENERATED_LEVELS = 13;
+  const uint32_t DOWNSAMPLE_TILE_SIZE = 64;
+
+  struct DownsampleConstants
+  {
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t srgb;
+  };
+
+  uint32_t getLevelExtent(uint32_t extent, uint32_t level)
+  {
+    return std::max(extent >> level, 1u);
+  }
+
+  uint32_t getFullMipChainLength(uint32_t width, uint32_t height)
+  {
+    uint32_t levels = 1;
+    for(uint32_t extent = std::max(width, height); extent > 1; extent >>= 1)
+      ++levels;
+    return levels;
+  }
+
+  void getLayoutScope(VkImageLayout layout, VkPipelineStageFlags2 &stages, VkAccessFlags2 &access)
+  {
+    switch(layout)
+    {
+      case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_2_COPY_BIT;
+        access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        break;
+      case VK_IMAGE_LAYOUT_GENERAL:
+        stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        break;
+      case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        break;
+      default:
+        stages = VK_PIPELINE_STAGE_2_NONE;
+        access = VK_ACCESS_2_NONE;
+        break;
+    }
+  }
+}
+
+TextureStreamer::TextureStreamer()
+{
+    mLogicalDevice            = VK_NULL_HANDLE;
+    mCapabilities             = {};
+    mFramesInFlight           = 0;
+    mFrame                    = 0;
+    mKernel                   = TranscodeKernel::Scalar;
+    mCompressedFormatFamily   = CompressedFormatFamily::None;
+    mMipGenerationSupported   = false;
+    mStagingBytesPerFrame     = 0;
+    mDownsampleLayoutIndex    = 0;
+    mDownsamplePipelineLayout = VK_NULL_HANDLE;
+    mDownsamplePipeline       = VK_NULL_HANDLE;
+    mCounterBuffer            = VK_NULL_HANDLE;
+    mCounterMemory            = VK_NULL_HANDLE;
+    mCounterInitialized       = false;
+    mStats                    = {};
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    destroy();
+}
+
+bool TextureStreamer::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight,
+                             VkDeviceSize stagingBytesPerFrame, VkPipelineCache pipelineCache)
+{
+    destroy();
+    mLogicalDevice        = logicalDevice;
+    mCapabilities         = capabilities;
+    mFramesInFlight       = framesInFlight;
+    mStagingBytesPerFrame = stagingBytesPerFrame;
+
+    if(!capabilities.timelineSynchronizationSupported)
+    {
+        std::cerr << "Texture streaming requires synchronization2." << std::endl;
+        return false;
+    }
+
+    mKernel = selectTranscodeKernel();
+
+    VkPhysicalDevice physicalDevice = capabilities.physicalDevice;
+    if(isFormatFeatureSupported(physicalDevice, VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        mCompressedFormatFamily = CompressedFormatFamily::BC;
+    else if(isFormatFeatureSupported(physicalDevice, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        mCompressedFormatFamily = CompressedFormatFamily::ASTC;
+    else if(isFormatFeatureSupported(physicalDevice, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        mCompressedFormatFamily = CompressedFormatFamily::ETC2;
+    else
+        mCompressedFormatFamily = CompressedFormatFamily::None;
+
+    if(!mStaging.create(mLogicalDevice, capabilities, stagingBytesPerFrame, framesInFlight, VK_BUFFER_USAGE_TRANSFER_SRC_BIT))
+    {
+        destroy();
+        return false;
+    }
+
+    // sRGB images are written through UNORM storage views
+    mMipGenerationSupported = isFormatFeatureSupported(physicalDevice, VK_FORMAT_R8G8B8A8_UNORM,
+                                                       VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+    if(mMipGenerationSupported && !createDownsamplePipeline(pipelineCache))
+    {
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+bool TextureStreamer::createDownsamplePipeline(VkPipelineCache pipelineCache)
+{
+    if(!mDescriptorBinder.create(mLogicalDevice, mCapabilities, mFramesInFlight))
+        return false;
+
+    std::vector<DescriptorBinding> bindings = {
+        { 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,  MAX_GENERATED_LEVELS, VK_SHADER_STAGE_COMPUTE_BIT },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,                    VK_SHADER_STAGE_COMPUTE_BIT }
+    };
+    if(!mDescriptorBinder.createLayout(bindings, true, mDownsampleLayoutIndex))
+        return false;
+    VkDescriptorSetLayout setLayout = mDescriptorBinder.getSetLayout(mDownsampleLayoutIndex);
+
+    VkPushConstantRange pushConstantRange = {
+        VK_SHADER_STAGE_COMPUTE_BIT,            // VkShaderStageFlags     stageFlags
+        0,                                      // uint32_t               offset
+        sizeof(DownsampleConstants)             // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+        nullptr,                                        // const void                     * pNext
+        0,                                              // VkPipelineLayoutCreateFlags      flags
+        1,                                              // uint32_t                         setLayoutCount
+        &setLayout,                                     // const VkDescriptorSetLayout    * pSetLayouts
+        1,                                              // uint32_t                         pushConstantRangeCount
+        &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    VkResult result = vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &mDownsamplePipelineLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create mip downsample pipeline layout." << std::endl;
+        return false;
+    }
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    bool created = createShaderModuleFromFile(mLogicalDevice, "mip_downsample.comp", shaderModule) &&
+                   createComputePipeline(mLogicalDevice, shaderModule, mDownsamplePipelineLayout, nullptr, pipelineCache,
+                                         mDownsamplePipeline);
+    destroyShaderModule(mLogicalDevice, shaderModule);
+    if(!created)
+        return false;
+
+    // Workgroups count themselves in this buffer, the last one resets it
+    return createBuffer(mLogicalDevice, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        mCounterBuffer) &&
+           allocateAndBindMemoryObjectToBuffer(mCapabilities.memoryProperties, mLogicalDevice, mCounterBuffer,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mCounterMemory);
+}
+
+void TextureStreamer::destroy()
+{
+    for(auto &texture : mTextures)
+    {
+        destroyImageView(mLogicalDevice, texture->view);
+        destroyImage(mLogicalDevice, texture->image);
+        freeMemoryObject(mLogicalDevice, texture->memory);
+    }
+    mTextures.clear();
+    for(auto &retired : mRetiredViews)
+        destroyImageView(mLogicalDevice, retired.view);
+    mRetiredViews.clear();
+
+    destroyPipeline(mLogicalDevice, mDownsamplePipeline);
+    destroyPipelineLayout(mLogicalDevice, mDownsamplePipelineLayout);
+    destroyBuffer(mLogicalDevice, mCounterBuffer);
+    freeMemoryObject(mLogicalDevice, mCounterMemory);
+    mDescriptorBinder.destroy();
+    mStaging.destroy();
+
+    mFrame                  = 0;
+    mMipGenerationSupported = false;
+    mCounterInitialized     = false;
+    mStats                  = {};
+}
+
+bool TextureStreamer::loadTexture(std::string const &filename, uint32_t &textureIndex)
+{
+    std::unique_ptr<Texture> texture(new Texture());
+    if(!texture->file.open(filename))
+        return false;
+
+    if(texture->file.isBasisUniversal() &&
+       !texture->file.setTranscodeTarget(selectBasisTarget(texture->file.hasAlpha()), mKernel))
+        return false;
+
+    VkFormat storedFormat = texture->file.getFormat();
+    if(!getFormatBlockInfo(storedFormat, texture->sourceBlock))
+    {
+        std::cerr << "'" << filename << "' uses a format the texture streamer does not upload." << std::endl;
+        return false;
+    }
+
+    VkFormat expandedFormat = getExpandedFormat(storedFormat);
+    texture->expand      = expandedFormat != VK_FORMAT_UNDEFINED;
+    texture->format      = texture->expand ? expandedFormat : storedFormat;
+    texture->uploadBlock = texture->expand ? FormatBlockInfo{ 1, 1, 4 } : texture->sourceBlock;
+    texture->width       = texture->file.getWidth();
+    texture->height      = texture->file.getHeight();
+
+    if(!isFormatFeatureSupported(mCapabilities.physicalDevice, texture->format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+    {
+        std::cerr << "The device cannot sample the format of '" << filename << "', build it for the "
+                  << getCompressedFormatFamilyName(mCompressedFormatFamily) << " format family." << std::endl;
+        return false;
+    }
+
+    uint32_t fullChainLength = getFullMipChainLength(texture->width, texture->height);
+    uint32_t storedLevels = texture->file.getLevelCount();
+    if(storedLevels > fullChainLength)
+    {
+        std::cerr << "'" << filename << "' stores more levels than its size allows." << std::endl;
+        return false;
+    }
+
+    bool generatable = texture->format == VK_FORMAT_R8G8B8A8_UNORM || texture->format == VK_FORMAT_R8G8B8A8_SRGB;
+    texture->generateMips = storedLevels == 1 && fullChainLength > 1 && mMipGenerationSupported && generatable;
+    texture->levelCount   = texture->generateMips ? std::min(fullChainLength, MAX_GENERATED_LEVELS) : storedLevels;
+
+    // At least one block row of level 0 has to fit into a frame's staging memory
+    if(getUploadRowSize(*texture, 0) > mStagingBytesPerFrame)
+    {
+        std::cerr << "'" << filename << "' is too wide for the texture streaming budget." << std::endl;
+        return false;
+    }
+
+    VkImageCreateFlags flags = 0;
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if(texture->generateMips)
+    {
+        usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        if(texture->format == VK_FORMAT_R8G8B8A8_SRGB)
+            flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+    }
+
+    VkImageCreateInfo imageCreateInfo = {
+        VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,              // VkStructureType          sType
+        nullptr,                                          // const void             * pNext
+        flags,                                            // VkImageCreateFlags       flags
+        VK_IMAGE_TYPE_2D,                                 // VkImageType              imageType
+        texture->format,                                  // VkFormat                 format
+        { texture->width, texture->height, 1 },           // VkExtent3D               extent
+        texture->levelCount,                              // uint32_t                 mipLevels
+        1,                                                // uint32_t                 arrayLayers
+        VK_SAMPLE_COUNT_1_BIT,                            // VkSampleCountFlagBits    samples
+        VK_IMAGE_TILING_OPTIMAL,                          // VkImageTiling            tiling
+        usage,                                            // VkImageUsageFlags        usage
+        VK_SHARING_MODE_EXCLUSIVE,                        // VkSharingMode            sharingMode
+        0,                                                // uint32_t                 queueFamilyIndexCount
+        nullptr,                                          // const uint32_t         * pQueueFamilyIndices
+        VK_IMAGE_LAYOUT_UNDEFINED                         // VkImageLayout            initialLayout
+    };
+
+    texture->image  = VK_NULL_HANDLE;
+    texture->memory = VK_NULL_HANDLE;
+    texture->view   = VK_NULL_HANDLE;
+    VkResult result = vkCreateImage(mLogicalDevice, &imageCreateInfo, nullptr, &texture->image);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create an image for '" << filename << "'." << std::endl;
+        return false;
+    }
+    if(!allocateAndBindMemoryObjectToImage(mCapabilities.memoryProperties, mLogicalDevice, texture->image,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture->memory))
+    {
+        destroyImage(mLogicalDevice, texture->image);
+        freeMemoryObject(mLogicalDevice, texture->memory);
+        return false;
+    }
+
+    texture->initialized   = false;
+    texture->residentLevel = texture->levelCount;
+    texture->uploadLevel   = texture->generateMips ? 0 : texture->levelCount - 1;
+    texture->uploadedRows  = 0;
+    texture->levelData     = nullptr;
+
+    textureIndex = static_cast<uint32_t>(mTextures.size());
+    mStats.pendingLevels += texture->generateMips ? 1 : texture->levelCount;
+    mTextures.push_back(std::move(texture));
+    mStats.textures = static_cast<uint32_t>(mTextures.size());
+    return true;
+}
+
+bool TextureStreamer::recordStreaming(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    ++mFrame;
+
+    // Storage views may be referenced by cached descriptor sets, which must not be handed out again
+    bool storageViewsRetired = false;
+    for(size_t index = 0; index < mRetiredViews.size();)
+    {
+        RetiredView &retired = mRetiredViews[index];
+        if(retired.frame + mFramesInFlight <= mFrame)
+        {
+            storageViewsRetired |= retired.storage;
+            destroyImageView(mLogicalDevice, retired.view);
+            retired = mRetiredViews.back();
+            mRetiredViews.pop_back();
+        }
+        else
+            ++index;
+    }
+    if(mMipGenerationSupported)
+    {
+        if(storageViewsRetired)
+            mDescriptorBinder.invalidate();
+        mDescriptorBinder.beginFrame();
+    }
+
+    mStaging.beginFrame(frameIndex);
+    VkDeviceSize budget = mStagingBytesPerFrame;
+    while(Texture *texture = selectUpload())
+    {
+        if(getUploadRowSize(*texture, texture->uploadLevel) > budget)
+            break;
+
+        if(!texture->initialized)
+        {
+            recordLevelTransition(commandBuffer, *texture, 0, texture->levelCount, VK_IMAGE_LAYOUT_UNDEFINED,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            texture->initialized = true;
+        }
+        if(!recordUpload(commandBuffer, *texture, budget))
+            return false;
+    }
+    return true;
+}
+
+TextureStreamer::Texture *TextureStreamer::selectUpload()
+{
+    // Coarse to fine across all textures: the smallest missing level goes first
+    Texture *selected = nullptr;
+    VkDeviceSize selectedSize = 0;
+    for(auto &texture : mTextures)
+    {
+        if(texture->residentLevel == 0)
+            continue;
+
+        uint32_t level = texture->uploadLevel;
+        VkDeviceSize size = getLevelByteSize(texture->uploadBlock, getLevelExtent(texture->width, level),
+                                             getLevelExtent(texture->height, level));
+        if(selected == nullptr || size < selectedSize)
+        {
+            selected = texture.get();
+            selectedSize = size;
+        }
+    }
+    return selected;
+}
+
+bool TextureStreamer::recordUpload(VkCommandBuffer commandBuffer, Texture &texture, VkDeviceSize &budget)
+{
+    uint32_t level = texture.uploadLevel;
+    uint32_t width = getLevelExtent(texture.width, level);
+    uint32_t height = getLevelExtent(texture.height, level);
+
+    if(texture.levelData == nullptr)
+    {
+        size_t size;
+        if(!texture.file.getLevelData(level, texture.levelScratch, texture.levelData, size))
+            return false;
+        if(size < getLevelByteSize(texture.sourceBlock, width, height))
+        {
+            std::cerr << "Level " << level << " of a texture is smaller than its extent requires." << std::endl;
+            texture.levelData = nullptr;
+            return false;
+        }
+    }
+
+    uint32_t blockHeight = texture.uploadBlock.height;
+    uint32_t totalRows = (height + blockHeight - 1) / blockHeight;
+    VkDeviceSize rowSize = getUploadRowSize(texture, level);
+    uint32_t rows = static_cast<uint32_t>(std::min<VkDeviceSize>(totalRows - texture.uploadedRows, budget / rowSize));
+
+    RingAllocation allocation;
+    if(!mStaging.allocate(rows * rowSize, allocation))
+    {
+        // Alignment padding used up the rest of this frame's staging memory
+        budget = 0;
+        return true;
+    }
+
+    size_t sourceRowSize = getLevelByteSize(texture.sourceBlock, width, 1);
+    uint8_t const *source = texture.levelData + texture.uploadedRows * sourceRowSize;
+    if(texture.expand)
+    {
+        expandRGB8ToRGBA8(mKernel, source, static_cast<uint8_t *>(allocation.data), static_cast<size_t>(rows) * width);
+        mStats.expandedBytes += rows * rowSize;
+    }
+    else
+        std::memcpy(allocation.data, source, rows * sourceRowSize);
+
+    uint32_t offsetY = texture.uploadedRows * blockHeight;
+    VkBufferImageCopy region = {
+        allocation.dynamicOffset,                             // VkDeviceSize                 bufferOffset
+        0,                                                    // uint32_t                     bufferRowLength
+        0,                                                    // uint32_t                     bufferImageHeight
+        {                                                     // VkImageSubresourceLayers     imageSubresource
+          VK_IMAGE_ASPECT_COLOR_BIT,                            // VkImageAspectFlags           aspectMask
+          level,                                                // uint32_t                     mipLevel
+          0,                                                    // uint32_t                     baseArrayLayer
+          1                                                     // uint32_t                     layerCount
+        },
+        { 0, static_cast<int32_t>(offsetY), 0 },              // VkOffset3D                   imageOffset
+        { width, std::min(rows * blockHeight, height - offsetY), 1 } // VkExtent3D             imageExtent
+    };
+    vkCmdCopyBufferToImage(commandBuffer, allocation.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    texture.uploadedRows += rows;
+    budget -= rows * rowSize;
+    mStats.uploadedBytes += rows * rowSize;
+
+    if(texture.uploadedRows < totalRows)
+        return true;
+    return finishLevel(commandBuffer, texture);
+}
+
+bool TextureStreamer::finishLevel(VkCommandBuffer commandBuffer, Texture &texture)
+{
+    uint32_t level = texture.uploadLevel;
+    std::vector<uint8_t>().swap(texture.levelScratch);
+    texture.levelData    = nullptr;
+    texture.uploadedRows = 0;
+    --mStats.pendingLevels;
+
+    if(texture.generateMips)
+        return recordMipGeneration(commandBuffer, texture);
+
+    recordLevelTransition(commandBuffer, texture, level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    VkImageView view;
+    if(!createImageView(mLogicalDevice, texture.image, texture.format, level, texture.levelCount - level, view))
+        return false;
+    retireView(texture.view, false);
+    texture.view          = view;
+    texture.residentLevel = level;
+
+    if(level > 0)
+        texture.uploadLevel = level - 1;
+    else
+        texture.file.close();
+    return true;
+}
+
+bool TextureStreamer::recordMipGeneration(VkCommandBuffer commandBuffer, Texture &texture)
+{
+    VkImageView levelViews[MAX_GENERATED_LEVELS] = {};
+    for(uint32_t level = 0; level < texture.levelCount; ++level)
+    {
+        if(!createImageView(mLogicalDevice, texture.image, VK_FORMAT_R8G8B8A8_UNORM, level, 1, levelViews[level]))
+        {
+            for(VkImageView &view : levelViews)
+                destroyImageView(mLogicalDevice, view);
+            return false;
+        }
+    }
+
+    // Unused array elements repeat the last level, the shader never touches them
+    DescriptorInfo descriptors[MAX_GENERATED_LEVELS + 1];
+    for(uint32_t level = 0; level < MAX_GENERATED_LEVELS; ++level)
+    {
+        VkImageView view = levelViews[std::min(level, texture.levelCount - 1)];
+        descriptors[level] = DescriptorInfo::fromImage(VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    descriptors[MAX_GENERATED_LEVELS] = DescriptorInfo::fromBuffer(mCounterBuffer, 0, sizeof(uint32_t));
+
+    if(!mCounterInitialized)
+    {
+        vkCmdFillBuffer(commandBuffer, mCounterBuffer, 0, sizeof(uint32_t), 0);
+        mCounterInitialized = true;
+    }
+
+    // Orders the counter after its fill and after the reset by the previous generation
+    VkMemoryBarrier2 counterBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,                                       // VkStructureType          sType
+        nullptr,                                                                  // const void             * pNext
+        VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,   // VkPipelineStageFlags2    srcStageMask
+        VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,    // VkAccessFlags2           srcAccessMask
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,                                   // VkPipelineStageFlags2    dstStageMask
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT // VkAccessFlags2          dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+        nullptr,                                // const void                     * pNext
+        0,                                      // VkDependencyFlags                dependencyFlags
+        1,                                      // uint32_t                         memoryBarrierCount
+        &counterBarrier,                        // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                      // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        0,                                      // uint32_t                         imageMemoryBarrierCount
+        nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    recordLevelTransition(commandBuffer, texture, 0, texture.levelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          VK_IMAGE_LAYOUT_GENERAL);
+
+    DownsampleConstants constants = {
+        texture.width,
+        texture.height,
+        texture.levelCount,
+        texture.format == VK_FORMAT_R8G8B8A8_SRGB ? 1u : 0u
+    };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mDownsamplePipeline);
+    if(!mDescriptorBinder.bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mDownsamplePipelineLayout, 0,
+                               mDownsampleLayoutIndex, descriptors))
+    {
+        for(VkImageView &view : levelViews)
+            destroyImageView(mLogicalDevice, view);
+        return false;
+    }
+    vkCmdPushConstants(commandBuffer, mDownsamplePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (texture.width + DOWNSAMPLE_TILE_SIZE - 1) / DOWNSAMPLE_TILE_SIZE,
+                  (texture.height + DOWNSAMPLE_TILE_SIZE - 1) / DOWNSAMPLE_TILE_SIZE, 1);
+
+    recordLevelTransition(commandBuffer, texture, 0, texture.levelCount, VK_IMAGE_LAYOUT_GENERAL,
+                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    for(uint32_t level = 0; level < texture.levelCount; ++level)
+        retireView(levelViews[level], true);
+
+    VkImageView view;
+    if(!createImageView(mLogicalDevice, texture.image, texture.format, 0, texture.levelCount, view))
+        return false;
+    retireView(texture.view, false);
+    texture.view          = view;
+    texture.residentLevel = 0;
+    texture.file.close();
+    ++mStats.generatedMipChains;
+    return true;
+}
+
+void TextureStreamer::recordLevelTransition(VkCommandBuffer commandBuffer, Texture const &texture, uint32_t baseLevel,
+                                            uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+    VkPipelineStageFlags2 srcStages, dstStages;
+    VkAccessFlags2 srcAccess, dstAccess;
+    getLayoutScope(oldLayout, srcStages, srcAccess);
+    getLayoutScope(newLayout, dstStages, dstAccess);
+
+    VkImageMemoryBarrier2 imageBarrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,   // VkStructureType            sType
+        nullptr,                                    // const void               * pNext
+        srcStages,                                  // VkPipelineStageFlags2      srcStageMask
+        srcAccess,                                  // VkAccessFlags2             srcAccessMask
+        dstStages,                                  // VkPipelineStageFlags2      dstStageMask
+        dstAccess,                                  // VkAccessFlags2             dstAccessMask
+        oldLayout,                                  // VkImageLayout              oldLayout
+        newLayout,                                  // VkImageLayout              newLayout
+        VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   dstQueueFamilyIndex
+        texture.image,                              // VkImage                    image
+        {                                           // VkImageSubresourceRange    subresourceRange
+          VK_IMAGE_ASPECT_COLOR_BIT,                  // VkImageAspectFlags         aspectMask
+          baseLevel,                                  // uint32_t                   baseMipLevel
+          levelCount,                                 // uint32_t                   levelCount
+          0,                                          // uint32_t                   baseArrayLayer
+          1                                           // uint32_t                   layerCount
+        }
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+        nullptr,                                // const void                     * pNext
+        0,                                      // VkDependencyFlags                dependencyFlags
+        0,                                      // uint32_t                         memoryBarrierCount
+        nullptr,                                // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                      // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        1,                                      // uint32_t                         imageMemoryBarrierCount
+        &imageBarrier                           // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void TextureStreamer::retireView(VkImageView view, bool storage)
+{
+    if(view != VK_NULL_HANDLE)
+        mRetiredViews.push_back({ view, mFrame, storage });
+}
+
+VkDeviceSize TextureStreamer::getUploadRowSize(Texture const &texture, uint32_t level) const
+{
+    // One row of blocks of the uploaded format
+    return getLevelByteSize(texture.uploadBlock, getLevelExtent(texture.width, level), 1);
+}
+
+VkImageView TextureStreamer::getImageView(uint32_t textureIndex) const
+{
+    return mTextures[textureIndex]->view;
+}
+
+uint32_t TextureStreamer::getResidentMipLevel(uint32_t textureIndex) const
+{
+    return mTextures[textureIndex]->residentLevel;
+}
+
+// ETC1S data goes to the family the device samples best. ASTC output is opaque only, images with
+// alpha take ETC2 where the device has it
+BasisTarget TextureStreamer::selectBasisTarget(bool alpha) const
+{
+    switch(mCompressedFormatFamily)
+    {
+        case CompressedFormatFamily::BC:
+            return BasisTarget::BC7;
+        case CompressedFormatFamily::ASTC:
+            if(!alpha)
+                return BasisTarget::ASTC;
+            if(isFormatFeatureSupported(mCapabilities.physicalDevice, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK,
+                                        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+                return BasisTarget::ETC2;
+            return BasisTarget::RGBA8;
+        case CompressedFormatFamily::ETC2:
+            return BasisTarget::ETC2;
+        default:
+            return BasisTarget::RGBA8;
+    }
+}
+
+CompressedFormatFamily TextureStreamer::getCompressedFormatFamily() const
+{
+    return mCompressedFormatFamily;
+}
+
+char const *TextureStreamer::getCompressedFormatFamilyName(CompressedFormatFamily family)
+{
+    switch(family)
+    {
+        case CompressedFormatFamily::BC:
+            return "BC";
+        case CompressedFormatFamily::ASTC:
+            return "ASTC";
+        case CompressedFormatFamily::ETC2:
+            return "ETC2";
+        default:
+            return "uncompressed";
+    }
+}
+
+TextureStreamerStats const &TextureStreamer::getStats() const
+{
+    return mStats;
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,422 @@
+#include <cstring>
+
+#include "TextureTranscoding.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRANSCODE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TRANSCODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(TRANSCODE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define TARGET_SSSE3
+#endif
+
+namespace VulkanSample
+{
+
+namespace
+{
+  void expandTail(uint8_t const *source, uint8_t *destination, size_t begin, size_t end)
+  {
+    for(size_t pixel = begin; pixel < end; ++pixel)
+    {
+      destination[pixel * 4 + 0] = source[pixel * 3 + 0];
+      destination[pixel * 4 + 1] = source[pixel * 3 + 1];
+      destination[pixel * 4 + 2] = source[pixel * 3 + 2];
+      destination[pixel * 4 + 3] = 255;
+    }
+  }
+
+  void decodeSelectorBlockScalar(uint8_t const *palette, uint8_t const *selectors, uint8_t const *alphaPalette,
+                                 uint8_t const *alphaSelectors, uint8_t *destination, size_t rowPitch)
+  {
+    for(uint32_t y = 0; y < 4; ++y)
+    {
+      uint8_t *row = destination + y * rowPitch;
+      for(uint32_t x = 0; x < 4; ++x)
+      {
+        uint32_t texel = y * 4 + x;
+        std::memcpy(row + x * 4, palette + selectors[texel] * 4, 4);
+        if(alphaPalette != nullptr)
+          row[x * 4 + 3] = alphaPalette[alphaSelectors[texel] * 4 + 1];
+      }
+    }
+  }
+
+  uint64_t packEacSelectorsScalar(uint8_t const *remap, uint8_t const *selectors)
+  {
+    uint64_t packed = 0;
+    for(uint32_t x = 0; x < 4; ++x)
+    {
+      for(uint32_t y = 0; y < 4; ++y)
+        packed = (packed << 3) | remap[selectors[y * 4 + x]];
+    }
+    return packed;
+  }
+
+  uint64_t combineEacQuads(uint32_t const *quads)
+  {
+    return (static_cast<uint64_t>(quads[0]) << 36) | (static_cast<uint64_t>(quads[1]) << 24) |
+           (static_cast<uint64_t>(quads[2]) << 12) | quads[3];
+  }
+
+#ifdef TRANSCODE_X86
+  // 16 pixels per iteration: three 16-byte loads are realigned so every register starts at a
+  // pixel boundary, then one shuffle spreads four RGB triples into four RGBA texels
+  TARGET_SSSE3
+  void expandSSSE3(uint8_t const *source, uint8_t *destination, size_t pixelCount)
+  {
+    __m128i const shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i const alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    size_t pixel = 0;
+    for(; pixel + 16 <= pixelCount; pixel += 16)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + pixel * 3));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + pixel * 3 + 16));
+      __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + pixel * 3 + 32));
+
+      __m128i pixels0 = a;
+      __m128i pixels1 = _mm_alignr_epi8(b, a, 12);
+      __m128i pixels2 = _mm_alignr_epi8(c, b, 8);
+      __m128i pixels3 = _mm_srli_si128(c, 4);
+
+      __m128i *output = reinterpret_cast<__m128i*>(destination + pixel * 4);
+      _mm_storeu_si128(output + 0, _mm_or_si128(_mm_shuffle_epi8(pixels0, shuffle), alpha));
+      _mm_storeu_si128(output + 1, _mm_or_si128(_mm_shuffle_epi8(pixels1, shuffle), alpha));
+      _mm_storeu_si128(output + 2, _mm_or_si128(_mm_shuffle_epi8(pixels2, shuffle), alpha));
+      _mm_storeu_si128(output + 3, _mm_or_si128(_mm_shuffle_epi8(pixels3, shuffle), alpha));
+    }
+    expandTail(source, destination, pixel, pixelCount);
+  }
+
+  // One shuffle gathers the palette offsets of a row's texels, a second one their colors; alpha
+  // values are looked up for all 16 texels at once and shuffled into every fourth byte
+  TARGET_SSSE3
+  void decodeSelectorBlockSSSE3(uint8_t const *palette, uint8_t const *selectors, uint8_t const *alphaPalette,
+                                uint8_t const *alphaSelectors, uint8_t *destination, size_t rowPitch)
+  {
+    __m128i const channels = _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+    __m128i const texelSpread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+
+    // Selectors are at most 3, shifting 16-bit lanes keeps them inside their bytes
+    __m128i colors = _mm_loadu_si128(reinterpret_cast<__m128i const*>(palette));
+    __m128i offsets = _mm_slli_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(selectors)), 2);
+    __m128i alpha = _mm_setzero_si128();
+    __m128i colorMask = _mm_set1_epi32(-1);
+    if(alphaPalette != nullptr)
+    {
+      __m128i alphaOffsets = _mm_slli_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(alphaSelectors)), 2);
+      alpha = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(alphaPalette)),
+                               _mm_add_epi8(alphaOffsets, _mm_set1_epi8(1)));
+      colorMask = _mm_set1_epi32(0x00FFFFFF);
+    }
+
+    for(int y = 0; y < 4; ++y)
+    {
+      __m128i spread = _mm_add_epi8(texelSpread, _mm_set1_epi8(static_cast<char>(y * 4)));
+      __m128i texels = _mm_shuffle_epi8(colors, _mm_add_epi8(_mm_shuffle_epi8(offsets, spread), channels));
+      __m128i place = _mm_or_si128(_mm_and_si128(spread, _mm_set1_epi32(static_cast<int>(0xFF000000u))),
+                                   _mm_set1_epi32(0x00808080));
+      texels = _mm_or_si128(_mm_and_si128(texels, colorMask), _mm_shuffle_epi8(alpha, place));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + y * rowPitch), texels);
+    }
+  }
+
+  // Indices are merged pairwise by multiply-adds, 6 bits per pair and 12 per column
+  TARGET_SSSE3
+  uint64_t packEacSelectorsSSSE3(uint8_t const *remap, uint8_t const *selectors)
+  {
+    int remapWord;
+    std::memcpy(&remapWord, remap, sizeof(remapWord));
+
+    __m128i columns = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(selectors)),
+                                       _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    __m128i indices = _mm_shuffle_epi8(_mm_cvtsi32_si128(remapWord), columns);
+    __m128i pairs = _mm_maddubs_epi16(indices, _mm_set1_epi16(0x0108));
+    __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010040));
+
+    uint32_t values[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values), quads);
+    return combineEacQuads(values);
+  }
+
+  bool isSSSE3Supported()
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("ssse3");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return false;
+#endif
+  }
+#endif // TRANSCODE_X86
+
+#ifdef TRANSCODE_NEON
+  const uint8_t TEXEL_SPREAD[16]  = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 };
+  const uint8_t COLUMN_ORDER[16]  = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+  const int8_t  PAIR_SHIFTS[16]   = { 3, 0, 3, 0, 3, 0, 3, 0, 3, 0, 3, 0, 3, 0, 3, 0 };
+  const int16_t COLUMN_SHIFTS[8]  = { 6, 0, 6, 0, 6, 0, 6, 0 };
+
+  // 16-byte table lookup that also builds for 32-bit ARM, indices past the table give 0
+  uint8x16_t lookup16(uint8x16_t table, uint8x16_t indices)
+  {
+    uint8x8x2_t halves = { { vget_low_u8(table), vget_high_u8(table) } };
+    return vcombine_u8(vtbl2_u8(halves, vget_low_u8(indices)), vtbl2_u8(halves, vget_high_u8(indices)));
+  }
+  void expandNEON(uint8_t const *source, uint8_t *destination, size_t pixelCount)
+  {
+    size_t pixel = 0;
+    for(; pixel + 16 <= pixelCount; pixel += 16)
+    {
+      uint8x16x3_t rgb = vld3q_u8(source + pixel * 3);
+      uint8x16x4_t rgba;
+      rgba.val[0] = rgb.val[0];
+      rgba.val[1] = rgb.val[1];
+      rgba.val[2] = rgb.val[2];
+      rgba.val[3] = vdupq_n_u8(255);
+      vst4q_u8(destination + pixel * 4, rgba);
+    }
+    expandTail(source, destination, pixel, pixelCount);
+  }
+
+  void decodeSelectorBlockNEON(uint8_t const *palette, uint8_t const *selectors, uint8_t const *alphaPalette,
+                               uint8_t const *alphaSelectors, uint8_t *destination, size_t rowPitch)
+  {
+    uint8x16_t const channels = vreinterpretq_u8_u32(vdupq_n_u32(0x03020100));
+    uint8x16_t const alphaLanes = vreinterpretq_u8_u32(vdupq_n_u32(0x00FFFFFF));
+
+    uint8x16_t colors = vld1q_u8(palette);
+    uint8x16_t offsets = vshlq_n_u8(vld1q_u8(selectors), 2);
+    uint8x16_t alpha = vdupq_n_u8(0);
+    uint8x16_t colorMask = vdupq_n_u8(255);
+    if(alphaPalette != nullptr)
+    {
+      uint8x16_t alphaOffsets = vaddq_u8(vshlq_n_u8(vld1q_u8(alphaSelectors), 2), vdupq_n_u8(1));
+      alpha = lookup16(vld1q_u8(alphaPalette), alphaOffsets);
+      colorMask = alphaLanes;
+    }
+
+    for(int y = 0; y < 4; ++y)
+    {
+      uint8x16_t spread = vaddq_u8(vld1q_u8(TEXEL_SPREAD), vdupq_n_u8(static_cast<uint8_t>(y * 4)));
+      uint8x16_t texels = lookup16(colors, vaddq_u8(lookup16(offsets, spread), channels));
+      texels = vorrq_u8(vandq_u8(texels, colorMask), lookup16(alpha, vorrq_u8(spread, alphaLanes)));
+      vst1q_u8(destination + y * rowPitch, texels);
+    }
+  }
+
+  uint64_t packEacSelectorsNEON(uint8_t const *remap, uint8_t const *selectors)
+  {
+    uint32_t remapWord;
+    std::memcpy(&remapWord, remap, sizeof(remapWord));
+
+    uint8x16_t columns = lookup16(vld1q_u8(selectors), vld1q_u8(COLUMN_ORDER));
+    uint8x16_t indices = lookup16(vreinterpretq_u8_u32(vsetq_lane_u32(remapWord, vdupq_n_u32(0), 0)), columns);
+    uint16x8_t pairs = vpaddlq_u8(vshlq_u8(indices, vld1q_s8(PAIR_SHIFTS)));
+    uint32x4_t quads = vpaddlq_u16(vshlq_u16(pairs, vld1q_s16(COLUMN_SHIFTS)));
+
+    uint32_t values[4];
+    vst1q_u32(values, quads);
+    return combineEacQuads(values);
+  }
+#endif // TRANSCODE_NEON
+}
+
+bool getFormatBlockInfo(VkFormat format, FormatBlockInfo &blockInfo)
+{
+  switch(format)
+  {
+    case VK_FORMAT_R8_UNORM:
+      blockInfo = { 1, 1, 1 };
+      return true;
+    case VK_FORMAT_R8G8_UNORM:
+      blockInfo = { 1, 1, 2 };
+      return true;
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_R8G8B8_SRGB:
+    case VK_FORMAT_B8G8R8_UNORM:
+    case VK_FORMAT_B8G8R8_SRGB:
+      blockInfo = { 1, 1, 3 };
+      return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      blockInfo = { 1, 1, 4 };
+      return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+      blockInfo = { 1, 1, 8 };
+      return true;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+      blockInfo = { 4, 4, 8 };
+      return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+      blockInfo = { 4, 4, 16 };
+      return true;
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+      blockInfo = { 6, 6, 16 };
+      return true;
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+      blockInfo = { 8, 8, 16 };
+      return true;
+    default:
+      return false;
+  }
+}
+
+size_t getLevelByteSize(FormatBlockInfo const &blockInfo, uint32_t width, uint32_t height)
+{
+  size_t blocksWide = (width + blockInfo.width - 1) / blockInfo.width;
+  size_t blocksHigh = (height + blockInfo.height - 1) / blockInfo.height;
+  return blocksWide * blocksHigh * blockInfo.bytes;
+}
+
+VkFormat getExpandedFormat(VkFormat format)
+{
+  switch(format)
+  {
+    case VK_FORMAT_R8G8B8_UNORM:
+      return VK_FORMAT_R8G8B8A8_UNORM;
+    case VK_FORMAT_R8G8B8_SRGB:
+      return VK_FORMAT_R8G8B8A8_SRGB;
+    case VK_FORMAT_B8G8R8_UNORM:
+      return VK_FORMAT_B8G8R8A8_UNORM;
+    case VK_FORMAT_B8G8R8_SRGB:
+      return VK_FORMAT_B8G8R8A8_SRGB;
+    default:
+      return VK_FORMAT_UNDEFINED;
+  }
+}
+
+TranscodeKernel selectTranscodeKernel()
+{
+#ifdef TRANSCODE_X86
+  if(isSSSE3Supported())
+    return TranscodeKernel::SSSE3;
+  return TranscodeKernel::Scalar;
+#elif defined TRANSCODE_NEON
+  return TranscodeKernel::NEON;
+#else
+  return TranscodeKernel::Scalar;
+#endif
+}
+
+char const *getTranscodeKernelName(TranscodeKernel kernel)
+{
+  switch(kernel)
+  {
+    case TranscodeKernel::SSSE3:
+      return "SSSE3";
+    case TranscodeKernel::NEON:
+      return "NEON";
+    default:
+      return "Scalar";
+  }
+}
+
+void expandRGB8ToRGBA8(TranscodeKernel kernel, uint8_t const *source, uint8_t *destination, size_t pixelCount)
+{
+  switch(kernel)
+  {
+#ifdef TRANSCODE_X86
+    case TranscodeKernel::SSSE3:
+      if(isSSSE3Supported())
+      {
+        expandSSSE3(source, destination, pixelCount);
+        return;
+      }
+      break;
+#endif
+#ifdef TRANSCODE_NEON
+    case TranscodeKernel::NEON:
+      expandNEON(source, destination, pixelCount);
+      return;
+#endif
+    default:
+      break;
+  }
+  expandTail(source, destination, 0, pixelCount);
+}
+
+void decodeSelectorBlock(TranscodeKernel kernel, uint8_t const *palette, uint8_t const *selectors,
+                         uint8_t const *alphaPalette, uint8_t const *alphaSelectors, uint8_t *destination,
+                         size_t rowPitch)
+{
+  switch(kernel)
+  {
+#ifdef TRANSCODE_X86
+    case TranscodeKernel::SSSE3:
+      if(isSSSE3Supported())
+      {
+        decodeSelectorBlockSSSE3(palette, selectors, alphaPalette, alphaSelectors, destination, rowPitch);
+        return;
+      }
+      break;
+#endif
+#ifdef TRANSCODE_NEON
+    case TranscodeKernel::NEON:
+      decodeSelectorBlockNEON(palette, selectors, alphaPalette, alphaSelectors, destination, rowPitch);
+      return;
+#endif
+    default:
+      break;
+  }
+  decodeSelectorBlockScalar(palette, selectors, alphaPalette, alphaSelectors, destination, rowPitch);
+}
+
+uint64_t packEacSelectors(TranscodeKernel kernel, uint8_t const *remap, uint8_t const *selectors)
+{
+  switch(kernel)
+  {
+#ifdef TRANSCODE_X86
+    case TranscodeKernel::SSSE3:
+      if(isSSSE3Supported())
+        return packEacSelectorsSSSE3(remap, selectors);
+      break;
+#endif
+#ifdef TRANSCODE_NEON
+    case TranscodeKernel::NEON:
+      return packEacSelectorsNEON(remap, selectors);
+#endif
+    default:
+      break;
+  }
+  return packEacSelectorsScalar(remap, selectors);
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  struct ParallelForState
+  {
+    std::function<void(uint32_t, uint32_t)> const *body;
+    uint32_t                                       count;
+    uint32_t                                       grainSize;
+    uint32_t                                       chunkCount;
+    std::atomic<uint32_t>                          nextChunk;
+    std::atomic<uint32_t>                          finishedChunks;
+    std::mutex                                     mutex;
+    std::condition_variable                        finished;
+  };
+
+  void runChunks(ParallelForState &state)
+  {
+    uint32_t chunk;
+    while((chunk = state.nextChunk.fetch_add(1)) < state.chunkCount)
+    {
+      uint32_t begin = chunk * state.grainSize;
+      uint32_t end = std::min(begin + state.grainSize, state.count);
+      {
+        PROFILE_ZONE("parallelFor chunk");
+        (*state.body)(begin, end);
+      }
+
+      if(state.finishedChunks.fetch_add(1) + 1 == state.chunkCount)
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.finished.notify_all();
+      }
+    }
+  }
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    mStopping = false;
+
+    if(threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for(uint32_t i = 0; i < threadCount; ++i)
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+
+    for(auto &worker : mWorkers)
+        worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mCondition.notify_one();
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t, uint32_t)> const &body)
+{
+    if(count == 0)
+        return;
+
+    grainSize = std::max(grainSize, 1u);
+    uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+    if(chunkCount == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->body = &body;
+    state->count = count;
+    state->grainSize = grainSize;
+    state->chunkCount = chunkCount;
+    state->nextChunk = 0;
+    state->finishedChunks = 0;
+
+    // Helpers that start after all chunks were taken exit without touching body
+    uint32_t helpers = std::min(chunkCount - 1, getThreadCount());
+    for(uint32_t i = 0; i < helpers; ++i)
+        submit([state]() { runChunks(*state); });
+
+    runChunks(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->finishedChunks.load() == state->chunkCount; });
+}
+
+uint32_t ThreadPool::getThreadCount() const
+{
+    return static_cast<uint32_t>(mWorkers.size());
+}
+
+void ThreadPool::workerLoop()
+{
+    PROFILE_THREAD_NAME("Worker");
+
+    for(;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            if(mStopping && mTasks.empty())
+                return;
+
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,1261 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "ThreadPool.h"
+#include "VirtualTexture.h"
+#include "VulkanResources.h"
+
+namespace VulkanSample
+{
+
+namespace
+{
+  const uint32_t TEXEL_BYTES            = 4;
+  const uint32_t SLOT_SIZE              = VirtualTexture::PAGE_SIZE + 2 * VirtualTexture::PAGE_BORDER;
+  const uint32_t FEEDBACK_JITTER_PERIOD = 16;     // pixels of a 4x4 block
+
+  // Must match virtual_texture.frag
+  const uint32_t ENTRY_VALID = 0x80000000u;
+
+  struct PageTableHeader
+  {
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t sparse;
+    uint32_t slotsPerRow;
+    uint32_t feedbackJitter;
+    uint32_t padding[2];
+    uint32_t levelFirstPage[VirtualTexture::MAX_LEVELS];
+    uint32_t levelPagesX[VirtualTexture::MAX_LEVELS];
+  };
+
+  uint32_t getLevelExtent(uint32_t extent, uint32_t level)
+  {
+    return std::max(extent >> level, 1u);
+  }
+
+  uint32_t wrapCoordinate(int32_t coordinate, uint32_t extent)
+  {
+    int32_t wrapped = coordinate % static_cast<int32_t>(extent);
+    return static_cast<uint32_t>(wrapped < 0 ? wrapped + static_cast<int32_t>(extent) : wrapped);
+  }
+
+  // Copies count texels of a row starting at x, wrapping around its ends like the REPEAT address mode
+  void copyWrappedRow(uint8_t const *row, uint32_t width, int32_t x, uint32_t count, uint8_t *destination)
+  {
+    while(count > 0)
+    {
+      uint32_t start = wrapCoordinate(x, width);
+      uint32_t span = std::min(count, width - start);
+      std::memcpy(destination, row + start * TEXEL_BYTES, span * TEXEL_BYTES);
+      destination += span * TEXEL_BYTES;
+      x += static_cast<int32_t>(span);
+      count -= span;
+    }
+  }
+
+  void getLayoutScope(VkImageLayout layout, VkPipelineStageFlags2 &stages, VkAccessFlags2 &access)
+  {
+    switch(layout)
+    {
+      case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_2_COPY_BIT;
+        access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        break;
+      case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        break;
+      default:
+        stages = VK_PIPELINE_STAGE_2_NONE;
+        access = VK_ACCESS_2_NONE;
+        break;
+    }
+  }
+
+  void recordMemoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess,
+                           VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess)
+  {
+    VkMemoryBarrier2 memoryBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,     // VkStructureType          sType
+      nullptr,                                // const void             * pNext
+      srcStages,                              // VkPipelineStageFlags2    srcStageMask
+      srcAccess,                              // VkAccessFlags2           srcAccessMask
+      dstStages,                              // VkPipelineStageFlags2    dstStageMask
+      dstAccess                               // VkAccessFlags2           dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+      VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+      nullptr,                                // const void                     * pNext
+      0,                                      // VkDependencyFlags                dependencyFlags
+      1,                                      // uint32_t                         memoryBarrierCount
+      &memoryBarrier,                         // const VkMemoryBarrier2         * pMemoryBarriers
+      0,                                      // uint32_t                         bufferMemoryBarrierCount
+      nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+      0,                                      // uint32_t                         imageMemoryBarrierCount
+      nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+  }
+
+  bool allocateMemory(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice, VkDeviceSize size,
+                      uint32_t memoryTypeBits, VkDeviceMemory &memoryObject)
+  {
+    uint32_t memoryTypeIndex;
+    if(!selectMemoryType(memoryProperties, memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryTypeIndex))
+      return false;
+
+    VkMemoryAllocateInfo memoryAllocateInfo = {
+      VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,   // VkStructureType    sType
+      nullptr,                                  // const void       * pNext
+      size,                                     // VkDeviceSize       allocationSize
+      memoryTypeIndex                           // uint32_t           memoryTypeIndex
+    };
+
+    VkResult result = vkAllocateMemory(logicalDevice, &memoryAllocateInfo, nullptr, &memoryObject);
+    if(result != VK_SUCCESS)
+    {
+      std::cerr << "Could not allocate virtual texture page memory." << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
+
+VirtualTexture::VirtualTexture()
+{
+    mLogicalDevice     = VK_NULL_HANDLE;
+    mParameters        = {};
+    mFramesInFlight    = 0;
+    mIoThreads         = nullptr;
+    mWidth             = 0;
+    mHeight            = 0;
+    mSparse            = false;
+    mMipTailFirstLevel = 0;
+    mPinnedLevel       = 0;
+    mFrame             = 0;
+    mFrameIndex        = 0;
+    mImage             = VK_NULL_HANDLE;
+    mImageLevelCount   = 0;
+    mImageMemory       = VK_NULL_HANDLE;
+    mMipTailMemory     = VK_NULL_HANDLE;
+    mSparsePageBytes   = 0;
+    mMipTailBind       = {};
+    mMipTailBound      = false;
+    mImageView         = VK_NULL_HANDLE;
+    mSampler           = VK_NULL_HANDLE;
+    mImageInitialized  = false;
+    mSlotsPerRow       = 0;
+    mLruHead           = NO_SLOT;
+    mLruTail           = NO_SLOT;
+    mStagingBuffer     = VK_NULL_HANDLE;
+    mStagingMemory     = VK_NULL_HANDLE;
+    mStagingData       = nullptr;
+    mStagingSlotBytes  = 0;
+    mTailStagingOffset = 0;
+    mPendingLoads      = 0;
+    mPageTableVersion  = 0;
+    mPageTableDirty    = false;
+    mFeedbackBuffer    = VK_NULL_HANDLE;
+    mFeedbackMemory    = VK_NULL_HANDLE;
+    mFeedbackBytes     = 0;
+    mDescriptorSetLayout = VK_NULL_HANDLE;
+    mDescriptorPool    = VK_NULL_HANDLE;
+    mStats             = {};
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    destroy();
+}
+
+bool VirtualTexture::isSupported(DeviceCapabilities const &capabilities)
+{
+    return capabilities.timelineSynchronizationSupported && capabilities.fragmentStoresAndAtomicsSupported;
+}
+
+VirtualTextureParameters VirtualTexture::getDefaultParameters()
+{
+    VirtualTextureParameters parameters;
+    parameters.cachePages         = 1024;     // 64 MiB of sparse pages, a 4352x4352 page cache
+    parameters.maxUploadsPerFrame = 32;
+    parameters.maxPendingLoads    = 128;
+    parameters.forcePageCache     = false;
+    return parameters;
+}
+
+bool VirtualTexture::create(VkDevice logicalDevice, DeviceCapabilities const &capabilities, uint32_t framesInFlight,
+                            std::string const &filename, VirtualTextureParameters const &parameters, ThreadPool *ioThreads)
+{
+    destroy();
+    mLogicalDevice  = logicalDevice;
+    mParameters     = parameters;
+    mFramesInFlight = framesInFlight;
+    mIoThreads      = ioThreads;
+
+    if(!isSupported(capabilities))
+    {
+        std::cerr << "Virtual texturing requires fragmentStoresAndAtomics and synchronization2." << std::endl;
+        destroy();
+        return false;
+    }
+    if((parameters.cachePages == 0) || (parameters.maxUploadsPerFrame == 0) || (parameters.maxPendingLoads == 0))
+    {
+        std::cerr << "Virtual texture parameters must not be zero." << std::endl;
+        destroy();
+        return false;
+    }
+
+    if(!mFile.open(filename))
+    {
+        destroy();
+        return false;
+    }
+    VkFormat format = mFile.getFormat();
+    if((format != VK_FORMAT_R8G8B8A8_UNORM) && (format != VK_FORMAT_R8G8B8A8_SRGB))
+    {
+        std::cerr << "'" << filename << "' must be stored as RGBA8 for virtual texturing." << std::endl;
+        destroy();
+        return false;
+    }
+
+    mWidth = mFile.getWidth();
+    mHeight = mFile.getHeight();
+    uint32_t levelCount = mFile.getLevelCount();
+    uint32_t fullChainLength = 1;
+    for(uint32_t extent = std::max(mWidth, mHeight); extent > 1; extent >>= 1)
+        ++fullChainLength;
+    if((levelCount > fullChainLength) || (levelCount > MAX_LEVELS))
+    {
+        std::cerr << "'" << filename << "' stores more levels than virtual texturing handles." << std::endl;
+        destroy();
+        return false;
+    }
+
+    uint32_t pageCount = 0;
+    for(uint32_t level = 0; level < levelCount; ++level)
+    {
+        Level info;
+        info.width     = getLevelExtent(mWidth, level);
+        info.height    = getLevelExtent(mHeight, level);
+        info.pagesX    = (info.width + PAGE_SIZE - 1) / PAGE_SIZE;
+        info.pagesY    = (info.height + PAGE_SIZE - 1) / PAGE_SIZE;
+        info.firstPage = pageCount;
+        pageCount += info.pagesX * info.pagesY;
+        mLevels.push_back(info);
+    }
+    mLevelSources.reset(new LevelSource[levelCount]);
+    for(uint32_t level = 0; level < levelCount; ++level)
+    {
+        mLevelSources[level].valid = false;
+        mLevelSources[level].data  = nullptr;
+    }
+
+    mSparse = capabilities.sparseResidencyImage2DSupported && !parameters.forcePageCache;
+    if(mSparse && !createSparseImage(capabilities))
+    {
+        std::cerr << "Sparse residency cannot page '" << filename << "', using the page cache." << std::endl;
+        destroySparseImage();
+        mSparse = false;
+    }
+    if(!mSparse && !createCacheImage(capabilities))
+    {
+        destroy();
+        return false;
+    }
+
+    // The coarsest level is always resident and serves as the fallback of every other page; in a
+    // sparse image that is the mip tail, which does not take pages from the pool
+    mPinnedLevel = (mSparse && (mMipTailFirstLevel < levelCount)) ? mMipTailFirstLevel : levelCount - 1;
+    uint32_t pinnedSlots = mPinnedLevel < mMipTailFirstLevel ? pageCount - mLevels[mPinnedLevel].firstPage : 0;
+    if(pinnedSlots > parameters.cachePages / 2)
+    {
+        std::cerr << "The coarsest level of '" << filename << "' takes more than half of the page cache." << std::endl;
+        destroy();
+        return false;
+    }
+
+    mPages.resize(pageCount);
+    for(uint32_t page = 0; page < pageCount; ++page)
+    {
+        mPages[page].state         = PageState::Missing;
+        mPages[page].pinned        = page >= mLevels[mPinnedLevel].firstPage;
+        mPages[page].slot          = NO_SLOT;
+        mPages[page].lastRequested = 0;
+        mPages[page].evictions     = 0;
+    }
+    mSlots.resize(parameters.cachePages);
+    for(uint32_t slot = parameters.cachePages; slot-- > 0;)
+    {
+        mSlots[slot] = { NO_SLOT, NO_SLOT, NO_SLOT, 0 };
+        mFreeSlots.push_back(slot);
+    }
+
+    if(!createImageView(mLogicalDevice, mImage, format, 0, mImageLevelCount, mImageView) ||
+       !createSampler(mLogicalDevice, VK_FILTER_LINEAR,
+                      mSparse ? VK_SAMPLER_ADDRESS_MODE_REPEAT : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, mSampler))
+    {
+        destroy();
+        return false;
+    }
+
+    // Page slots for the loads in flight and for the uploads of the frames still reading them,
+    // followed by the mip tail levels
+    uint32_t stagingSlotCount = parameters.maxPendingLoads + parameters.maxUploadsPerFrame * framesInFlight;
+    mStagingSlotBytes  = mSparse ? PAGE_SIZE * PAGE_SIZE * TEXEL_BYTES : SLOT_SIZE * SLOT_SIZE * TEXEL_BYTES;
+    mTailStagingOffset = stagingSlotCount * mStagingSlotBytes;
+    VkDeviceSize stagingBytes = mTailStagingOffset;
+    for(uint32_t level = mMipTailFirstLevel; level < levelCount; ++level)
+        stagingBytes += static_cast<VkDeviceSize>(mLevels[level].width) * mLevels[level].height * TEXEL_BYTES;
+
+    void *stagingData;
+    if(!createHostVisibleBuffer(capabilities.memoryProperties, mLogicalDevice, stagingBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                nullptr, mStagingBuffer, mStagingMemory) ||
+       (vkMapMemory(mLogicalDevice, mStagingMemory, 0, VK_WHOLE_SIZE, 0, &stagingData) != VK_SUCCESS))
+    {
+        std::cerr << "Could not create virtual texture staging memory." << std::endl;
+        destroy();
+        return false;
+    }
+    mStagingData = static_cast<uint8_t *>(stagingData);
+    for(uint32_t slot = stagingSlotCount; slot-- > 0;)
+        mFreeStagingSlots.push_back(slot);
+
+    mFeedbackBytes = (pageCount + 31) / 32 * sizeof(uint32_t);
+    if(!createBuffer(mLogicalDevice, mFeedbackBytes,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     mFeedbackBuffer) ||
+       !allocateAndBindMemoryObjectToBuffer(capabilities.memoryProperties, mLogicalDevice, mFeedbackBuffer,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mFeedbackMemory))
+    {
+        destroy();
+        return false;
+    }
+
+    mPageTable.assign(pageCount, 0);
+    mPageTableVersion = 1;
+    mPageTableDirty   = true;
+    if(!createFrameSlots(capabilities, framesInFlight) || !createDescriptors())
+    {
+        destroy();
+        return false;
+    }
+
+    mStats.sparse       = mSparse;
+    mStats.virtualPages = pageCount;
+    return true;
+}
+
+bool VirtualTexture::createSparseImage(DeviceCapabilities const &capabilities)
+{
+    VkFormat format = mFile.getFormat();
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    // Pages have to match the sparse blocks of the format
+    uint32_t propertyCount = 0;
+    vkGetPhysicalDeviceSparseImageFormatProperties(capabilities.physicalDevice, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+                                                   usage, VK_IMAGE_TILING_OPTIMAL, &propertyCount, nullptr);
+    std::vector<VkSparseImageFormatProperties> formatProperties(propertyCount);
+    vkGetPhysicalDeviceSparseImageFormatProperties(capabilities.physicalDevice, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+                                                   usage, VK_IMAGE_TILING_OPTIMAL, &propertyCount, formatProperties.data());
+    bool standardBlocks = false;
+    for(auto &properties : formatProperties)
+    {
+        if((properties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) &&
+           (properties.imageGranularity.width == PAGE_SIZE) && (properties.imageGranularity.height == PAGE_SIZE) &&
+           (properties.imageGranularity.depth == 1) &&
+           !(properties.flags & VK_SPARSE_IMAGE_FORMAT_NONSTANDARD_BLOCK_SIZE_BIT))
+            standardBlocks = true;
+    }
+    if(!standardBlocks)
+        return false;
+
+    mImageLevelCount = static_cast<uint32_t>(mLevels.size());
+    VkImageCreateInfo imageCreateInfo = {
+        VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,              // VkStructureType          sType
+        nullptr,                                          // const void             * pNext
+        VK_IMAGE_CREATE_SPARSE_BINDING_BIT |              // VkImageCreateFlags       flags
+        VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT,
+        VK_IMAGE_TYPE_2D,                                 // VkImageType              imageType
+        format,                                           // VkFormat                 format
+        { mWidth, mHeight, 1 },                           // VkExtent3D               extent
+        mImageLevelCount,                                 // uint32_t                 mipLevels
+        1,                                                // uint32_t                 arrayLayers
+        VK_SAMPLE_COUNT_1_BIT,                            // VkSampleCountFlagBits    samples
+        VK_IMAGE_TILING_OPTIMAL,                          // VkImageTiling            tiling
+        usage,                                            // VkImageUsageFlags        usage
+        VK_SHARING_MODE_EXCLUSIVE,                        // VkSharingMode            sharingMode
+        0,                                                // uint32_t                 queueFamilyIndexCount
+        nullptr,                                          // const uint32_t         * pQueueFamilyIndices
+        VK_IMAGE_LAYOUT_UNDEFINED                         // VkImageLayout            initialLayout
+    };
+
+    VkResult result = vkCreateImage(mLogicalDevice, &imageCreateInfo, nullptr, &mImage);
+    if(result != VK_SUCCESS)
+        return false;
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(mLogicalDevice, mImage, &memoryRequirements);
+    mSparsePageBytes = memoryRequirements.alignment;
+    if(mSparsePageBytes != PAGE_SIZE * PAGE_SIZE * TEXEL_BYTES)
+        return false;
+
+    uint32_t requirementCount = 0;
+    vkGetImageSparseMemoryRequirements(mLogicalDevice, mImage, &requirementCount, nullptr);
+    std::vector<VkSparseImageMemoryRequirements> sparseRequirements(requirementCount);
+    vkGetImageSparseMemoryRequirements(mLogicalDevice, mImage, &requirementCount, sparseRequirements.data());
+
+    mMipTailFirstLevel = mImageLevelCount;
+    mMipTailBind = {};
+    for(auto &requirements : sparseRequirements)
+    {
+        // Metadata would need bindings of its own
+        if(requirements.formatProperties.aspectMask & VK_IMAGE_ASPECT_METADATA_BIT)
+            return false;
+        if((requirements.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) &&
+           (requirements.imageMipTailFirstLod < mImageLevelCount))
+        {
+            mMipTailFirstLevel = requirements.imageMipTailFirstLod;
+            mMipTailBind = {
+                requirements.imageMipTailOffset,      // VkDeviceSize               resourceOffset
+                requirements.imageMipTailSize,        // VkDeviceSize               size
+                VK_NULL_HANDLE,                       // VkDeviceMemory             memory
+                0,                                    // VkDeviceSize               memoryOffset
+                0                                     // VkSparseMemoryBindFlags    flags
+            };
+        }
+    }
+
+    if(!allocateMemory(capabilities.memoryProperties, mLogicalDevice, mParameters.cachePages * mSparsePageBytes,
+                       memoryRequirements.memoryTypeBits, mImageMemory))
+        return false;
+    if(mMipTailBind.size > 0)
+    {
+        VkDeviceSize tailBytes = (mMipTailBind.size + mSparsePageBytes - 1) / mSparsePageBytes * mSparsePageBytes;
+        if(!allocateMemory(capabilities.memoryProperties, mLogicalDevice, tailBytes, memoryRequirements.memoryTypeBits,
+                           mMipTailMemory))
+            return false;
+        mMipTailBind.memory = mMipTailMemory;
+    }
+    return true;
+}
+
+void VirtualTexture::destroySparseImage()
+{
+    destroyImage(mLogicalDevice, mImage);
+    freeMemoryObject(mLogicalDevice, mImageMemory);
+    freeMemoryObject(mLogicalDevice, mMipTailMemory);
+    mMipTailBind       = {};
+    mMipTailFirstLevel = static_cast<uint32_t>(mLevels.size());
+    mImageLevelCount   = 0;
+    mSparsePageBytes   = 0;
+}
+
+bool VirtualTexture::createCacheImage(DeviceCapabilities const &capabilities)
+{
+    mMipTailFirstLevel = static_cast<uint32_t>(mLevels.size());
+    mImageLevelCount = 1;
+    mSlotsPerRow = 1;
+    while(mSlotsPerRow * mSlotsPerRow < mParameters.cachePages)
+        ++mSlotsPerRow;
+    uint32_t slotRows = (mParameters.cachePages + mSlotsPerRow - 1) / mSlotsPerRow;
+    if(mSlotsPerRow * SLOT_SIZE > capabilities.properties.limits.maxImageDimension2D)
+    {
+        std::cerr << "The virtual texture page cache exceeds the maximal image size." << std::endl;
+        return false;
+    }
+
+    VkImageCreateInfo imageCreateInfo = {
+        VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,              // VkStructureType          sType
+        nullptr,                                          // const void             * pNext
+        0,                                                // VkImageCreateFlags       flags
+        VK_IMAGE_TYPE_2D,                                 // VkImageType              imageType
+        mFile.getFormat(),                                // VkFormat                 format
+        { mSlotsPerRow * SLOT_SIZE, slotRows * SLOT_SIZE, 1 }, // VkExtent3D          extent
+        1,                                                // uint32_t                 mipLevels
+        1,                                                // uint32_t                 arrayLayers
+        VK_SAMPLE_COUNT_1_BIT,                            // VkSampleCountFlagBits    samples
+        VK_IMAGE_TILING_OPTIMAL,                          // VkImageTiling            tiling
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT |                 // VkImageUsageFlags        usage
+        VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_SHARING_MODE_EXCLUSIVE,                        // VkSharingMode            sharingMode
+        0,                                                // uint32_t                 queueFamilyIndexCount
+        nullptr,                                          // const uint32_t         * pQueueFamilyIndices
+        VK_IMAGE_LAYOUT_UNDEFINED                         // VkImageLayout            initialLayout
+    };
+
+    VkResult result = vkCreateImage(mLogicalDevice, &imageCreateInfo, nullptr, &mImage);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create the virtual texture page cache." << std::endl;
+        return false;
+    }
+    return allocateAndBindMemoryObjectToImage(capabilities.memoryProperties, mLogicalDevice, mImage,
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mImageMemory);
+}
+
+bool VirtualTexture::createFrameSlots(DeviceCapabilities const &capabilities, uint32_t framesInFlight)
+{
+    PageTableHeader header = {};
+    header.width       = mWidth;
+    header.height      = mHeight;
+    header.levelCount  = static_cast<uint32_t>(mLevels.size());
+    header.sparse      = mSparse ? 1 : 0;
+    header.slotsPerRow = mSlotsPerRow;
+    for(uint32_t level = 0; level < mLevels.size(); ++level)
+    {
+        header.levelFirstPage[level] = mLevels[level].firstPage;
+        header.levelPagesX[level]    = mLevels[level].pagesX;
+    }
+
+    VkDeviceSize tableBytes = sizeof(PageTableHeader) + mPages.size() * sizeof(uint32_t);
+    mFrameSlots.resize(framesInFlight);
+    for(auto &slot : mFrameSlots)
+        slot = { VK_NULL_HANDLE, VK_NULL_HANDLE, nullptr, 0, VK_NULL_HANDLE, VK_NULL_HANDLE, nullptr, false, VK_NULL_HANDLE };
+
+    for(auto &slot : mFrameSlots)
+    {
+        void *tableData;
+        void *readbackData;
+        if(!createHostVisibleBuffer(capabilities.memoryProperties, mLogicalDevice, tableBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    nullptr, slot.tableBuffer, slot.tableMemory) ||
+           !createHostVisibleBuffer(capabilities.memoryProperties, mLogicalDevice, mFeedbackBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    nullptr, slot.readbackBuffer, slot.readbackMemory))
+            return false;
+        if((vkMapMemory(mLogicalDevice, slot.tableMemory, 0, VK_WHOLE_SIZE, 0, &tableData) != VK_SUCCESS) ||
+           (vkMapMemory(mLogicalDevice, slot.readbackMemory, 0, VK_WHOLE_SIZE, 0, &readbackData) != VK_SUCCESS))
+        {
+            std::cerr << "Could not map virtual texture page table memory." << std::endl;
+            return false;
+        }
+        slot.tableData    = static_cast<uint32_t *>(tableData);
+        slot.readbackData = static_cast<uint32_t const *>(readbackData);
+        std::memcpy(slot.tableData, &header, sizeof(header));
+    }
+    return true;
+}
+
+bool VirtualTexture::createDescriptors()
+{
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            0,                                          // uint32_t              binding
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  // VkDescriptorType      descriptorType
+            1,                                          // uint32_t              descriptorCount
+            VK_SHADER_STAGE_FRAGMENT_BIT,               // VkShaderStageFlags    stageFlags
+            nullptr                                     // const VkSampler     * pImmutableSamplers
+        },
+        {
+            1,                                          // uint32_t              binding
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          // VkDescriptorType      descriptorType
+            1,                                          // uint32_t              descriptorCount
+            VK_SHADER_STAGE_FRAGMENT_BIT,               // VkShaderStageFlags    stageFlags
+            nullptr                                     // const VkSampler     * pImmutableSamplers
+        },
+        {
+            2,                                          // uint32_t              binding
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          // VkDescriptorType      descriptorType
+            1,                                          // uint32_t              descriptorCount
+            VK_SHADER_STAGE_FRAGMENT_BIT,               // VkShaderStageFlags    stageFlags
+            nullptr                                     // const VkSampler     * pImmutableSamplers
+        }
+    };
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,  // VkStructureType                        sType
+        nullptr,                                              // const void                           * pNext
+        0,                                                    // VkDescriptorSetLayoutCreateFlags       flags
+        3,                                                    // uint32_t                               bindingCount
+        bindings                                              // const VkDescriptorSetLayoutBinding   * pBindings
+    };
+
+    VkResult result = vkCreateDescriptorSetLayout(mLogicalDevice, &descriptorSetLayoutCreateInfo, nullptr, &mDescriptorSetLayout);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create a layout for virtual texture descriptor sets." << std::endl;
+        return false;
+    }
+
+    uint32_t setCount = static_cast<uint32_t>(mFrameSlots.size());
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         2 * setCount }
+    };
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,  // VkStructureType                sType
+        nullptr,                                        // const void                   * pNext
+        0,                                              // VkDescriptorPoolCreateFlags    flags
+        setCount,                                       // uint32_t                       maxSets
+        2,                                              // uint32_t                       poolSizeCount
+        poolSizes                                       // const VkDescriptorPoolSize   * pPoolSizes
+    };
+
+    result = vkCreateDescriptorPool(mLogicalDevice, &descriptorPoolCreateInfo, nullptr, &mDescriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not create virtual texture descriptor pool." << std::endl;
+        return false;
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(setCount, mDescriptorSetLayout);
+    std::vector<VkDescriptorSet> descriptorSets(setCount);
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,   // VkStructureType                  sType
+        nullptr,                                          // const void                     * pNext
+        mDescriptorPool,                                  // VkDescriptorPool                 descriptorPool
+        setCount,                                         // uint32_t                         descriptorSetCount
+        setLayouts.data()                                 // const VkDescriptorSetLayout    * pSetLayouts
+    };
+
+    result = vkAllocateDescriptorSets(mLogicalDevice, &descriptorSetAllocateInfo, descriptorSets.data());
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not allocate virtual texture descriptor sets." << std::endl;
+        return false;
+    }
+
+    VkDescriptorImageInfo imageInfo = { mSampler, mImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    VkDescriptorBufferInfo feedbackInfo = { mFeedbackBuffer, 0, VK_WHOLE_SIZE };
+    for(uint32_t index = 0; index < setCount; ++index)
+    {
+        FrameSlot &slot = mFrameSlots[index];
+        slot.descriptorSet = descriptorSets[index];
+        VkDescriptorBufferInfo tableInfo = { slot.tableBuffer, 0, VK_WHOLE_SIZE };
+
+        VkWriteDescriptorSet writes[3];
+        for(uint32_t binding = 0; binding < 3; ++binding)
+        {
+            writes[binding] = {
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,   // VkStructureType                  sType
+                nullptr,                                  // const void                     * pNext
+                slot.descriptorSet,                       // VkDescriptorSet                  dstSet
+                binding,                                  // uint32_t                         dstBinding
+                0,                                        // uint32_t                         dstArrayElement
+                1,                                        // uint32_t                         descriptorCount
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,        // VkDescriptorType                 descriptorType
+                nullptr,                                  // const VkDescriptorImageInfo    * pImageInfo
+                binding == 1 ? &tableInfo : &feedbackInfo, // const VkDescriptorBufferInfo  * pBufferInfo
+                nullptr                                   // const VkBufferView             * pTexelBufferView
+            };
+        }
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo     = &imageInfo;
+        writes[0].pBufferInfo    = nullptr;
+        vkUpdateDescriptorSets(mLogicalDevice, 3, writes, 0, nullptr);
+    }
+    return true;
+}
+
+void VirtualTexture::destroy()
+{
+    if(mLogicalDevice == VK_NULL_HANDLE)
+        return;
+
+    // Loads write into the staging memory
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this]() { return mPendingLoads == 0; });
+    }
+    LoadResult result;
+    while(mLoadResults.pop(result))
+    {
+    }
+    mLoadedPages.clear();
+
+    destroyDescriptorPool(mLogicalDevice, mDescriptorPool);
+    destroyDescriptorSetLayout(mLogicalDevice, mDescriptorSetLayout);
+    for(auto &slot : mFrameSlots)
+    {
+        destroyBuffer(mLogicalDevice, slot.tableBuffer);
+        freeMemoryObject(mLogicalDevice, slot.tableMemory);
+        destroyBuffer(mLogicalDevice, slot.readbackBuffer);
+        freeMemoryObject(mLogicalDevice, slot.readbackMemory);
+    }
+    mFrameSlots.clear();
+    destroyBuffer(mLogicalDevice, mFeedbackBuffer);
+    freeMemoryObject(mLogicalDevice, mFeedbackMemory);
+    destroyBuffer(mLogicalDevice, mStagingBuffer);
+    freeMemoryObject(mLogicalDevice, mStagingMemory);
+    mStagingData = nullptr;
+
+    destroySampler(mLogicalDevice, mSampler);
+    destroyImageView(mLogicalDevice, mImageView);
+    destroySparseImage();
+
+    mFile.close();
+    mLevels.clear();
+    mLevelSources.reset();
+    mPages.clear();
+    mSlots.clear();
+    mFreeSlots.clear();
+    mRetiredSlots.clear();
+    mPendingBinds.clear();
+    mFreeStagingSlots.clear();
+    mRetiredStagingSlots.clear();
+    mPageTable.clear();
+
+    mLruHead          = NO_SLOT;
+    mLruTail          = NO_SLOT;
+    mFrame            = 0;
+    mSparse           = false;
+    mMipTailBound     = false;
+    mImageInitialized = false;
+    mSlotsPerRow      = 0;
+    mStats            = {};
+    mLogicalDevice    = VK_NULL_HANDLE;
+}
+
+bool VirtualTexture::recordUpdate(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    ++mFrame;
+    mFrameIndex = frameIndex;
+    FrameSlot &slot = mFrameSlots[frameIndex];
+
+    if(!mImageInitialized)
+    {
+        if(!recordInitialization(commandBuffer))
+            return false;
+        mImageInitialized = true;
+    }
+    releaseRetiredSlots();
+
+    std::vector<uint32_t> missing;
+    for(uint32_t page = mLevels[mPinnedLevel].firstPage; page < mPages.size(); ++page)
+        requestPage(page, missing);
+    if(slot.resolved)
+    {
+        readFeedback(slot, missing);
+        slot.resolved = false;
+    }
+
+    queueLoads(missing);
+    bool loaded = collectLoadResults();
+    evictAhead();
+    recordUploads(commandBuffer);
+
+    if(mPageTableDirty)
+        rebuildPageTable();
+    if(slot.tableVersion != mPageTableVersion)
+    {
+        std::memcpy(slot.tableData + sizeof(PageTableHeader) / sizeof(uint32_t), mPageTable.data(),
+                    mPageTable.size() * sizeof(uint32_t));
+        slot.tableVersion = mPageTableVersion;
+    }
+    reinterpret_cast<PageTableHeader *>(slot.tableData)->feedbackJitter = static_cast<uint32_t>(mFrame % FEEDBACK_JITTER_PERIOD);
+    return loaded;
+}
+
+bool VirtualTexture::recordInitialization(VkCommandBuffer commandBuffer)
+{
+    vkCmdFillBuffer(commandBuffer, mFeedbackBuffer, 0, mFeedbackBytes, 0);
+    recordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    // The mip tail is bound by the first submitSparseBinds, before this command buffer runs
+    std::vector<VkBufferImageCopy> copies;
+    VkDeviceSize bufferOffset = mTailStagingOffset;
+    for(uint32_t level = mMipTailFirstLevel; level < mLevels.size(); ++level)
+    {
+        Level const &info = mLevels[level];
+        uint8_t const *data;
+        if(!getLevelSource(level, data))
+            return false;
+
+        VkDeviceSize size = static_cast<VkDeviceSize>(info.width) * info.height * TEXEL_BYTES;
+        std::memcpy(mStagingData + bufferOffset, data, static_cast<size_t>(size));
+        copies.push_back({
+            bufferOffset,                                         // VkDeviceSize                 bufferOffset
+            0,                                                    // uint32_t                     bufferRowLength
+            0,                                                    // uint32_t                     bufferImageHeight
+            { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },           // VkImageSubresourceLayers     imageSubresource
+            { 0, 0, 0 },                                          // VkOffset3D                   imageOffset
+            { info.width, info.height, 1 }                        // VkExtent3D                   imageExtent
+        });
+        bufferOffset += size;
+
+        for(uint32_t page = info.firstPage; page < info.firstPage + info.pagesX * info.pagesY; ++page)
+        {
+            mPages[page].state = PageState::Resident;
+            mPages[page].slot  = TAIL_SLOT;
+            ++mStats.residentPages;
+        }
+        mPageTableDirty = true;
+    }
+
+    recordImageTransition(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    if(!copies.empty())
+        vkCmdCopyBufferToImage(commandBuffer, mStagingBuffer, mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(copies.size()), copies.data());
+    recordImageTransition(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return true;
+}
+
+void VirtualTexture::releaseRetiredSlots()
+{
+    while(!mRetiredSlots.empty() && (mRetiredSlots.front().frame + mFramesInFlight <= mFrame))
+    {
+        RetiredSlot const &retired = mRetiredSlots.front();
+        // A page loaded again in the meantime has been, or will be, bound to its new memory. After
+        // another eviction that newer residency may still be sampled, its own retirement unbinds it.
+        Page const &page = mPages[retired.page];
+        if(mSparse && (page.state == PageState::Missing) && (page.evictions == retired.evictions))
+        {
+            VkSparseImageMemoryBind unbind = {};
+            getPageRegion(retired.page, unbind.subresource.mipLevel, unbind.offset, unbind.extent);
+            unbind.subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            mPendingBinds.push_back(unbind);
+        }
+        mFreeSlots.push_back(retired.slot);
+        mRetiredSlots.pop_front();
+    }
+    while(!mRetiredStagingSlots.empty() && (mRetiredStagingSlots.front().second + mFramesInFlight <= mFrame))
+    {
+        mFreeStagingSlots.push_back(mRetiredStagingSlots.front().first);
+        mRetiredStagingSlots.pop_front();
+    }
+}
+
+void VirtualTexture::readFeedback(FrameSlot &slot, std::vector<uint32_t> &missing)
+{
+    uint32_t pageCount = static_cast<uint32_t>(mPages.size());
+    uint32_t requested = 0;
+    for(uint32_t word = 0; word < (pageCount + 31) / 32; ++word)
+    {
+        uint32_t bits = slot.readbackData[word];
+        for(uint32_t page = word * 32; (bits != 0) && (page < pageCount); bits >>= 1, ++page)
+        {
+            if(bits & 1)
+            {
+                requestPage(page, missing);
+                ++requested;
+            }
+        }
+    }
+    mStats.requestedPages = requested;
+}
+
+void VirtualTexture::requestPage(uint32_t page, std::vector<uint32_t> &missing)
+{
+    // Ancestors are kept too, they are the fallback while the page is missing
+    while(true)
+    {
+        Page &entry = mPages[page];
+        if(entry.lastRequested == mFrame)
+            return;
+        entry.lastRequested = mFrame;
+
+        if(entry.state == PageState::Missing)
+            missing.push_back(page);
+        else if((entry.state == PageState::Resident) && !entry.pinned && (mSlots[entry.slot].lastUsed != mFrame))
+        {
+            unlinkSlot(entry.slot);
+            linkSlot(entry.slot);
+            mSlots[entry.slot].lastUsed = mFrame;
+        }
+
+        if(getPageLevel(page) + 1 >= mLevels.size())
+            return;
+        page = getParentPage(page);
+    }
+}
+
+void VirtualTexture::linkSlot(uint32_t slot)
+{
+    mSlots[slot].previous = mLruTail;
+    mSlots[slot].next     = NO_SLOT;
+    if(mLruTail != NO_SLOT)
+        mSlots[mLruTail].next = slot;
+    else
+        mLruHead = slot;
+    mLruTail = slot;
+}
+
+void VirtualTexture::unlinkSlot(uint32_t slot)
+{
+    Slot &entry = mSlots[slot];
+    if(entry.previous != NO_SLOT)
+        mSlots[entry.previous].next = entry.next;
+    else
+        mLruHead = entry.next;
+    if(entry.next != NO_SLOT)
+        mSlots[entry.next].previous = entry.previous;
+    else
+        mLruTail = entry.previous;
+    entry.previous = NO_SLOT;
+    entry.next     = NO_SLOT;
+}
+
+void VirtualTexture::queueLoads(std::vector<uint32_t> &missing)
+{
+    // Coarser levels come later in the page order, loading them first gives every request a
+    // fallback as early as possible
+    std::sort(missing.begin(), missing.end(), std::greater<uint32_t>());
+    for(size_t index = 0; index < missing.size(); ++index)
+    {
+        if((mStats.pendingLoads >= mParameters.maxPendingLoads) || mFreeStagingSlots.empty())
+        {
+            mStats.deferredRequests += missing.size() - index;
+            return;
+        }
+
+        uint32_t page = missing[index];
+        uint32_t stagingSlot = mFreeStagingSlots.back();
+        mFreeStagingSlots.pop_back();
+        mPages[page].state = PageState::Loading;
+        ++mStats.pendingLoads;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mPendingLoads;
+        }
+
+        if(mIoThreads != nullptr)
+            mIoThreads->submit([this, page, stagingSlot]() { loadPage(page, stagingSlot); });
+        else
+            loadPage(page, stagingSlot);
+    }
+}
+
+void VirtualTexture::loadPage(uint32_t page, uint32_t stagingSlot)
+{
+    uint32_t level;
+    VkOffset3D offset;
+    VkExtent3D extent;
+    getPageRegion(page, level, offset, extent);
+
+    uint8_t const *source;
+    bool success = getLevelSource(level, source);
+    if(success)
+    {
+        Level const &info = mLevels[level];
+        size_t rowBytes = static_cast<size_t>(info.width) * TEXEL_BYTES;
+        uint8_t *destination = mStagingData + stagingSlot * mStagingSlotBytes;
+        if(mSparse)
+        {
+            for(uint32_t y = 0; y < extent.height; ++y)
+                std::memcpy(destination + y * extent.width * TEXEL_BYTES, source + (offset.y + y) * rowBytes + offset.x * TEXEL_BYTES,
+                            extent.width * TEXEL_BYTES);
+        }
+        else
+        {
+            // The border repeats the texture across its edges, matching its REPEAT addressing
+            for(uint32_t y = 0; y < SLOT_SIZE; ++y)
+            {
+                uint32_t sourceY = wrapCoordinate(offset.y + static_cast<int32_t>(y) - static_cast<int32_t>(PAGE_BORDER), info.height);
+                copyWrappedRow(source + sourceY * rowBytes, info.width, offset.x - static_cast<int32_t>(PAGE_BORDER), SLOT_SIZE,
+                               destination + y * SLOT_SIZE * TEXEL_BYTES);
+            }
+        }
+    }
+    mLoadResults.push({ page, stagingSlot, success });
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    --mPendingLoads;
+    mCondition.notify_all();
+}
+
+bool VirtualTexture::collectLoadResults()
+{
+    bool success = true;
+    LoadResult result;
+    while(mLoadResults.pop(result))
+    {
+        if(result.success)
+        {
+            mLoadedPages.push_back(result);
+            continue;
+        }
+        // Level sources are read once, a failed one fails again on every retry
+        mPages[result.page].state = PageState::Failed;
+        mFreeStagingSlots.push_back(result.stagingSlot);
+        --mStats.pendingLoads;
+        ++mStats.failedPages;
+        success = false;
+    }
+    return success;
+}
+
+void VirtualTexture::evictAhead()
+{
+    // Evicted slots only become free framesInFlight frames later, keep enough of them on the way
+    // for the loads in flight. Pages requested this frame stay.
+    size_t target = std::min(mStats.pendingLoads, mParameters.maxUploadsPerFrame * mFramesInFlight);
+    while((mFreeSlots.size() + mRetiredSlots.size() < target) && (mLruHead != NO_SLOT) &&
+          (mSlots[mLruHead].lastUsed < mFrame))
+    {
+        uint32_t slot = mLruHead;
+        uint32_t page = mSlots[slot].page;
+        unlinkSlot(slot);
+        mPages[page].state = PageState::Missing;
+        mPages[page].slot  = NO_SLOT;
+        ++mPages[page].evictions;
+        mRetiredSlots.push_back({ slot, page, mPages[page].evictions, mFrame });
+        mPageTableDirty = true;
+        --mStats.residentPages;
+        ++mStats.evictedPages;
+    }
+}
+
+void VirtualTexture::recordUploads(VkCommandBuffer commandBuffer)
+{
+    std::vector<VkBufferImageCopy> copies;
+    while(!mLoadedPages.empty() && (copies.size() < mParameters.maxUploadsPerFrame) && !mFreeSlots.empty())
+    {
+        LoadResult loaded = mLoadedPages.front();
+        mLoadedPages.pop_front();
+        uint32_t slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+
+        VkBufferImageCopy copy = {};
+        copy.bufferOffset = loaded.stagingSlot * mStagingSlotBytes;
+        copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        if(mSparse)
+        {
+            getPageRegion(loaded.page, copy.imageSubresource.mipLevel, copy.imageOffset, copy.imageExtent);
+            mPendingBinds.push_back({
+                { VK_IMAGE_ASPECT_COLOR_BIT, copy.imageSubresource.mipLevel, 0 }, // VkImageSubresource         subresource
+                copy.imageOffset,                                     // VkOffset3D                 offset
+                copy.imageExtent,                                     // VkExtent3D                 extent
+                mImageMemory,                                         // VkDeviceMemory             memory
+                slot * mSparsePageBytes,                              // VkDeviceSize               memoryOffset
+                0                                                     // VkSparseMemoryBindFlags    flags
+            });
+        }
+        else
+        {
+            copy.imageOffset = { static_cast<int32_t>(slot % mSlotsPerRow * SLOT_SIZE),
+                                 static_cast<int32_t>(slot / mSlotsPerRow * SLOT_SIZE), 0 };
+            copy.imageExtent = { SLOT_SIZE, SLOT_SIZE, 1 };
+        }
+        copies.push_back(copy);
+
+        Page &page = mPages[loaded.page];
+        page.state = PageState::Resident;
+        page.slot  = slot;
+        mSlots[slot].page     = loaded.page;
+        mSlots[slot].lastUsed = mFrame;
+        if(!page.pinned)
+            linkSlot(slot);
+        mRetiredStagingSlots.push_back({ loaded.stagingSlot, mFrame });
+        mPageTableDirty = true;
+        --mStats.pendingLoads;
+        ++mStats.residentPages;
+        ++mStats.loadedPages;
+    }
+    if(copies.empty())
+        return;
+
+    recordImageTransition(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdCopyBufferToImage(commandBuffer, mStagingBuffer, mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(copies.size()), copies.data());
+    recordImageTransition(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VirtualTexture::recordImageTransition(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+    VkPipelineStageFlags2 srcStages, dstStages;
+    VkAccessFlags2 srcAccess, dstAccess;
+    getLayoutScope(oldLayout, srcStages, srcAccess);
+    getLayoutScope(newLayout, dstStages, dstAccess);
+
+    VkImageMemoryBarrier2 imageBarrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,   // VkStructureType            sType
+        nullptr,                                    // const void               * pNext
+        srcStages,                                  // VkPipelineStageFlags2      srcStageMask
+        srcAccess,                                  // VkAccessFlags2             srcAccessMask
+        dstStages,                                  // VkPipelineStageFlags2      dstStageMask
+        dstAccess,                                  // VkAccessFlags2             dstAccessMask
+        oldLayout,                                  // VkImageLayout              oldLayout
+        newLayout,                                  // VkImageLayout              newLayout
+        VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   dstQueueFamilyIndex
+        mImage,                                     // VkImage                    image
+        {                                           // VkImageSubresourceRange    subresourceRange
+          VK_IMAGE_ASPECT_COLOR_BIT,                  // VkImageAspectFlags         aspectMask
+          0,                                          // uint32_t                   baseMipLevel
+          mImageLevelCount,                           // uint32_t                   levelCount
+          0,                                          // uint32_t                   baseArrayLayer
+          1                                           // uint32_t                   layerCount
+        }
+    };
+
+    VkDependencyInfo dependencyInfo = {
+        VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+        nullptr,                                // const void                     * pNext
+        0,                                      // VkDependencyFlags                dependencyFlags
+        0,                                      // uint32_t                         memoryBarrierCount
+        nullptr,                                // const VkMemoryBarrier2         * pMemoryBarriers
+        0,                                      // uint32_t                         bufferMemoryBarrierCount
+        nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+        1,                                      // uint32_t                         imageMemoryBarrierCount
+        &imageBarrier                           // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void VirtualTexture::rebuildPageTable()
+{
+    // Coarse to fine, so a missing page can take the entry of its parent
+    for(uint32_t level = static_cast<uint32_t>(mLevels.size()); level-- > 0;)
+    {
+        Level const &info = mLevels[level];
+        for(uint32_t page = info.firstPage; page < info.firstPage + info.pagesX * info.pagesY; ++page)
+        {
+            Page const &entry = mPages[page];
+            uint32_t value = 0;
+            if(entry.state == PageState::Resident)
+            {
+                value = ENTRY_VALID | (level << 24);
+                if(!mSparse)
+                    value |= ((entry.slot / mSlotsPerRow) << 12) | (entry.slot % mSlotsPerRow);
+            }
+            else if(level + 1 < mLevels.size())
+                value = mPageTable[getParentPage(page)];
+            mPageTable[page] = value;
+        }
+    }
+    ++mPageTableVersion;
+    mPageTableDirty = false;
+}
+
+void VirtualTexture::recordFeedbackResolve(VkCommandBuffer commandBuffer)
+{
+    FrameSlot &slot = mFrameSlots[mFrameIndex];
+    recordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+    VkBufferCopy region = { 0, 0, mFeedbackBytes };
+    vkCmdCopyBuffer(commandBuffer, mFeedbackBuffer, slot.readbackBuffer, 1, &region);
+    recordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE,
+                        VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_NONE);
+    vkCmdFillBuffer(commandBuffer, mFeedbackBuffer, 0, mFeedbackBytes, 0);
+
+    recordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_HOST_BIT,
+                        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_HOST_READ_BIT);
+    slot.resolved = true;
+}
+
+bool VirtualTexture::submitSparseBinds(VkQueue queue, VkSemaphore timelineSemaphore, uint64_t signalValue)
+{
+    if(!mSparse)
+        return true;
+
+    bool bindMipTail = !mMipTailBound && (mMipTailBind.size > 0);
+    VkSparseImageOpaqueMemoryBindInfo opaqueBindInfo = {
+        mImage,                                   // VkImage                      image
+        1,                                        // uint32_t                     bindCount
+        &mMipTailBind                             // const VkSparseMemoryBind   * pBinds
+    };
+    VkSparseImageMemoryBindInfo imageBindInfo = {
+        mImage,                                   // VkImage                          image
+        static_cast<uint32_t>(mPendingBinds.size()), // uint32_t                     bindCount
+        mPendingBinds.data()                      // const VkSparseImageMemoryBind  * pBinds
+    };
+
+    VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo = {
+        VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO, // VkStructureType    sType
+        nullptr,                                  // const void       * pNext
+        0,                                        // uint32_t           waitSemaphoreValueCount
+        nullptr,                                  // const uint64_t   * pWaitSemaphoreValues
+        1,                                        // uint32_t           signalSemaphoreValueCount
+        &signalValue                              // const uint64_t   * pSignalSemaphoreValues
+    };
+
+    VkBindSparseInfo bindSparseInfo = {
+        VK_STRUCTURE_TYPE_BIND_SPARSE_INFO,       // VkStructureType                            sType
+        &timelineSemaphoreSubmitInfo,             // const void                               * pNext
+        0,                                        // uint32_t                                   waitSemaphoreCount
+        nullptr,                                  // const VkSemaphore                        * pWaitSemaphores
+        0,                                        // uint32_t                                   bufferBindCount
+        nullptr,                                  // const VkSparseBufferMemoryBindInfo       * pBufferBinds
+        bindMipTail ? 1u : 0u,                    // uint32_t                                   imageOpaqueBindCount
+        &opaqueBindInfo,                          // const VkSparseImageOpaqueMemoryBindInfo  * pImageOpaqueBinds
+        mPendingBinds.empty() ? 0u : 1u,          // uint32_t                                   imageBindCount
+        &imageBindInfo,                           // const VkSparseImageMemoryBindInfo        * pImageBinds
+        1,                                        // uint32_t                                   signalSemaphoreCount
+        &timelineSemaphore                        // const VkSemaphore                        * pSignalSemaphores
+    };
+
+    VkResult result = vkQueueBindSparse(queue, 1, &bindSparseInfo, VK_NULL_HANDLE);
+    if(result != VK_SUCCESS)
+    {
+        std::cerr << "Could not bind virtual texture pages." << std::endl;
+        return false;
+    }
+    mPendingBinds.clear();
+    mMipTailBound = true;
+    return true;
+}
+
+uint32_t VirtualTexture::getPageLevel(uint32_t page) const
+{
+    uint32_t level = 0;
+    while((level + 1 < mLevels.size()) && (mLevels[level + 1].firstPage <= page))
+        ++level;
+    return level;
+}
+
+uint32_t VirtualTexture::getParentPage(uint32_t page) const
+{
+    uint32_t level = getPageLevel(page);
+    Level const &info = mLevels[level];
+    Level const &parent = mLevels[level + 1];
+    uint32_t index = page - info.firstPage;
+    uint32_t x = std::min((index % info.pagesX) / 2, parent.pagesX - 1);
+    uint32_t y = std::min((index / info.pagesX) / 2, parent.pagesY - 1);
+    return parent.firstPage + y * parent.pagesX + x;
+}
+
+void VirtualTexture::getPageRegion(uint32_t page, uint32_t &level, VkOffset3D &offset, VkExtent3D &extent) const
+{
+    level = getPageLevel(page);
+    Level const &info = mLevels[level];
+    uint32_t index = page - info.firstPage;
+    uint32_t x = index % info.pagesX * PAGE_SIZE;
+    uint32_t y = index / info.pagesX * PAGE_SIZE;
+    offset = { static_cast<int32_t>(x), static_cast<int32_t>(y), 0 };
+    extent = { std::min(info.width - x, uint32_t(PAGE_SIZE)), std::min(info.height - y, uint32_t(PAGE_SIZE)), 1 };
+}
+
+bool VirtualTexture::getLevelSource(uint32_t level, uint8_t const *&data)
+{
+    LevelSource &source = mLevelSources[level];
+    std::call_once(source.once, [this, level, &source]() {
+        size_t size;
+        source.valid = mFile.getLevelData(level, source.scratch, source.data, size);
+        Level const &info = mLevels[level];
+        if(source.valid && (size < static_cast<size_t>(info.width) * info.height * TEXEL_BYTES))
+        {
+            std::cerr << "Level " << level << " of the virtual texture is smaller than its extent requires." << std::endl;
+            source.valid = false;
+        }
+    });
+    data = source.data;
+    return source.valid;
+}
+
+bool VirtualTexture::usesSparseResidency() const
+{
+    return mSparse;
+}
+
+VkDescriptorSetLayout VirtualTexture::getDescriptorSetLayout() const
+{
+    return mDescriptorSetLayout;
+}
+
+VkDescriptorSet VirtualTexture::getDescriptorSet(uint32_t frameIndex) const
+{
+    return mFrameSlots[frameIndex].descriptorSet;
+}
+
+VirtualTextureStats VirtualTexture::getStats() const
+{
+    return mStats;
+}
+
+} // namespace VulkanSample
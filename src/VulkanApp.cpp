@@ -1,25 +1,180 @@
+#include <chrono>
+#include <thread>
+
+#include "Profiler.h"
 #include "VulkanApp.h"
+#include "VulkanResources.h"
 
 namespace VulkanSample
 {
 
+namespace
+{
+    char const * const PIPELINE_CACHE_FILENAME = "VulkanSample.pipelinecache";
+
+    // Paces the render loop as long as nothing is presented
+    const std::chrono::microseconds FRAME_INTERVAL(16667);
+
+    std::vector<const char*> getDesiredDeviceExtensions()
+    {
+        return { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    }
+}
+
 VulkanApp::VulkanApp()
 {
+    mVkLibrary     = nullptr;
     mInstance      = VK_NULL_HANDLE;
     mSurface       = VK_NULL_HANDLE;
     mLogicalDevice = VK_NULL_HANDLE;
+    mSwapchain     = VK_NULL_HANDLE;
+    mPipelineCache = VK_NULL_HANDLE;
+
+    mWindowExtent       = { 0, 0 };
+    mSwapchainOutOfDate = true;
+    mMouseX             = 0;
+    mMouseY             = 0;
+    mMouseButtons[0]    = false;
+    mMouseButtons[1]    = false;
+    mMouseWheel         = 0.0f;
+}
+
+void VulkanApp::startInit()
+{
+    if(mInstanceStage.valid())
+        return;
+
+    mInstanceStage = std::async(std::launch::async, &VulkanApp::createInstanceStage, this);
+
+    // Only needs the file system, the data is validated against the device once it exists
+    mPipelineCacheData = std::async(std::launch::async, [this]()
+    {
+        StartupStage stage(mStartupTimeline, "Read pipeline cache");
+        std::vector<unsigned char> data;
+        loadPipelineCacheData(PIPELINE_CACHE_FILENAME, data);
+        return data;
+    });
 }
 
 bool VulkanApp::init(WindowParameters windowParameters)
 {
-    if (!loadVkLibrary(mVkLibrary))
-        return false;
+    PROFILE_FUNCTION();
 
-    if (!loadFunctionFromVulkanLibrary(mVkLibrary))
+    startInit();
+    if(!mInstanceStage.get())
         return false;
 
-    if(!loadGlobalLevelFunctions())
-        return false;
+    {
+        StartupStage stage(mStartupTimeline, "Create presentation surface");
+        if(!createPresentationSurface(mInstance, windowParameters, mSurface))
+            return false;
+    }
+
+    {
+        StartupStage stage(mStartupTimeline, "Create logical device");
+        if(!createLogicalDevice(mPhysicalDevices, mLogicalDevice, getDesiredDeviceExtensions(), mSurface, mGraphicsQueue,
+                                mComputeQueue, mPresentQueue, mDeviceCapabilities))
+            return false;
+    }
+
+    std::vector<unsigned char> pipelineCacheData = mPipelineCacheData.get();
+    {
+        StartupStage stage(mStartupTimeline, "Create pipeline cache");
+        if(!createPipelineCache(mLogicalDevice, mDeviceCapabilities.properties, pipelineCacheData, mPipelineCache))
+            return false;
+    }
+
+    mStartupTimeline.finish();
+    return true;
+}
+
+void VulkanApp::runRenderLoop(WindowEventQueue &events)
+{
+    PROFILE_THREAD_NAME("Render");
+
+    std::vector<WindowEvent> frameEvents;
+    auto nextFrame = std::chrono::steady_clock::now();
+    while(true)
+    {
+        PROFILE_ZONE("Frame");
+
+        frameEvents.clear();
+        events.poll(frameEvents);
+        if(!handleWindowEvents(frameEvents))
+            break;
+
+        // A minimized window has nothing to render into, the frame is skipped
+        if(mWindowExtent.width > 0 && mWindowExtent.height > 0)
+        {
+            // Recording and submission of the frame go here; the swapchain is recreated first
+            // when a resize marked it out of date
+            mSwapchainOutOfDate = false;
+        }
+        mMouseWheel = 0.0f;
+
+        nextFrame += FRAME_INTERVAL;
+        auto now = std::chrono::steady_clock::now();
+        if(nextFrame < now)
+            nextFrame = now;
+        std::this_thread::sleep_until(nextFrame);
+    }
+
+    if(mLogicalDevice)
+        vkDeviceWaitIdle(mLogicalDevice);
+}
+
+bool VulkanApp::handleWindowEvents(std::vector<WindowEvent> const &events)
+{
+    for(auto &event : events)
+    {
+        switch(event.type)
+        {
+        case WindowEventType::Quit:
+            return false;
+        case WindowEventType::Resize:
+            if(event.width != mWindowExtent.width || event.height != mWindowExtent.height)
+            {
+                mWindowExtent = { event.width, event.height };
+                mSwapchainOutOfDate = true;
+            }
+            break;
+        case WindowEventType::MouseMove:
+            mMouseX = event.x;
+            mMouseY = event.y;
+            break;
+        case WindowEventType::MouseClick:
+            if(event.button < 2)
+                mMouseButtons[event.button] = event.pressed;
+            break;
+        case WindowEventType::MouseWheel:
+            mMouseWheel += event.wheelDelta;
+            break;
+        }
+    }
+    return true;
+}
+
+StartupTimeline &VulkanApp::getStartupTimeline()
+{
+    return mStartupTimeline;
+}
+
+// Runs on a worker thread while the window is created, nothing here depends on the window
+bool VulkanApp::createInstanceStage()
+{
+    PROFILE_THREAD_NAME("Start-up");
+
+    {
+        StartupStage stage(mStartupTimeline, "Load Vulkan library");
+        if (!loadVkLibrary(mVkLibrary))
+            return false;
+
+        if (!loadFunctionFromVulkanLibrary(mVkLibrary))
+            return false;
+
+        if(!loadGlobalLevelFunctions())
+            return false;
+    }
 
     std::vector<const char*> desiredInstanceExtensions;
     desiredInstanceExtensions.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
@@ -33,29 +188,59 @@ bool VulkanApp::init(WindowParameters windowParameters)
 #endif
     );
 
-    if (!createInstance(desiredInstanceExtensions, "VulkanSample", mInstance))
-        return false;
-
-    if (!loadInstanceLevelFunctions(mInstance, {}))
-        return false;
+    {
+        StartupStage stage(mStartupTimeline, "Create instance");
+        if (!createInstance(desiredInstanceExtensions, "VulkanSample", mInstance))
+            return false;
 
-    if(!createPresentationSurface(mInstance, windowParameters, mSurface))
-        return false;
+        if (!loadInstanceLevelFunctions(mInstance, desiredInstanceExtensions))
+            return false;
+    }
 
     std::vector<VkPhysicalDevice> physicalDevices;
-    if (!enumerateAvailablePhysicalDevices(mInstance, physicalDevices))
-        return false;
+    {
+        StartupStage stage(mStartupTimeline, "Enumerate physical devices");
+        if (!enumerateAvailablePhysicalDevices(mInstance, physicalDevices))
+            return false;
+    }
 
-    std::vector<const char*> desiredDeviceExtensions;
-    desiredDeviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-    if(!createLogicalDevice(mInstance, mLogicalDevice, desiredDeviceExtensions, mSurface, mGraphicsQueue, mComputeQueue, mPresentQueue))
-        return false;
+    // Devices are independent, each one is probed on its own thread and this one takes the first
+    mPhysicalDevices.resize(physicalDevices.size());
+    std::vector<std::future<void>> probes;
+    for(size_t index = 1; index < physicalDevices.size(); ++index)
+    {
+        probes.push_back(std::async(std::launch::async, [this, &physicalDevices, index]()
+        {
+            probePhysicalDevice(physicalDevices[index], mPhysicalDevices[index]);
+        }));
+    }
+    probePhysicalDevice(physicalDevices[0], mPhysicalDevices[0]);
+    for(auto &probe : probes)
+        probe.wait();
 
     return true;
 }
 
+void VulkanApp::probePhysicalDevice(VkPhysicalDevice physicalDevice, PhysicalDeviceProbe &probe)
+{
+    StartupTimeline::Clock::time_point begin = StartupTimeline::Clock::now();
+    VulkanSample::probePhysicalDevice(physicalDevice, getDesiredDeviceExtensions(), probe);
+    mStartupTimeline.record(std::string("Probe ") + probe.properties.deviceName, begin, StartupTimeline::Clock::now());
+}
+
 VulkanApp::~VulkanApp()
 {
+  if(mInstanceStage.valid())
+    mInstanceStage.wait();
+  if(mPipelineCacheData.valid())
+    mPipelineCacheData.wait();
+
+  if(mPipelineCache)
+  {
+    savePipelineCache(mLogicalDevice, mPipelineCache, PIPELINE_CACHE_FILENAME);
+    destroyPipelineCache(mLogicalDevice, mPipelineCache);
+  }
+
   if(mSwapchain)
     vkDestroySwapchainKHR(mLogicalDevice, mSwapchain, nullptr);
 
@@ -8,6 +8,8 @@ namespace VulkanSample
 #define INSTANCE_LEVEL_VULKAN_FUNCTION(name) PFN_##name name;
 #define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension) PFN_##name name;
 #define DEVICE_LEVEL_VULKAN_FUNCTION(name) PFN_##name name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_LAZY(name) PFN_##name name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_VERSION(name, version) PFN_##name name;
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension) PFN_##name name;
 
 #include "ListOfVulkanFunctions.inl"
@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "VulkanResources.h"
+
+#ifndef VULKANSAMPLE_SHADER_DIRECTORY
+#define VULKANSAMPLE_SHADER_DIRECTORY "shaders/"
+#endif
+
+namespace VulkanSample
+{
+
+bool getBinaryFileContents(std::string const &filename, std::vector<unsigned char> &contents)
+{
+  contents.clear();
+
+  std::ifstream file(filename, std::ios::binary);
+  if(file.fail())
+  {
+    std::cerr << "Could not open '" << filename << "' file." << std::endl;
+    return false;
+  }
+
+  std::streampos begin = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streampos end = file.tellg();
+
+  contents.resize(static_cast<size_t>(end - begin));
+  file.seekg(0, std::ios::beg);
+  file.read(reinterpret_cast<char*>(contents.data()), end - begin);
+  if(file.fail())
+  {
+    std::cerr << "Could not read '" << filename << "' file." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+std::string getShaderPath(char const *shaderName)
+{
+  return std::string(VULKANSAMPLE_SHADER_DIRECTORY) + shaderName + ".spv";
+}
+
+bool selectMemoryType(VkPhysicalDeviceMemoryProperties const &memoryProperties, uint32_t memoryTypeBits,
+                      VkMemoryPropertyFlags desiredProperties, uint32_t &memoryTypeIndex)
+{
+  for(uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type)
+  {
+    if((memoryTypeBits & (1u << type)) &&
+       ((memoryProperties.memoryTypes[type].propertyFlags & desiredProperties) == desiredProperties))
+    {
+      memoryTypeIndex = type;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool createBuffer(VkDevice logicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer,
+                  std::vector<uint32_t> const &queueFamilies)
+{
+  std::vector<uint32_t> sharingFamilies;
+  for(uint32_t family : queueFamilies)
+  {
+    if(std::find(sharingFamilies.begin(), sharingFamilies.end(), family) == sharingFamilies.end())
+      sharingFamilies.push_back(family);
+  }
+  bool concurrent = sharingFamilies.size() > 1;
+
+  VkBufferCreateInfo bufferCreateInfo = {
+    VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,                                   // VkStructureType        sType
+    nullptr,                                                                // const void           * pNext
+    0,                                                                      // VkBufferCreateFlags    flags
+    size,                                                                   // VkDeviceSize           size
+    usage,                                                                  // VkBufferUsageFlags     usage
+    concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,    // VkSharingMode          sharingMode
+    concurrent ? static_cast<uint32_t>(sharingFamilies.size()) : 0,         // uint32_t               queueFamilyIndexCount
+    concurrent ? sharingFamilies.data() : nullptr                           // const uint32_t       * pQueueFamilyIndices
+  };
+
+  VkResult result = vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, &buffer);
+  if((result != VK_SUCCESS) || (buffer == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not create a buffer." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool allocateAndBindMemoryObjectToBuffer(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                                         VkBuffer buffer, VkMemoryPropertyFlags memoryObjectProperties,
+                                         VkDeviceMemory &memoryObject, VkMemoryAllocateFlags allocateFlags)
+{
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(logicalDevice, buffer, &memoryRequirements);
+
+  uint32_t memoryTypeIndex;
+  if(!selectMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, memoryObjectProperties, memoryTypeIndex))
+  {
+    std::cerr << "Could not find a memory type for a buffer." << std::endl;
+    return false;
+  }
+
+  VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo = {
+    VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,   // VkStructureType          sType
+    nullptr,                                        // const void             * pNext
+    allocateFlags,                                  // VkMemoryAllocateFlags    flags
+    0                                               // uint32_t                 deviceMask
+  };
+
+  VkMemoryAllocateInfo bufferMemoryAllocateInfo = {
+    VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,                     // VkStructureType    sType
+    allocateFlags != 0 ? &memoryAllocateFlagsInfo : nullptr,    // const void       * pNext
+    memoryRequirements.size,                                    // VkDeviceSize       allocationSize
+    memoryTypeIndex                                             // uint32_t           memoryTypeIndex
+  };
+
+  VkResult result = vkAllocateMemory(logicalDevice, &bufferMemoryAllocateInfo, nullptr, &memoryObject);
+  if((result != VK_SUCCESS) || (memoryObject == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not allocate memory for a buffer." << std::endl;
+    return false;
+  }
+
+  result = vkBindBufferMemory(logicalDevice, buffer, memoryObject, 0);
+  if(result != VK_SUCCESS)
+  {
+    std::cerr << "Could not bind memory object to a buffer." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool createHostVisibleBuffer(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                             VkDeviceSize size, VkBufferUsageFlags usage, void const *data,
+                             VkBuffer &buffer, VkDeviceMemory &memoryObject)
+{
+  if(!createBuffer(logicalDevice, size, usage, buffer))
+    return false;
+
+  if(!allocateAndBindMemoryObjectToBuffer(memoryProperties, logicalDevice, buffer,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                          memoryObject))
+    return false;
+
+  if(data == nullptr)
+    return true;
+
+  void *pointer;
+  VkResult result = vkMapMemory(logicalDevice, memoryObject, 0, size, 0, &pointer);
+  if(result != VK_SUCCESS)
+  {
+    std::cerr << "Could not map memory object." << std::endl;
+    return false;
+  }
+  std::memcpy(pointer, data, static_cast<size_t>(size));
+  vkUnmapMemory(logicalDevice, memoryObject);
+  return true;
+}
+
+bool createDeviceAddressBuffer(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                               VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryObjectProperties,
+                               VkBuffer &buffer, VkDeviceMemory &memoryObject, VkDeviceAddress &deviceAddress,
+                               std::vector<uint32_t> const &queueFamilies)
+{
+  if(!createBuffer(logicalDevice, size, usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, buffer, queueFamilies))
+    return false;
+
+  if(!allocateAndBindMemoryObjectToBuffer(memoryProperties, logicalDevice, buffer, memoryObjectProperties, memoryObject,
+                                          VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT))
+    return false;
+
+  deviceAddress = getBufferDeviceAddress(logicalDevice, buffer);
+  return true;
+}
+
+VkDeviceAddress getBufferDeviceAddress(VkDevice logicalDevice, VkBuffer buffer)
+{
+  VkBufferDeviceAddressInfo bufferDeviceAddressInfo = {
+    VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,   // VkStructureType    sType
+    nullptr,                                        // const void       * pNext
+    buffer                                          // VkBuffer           buffer
+  };
+  return vkGetBufferDeviceAddress(logicalDevice, &bufferDeviceAddressInfo);
+}
+
+bool isFormatFeatureSupported(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatFeatureFlags features)
+{
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+  return (formatProperties.optimalTilingFeatures & features) == features;
+}
+
+bool allocateAndBindMemoryObjectToImage(VkPhysicalDeviceMemoryProperties const &memoryProperties, VkDevice logicalDevice,
+                                        VkImage image, VkMemoryPropertyFlags memoryObjectProperties,
+                                        VkDeviceMemory &memoryObject)
+{
+  VkMemoryRequirements memoryRequirements;
+  vkGetImageMemoryRequirements(logicalDevice, image, &memoryRequirements);
+
+  uint32_t memoryTypeIndex;
+  if(!selectMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, memoryObjectProperties, memoryTypeIndex))
+  {
+    std::cerr << "Could not find a memory type for an image." << std::endl;
+    return false;
+  }
+
+  VkMemoryAllocateInfo imageMemoryAllocateInfo = {
+    VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,   // VkStructureType    sType
+    nullptr,                                  // const void       * pNext
+    memoryRequirements.size,                  // VkDeviceSize       allocationSize
+    memoryTypeIndex                           // uint32_t           memoryTypeIndex
+  };
+
+  VkResult result = vkAllocateMemory(logicalDevice, &imageMemoryAllocateInfo, nullptr, &memoryObject);
+  if((result != VK_SUCCESS) || (memoryObject == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not allocate memory for an image." << std::endl;
+    return false;
+  }
+
+  result = vkBindImageMemory(logicalDevice, image, memoryObject, 0);
+  if(result != VK_SUCCESS)
+  {
+    std::cerr << "Could not bind memory object to an image." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool createImageView(VkDevice logicalDevice, VkImage image, VkFormat format, uint32_t baseMipLevel, uint32_t levelCount,
+                     VkImageView &imageView)
+{
+  VkImageViewCreateInfo imageViewCreateInfo = {
+    VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,   // VkStructureType            sType
+    nullptr,                                    // const void               * pNext
+    0,                                          // VkImageViewCreateFlags     flags
+    image,                                      // VkImage                    image
+    VK_IMAGE_VIEW_TYPE_2D,                      // VkImageViewType            viewType
+    format,                                     // VkFormat                   format
+    {                                           // VkComponentMapping         components
+      VK_COMPONENT_SWIZZLE_IDENTITY,              // VkComponentSwizzle         r
+      VK_COMPONENT_SWIZZLE_IDENTITY,              // VkComponentSwizzle         g
+      VK_COMPONENT_SWIZZLE_IDENTITY,              // VkComponentSwizzle         b
+      VK_COMPONENT_SWIZZLE_IDENTITY               // VkComponentSwizzle         a
+    },
+    {                                           // VkImageSubresourceRange    subresourceRange
+      VK_IMAGE_ASPECT_COLOR_BIT,                  // VkImageAspectFlags         aspectMask
+      baseMipLevel,                               // uint32_t                   baseMipLevel
+      levelCount,                                 // uint32_t                   levelCount
+      0,                                          // uint32_t                   baseArrayLayer
+      1                                           // uint32_t                   layerCount
+    }
+  };
+
+  VkResult result = vkCreateImageView(logicalDevice, &imageViewCreateInfo, nullptr, &imageView);
+  if((result != VK_SUCCESS) || (imageView == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not create an image view." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool createSampler(VkDevice logicalDevice, VkFilter filter, VkSamplerAddressMode addressMode, VkSampler &sampler)
+{
+  VkSamplerMipmapMode mipmapMode = filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  VkSamplerCreateInfo samplerCreateInfo = {
+    VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,    // VkStructureType          sType
+    nullptr,                                  // const void             * pNext
+    0,                                        // VkSamplerCreateFlags     flags
+    filter,                                   // VkFilter                 magFilter
+    filter,                                   // VkFilter                 minFilter
+    mipmapMode,                               // VkSamplerMipmapMode      mipmapMode
+    addressMode,                              // VkSamplerAddressMode     addressModeU
+    addressMode,                              // VkSamplerAddressMode     addressModeV
+    addressMode,                              // VkSamplerAddressMode     addressModeW
+    0.0f,                                     // float                    mipLodBias
+    VK_FALSE,                                 // VkBool32                 anisotropyEnable
+    1.0f,                                     // float                    maxAnisotropy
+    VK_FALSE,                                 // VkBool32                 compareEnable
+    VK_COMPARE_OP_ALWAYS,                     // VkCompareOp              compareOp
+    0.0f,                                     // float                    minLod
+    VK_LOD_CLAMP_NONE,                        // float                    maxLod
+    VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,  // VkBorderColor            borderColor
+    VK_FALSE                                  // VkBool32                 unnormalizedCoordinates
+  };
+
+  VkResult result = vkCreateSampler(logicalDevice, &samplerCreateInfo, nullptr, &sampler);
+  if((result != VK_SUCCESS) || (sampler == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not create a sampler." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool createShaderModule(VkDevice logicalDevice, std::vector<unsigned char> const &sourceCode, VkShaderModule &shaderModule)
+{
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {
+    VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,                // VkStructureType              sType
+    nullptr,                                                    // const void                 * pNext
+    0,                                                          // VkShaderModuleCreateFlags    flags
+    sourceCode.size(),                                          // size_t                       codeSize
+    reinterpret_cast<uint32_t const *>(sourceCode.data())       // const uint32_t             * pCode
+  };
+
+  VkResult result = vkCreateShaderModule(logicalDevice, &shaderModuleCreateInfo, nullptr, &shaderModule);
+  if((result != VK_SUCCESS) || (shaderModule == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not create a shader module." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool createShaderModuleFromFile(VkDevice logicalDevice, char const *shaderName, VkShaderModule &shaderModule)
+{
+  std::vector<unsigned char> sourceCode;
+  if(!getBinaryFileContents(getShaderPath(shaderName), sourceCode))
+    return false;
+
+  return createShaderModule(logicalDevice, sourceCode, shaderModule);
+}
+
+bool createComputePipeline(VkDevice logicalDevice, VkShaderModule shaderModule, VkPipelineLayout pipelineLayout,
+                           VkSpecializationInfo const *specializationInfo, VkPipelineCache pipelineCache,
+                           VkPipeline &computePipeline)
+{
+  VkPipelineShaderStageCreateInfo shaderStage = {
+    VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,  // VkStructureType                    sType
+    nullptr,                                              // const void                       * pNext
+    0,                                                    // VkPipelineShaderStageCreateFlags   flags
+    VK_SHADER_STAGE_COMPUTE_BIT,                          // VkShaderStageFlagBits              stage
+    shaderModule,                                         // VkShaderModule                     module
+    "main",                                               // const char                       * pName
+    specializationInfo                                    // const VkSpecializationInfo       * pSpecializationInfo
+  };
+
+  VkComputePipelineCreateInfo computePipelineCreateInfo = {
+    VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,   // VkStructureType                    sType
+    nullptr,                                          // const void                       * pNext
+    0,                                                // VkPipelineCreateFlags              flags
+    shaderStage,                                      // VkPipelineShaderStageCreateInfo    stage
+    pipelineLayout,                                   // VkPipelineLayout                   layout
+    VK_NULL_HANDLE,                                   // VkPipeline                         basePipelineHandle
+    -1                                                // int32_t                            basePipelineIndex
+  };
+
+  VkResult result = vkCreateComputePipelines(logicalDevice, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &computePipeline);
+  if((result != VK_SUCCESS) || (computePipeline == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not create compute pipeline." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool loadPipelineCacheData(std::string const &filename, std::vector<unsigned char> &data)
+{
+  data.clear();
+  if(std::ifstream(filename, std::ios::binary).fail())
+    return true;
+
+  return getBinaryFileContents(filename, data);
+}
+
+bool createPipelineCache(VkDevice logicalDevice, VkPhysicalDeviceProperties const &properties,
+                         std::vector<unsigned char> const &initialData, VkPipelineCache &pipelineCache)
+{
+  bool compatible = initialData.size() >= sizeof(VkPipelineCacheHeaderVersionOne);
+  if(compatible)
+  {
+    VkPipelineCacheHeaderVersionOne header;
+    std::memcpy(&header, initialData.data(), sizeof(header));
+    compatible = (header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+                 (header.vendorID == properties.vendorID) && (header.deviceID == properties.deviceID) &&
+                 (std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+  }
+
+  VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {
+    VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,     // VkStructureType                sType
+    nullptr,                                          // const void                   * pNext
+    0,                                                // VkPipelineCacheCreateFlags     flags
+    compatible ? initialData.size() : 0,              // size_t                         initialDataSize
+    compatible ? initialData.data() : nullptr         // const void                   * pInitialData
+  };
+
+  VkResult result = vkCreatePipelineCache(logicalDevice, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+  if((result != VK_SUCCESS) || (pipelineCache == VK_NULL_HANDLE))
+  {
+    std::cerr << "Could not create pipeline cache." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool savePipelineCache(VkDevice logicalDevice, VkPipelineCache pipelineCache, std::string const &filename)
+{
+  size_t dataSize = 0;
+  VkResult result = vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, nullptr);
+  if((result != VK_SUCCESS) || (dataSize == 0))
+  {
+    std::cerr << "Could not get the size of pipeline cache data." << std::endl;
+    return false;
+  }
+
+  std::vector<unsigned char> data(dataSize);
+  result = vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, data.data());
+  if((result != VK_SUCCESS) && (result != VK_INCOMPLETE))
+  {
+    std::cerr << "Could not get pipeline cache data." << std::endl;
+    return false;
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<char const *>(data.data()), static_cast<std::streamsize>(dataSize));
+  if(file.fail())
+  {
+    std::cerr << "Could not write '" << filename << "' file." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void destroyBuffer(VkDevice logicalDevice, VkBuffer &buffer)
+{
+  if(buffer != VK_NULL_HANDLE)
+  {
+    vkDestroyBuffer(logicalDevice, buffer, nullptr);
+    buffer = VK_NULL_HANDLE;
+  }
+}
+
+void destroyImage(VkDevice logicalDevice, VkImage &image)
+{
+  if(image != VK_NULL_HANDLE)
+  {
+    vkDestroyImage(logicalDevice, image, nullptr);
+    image = VK_NULL_HANDLE;
+  }
+}
+
+void destroyImageView(VkDevice logicalDevice, VkImageView &imageView)
+{
+  if(imageView != VK_NULL_HANDLE)
+  {
+    vkDestroyImageView(logicalDevice, imageView, nullptr);
+    imageView = VK_NULL_HANDLE;
+  }
+}
+
+void destroySampler(VkDevice logicalDevice, VkSampler &sampler)
+{
+  if(sampler != VK_NULL_HANDLE)
+  {
+    vkDestroySampler(logicalDevice, sampler, nullptr);
+    sampler = VK_NULL_HANDLE;
+  }
+}
+
+void freeMemoryObject(VkDevice logicalDevice, VkDeviceMemory &memoryObject)
+{
+  if(memoryObject != VK_NULL_HANDLE)
+  {
+    vkFreeMemory(logicalDevice, memoryObject, nullptr);
+    memoryObject = VK_NULL_HANDLE;
+  }
+}
+
+void destroyShaderModule(VkDevice logicalDevice, VkShaderModule &shaderModule)
+{
+  if(shaderModule != VK_NULL_HANDLE)
+  {
+    vkDestroyShaderModule(logicalDevice, shaderModule, nullptr);
+    shaderModule = VK_NULL_HANDLE;
+  }
+}
+
+void destroyPipeline(VkDevice logicalDevice, VkPipeline &pipeline)
+{
+  if(pipeline != VK_NULL_HANDLE)
+  {
+    vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+    pipeline = VK_NULL_HANDLE;
+  }
+}
+
+void destroyPipelineLayout(VkDevice logicalDevice, VkPipelineLayout &pipelineLayout)
+{
+  if(pipelineLayout != VK_NULL_HANDLE)
+  {
+    vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+    pipelineLayout = VK_NULL_HANDLE;
+  }
+}
+
+void destroyDescriptorSetLayout(VkDevice logicalDevice, VkDescriptorSetLayout &descriptorSetLayout)
+{
+  if(descriptorSetLayout != VK_NULL_HANDLE)
+  {
+    vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+    descriptorSetLayout = VK_NULL_HANDLE;
+  }
+}
+
+void destroyDescriptorPool(VkDevice logicalDevice, VkDescriptorPool &descriptorPool)
+{
+  if(descriptorPool != VK_NULL_HANDLE)
+  {
+    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    descriptorPool = VK_NULL_HANDLE;
+  }
+}
+
+void destroyPipelineCache(VkDevice logicalDevice, VkPipelineCache &pipelineCache)
+{
+  if(pipelineCache != VK_NULL_HANDLE)
+  {
+    vkDestroyPipelineCache(logicalDevice, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+  }
+}
+
+} // namespace VulkanSample
@@ -0,0 +1,110 @@
+#include "WindowEventQueue.h"
+
+namespace VulkanSample
+{
+
+WindowEventQueue::WindowEventQueue() : mRing(CAPACITY)
+{
+    mPendingMove   = {};
+    mPendingResize = {};
+    mMovePending   = false;
+    mResizePending = false;
+    mQuitRequested = false;
+    mQuitDelivered = false;
+    mPosted        = 0;
+    mMerged        = 0;
+    mDropped       = 0;
+}
+
+bool WindowEventQueue::push(WindowEvent const &event)
+{
+    if(mRing.push(event))
+        return true;
+    ++mDropped;
+    return false;
+}
+
+void WindowEventQueue::post(WindowEvent const &event)
+{
+    ++mPosted;
+    switch(event.type)
+    {
+    case WindowEventType::MouseMove:
+        mMerged += mMovePending ? 1 : 0;
+        mPendingMove = event;
+        mMovePending = true;
+        break;
+    case WindowEventType::Resize:
+        mMerged += mResizePending ? 1 : 0;
+        mPendingResize = event;
+        mResizePending = true;
+        break;
+    case WindowEventType::Quit:
+        mQuitRequested = true;
+        flush();
+        push(event);
+        break;
+    default:
+        // A click applies at the position the pointer had when it happened
+        flush();
+        push(event);
+        break;
+    }
+}
+
+void WindowEventQueue::flush()
+{
+    // State updates that do not fit stay pending and are retried with the next batch
+    if(mResizePending && mRing.push(mPendingResize))
+        mResizePending = false;
+    if(mMovePending && mRing.push(mPendingMove))
+        mMovePending = false;
+}
+
+void WindowEventQueue::poll(std::vector<WindowEvent> &events)
+{
+    size_t first = events.size();
+    WindowEvent event;
+    while(mRing.pop(event))
+    {
+        if(event.type == WindowEventType::Quit)
+        {
+            if(mQuitDelivered)
+                continue;
+            mQuitDelivered = true;
+        }
+        else if(events.size() > first && (event.type == WindowEventType::MouseMove || event.type == WindowEventType::Resize) &&
+                events.back().type == event.type)
+        {
+            events.back() = event;
+            ++mMerged;
+            continue;
+        }
+        events.push_back(event);
+    }
+
+    // The quit event itself may have been dropped on a full ring
+    if(mQuitRequested && !mQuitDelivered)
+    {
+        WindowEvent quit = {};
+        quit.type = WindowEventType::Quit;
+        events.push_back(quit);
+        mQuitDelivered = true;
+    }
+}
+
+bool WindowEventQueue::isQuitRequested() const
+{
+    return mQuitRequested;
+}
+
+WindowEventStats WindowEventQueue::getStats() const
+{
+    WindowEventStats stats;
+    stats.posted  = mPosted;
+    stats.merged  = mMerged;
+    stats.dropped = mDropped;
+    return stats;
+}
+
+} // namespace VulkanSample
@@ -1,22 +1,53 @@
+#include <cstdlib>
+#include <thread>
+
+#include "Profiler.h"
 #include "VulkanApp.h"
 
 int main()
 {
+  // The window is created on this thread (it owns the window's messages) while Vulkan is brought up in the background
+  VulkanSample::VulkanApp app;
+  app.startInit();
+
   VulkanSample::WindowParameters windowParameters = {};
-  if(!VulkanSample::createWindowHandle(windowParameters, "VulkanSample", 50, 25, 1280, 800))
   {
-      std::cerr << "Failed to create window handle" << std::endl;
-      return -1;
+    VulkanSample::StartupStage stage(app.getStartupTimeline(), "Create window");
+    if(!VulkanSample::createWindowHandle(windowParameters, "VulkanSample", 50, 25, 1280, 800))
+    {
+        std::cerr << "Failed to create window handle" << std::endl;
+        return -1;
+    }
   }
 
-  VulkanSample::VulkanApp app;
   if (!app.init(windowParameters))
   {
       std::cerr << "Error initializing Vulkan application, finishing execution..." << std::endl;
       return -1;
   }
+  app.getStartupTimeline().print(std::cout);
+
+  // This thread keeps pumping the window's messages while a separate thread renders; they only
+  // share the event ring, so dragging or resizing the window never stalls frame submission
+  VulkanSample::WindowEventQueue events;
+  std::thread renderThread([&]()
+  {
+    app.runRenderLoop(events);
+    VulkanSample::exitWindowEventLoop(windowParameters);
+  });
+  VulkanSample::runWindowEventLoop(windowParameters, events);
+  renderThread.join();
 
   VulkanSample::destroyWindowHandle(windowParameters);
 
+#ifdef VULKANSAMPLE_PROFILING
+  // VULKANSAMPLE_PROFILE=<path> writes <path>.json (chrome://tracing, Perfetto) and <path>.vsprof
+  if(char const *profilePath = std::getenv("VULKANSAMPLE_PROFILE"))
+  {
+    VulkanSample::exportProfileChromeTrace(std::string(profilePath) + ".json");
+    VulkanSample::exportProfileBinary(std::string(profilePath) + ".vsprof");
+  }
+#endif
+
   return 0;
 }
@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "ClusteredLighting.h"
+#include "Common.h"
+#include "VulkanResources.h"
+
+// Validates the clustered light assignment against the CPU reference and reports the GPU time of
+// the culling pass, measured with timestamp queries, for a sweep of light counts and resolutions.
+// Usage: ClusteredLightingBenchmark [iterations] [tileSize] [depthSlices]
+
+using namespace VulkanSample;
+
+namespace
+{
+  const VkExtent2D RESOLUTIONS[] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+  const uint32_t LIGHT_COUNTS[] = { 256, 1024, 4096, 16384 };
+  const float NEAR_PLANE = 0.1f;
+  const float FAR_PLANE  = 100.0f;
+
+  struct BenchmarkDevice
+  {
+    VkDevice           logicalDevice;
+    DeviceCapabilities capabilities;
+    QueueParameters    queue;
+    VkCommandPool      commandPool;
+    VkCommandBuffer    commandBuffer;
+    VkQueryPool        queryPool;
+    VkBuffer           stagingBuffer;
+    VkDeviceMemory     stagingMemory;
+    void              *stagingData;
+  };
+
+  bool submitAndWait(BenchmarkDevice &device, std::function<void(VkCommandBuffer)> const &record)
+  {
+    VkCommandBufferBeginInfo beginInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,   // VkStructureType                        sType
+      nullptr,                                       // const void                           * pNext
+      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,   // VkCommandBufferUsageFlags              flags
+      nullptr                                        // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+    };
+
+    if((vkResetCommandPool(device.logicalDevice, device.commandPool, 0) != VK_SUCCESS) ||
+       (vkBeginCommandBuffer(device.commandBuffer, &beginInfo) != VK_SUCCESS))
+    {
+      std::cerr << "Could not begin command buffer." << std::endl;
+      return false;
+    }
+    record(device.commandBuffer);
+    if(vkEndCommandBuffer(device.commandBuffer) != VK_SUCCESS)
+    {
+      std::cerr << "Could not end command buffer." << std::endl;
+      return false;
+    }
+
+    VkCommandBufferSubmitInfo commandBufferInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,  // VkStructureType    sType
+      nullptr,                                       // const void       * pNext
+      device.commandBuffer,                          // VkCommandBuffer    commandBuffer
+      0                                              // uint32_t           deviceMask
+    };
+
+    VkSubmitInfo2 submitInfo = {
+      VK_STRUCTURE_TYPE_SUBMIT_INFO_2,               // VkStructureType                    sType
+      nullptr,                                       // const void                       * pNext
+      0,                                             // VkSubmitFlags                      flags
+      0,                                             // uint32_t                           waitSemaphoreInfoCount
+      nullptr,                                       // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+      1,                                             // uint32_t                           commandBufferInfoCount
+      &commandBufferInfo,                            // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+      0,                                             // uint32_t                           signalSemaphoreInfoCount
+      nullptr                                        // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+    };
+
+    if((vkQueueSubmit2(device.queue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) ||
+       (vkQueueWaitIdle(device.queue.handle) != VK_SUCCESS))
+    {
+      std::cerr << "Could not execute command buffer." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  void recordBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+  {
+    VkMemoryBarrier2 memoryBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,                               // VkStructureType          sType
+      nullptr,                                                          // const void             * pNext
+      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,                           // VkPipelineStageFlags2    srcStageMask
+      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT, // VkAccessFlags2 srcAccessMask
+      dstStageMask,                                                     // VkPipelineStageFlags2    dstStageMask
+      dstAccessMask                                                     // VkAccessFlags2           dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+      VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+      nullptr,                                // const void                     * pNext
+      0,                                      // VkDependencyFlags                dependencyFlags
+      1,                                      // uint32_t                         memoryBarrierCount
+      &memoryBarrier,                         // const VkMemoryBarrier2         * pMemoryBarriers
+      0,                                      // uint32_t                         bufferMemoryBarrierCount
+      nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+      0,                                      // uint32_t                         imageMemoryBarrierCount
+      nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+  }
+
+  bool download(BenchmarkDevice &device, VkBuffer buffer, size_t count, std::vector<uint32_t> &data)
+  {
+    VkDeviceSize size = count * sizeof(uint32_t);
+    bool result = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      VkBufferCopy region = { 0, 0, size };
+      vkCmdCopyBuffer(commandBuffer, buffer, device.stagingBuffer, 1, &region);
+    });
+    data.assign(static_cast<uint32_t*>(device.stagingData), static_cast<uint32_t*>(device.stagingData) + count);
+    return result;
+  }
+
+  // Records the culling iterations times between two timestamps, returns the GPU time in seconds
+  bool measure(BenchmarkDevice &device, uint32_t iterations, std::function<void(VkCommandBuffer)> const &record, double &seconds)
+  {
+    bool result = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      vkCmdResetQueryPool(commandBuffer, device.queryPool, 0, 2);
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, device.queryPool, 0);
+      for(uint32_t iteration = 0; iteration < iterations; ++iteration)
+      {
+        // The next iteration resets the counter the previous one incremented
+        if(iteration > 0)
+          recordBarrier(commandBuffer, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+        record(commandBuffer);
+      }
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, device.queryPool, 1);
+    });
+    if(!result)
+      return false;
+
+    uint64_t timestamps[2];
+    if(vkGetQueryPoolResults(device.logicalDevice, device.queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                             VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+    {
+      std::cerr << "Could not read timestamp queries." << std::endl;
+      return false;
+    }
+    seconds = (timestamps[1] - timestamps[0]) * static_cast<double>(device.capabilities.properties.limits.timestampPeriod) * 1e-9;
+    return true;
+  }
+
+  // Lights spread through the view frustum up to 60 units away, with radii of 0.5 to 2 units
+  void generateLights(ClusteredLightingView const &view, uint32_t count, std::vector<ClusteredLight> &lights)
+  {
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    lights.resize(count);
+    for(auto &light : lights)
+    {
+      float depth = 1.0f + 59.0f * std::cbrt(unit(random));   // uniform in volume
+      light.position[0] = (2.0f * unit(random) - 1.0f) * view.tanHalfFovX * depth;
+      light.position[1] = (2.0f * unit(random) - 1.0f) * view.tanHalfFovY * depth;
+      light.position[2] = -depth;
+      light.radius      = 0.5f + 1.5f * unit(random);
+      light.color[0]    = unit(random);
+      light.color[1]    = unit(random);
+      light.color[2]    = unit(random);
+      light.intensity   = 1.0f;
+    }
+  }
+
+  // GPU lights of each cluster must lie between the assignments of slightly shrunk and grown
+  // lights, the clusters of the fragment shader only need to be conservative up to rounding
+  bool validate(std::vector<uint32_t> const &ranges, std::vector<uint32_t> const &indices,
+                std::vector<std::vector<uint32_t>> const &inner, std::vector<std::vector<uint32_t>> const &outer,
+                double &averageLights)
+  {
+    uint64_t total = 0;
+    std::vector<uint32_t> clusterLights;
+    for(size_t cluster = 0; cluster < inner.size(); ++cluster)
+    {
+      uint32_t offset = ranges[2 * cluster];
+      uint32_t count = ranges[2 * cluster + 1];
+      if(size_t(offset) + count + 1 > indices.size())
+        return false;
+
+      clusterLights.assign(indices.begin() + 1 + offset, indices.begin() + 1 + offset + count);
+      std::sort(clusterLights.begin(), clusterLights.end());
+      total += count;
+
+      for(uint32_t light : clusterLights)
+      {
+        if(!std::binary_search(outer[cluster].begin(), outer[cluster].end(), light))
+          return false;
+      }
+      if(inner[cluster].size() > ClusteredLighting::MAX_LIGHTS_PER_CLUSTER)
+      {
+        if(count != ClusteredLighting::MAX_LIGHTS_PER_CLUSTER)
+          return false;
+        continue;
+      }
+      for(uint32_t light : inner[cluster])
+      {
+        if(!std::binary_search(clusterLights.begin(), clusterLights.end(), light))
+          return false;
+      }
+    }
+    averageLights = inner.empty() ? 0.0 : double(total) / inner.size();
+    return true;
+  }
+
+  bool runBenchmarks(BenchmarkDevice &device, ClusteredLighting &lighting, ClusteredLightingParameters const &parameters,
+                     uint32_t iterations)
+  {
+    bool success = true;
+    for(VkExtent2D extent : RESOLUTIONS)
+    {
+      ClusteredLightingView view;
+      view.view        = identityMatrix();
+      view.tanHalfFovY = std::tan(0.5f * 1.0471976f);
+      view.tanHalfFovX = view.tanHalfFovY * extent.width / extent.height;
+      view.nearPlane   = NEAR_PLANE;
+      view.farPlane    = FAR_PLANE;
+      view.extent      = extent;
+
+      ClusterGrid grid = ClusteredLighting::getClusterGrid(parameters, extent);
+      uint32_t clusterCount = grid.x * grid.y * grid.z;
+      std::cout << "  " << extent.width << "x" << extent.height << ", " << grid.x << "x" << grid.y << "x" << grid.z
+                << " clusters" << std::endl;
+
+      for(uint32_t lightCount : LIGHT_COUNTS)
+      {
+        std::vector<ClusteredLight> lights;
+        generateLights(view, lightCount, lights);
+        if(!lighting.setLights(0, lights))
+          return false;
+
+        auto record = [&](VkCommandBuffer commandBuffer) { lighting.recordCulling(commandBuffer, 0, view); };
+        std::vector<uint32_t> ranges, indices;
+        success &= submitAndWait(device, record) &&
+                   download(device, lighting.getClusterRangeBuffer(0), 2 * size_t(clusterCount), ranges) &&
+                   download(device, lighting.getLightIndexBuffer(0), size_t(lighting.getStats().indexCapacity) + 1, indices);
+
+        std::vector<std::vector<uint32_t>> inner, outer;
+        referenceAssignLights(parameters, view, lights, 0.999f, inner);
+        referenceAssignLights(parameters, view, lights, 1.001f, outer);
+        double averageLights = 0.0;
+        bool valid = !ranges.empty() && validate(ranges, indices, inner, outer, averageLights);
+
+        double seconds = 0.0;
+        bool measured = measure(device, iterations, record, seconds);
+        std::cout << "    " << std::setw(6) << lightCount << " lights" << (valid ? "  ok    " : "  FAILED")
+                  << std::setw(8) << std::fixed << std::setprecision(1) << averageLights << " lights/cluster";
+        if(measured)
+          std::cout << std::setw(10) << std::setprecision(3) << seconds * 1e3 / iterations << " ms";
+        std::cout << std::endl;
+        success &= valid && measured;
+      }
+    }
+    return success;
+  }
+
+  bool benchmarkDevice(PhysicalDeviceProbe const &probe, uint32_t iterations, ClusteredLightingParameters const &parameters)
+  {
+    std::cout << probe.properties.deviceName << std::endl;
+
+    BenchmarkDevice device = {};
+    QueueParameters graphicsQueue, presentQueue;
+    if(!createLogicalDevice({ probe }, device.logicalDevice, {}, VK_NULL_HANDLE, graphicsQueue, device.queue, presentQueue,
+                            device.capabilities))
+      return false;
+
+    bool success = false;
+    ClusteredLighting lighting;
+    if(!ClusteredLighting::isSupported(device.capabilities))
+    {
+      std::cout << "  skipped, clustered lighting is not supported" << std::endl;
+      success = true;
+    }
+    else
+    {
+      VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,   // VkStructureType              sType
+        nullptr,                                      // const void                 * pNext
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,         // VkCommandPoolCreateFlags     flags
+        device.queue.familyIndex                      // uint32_t                     queueFamilyIndex
+      };
+
+      VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,     // VkStructureType                  sType
+        nullptr,                                      // const void                     * pNext
+        0,                                            // VkQueryPoolCreateFlags           flags
+        VK_QUERY_TYPE_TIMESTAMP,                      // VkQueryType                      queryType
+        2,                                            // uint32_t                         queryCount
+        0                                             // VkQueryPipelineStatisticFlags    pipelineStatistics
+      };
+
+      // Large enough for the index list of the largest resolution
+      VkExtent2D maxExtent = RESOLUTIONS[sizeof(RESOLUTIONS) / sizeof(RESOLUTIONS[0]) - 1];
+      ClusterGrid grid = ClusteredLighting::getClusterGrid(parameters, maxExtent);
+      VkDeviceSize stagingSize = (VkDeviceSize(grid.x) * grid.y * grid.z * parameters.averageLightsPerCluster + 1) * sizeof(uint32_t);
+      if((vkCreateCommandPool(device.logicalDevice, &commandPoolCreateInfo, nullptr, &device.commandPool) == VK_SUCCESS) &&
+         (vkCreateQueryPool(device.logicalDevice, &queryPoolCreateInfo, nullptr, &device.queryPool) == VK_SUCCESS) &&
+         createHostVisibleBuffer(device.capabilities.memoryProperties, device.logicalDevice, stagingSize,
+                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr, device.stagingBuffer, device.stagingMemory) &&
+         (vkMapMemory(device.logicalDevice, device.stagingMemory, 0, stagingSize, 0, &device.stagingData) == VK_SUCCESS))
+      {
+        VkCommandBufferAllocateInfo allocateInfo = {
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // VkStructureType          sType
+          nullptr,                                        // const void             * pNext
+          device.commandPool,                             // VkCommandPool            commandPool
+          VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // VkCommandBufferLevel     level
+          1                                               // uint32_t                 commandBufferCount
+        };
+
+        success = (vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &device.commandBuffer) == VK_SUCCESS) &&
+                  lighting.create(device.logicalDevice, device.capabilities, { device.queue.familyIndex }, 1, maxExtent,
+                                  parameters, VK_NULL_HANDLE) &&
+                  runBenchmarks(device, lighting, parameters, iterations);
+      }
+      else
+      {
+        std::cerr << "Could not create benchmark resources." << std::endl;
+      }
+    }
+
+    vkDeviceWaitIdle(device.logicalDevice);
+    lighting.destroy();
+    destroyBuffer(device.logicalDevice, device.stagingBuffer);
+    freeMemoryObject(device.logicalDevice, device.stagingMemory);
+    if(device.queryPool != VK_NULL_HANDLE)
+      vkDestroyQueryPool(device.logicalDevice, device.queryPool, nullptr);
+    if(device.commandPool != VK_NULL_HANDLE)
+      vkDestroyCommandPool(device.logicalDevice, device.commandPool, nullptr);
+    vkDestroyDevice(device.logicalDevice, nullptr);
+    return success;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ClusteredLightingParameters parameters = ClusteredLighting::getDefaultParameters();
+  uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 20;
+  if(argc > 2)
+    parameters.tileSize = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+  if(argc > 3)
+    parameters.depthSlices = static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10));
+  if(iterations == 0 || parameters.tileSize == 0 || parameters.depthSlices == 0)
+  {
+    std::cerr << "Usage: ClusteredLightingBenchmark [iterations] [tileSize] [depthSlices]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  LIBRARY_TYPE vkLibrary = nullptr;
+  VkInstance instance = VK_NULL_HANDLE;
+  std::vector<const char*> instanceExtensions;
+  std::vector<VkPhysicalDevice> physicalDevices;
+  if(!loadVkLibrary(vkLibrary) || !loadFunctionFromVulkanLibrary(vkLibrary) || !loadGlobalLevelFunctions() ||
+     !createInstance(instanceExtensions, "ClusteredLightingBenchmark", instance) ||
+     !loadInstanceLevelFunctions(instance, instanceExtensions) ||
+     !enumerateAvailablePhysicalDevices(instance, physicalDevices))
+  {
+    if(instance != VK_NULL_HANDLE)
+      vkDestroyInstance(instance, nullptr);
+    releaseVulkanLibrary(vkLibrary);
+    return EXIT_FAILURE;
+  }
+
+  // Devices are benchmarked one after another, device-level functions are reloaded for each of them
+  bool success = true;
+  for(VkPhysicalDevice physicalDevice : physicalDevices)
+  {
+    PhysicalDeviceProbe probe;
+    if(!probePhysicalDevice(physicalDevice, {}, probe) || !probe.suitable)
+      continue;
+    success &= benchmarkDevice(probe, iterations, parameters);
+  }
+
+  vkDestroyInstance(instance, nullptr);
+  releaseVulkanLibrary(vkLibrary);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,360 @@
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "Common.h"
+#include "ComputePrimitives.h"
+#include "VulkanResources.h"
+
+// Validates the compute primitives against their CPU references on every Vulkan device (lavapipe
+// included) and reports their throughput measured with timestamp queries.
+// Usage: ComputePrimitivesBenchmark [elementCount] [iterations]
+
+using namespace VulkanSample;
+
+namespace
+{
+  struct DeviceBuffer
+  {
+    VkBuffer        buffer;
+    VkDeviceMemory  memory;
+    VkDeviceAddress address;
+  };
+
+  struct BenchmarkDevice
+  {
+    VkDevice           logicalDevice;
+    DeviceCapabilities capabilities;
+    QueueParameters    queue;
+    VkCommandPool      commandPool;
+    VkCommandBuffer    commandBuffer;
+    VkQueryPool        queryPool;
+    VkBuffer           stagingBuffer;
+    VkDeviceMemory     stagingMemory;
+    void              *stagingData;
+  };
+
+  bool createDeviceBuffer(BenchmarkDevice &device, VkDeviceSize size, DeviceBuffer &buffer)
+  {
+    return createDeviceAddressBuffer(device.capabilities.memoryProperties, device.logicalDevice, size,
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer.buffer, buffer.memory, buffer.address);
+  }
+
+  void destroyDeviceBuffer(BenchmarkDevice &device, DeviceBuffer &buffer)
+  {
+    destroyBuffer(device.logicalDevice, buffer.buffer);
+    freeMemoryObject(device.logicalDevice, buffer.memory);
+  }
+
+  bool submitAndWait(BenchmarkDevice &device, std::function<void(VkCommandBuffer)> const &record)
+  {
+    VkCommandBufferBeginInfo beginInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,   // VkStructureType                        sType
+      nullptr,                                       // const void                           * pNext
+      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,   // VkCommandBufferUsageFlags              flags
+      nullptr                                        // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+    };
+
+    if((vkResetCommandPool(device.logicalDevice, device.commandPool, 0) != VK_SUCCESS) ||
+       (vkBeginCommandBuffer(device.commandBuffer, &beginInfo) != VK_SUCCESS))
+    {
+      std::cerr << "Could not begin command buffer." << std::endl;
+      return false;
+    }
+    record(device.commandBuffer);
+    if(vkEndCommandBuffer(device.commandBuffer) != VK_SUCCESS)
+    {
+      std::cerr << "Could not end command buffer." << std::endl;
+      return false;
+    }
+
+    VkCommandBufferSubmitInfo commandBufferInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,  // VkStructureType    sType
+      nullptr,                                       // const void       * pNext
+      device.commandBuffer,                          // VkCommandBuffer    commandBuffer
+      0                                              // uint32_t           deviceMask
+    };
+
+    VkSubmitInfo2 submitInfo = {
+      VK_STRUCTURE_TYPE_SUBMIT_INFO_2,               // VkStructureType                    sType
+      nullptr,                                       // const void                       * pNext
+      0,                                             // VkSubmitFlags                      flags
+      0,                                             // uint32_t                           waitSemaphoreInfoCount
+      nullptr,                                       // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+      1,                                             // uint32_t                           commandBufferInfoCount
+      &commandBufferInfo,                            // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+      0,                                             // uint32_t                           signalSemaphoreInfoCount
+      nullptr                                        // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+    };
+
+    if((vkQueueSubmit2(device.queue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) ||
+       (vkQueueWaitIdle(device.queue.handle) != VK_SUCCESS))
+    {
+      std::cerr << "Could not execute command buffer." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool upload(BenchmarkDevice &device, std::vector<uint32_t> const &data, DeviceBuffer &buffer)
+  {
+    VkDeviceSize size = data.size() * sizeof(uint32_t);
+    std::memcpy(device.stagingData, data.data(), static_cast<size_t>(size));
+    return submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      VkBufferCopy region = { 0, 0, size };
+      vkCmdCopyBuffer(commandBuffer, device.stagingBuffer, buffer.buffer, 1, &region);
+    });
+  }
+
+  bool download(BenchmarkDevice &device, DeviceBuffer const &buffer, size_t count, std::vector<uint32_t> &data)
+  {
+    VkDeviceSize size = count * sizeof(uint32_t);
+    bool result = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      VkBufferCopy region = { 0, 0, size };
+      vkCmdCopyBuffer(commandBuffer, buffer.buffer, device.stagingBuffer, 1, &region);
+    });
+    data.assign(static_cast<uint32_t*>(device.stagingData), static_cast<uint32_t*>(device.stagingData) + count);
+    return result;
+  }
+
+  // Records the primitive iterations times between two timestamps, returns the GPU time in seconds
+  bool measure(BenchmarkDevice &device, uint32_t iterations, std::function<void(VkCommandBuffer)> const &record, double &seconds)
+  {
+    bool result = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      vkCmdResetQueryPool(commandBuffer, device.queryPool, 0, 2);
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, device.queryPool, 0);
+      for(uint32_t iteration = 0; iteration < iterations; ++iteration)
+        record(commandBuffer);
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, device.queryPool, 1);
+    });
+    if(!result)
+      return false;
+
+    uint64_t timestamps[2];
+    if(vkGetQueryPoolResults(device.logicalDevice, device.queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                             VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+    {
+      std::cerr << "Could not read timestamp queries." << std::endl;
+      return false;
+    }
+    seconds = (timestamps[1] - timestamps[0]) * static_cast<double>(device.capabilities.properties.limits.timestampPeriod) * 1e-9;
+    return true;
+  }
+
+  void report(char const *name, bool valid, uint32_t count, uint32_t iterations, double seconds)
+  {
+    std::cout << "  " << std::left << std::setw(20) << name << std::right << (valid ? "  ok    " : "  FAILED");
+    if(seconds > 0.0)
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1) << (double(count) * iterations / seconds) * 1e-6 << " Melements/s";
+    std::cout << std::endl;
+  }
+
+  bool runBenchmarks(BenchmarkDevice &device, ComputePrimitives &primitives, uint32_t count, uint32_t iterations)
+  {
+    std::mt19937 random(1234);
+    std::vector<uint32_t> values(count), flags(count), keys(2 * size_t(count)), payloads(count);
+    for(uint32_t index = 0; index < count; ++index)
+    {
+      values[index] = random() & 0xFFFF;
+      flags[index] = random() & 1;
+      payloads[index] = index;
+    }
+    for(auto &key : keys)
+      key = random();
+
+    DeviceBuffer source, destination, auxiliary;
+    if(!createDeviceBuffer(device, 2 * VkDeviceSize(count) * sizeof(uint32_t), source) ||
+       !createDeviceBuffer(device, 2 * VkDeviceSize(count) * sizeof(uint32_t), destination) ||
+       !createDeviceBuffer(device, VkDeviceSize(count) * sizeof(uint32_t) + 16, auxiliary))
+      return false;
+
+    bool success = true;
+    std::vector<uint32_t> expected, actual;
+    double seconds;
+
+    // Reduction into auxiliary[0]
+    {
+      success &= upload(device, values, source);
+      auto record = [&](VkCommandBuffer commandBuffer) { primitives.recordReduce(commandBuffer, source.address, count, auxiliary.address); };
+      success &= submitAndWait(device, record) && download(device, auxiliary, 1, actual);
+      bool valid = !actual.empty() && actual[0] == referenceReduce(values);
+      report("reduce", valid, count, iterations, measure(device, iterations, record, seconds) ? seconds : 0.0);
+      success &= valid;
+    }
+
+    // Exclusive scan from source into destination
+    {
+      referenceExclusiveScan(values, expected);
+      auto record = [&](VkCommandBuffer commandBuffer) { primitives.recordExclusiveScan(commandBuffer, source.address, destination.address, count); };
+      success &= submitAndWait(device, record) && download(device, destination, count, actual);
+      bool valid = actual == expected;
+      report("exclusive scan", valid, count, iterations, measure(device, iterations, record, seconds) ? seconds : 0.0);
+      success &= valid;
+    }
+
+    // Compaction of source by the flags in auxiliary, the kept count goes behind the flags
+    {
+      referenceCompact(values, flags, expected);
+      success &= upload(device, flags, auxiliary);
+      VkDeviceAddress keptCount = auxiliary.address + VkDeviceSize(count) * sizeof(uint32_t);
+      auto record = [&](VkCommandBuffer commandBuffer)
+      {
+        primitives.recordCompact(commandBuffer, source.address, auxiliary.address, count, destination.address, keptCount);
+      };
+      std::vector<uint32_t> kept;
+      success &= submitAndWait(device, record) && download(device, destination, expected.size(), actual) &&
+                 download(device, auxiliary, count + 1, kept);
+      bool valid = actual == expected && kept.size() == count + 1 && kept[count] == expected.size();
+      report("compact", valid, count, iterations, measure(device, iterations, record, seconds) ? seconds : 0.0);
+      success &= valid;
+    }
+
+    // Radix sorts with payloads, later iterations sort already sorted data which costs the same
+    for(RadixSortKeyType keyType : { RadixSortKeyType::Uint32, RadixSortKeyType::Uint64 })
+    {
+      uint32_t keyWords = static_cast<uint32_t>(keyType);
+      std::vector<uint32_t> sortKeys(keys.begin(), keys.begin() + size_t(count) * keyWords);
+      std::vector<uint32_t> sortedKeys = sortKeys, sortedPayloads = payloads;
+      referenceRadixSort(keyType, sortedKeys, sortedPayloads);
+
+      success &= upload(device, sortKeys, source) && upload(device, payloads, destination);
+      auto record = [&](VkCommandBuffer commandBuffer)
+      {
+        primitives.recordRadixSort(commandBuffer, keyType, source.address, destination.address, count);
+      };
+      std::vector<uint32_t> actualPayloads;
+      success &= submitAndWait(device, record) && download(device, source, sortKeys.size(), actual) &&
+                 download(device, destination, count, actualPayloads);
+      bool valid = actual == sortedKeys && actualPayloads == sortedPayloads;
+      report(keyType == RadixSortKeyType::Uint32 ? "radix sort (32-bit)" : "radix sort (64-bit)", valid, count, iterations,
+             measure(device, iterations, record, seconds) ? seconds : 0.0);
+      success &= valid;
+    }
+
+    destroyDeviceBuffer(device, source);
+    destroyDeviceBuffer(device, destination);
+    destroyDeviceBuffer(device, auxiliary);
+    return success;
+  }
+
+  bool benchmarkDevice(PhysicalDeviceProbe const &probe, uint32_t count, uint32_t iterations)
+  {
+    std::cout << probe.properties.deviceName << " (subgroup size " << probe.subgroupProperties.subgroupSize << ")" << std::endl;
+
+    BenchmarkDevice device = {};
+    QueueParameters graphicsQueue, presentQueue;
+    if(!createLogicalDevice({ probe }, device.logicalDevice, {}, VK_NULL_HANDLE, graphicsQueue, device.queue, presentQueue,
+                            device.capabilities))
+      return false;
+
+    bool success = false;
+    ComputePrimitives primitives;
+    if(!ComputePrimitives::isSupported(device.capabilities))
+    {
+      std::cout << "  skipped, compute primitives are not supported" << std::endl;
+      success = true;
+    }
+    else
+    {
+      VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,   // VkStructureType              sType
+        nullptr,                                      // const void                 * pNext
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,         // VkCommandPoolCreateFlags     flags
+        device.queue.familyIndex                      // uint32_t                     queueFamilyIndex
+      };
+
+      VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,     // VkStructureType                  sType
+        nullptr,                                      // const void                     * pNext
+        0,                                            // VkQueryPoolCreateFlags           flags
+        VK_QUERY_TYPE_TIMESTAMP,                      // VkQueryType                      queryType
+        2,                                            // uint32_t                         queryCount
+        0                                             // VkQueryPipelineStatisticFlags    pipelineStatistics
+      };
+
+      VkDeviceSize stagingSize = 2 * VkDeviceSize(count) * sizeof(uint32_t);
+      if((vkCreateCommandPool(device.logicalDevice, &commandPoolCreateInfo, nullptr, &device.commandPool) == VK_SUCCESS) &&
+         (vkCreateQueryPool(device.logicalDevice, &queryPoolCreateInfo, nullptr, &device.queryPool) == VK_SUCCESS) &&
+         createHostVisibleBuffer(device.capabilities.memoryProperties, device.logicalDevice, stagingSize,
+                                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr,
+                                 device.stagingBuffer, device.stagingMemory) &&
+         (vkMapMemory(device.logicalDevice, device.stagingMemory, 0, stagingSize, 0, &device.stagingData) == VK_SUCCESS))
+      {
+        VkCommandBufferAllocateInfo allocateInfo = {
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // VkStructureType          sType
+          nullptr,                                        // const void             * pNext
+          device.commandPool,                             // VkCommandPool            commandPool
+          VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // VkCommandBufferLevel     level
+          1                                               // uint32_t                 commandBufferCount
+        };
+
+        success = (vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &device.commandBuffer) == VK_SUCCESS) &&
+                  primitives.create(device.logicalDevice, device.capabilities, count, VK_NULL_HANDLE) &&
+                  runBenchmarks(device, primitives, count, iterations);
+      }
+      else
+      {
+        std::cerr << "Could not create benchmark resources." << std::endl;
+      }
+    }
+
+    vkDeviceWaitIdle(device.logicalDevice);
+    primitives.destroy();
+    destroyBuffer(device.logicalDevice, device.stagingBuffer);
+    freeMemoryObject(device.logicalDevice, device.stagingMemory);
+    if(device.queryPool != VK_NULL_HANDLE)
+      vkDestroyQueryPool(device.logicalDevice, device.queryPool, nullptr);
+    if(device.commandPool != VK_NULL_HANDLE)
+      vkDestroyCommandPool(device.logicalDevice, device.commandPool, nullptr);
+    vkDestroyDevice(device.logicalDevice, nullptr);
+    return success;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : (1u << 22);
+  uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10;
+  if(count == 0 || iterations == 0)
+  {
+    std::cerr << "Usage: ComputePrimitivesBenchmark [elementCount] [iterations]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  LIBRARY_TYPE vkLibrary = nullptr;
+  VkInstance instance = VK_NULL_HANDLE;
+  std::vector<const char*> instanceExtensions;
+  std::vector<VkPhysicalDevice> physicalDevices;
+  if(!loadVkLibrary(vkLibrary) || !loadFunctionFromVulkanLibrary(vkLibrary) || !loadGlobalLevelFunctions() ||
+     !createInstance(instanceExtensions, "ComputePrimitivesBenchmark", instance) ||
+     !loadInstanceLevelFunctions(instance, instanceExtensions) ||
+     !enumerateAvailablePhysicalDevices(instance, physicalDevices))
+  {
+    if(instance != VK_NULL_HANDLE)
+      vkDestroyInstance(instance, nullptr);
+    releaseVulkanLibrary(vkLibrary);
+    return EXIT_FAILURE;
+  }
+
+  // Devices are benchmarked one after another, device-level functions are reloaded for each of them
+  bool success = true;
+  for(VkPhysicalDevice physicalDevice : physicalDevices)
+  {
+    PhysicalDeviceProbe probe;
+    if(!probePhysicalDevice(physicalDevice, {}, probe) || !probe.suitable)
+      continue;
+    success &= benchmarkDevice(probe, count, iterations);
+  }
+
+  vkDestroyInstance(instance, nullptr);
+  releaseVulkanLibrary(vkLibrary);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
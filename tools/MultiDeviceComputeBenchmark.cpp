@@ -0,0 +1,269 @@
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "Common.h"
+#include "MultiDeviceCompute.h"
+#include "VulkanResources.h"
+
+// Shards a hash kernel over every Vulkan device, validates the gathered results against a CPU
+// reference and reports the share of work and the throughput of each device over several runs.
+// With a single device (lavapipe on CI) pass devicesPerPhysicalDevice > 1 to run on several
+// logical devices, or list several ICDs in VK_DRIVER_FILES.
+// Usage: MultiDeviceComputeBenchmark [elementCount] [runs] [devicesPerPhysicalDevice] [hashRounds]
+
+using namespace VulkanSample;
+
+namespace
+{
+  const uint32_t CHUNK_ELEMENTS = 1u << 16;
+  const uint32_t WORKGROUP_SIZE = 256;
+
+  struct HashConstants
+  {
+    VkDeviceAddress source;
+    VkDeviceAddress destination;
+    uint32_t        count;
+    uint32_t        rounds;
+  };
+
+  struct HostBuffer
+  {
+    VkBuffer        buffer;
+    VkDeviceMemory  memory;
+    VkDeviceAddress address;
+    uint32_t       *data;
+  };
+
+  struct HashDevice
+  {
+    VkDevice         logicalDevice;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline       pipeline;
+    HostBuffer       sources[MultiDeviceCompute::SLOTS_PER_DEVICE];
+    HostBuffer       destinations[MultiDeviceCompute::SLOTS_PER_DEVICE];
+  };
+
+  uint32_t pcgHash(uint32_t value)
+  {
+    uint32_t state = value * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+  }
+
+  // Host visible and coherent, the chunks are written and read through the mapping
+  bool createHostBuffer(HashDevice &device, DeviceCapabilities const &capabilities, HostBuffer &buffer)
+  {
+    VkDeviceSize size = VkDeviceSize(CHUNK_ELEMENTS) * sizeof(uint32_t);
+    void *data = nullptr;
+    if(!createDeviceAddressBuffer(capabilities.memoryProperties, device.logicalDevice, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  buffer.buffer, buffer.memory, buffer.address) ||
+       (vkMapMemory(device.logicalDevice, buffer.memory, 0, size, 0, &data) != VK_SUCCESS))
+    {
+      std::cerr << "Could not create a chunk buffer." << std::endl;
+      return false;
+    }
+    buffer.data = static_cast<uint32_t*>(data);
+    return true;
+  }
+
+  void destroyHashDevice(HashDevice &device)
+  {
+    for(uint32_t slot = 0; slot < MultiDeviceCompute::SLOTS_PER_DEVICE; ++slot)
+    {
+      destroyBuffer(device.logicalDevice, device.sources[slot].buffer);
+      freeMemoryObject(device.logicalDevice, device.sources[slot].memory);
+      destroyBuffer(device.logicalDevice, device.destinations[slot].buffer);
+      freeMemoryObject(device.logicalDevice, device.destinations[slot].memory);
+    }
+    destroyPipeline(device.logicalDevice, device.pipeline);
+    destroyPipelineLayout(device.logicalDevice, device.pipelineLayout);
+    device = HashDevice();
+  }
+
+  bool createHashDevice(VkDevice logicalDevice, DeviceCapabilities const &capabilities, HashDevice &device)
+  {
+    device = HashDevice();
+    device.logicalDevice = logicalDevice;
+    if(!capabilities.bufferDeviceAddressSupported)
+    {
+      std::cerr << "The hash kernel requires buffer device addresses." << std::endl;
+      return false;
+    }
+
+    VkPushConstantRange pushConstantRange = {
+      VK_SHADER_STAGE_COMPUTE_BIT,                    // VkShaderStageFlags     stageFlags
+      0,                                              // uint32_t               offset
+      sizeof(HashConstants)                           // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+      nullptr,                                        // const void                     * pNext
+      0,                                              // VkPipelineLayoutCreateFlags      flags
+      0,                                              // uint32_t                         setLayoutCount
+      nullptr,                                        // const VkDescriptorSetLayout    * pSetLayouts
+      1,                                              // uint32_t                         pushConstantRangeCount
+      &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    if(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &device.pipelineLayout) != VK_SUCCESS)
+    {
+      std::cerr << "Could not create the hash pipeline layout." << std::endl;
+      return false;
+    }
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    bool created = createShaderModuleFromFile(logicalDevice, "shard_hash.comp", shaderModule) &&
+                   createComputePipeline(logicalDevice, shaderModule, device.pipelineLayout, nullptr, VK_NULL_HANDLE,
+                                         device.pipeline);
+    destroyShaderModule(logicalDevice, shaderModule);
+    for(uint32_t slot = 0; created && slot < MultiDeviceCompute::SLOTS_PER_DEVICE; ++slot)
+    {
+      created = createHostBuffer(device, capabilities, device.sources[slot]) &&
+                createHostBuffer(device, capabilities, device.destinations[slot]);
+    }
+    return created;
+  }
+
+  void recordHash(HashDevice &device, uint32_t slot, VkCommandBuffer commandBuffer, uint32_t count, uint32_t rounds)
+  {
+    HashConstants constants = { device.sources[slot].address, device.destinations[slot].address, count, rounds };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, device.pipeline);
+    vkCmdPushConstants(commandBuffer, device.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier2 memoryBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,             // VkStructureType          sType
+      nullptr,                                        // const void             * pNext
+      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,         // VkPipelineStageFlags2    srcStageMask
+      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,           // VkAccessFlags2           srcAccessMask
+      VK_PIPELINE_STAGE_2_HOST_BIT,                   // VkPipelineStageFlags2    dstStageMask
+      VK_ACCESS_2_HOST_READ_BIT                       // VkAccessFlags2           dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+      VK_STRUCTURE_TYPE_DEPENDENCY_INFO,              // VkStructureType                  sType
+      nullptr,                                        // const void                     * pNext
+      0,                                              // VkDependencyFlags                dependencyFlags
+      1,                                              // uint32_t                         memoryBarrierCount
+      &memoryBarrier,                                 // const VkMemoryBarrier2         * pMemoryBarriers
+      0,                                              // uint32_t                         bufferMemoryBarrierCount
+      nullptr,                                        // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+      0,                                              // uint32_t                         imageMemoryBarrierCount
+      nullptr                                         // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+  }
+
+  void report(MultiDeviceComputeStats const &stats, uint64_t count, bool valid)
+  {
+    std::cout << (valid ? "ok    " : "FAILED") << std::fixed << std::setprecision(1)
+              << std::setw(10) << count / stats.seconds * 1e-6 << " Melements/s total" << std::endl;
+    for(auto &device : stats.devices)
+    {
+      std::cout << "  " << std::left << std::setw(40) << device.name << std::right
+                << std::setw(6) << std::setprecision(1) << 100.0 * device.elements / count << "%"
+                << std::setw(6) << device.chunks << " chunks"
+                << std::setw(5) << device.stolenChunks << " stolen"
+                << std::setw(10) << device.throughput * 1e-6 << " Melements/s" << std::endl;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : (1u << 22);
+  uint32_t runs = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 5;
+  uint32_t replicas = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 1;
+  uint32_t rounds = argc > 4 ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : 32;
+  if(count == 0 || runs == 0 || replicas == 0)
+  {
+    std::cerr << "Usage: MultiDeviceComputeBenchmark [elementCount] [runs] [devicesPerPhysicalDevice] [hashRounds]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  LIBRARY_TYPE vkLibrary = nullptr;
+  VkInstance instance = VK_NULL_HANDLE;
+  std::vector<const char*> instanceExtensions;
+  std::vector<VkPhysicalDevice> physicalDevices;
+  if(!loadVkLibrary(vkLibrary) || !loadFunctionFromVulkanLibrary(vkLibrary) || !loadGlobalLevelFunctions() ||
+     !createInstance(instanceExtensions, "MultiDeviceComputeBenchmark", instance) ||
+     !loadInstanceLevelFunctions(instance, instanceExtensions) ||
+     !enumerateAvailablePhysicalDevices(instance, physicalDevices))
+  {
+    if(instance != VK_NULL_HANDLE)
+      vkDestroyInstance(instance, nullptr);
+    releaseVulkanLibrary(vkLibrary);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<PhysicalDeviceProbe> probes;
+  for(VkPhysicalDevice physicalDevice : physicalDevices)
+  {
+    PhysicalDeviceProbe probe;
+    if(probePhysicalDevice(physicalDevice, {}, probe))
+      probes.push_back(probe);
+  }
+
+  std::mt19937 random(1234);
+  std::vector<uint32_t> source(count), expected(count), actual(count);
+  for(uint32_t index = 0; index < count; ++index)
+  {
+    source[index] = random();
+    uint32_t value = source[index];
+    for(uint32_t round = 0; round < rounds; ++round)
+      value = pcgHash(value);
+    expected[index] = value;
+  }
+
+  bool success = false;
+  MultiDeviceCompute compute;
+  if(compute.create(probes, replicas))
+  {
+    // Every callback only touches the entry of its own device
+    std::vector<HashDevice> devices(compute.getDeviceCount());
+    MultiDeviceJob job;
+    job.elementCount = count;
+    job.chunkElements = CHUNK_ELEMENTS;
+    job.prepare = [&](uint32_t device, VkDevice logicalDevice, DeviceCapabilities const &capabilities)
+    {
+      return createHashDevice(logicalDevice, capabilities, devices[device]);
+    };
+    job.record = [&](uint32_t device, uint32_t slot, VkCommandBuffer commandBuffer, uint64_t first, uint32_t chunkCount)
+    {
+      std::memcpy(devices[device].sources[slot].data, source.data() + first, chunkCount * sizeof(uint32_t));
+      recordHash(devices[device], slot, commandBuffer, chunkCount, rounds);
+      return true;
+    };
+    job.gather = [&](uint32_t device, uint32_t slot, uint64_t first, uint32_t chunkCount)
+    {
+      std::memcpy(actual.data() + first, devices[device].destinations[slot].data, chunkCount * sizeof(uint32_t));
+      return true;
+    };
+    job.release = [&](uint32_t device)
+    {
+      destroyHashDevice(devices[device]);
+    };
+
+    // The first run distributes evenly, the following ones by the measured throughput
+    success = true;
+    for(uint32_t run = 0; run < runs && success; ++run)
+    {
+      std::fill(actual.begin(), actual.end(), 0u);
+      success = compute.run(job);
+      bool valid = success && actual == expected;
+      std::cout << "Run " << run << ": ";
+      report(compute.getStats(), count, valid);
+      success &= valid;
+    }
+  }
+
+  compute.destroy();
+  vkDestroyInstance(instance, nullptr);
+  releaseVulkanLibrary(vkLibrary);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
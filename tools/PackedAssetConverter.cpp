@@ -0,0 +1,231 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "Meshlet.h"
+#include "PackedAssetFormat.h"
+
+// Offline converter from Wavefront OBJ to the packed asset format loaded at runtime.
+// Usage: PackedAssetConverter <input.obj> <output.vspk> [--compression none|lz4|zstd]
+
+namespace
+{
+  struct ObjCorner
+  {
+    int position;
+    int texCoord;
+    int normal;
+  };
+
+  struct ObjCornerHash
+  {
+    size_t operator()(ObjCorner const &corner) const
+    {
+      return (static_cast<size_t>(corner.position) * 73856093u) ^ (static_cast<size_t>(corner.texCoord) * 19349663u) ^
+             (static_cast<size_t>(corner.normal) * 83492791u);
+    }
+  };
+
+  bool operator==(ObjCorner const &lhs, ObjCorner const &rhs)
+  {
+    return lhs.position == rhs.position && lhs.texCoord == rhs.texCoord && lhs.normal == rhs.normal;
+  }
+
+  // OBJ indices are 1-based, negative values count back from the last element
+  int resolveIndex(int index, size_t count)
+  {
+    if(index > 0)
+      return index - 1;
+    if(index < 0)
+      return static_cast<int>(count) + index;
+    return -1;
+  }
+
+  bool parseCorner(std::string const &token, size_t positions, size_t texCoords, size_t normals, ObjCorner &corner)
+  {
+    int values[3] = { 0, 0, 0 };
+    bool present[3] = { false, false, false };
+    size_t start = 0;
+    for(int component = 0; component < 3 && start <= token.size(); ++component)
+    {
+      size_t slash = token.find('/', start);
+      std::string part = token.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+      if(!part.empty())
+      {
+        values[component] = std::atoi(part.c_str());
+        present[component] = true;
+      }
+      if(slash == std::string::npos)
+        break;
+      start = slash + 1;
+    }
+
+    // Only empty fields mean "no attribute", written indices have to resolve to an element
+    size_t counts[3] = { positions, texCoords, normals };
+    int resolved[3];
+    for(int component = 0; component < 3; ++component)
+    {
+      resolved[component] = resolveIndex(values[component], counts[component]);
+      if((present[component] || component == 0) &&
+         (resolved[component] < 0 || resolved[component] >= static_cast<int>(counts[component])))
+        return false;
+    }
+    corner.position = resolved[0];
+    corner.texCoord = resolved[1];
+    corner.normal = resolved[2];
+    return true;
+  }
+
+  bool loadObj(char const *filename, std::vector<VulkanSample::MeshVertex> &vertices, std::vector<uint32_t> &indices)
+  {
+    std::ifstream file(filename);
+    if(file.fail())
+    {
+      std::cerr << "Could not open '" << filename << "' file." << std::endl;
+      return false;
+    }
+
+    std::vector<float> positions;
+    std::vector<float> texCoords;
+    std::vector<float> normals;
+    std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> uniqueCorners;
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while(std::getline(file, line))
+    {
+      ++lineNumber;
+      std::istringstream stream(line);
+      std::string keyword;
+      stream >> keyword;
+
+      if(keyword == "v")
+      {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        stream >> x >> y >> z;
+        positions.insert(positions.end(), { x, y, z });
+      }
+      else if(keyword == "vt")
+      {
+        float u = 0.0f, v = 0.0f;
+        stream >> u >> v;
+        texCoords.insert(texCoords.end(), { u, 1.0f - v });
+      }
+      else if(keyword == "vn")
+      {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        stream >> x >> y >> z;
+        normals.insert(normals.end(), { x, y, z });
+      }
+      else if(keyword == "f")
+      {
+        std::vector<uint32_t> polygon;
+        std::string token;
+        while(stream >> token)
+        {
+          ObjCorner corner;
+          if(!parseCorner(token, positions.size() / 3, texCoords.size() / 2, normals.size() / 3, corner))
+          {
+            std::cerr << "Invalid face index '" << token << "' in line " << lineNumber << "." << std::endl;
+            return false;
+          }
+
+          auto found = uniqueCorners.find(corner);
+          if(found == uniqueCorners.end())
+          {
+            VulkanSample::MeshVertex vertex = {};
+            std::memcpy(vertex.position, &positions[corner.position * 3], sizeof(vertex.position));
+            if(corner.normal >= 0)
+              std::memcpy(vertex.normal, &normals[corner.normal * 3], sizeof(vertex.normal));
+            if(corner.texCoord >= 0)
+              std::memcpy(vertex.texCoord, &texCoords[corner.texCoord * 2], sizeof(vertex.texCoord));
+
+            found = uniqueCorners.emplace(corner, static_cast<uint32_t>(vertices.size())).first;
+            vertices.push_back(vertex);
+          }
+          polygon.push_back(found->second);
+        }
+
+        // Triangle fan, OBJ polygons are convex
+        for(size_t i = 2; i < polygon.size(); ++i)
+          indices.insert(indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+      }
+    }
+
+    if(indices.empty())
+    {
+      std::cerr << "File '" << filename << "' does not contain any faces." << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  using namespace VulkanSample;
+
+  if(argc < 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <input.obj> <output.vspk> [--compression none|lz4|zstd]" << std::endl;
+    return -1;
+  }
+
+  AssetCompression compression = AssetCompression::None;
+  for(int argument = 3; argument + 1 < argc; argument += 2)
+  {
+    if(std::strcmp(argv[argument], "--compression") != 0)
+    {
+      std::cerr << "Unknown option '" << argv[argument] << "'." << std::endl;
+      return -1;
+    }
+
+    std::string codec = argv[argument + 1];
+    if(codec == "lz4")
+      compression = AssetCompression::LZ4;
+    else if(codec == "zstd")
+      compression = AssetCompression::Zstd;
+    else if(codec != "none")
+    {
+      std::cerr << "Unknown compression '" << codec << "'." << std::endl;
+      return -1;
+    }
+
+    if(!isCompressionAvailable(compression))
+    {
+      std::cerr << "Compression '" << codec << "' is not available in this build." << std::endl;
+      return -1;
+    }
+  }
+
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+  if(!loadObj(argv[1], vertices, indices))
+    return -1;
+
+  MeshletData meshletData;
+  if(!buildMeshlets(vertices, indices, meshletData))
+    return -1;
+
+  PackedAssetWriter writer;
+  writer.addSection(AssetSectionType::Vertices, sizeof(MeshVertex), static_cast<uint32_t>(vertices.size()),
+                    vertices.data(), compression);
+  writer.addSection(AssetSectionType::Indices, sizeof(uint32_t), static_cast<uint32_t>(indices.size()),
+                    indices.data(), compression);
+  writer.addSection(AssetSectionType::Meshlets, sizeof(Meshlet), static_cast<uint32_t>(meshletData.meshlets.size()),
+                    meshletData.meshlets.data(), compression);
+  writer.addSection(AssetSectionType::MeshletVertices, sizeof(uint32_t), static_cast<uint32_t>(meshletData.vertices.size()),
+                    meshletData.vertices.data(), compression);
+  writer.addSection(AssetSectionType::MeshletTriangles, sizeof(uint32_t), static_cast<uint32_t>(meshletData.triangles.size()),
+                    meshletData.triangles.data(), compression);
+
+  if(!writer.write(argv[2]))
+    return -1;
+
+  std::cout << "Wrote " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles and "
+            << meshletData.meshlets.size() << " meshlets to '" << argv[2] << "'." << std::endl;
+  return 0;
+}
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "Common.h"
+#include "PackedAssetLoader.h"
+#include "VulkanResources.h"
+
+// Compares the ways PackedAssetLoader gets a packed asset into device local buffers: the file
+// mapping copied into a staging buffer, the mapping imported with VK_EXT_external_memory_host, and
+// the staging path decoding each compiled in codec. The sections of the input (a file written by
+// PackedAssetConverter) are rewritten once per codec next to it, so all paths load the same data.
+// A load is timed from opening the file until the copies have finished on the GPU; after the
+// first iteration the file is in the page cache, which is the case this loader is built for.
+// Every load is read back and compared with the sections of the input.
+// Usage: PackedAssetLoadBenchmark <input.vspk> [iterations]
+
+using namespace VulkanSample;
+
+namespace
+{
+  struct Codec
+  {
+    AssetCompression compression;
+    char const      *name;
+  };
+
+  const Codec CODECS[] = {
+    { AssetCompression::None, "none" },
+    { AssetCompression::LZ4,  "lz4"  },
+    { AssetCompression::Zstd, "zstd" }
+  };
+
+  struct SectionData
+  {
+    PackedAssetSection   description;
+    std::vector<uint8_t> data;
+  };
+
+  struct BenchmarkDevice
+  {
+    VkDevice           logicalDevice;
+    DeviceCapabilities capabilities;
+    QueueParameters    queue;
+    VkCommandPool      commandPool;
+    VkCommandBuffer    commandBuffer;
+    VkBuffer           readbackBuffer;
+    VkDeviceMemory     readbackMemory;
+    void              *readbackData;
+  };
+
+  bool readSections(std::string const &filename, std::vector<SectionData> &sections)
+  {
+    PackedAsset asset;
+    if(!asset.open(filename))
+      return false;
+
+    for(auto &section : asset.getSections())
+    {
+      SectionData read;
+      read.description = section;
+      read.data.resize(static_cast<size_t>(section.size));
+      if(!asset.readSection(section, read.data.data()))
+        return false;
+      sections.push_back(std::move(read));
+    }
+    return true;
+  }
+
+  bool writeVariant(std::vector<SectionData> const &sections, AssetCompression compression, std::string const &filename)
+  {
+    PackedAssetWriter writer;
+    for(auto &section : sections)
+    {
+      writer.addSection(section.description.type, section.description.elementSize, section.description.elementCount,
+                        section.data.data(), compression);
+    }
+    return writer.write(filename);
+  }
+
+  bool submitAndWait(BenchmarkDevice &device, std::function<bool(VkCommandBuffer)> const &record)
+  {
+    VkCommandBufferBeginInfo beginInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,   // VkStructureType                        sType
+      nullptr,                                       // const void                           * pNext
+      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,   // VkCommandBufferUsageFlags              flags
+      nullptr                                        // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+    };
+
+    if((vkResetCommandPool(device.logicalDevice, device.commandPool, 0) != VK_SUCCESS) ||
+       (vkBeginCommandBuffer(device.commandBuffer, &beginInfo) != VK_SUCCESS))
+    {
+      std::cerr << "Could not begin command buffer." << std::endl;
+      return false;
+    }
+    bool recorded = record(device.commandBuffer);
+    if(vkEndCommandBuffer(device.commandBuffer) != VK_SUCCESS)
+    {
+      std::cerr << "Could not end command buffer." << std::endl;
+      return false;
+    }
+    if(!recorded)
+      return false;
+
+    VkCommandBufferSubmitInfo commandBufferInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,  // VkStructureType    sType
+      nullptr,                                       // const void       * pNext
+      device.commandBuffer,                          // VkCommandBuffer    commandBuffer
+      0                                              // uint32_t           deviceMask
+    };
+
+    VkSubmitInfo2 submitInfo = {
+      VK_STRUCTURE_TYPE_SUBMIT_INFO_2,               // VkStructureType                    sType
+      nullptr,                                       // const void                       * pNext
+      0,                                             // VkSubmitFlags                      flags
+      0,                                             // uint32_t                           waitSemaphoreInfoCount
+      nullptr,                                       // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+      1,                                             // uint32_t                           commandBufferInfoCount
+      &commandBufferInfo,                            // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+      0,                                             // uint32_t                           signalSemaphoreInfoCount
+      nullptr                                        // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+    };
+
+    if((vkQueueSubmit2(device.queue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) ||
+       (vkQueueWaitIdle(device.queue.handle) != VK_SUCCESS))
+    {
+      std::cerr << "Could not execute command buffer." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool validate(BenchmarkDevice &device, GpuMeshBuffers const &mesh, std::vector<SectionData> const &sections)
+  {
+    for(auto &section : sections)
+    {
+      uint32_t slot = static_cast<uint32_t>(section.description.type);
+      if(section.data.empty())
+        continue;
+      if(slot >= static_cast<uint32_t>(AssetSectionType::Count) || mesh.buffers[slot] == VK_NULL_HANDLE)
+        return false;
+
+      VkDeviceSize size = section.data.size();
+      bool copied = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+      {
+        VkBufferCopy region = { 0, 0, size };
+        vkCmdCopyBuffer(commandBuffer, mesh.buffers[slot], device.readbackBuffer, 1, &region);
+        return true;
+      });
+      if(!copied || std::memcmp(device.readbackData, section.data.data(), section.data.size()) != 0)
+        return false;
+    }
+    return true;
+  }
+
+  // Opens, uploads and waits for the asset iterations times, the mesh of the last load is validated
+  bool measure(BenchmarkDevice &device, DeviceCapabilities const &capabilities, std::string const &filename,
+               std::vector<SectionData> const &sections, uint32_t iterations, char const *name)
+  {
+    double totalMilliseconds = 0.0;
+    double cpuMilliseconds = 0.0;
+    PackedAssetLoadStats stats = {};
+    bool valid = true;
+
+    for(uint32_t iteration = 0; iteration < iterations && valid; ++iteration)
+    {
+      auto startTime = std::chrono::steady_clock::now();
+
+      PackedAsset asset;
+      PackedAssetLoader loader;
+      GpuMeshBuffers mesh = {};
+      valid = asset.open(filename) &&
+              submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+              {
+                return loader.recordUpload(device.logicalDevice, capabilities, asset, commandBuffer, mesh);
+              });
+      loader.releaseTransferResources();
+      asset.close();
+
+      totalMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+      cpuMilliseconds += loader.getStats().cpuMilliseconds;
+      stats = loader.getStats();
+
+      if(valid && iteration + 1 == iterations)
+        valid = validate(device, mesh, sections);
+      PackedAssetLoader::destroyMeshBuffers(device.logicalDevice, mesh);
+    }
+
+    uint64_t bytes = 0;
+    for(auto &section : sections)
+      bytes += section.data.size();
+
+    std::cout << "  " << std::left << std::setw(20) << name << std::right << (valid ? "  ok    " : "  FAILED");
+    if(valid)
+    {
+      double milliseconds = totalMilliseconds / iterations;
+      std::cout << std::fixed << std::setprecision(3)
+                << std::setw(10) << milliseconds << " ms/load"
+                << std::setw(10) << cpuMilliseconds / iterations << " ms recording"
+                << std::setw(10) << std::setprecision(2) << double(bytes) / (milliseconds * 1e6) << " GB/s"
+                << "   imported " << stats.importedSections << ", staged " << stats.stagedSections
+                << ", decompressed " << stats.decompressedBytes << " bytes";
+    }
+    std::cout << std::endl;
+    return valid;
+  }
+
+  bool benchmarkDevice(PhysicalDeviceProbe const &probe, std::vector<SectionData> const &sections,
+                       std::vector<std::pair<Codec, std::string>> const &variants, uint32_t iterations)
+  {
+    std::cout << probe.properties.deviceName << std::endl;
+
+    BenchmarkDevice device = {};
+    QueueParameters graphicsQueue, presentQueue;
+    if(!createLogicalDevice({ probe }, device.logicalDevice, {}, VK_NULL_HANDLE, graphicsQueue, device.queue, presentQueue,
+                            device.capabilities))
+      return false;
+
+    VkDeviceSize readbackSize = 16;
+    for(auto &section : sections)
+      readbackSize = std::max<VkDeviceSize>(readbackSize, section.data.size());
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,   // VkStructureType              sType
+      nullptr,                                      // const void                 * pNext
+      VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,         // VkCommandPoolCreateFlags     flags
+      device.queue.familyIndex                      // uint32_t                     queueFamilyIndex
+    };
+
+    bool success = false;
+    if((vkCreateCommandPool(device.logicalDevice, &commandPoolCreateInfo, nullptr, &device.commandPool) == VK_SUCCESS) &&
+       createHostVisibleBuffer(device.capabilities.memoryProperties, device.logicalDevice, readbackSize,
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr, device.readbackBuffer, device.readbackMemory) &&
+       (vkMapMemory(device.logicalDevice, device.readbackMemory, 0, readbackSize, 0, &device.readbackData) == VK_SUCCESS))
+    {
+      VkCommandBufferAllocateInfo allocateInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // VkStructureType          sType
+        nullptr,                                        // const void             * pNext
+        device.commandPool,                             // VkCommandPool            commandPool
+        VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // VkCommandBufferLevel     level
+        1                                               // uint32_t                 commandBufferCount
+      };
+      success = vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &device.commandBuffer) == VK_SUCCESS;
+
+      // The staging path is forced by hiding the extension from the loader
+      DeviceCapabilities stagingCapabilities = device.capabilities;
+      stagingCapabilities.externalMemoryHostSupported = false;
+
+      for(auto &variant : variants)
+      {
+        if(!success)
+          break;
+        if(variant.first.compression == AssetCompression::None)
+        {
+          success &= measure(device, stagingCapabilities, variant.second, sections, iterations, "mmap + staging");
+          if(device.capabilities.externalMemoryHostSupported)
+            success &= measure(device, device.capabilities, variant.second, sections, iterations, "host memory import");
+          else
+            std::cout << "  " << std::left << std::setw(20) << "host memory import" << std::right
+                      << "  skipped, VK_EXT_external_memory_host is not supported" << std::endl;
+        }
+        else
+        {
+          std::string name = std::string("decode ") + variant.first.name;
+          success &= measure(device, stagingCapabilities, variant.second, sections, iterations, name.c_str());
+        }
+      }
+    }
+    else
+    {
+      std::cerr << "Could not create benchmark resources." << std::endl;
+    }
+
+    vkDeviceWaitIdle(device.logicalDevice);
+    destroyBuffer(device.logicalDevice, device.readbackBuffer);
+    freeMemoryObject(device.logicalDevice, device.readbackMemory);
+    if(device.commandPool != VK_NULL_HANDLE)
+      vkDestroyCommandPool(device.logicalDevice, device.commandPool, nullptr);
+    vkDestroyDevice(device.logicalDevice, nullptr);
+    return success;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 20;
+  if(argc < 2 || iterations == 0)
+  {
+    std::cerr << "Usage: PackedAssetLoadBenchmark <input.vspk> [iterations]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string input = argv[1];
+  std::vector<SectionData> sections;
+  if(!readSections(input, sections))
+    return EXIT_FAILURE;
+
+  // Codecs that did not help a section leave it uncompressed, the variant is measured anyway
+  std::vector<std::pair<Codec, std::string>> variants;
+  bool success = true;
+  for(auto &codec : CODECS)
+  {
+    if(!isCompressionAvailable(codec.compression))
+      continue;
+    std::string filename = input + "." + codec.name + ".benchmark";
+    success &= writeVariant(sections, codec.compression, filename);
+    variants.emplace_back(codec, filename);
+  }
+
+  LIBRARY_TYPE vkLibrary = nullptr;
+  VkInstance instance = VK_NULL_HANDLE;
+  std::vector<const char*> instanceExtensions;
+  std::vector<VkPhysicalDevice> physicalDevices;
+  if(!success || !loadVkLibrary(vkLibrary) || !loadFunctionFromVulkanLibrary(vkLibrary) || !loadGlobalLevelFunctions() ||
+     !createInstance(instanceExtensions, "PackedAssetLoadBenchmark", instance) ||
+     !loadInstanceLevelFunctions(instance, instanceExtensions) ||
+     !enumerateAvailablePhysicalDevices(instance, physicalDevices))
+  {
+    if(instance != VK_NULL_HANDLE)
+      vkDestroyInstance(instance, nullptr);
+    releaseVulkanLibrary(vkLibrary);
+    for(auto &variant : variants)
+      std::remove(variant.second.c_str());
+    return EXIT_FAILURE;
+  }
+
+  // Devices are benchmarked one after another, device-level functions are reloaded for each of them
+  for(VkPhysicalDevice physicalDevice : physicalDevices)
+  {
+    PhysicalDeviceProbe probe;
+    if(!probePhysicalDevice(physicalDevice, {}, probe) || !probe.suitable)
+      continue;
+    success &= benchmarkDevice(probe, sections, variants, iterations);
+  }
+
+  vkDestroyInstance(instance, nullptr);
+  releaseVulkanLibrary(vkLibrary);
+  for(auto &variant : variants)
+    std::remove(variant.second.c_str());
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,173 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "Scene.h"
+#include "ThreadPool.h"
+
+// Builds a scene hierarchy of a million instances and times the hierarchy update and frustum
+// culling, on the calling thread and on a thread pool, with every culling kernel the compiler and
+// the CPU support. The visible list of every kernel is checked against the scalar one.
+// Usage: SceneBenchmark [instanceCount] [iterations]
+
+using namespace VulkanSample;
+
+namespace
+{
+  const uint32_t ROOT_COUNT   = 1024;       // placed on a grid, every other node hangs below them
+  const uint32_t FANOUT       = 8;
+  const float    GRID_SPACING = 40.0f;
+
+  const CullingKernel KERNELS[] = { CullingKernel::Scalar, CullingKernel::SSE, CullingKernel::AVX2, CullingKernel::NEON };
+
+  Float4x4 getLocalTransform(float x, float y, float z, float angle, float scale)
+  {
+    Float4x4 result = identityMatrix();
+    result.m[0]  = std::cos(angle) * scale;
+    result.m[2]  = -std::sin(angle) * scale;
+    result.m[5]  = scale;
+    result.m[8]  = std::sin(angle) * scale;
+    result.m[10] = std::cos(angle) * scale;
+    result.m[12] = x;
+    result.m[13] = y;
+    result.m[14] = z;
+    return result;
+  }
+
+  // Node i below the roots hangs off node (i - ROOT_COUNT) / FANOUT, which was created before it
+  void buildScene(Scene &scene, uint32_t instanceCount)
+  {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> offset(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> scale(0.6f, 0.9f);
+
+    uint32_t gridSize = static_cast<uint32_t>(std::sqrt(static_cast<double>(ROOT_COUNT)));
+    scene.reserve(instanceCount);
+    for(uint32_t node = 0; node < instanceCount; ++node)
+    {
+      uint32_t parent = INVALID_SCENE_NODE;
+      Float4x4 local;
+      if(node < ROOT_COUNT)
+      {
+        float x = (static_cast<float>(node % gridSize) - 0.5f * gridSize) * GRID_SPACING;
+        float z = -static_cast<float>(node / gridSize) * GRID_SPACING;
+        local = getLocalTransform(x, 0.0f, z, angle(random), 1.0f);
+      }
+      else
+      {
+        parent = (node - ROOT_COUNT) / FANOUT;
+        local = getLocalTransform(offset(random), offset(random) * 0.25f, offset(random), angle(random), scale(random));
+      }
+      scene.createNode(parent, local, { 0.0f, 0.0f, 0.0f, 1.0f }, node % 64, SCENE_NODE_VISIBLE_BIT);
+    }
+  }
+
+  // Camera above the front edge of the grid looking into it, 0..1 depth with y pointing up
+  Frustum getFrustum()
+  {
+    float nearPlane = 0.1f;
+    float farPlane = 600.0f;
+    float focal = 1.0f / std::tan(0.5f * 1.0471976f);
+    Float4x4 projection = {};
+    projection.m[0]  = focal * 9.0f / 16.0f;
+    projection.m[5]  = -focal;
+    projection.m[10] = farPlane / (nearPlane - farPlane);
+    projection.m[11] = -1.0f;
+    projection.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+
+    Float4x4 view = identityMatrix();
+    view.m[13] = -20.0f;
+    view.m[14] = -10.0f;
+    return extractFrustum(multiply(projection, view));
+  }
+
+  // A kernel the build or the CPU lacks falls back to a narrower one
+  bool isKernelAvailable(CullingKernel kernel)
+  {
+    CullSpheresFunction function = getCullSpheresFunction(kernel);
+    if(kernel == CullingKernel::Scalar)
+      return true;
+    if(function == cullSpheresScalar)
+      return false;
+    return kernel != CullingKernel::AVX2 || function != getCullSpheresFunction(CullingKernel::SSE);
+  }
+
+  double measure(uint32_t iterations, std::function<void()> const &run)
+  {
+    run();
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t iteration = 0; iteration < iterations; ++iteration)
+      run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+  }
+
+  void report(char const *name, bool valid, uint32_t instanceCount, double milliseconds)
+  {
+    std::cout << "  " << std::left << std::setw(28) << name << std::right << (valid ? "  ok    " : "  FAILED")
+              << std::fixed << std::setprecision(3) << std::setw(10) << milliseconds << " ms"
+              << std::setprecision(1) << std::setw(10) << instanceCount / (milliseconds * 1e3) << " Minstances/s" << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t instanceCount = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+  uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 20;
+  if(instanceCount < ROOT_COUNT || iterations == 0)
+  {
+    std::cerr << "Usage: SceneBenchmark [instanceCount >= " << ROOT_COUNT << "] [iterations]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Scene scene;
+  buildScene(scene, instanceCount);
+  ThreadPool threadPool;
+  Frustum frustum = getFrustum();
+
+  std::cout << instanceCount << " instances in " << ROOT_COUNT << " hierarchies, ";
+  scene.updateTransforms(nullptr);
+  std::cout << scene.getLevelCount() << " levels, " << threadPool.getThreadCount() << " worker threads" << std::endl;
+
+  // Levels are updated in parallel, the thread pool must produce the single threaded transforms
+  double milliseconds = measure(iterations, [&]() { scene.updateTransforms(nullptr); });
+  std::vector<Float4x4> worldTransforms = scene.getWorldTransforms();
+  report("update, single thread", true, instanceCount, milliseconds);
+  milliseconds = measure(iterations, [&]() { scene.updateTransforms(&threadPool); });
+  bool success = std::memcmp(worldTransforms.data(), scene.getWorldTransforms().data(), worldTransforms.size() * sizeof(Float4x4)) == 0;
+  report("update, thread pool", success, instanceCount, milliseconds);
+
+  VisibleList reference;
+  scene.setCullingKernel(CullingKernel::Scalar);
+  scene.cull(frustum, reference, nullptr);
+  std::cout << "  " << reference.nodes.size() << " visible instances" << std::endl;
+
+  VisibleList visible;
+  for(CullingKernel kernel : KERNELS)
+  {
+    std::string name = std::string("cull ") + getCullingKernelName(kernel);
+    if(!isKernelAvailable(kernel))
+    {
+      std::cout << "  " << std::left << std::setw(28) << name << std::right << "  skipped, not supported" << std::endl;
+      continue;
+    }
+    scene.setCullingKernel(kernel);
+
+    milliseconds = measure(iterations, [&]() { scene.cull(frustum, visible, nullptr); });
+    bool valid = visible.nodes == reference.nodes && visible.meshIds == reference.meshIds;
+    report((name + ", single thread").c_str(), valid, instanceCount, milliseconds);
+    success &= valid;
+
+    milliseconds = measure(iterations, [&]() { scene.cull(frustum, visible, &threadPool); });
+    valid = visible.nodes == reference.nodes && visible.meshIds == reference.meshIds;
+    report((name + ", thread pool").c_str(), valid, instanceCount, milliseconds);
+    success &= valid;
+  }
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,922 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "Common.h"
+#include "GeometryPool.h"
+#include "VulkanResources.h"
+
+// Draws the same scene of meshes in three vertex layouts twice: with classic vertex buffer binding
+// (a pipeline per layout, a vertex and index buffer bind per mesh and a vkCmdDrawIndexed per draw)
+// and with GeometryPool vertex pulling (one pipeline, one index buffer, one indirect draw). Both
+// images are compared, then the GPU time (timestamp queries) and the CPU recording time of both
+// paths are reported for a sweep of draw counts.
+// Usage: VertexPullingBenchmark [iterations]
+
+using namespace VulkanSample;
+
+namespace
+{
+  const VkExtent2D EXTENT          = { 1920, 1080 };
+  const VkFormat   COLOR_FORMAT    = VK_FORMAT_R8G8B8A8_UNORM;
+  const VkFormat   DEPTH_FORMAT    = VK_FORMAT_D32_SFLOAT;
+  const uint32_t   DRAW_COUNTS[]   = { 256, 1024, 4096, 16384 };
+  const uint32_t   MESH_COUNT      = 96;
+  const uint32_t   VALIDATION_DRAWS = 1024;
+  const VkDeviceSize STAGING_SIZE  = 16 * 1024 * 1024;
+
+  // Same attributes, different places: interleaved, texture coordinates first, and padded
+  const VertexLayout LAYOUTS[] = {
+    { 32,  0, 12, 24 },
+    { 32,  8, 20,  0 },
+    { 48,  0, 16, 32 }
+  };
+  const uint32_t LAYOUT_COUNT = sizeof(LAYOUTS) / sizeof(LAYOUTS[0]);
+
+  struct BenchmarkDevice
+  {
+    VkDevice           logicalDevice;
+    DeviceCapabilities capabilities;
+    QueueParameters    queue;
+    VkCommandPool      commandPool;
+    VkCommandBuffer    commandBuffer;
+    VkQueryPool        queryPool;
+    VkBuffer           stagingBuffer;
+    VkDeviceMemory     stagingMemory;
+    void              *stagingData;
+  };
+
+  struct RenderTarget
+  {
+    VkImage        colorImage;
+    VkDeviceMemory colorMemory;
+    VkImageView    colorView;
+    VkImage        depthImage;
+    VkDeviceMemory depthMemory;
+    VkImageView    depthView;
+  };
+
+  struct ClassicMesh
+  {
+    VkBuffer       vertexBuffer;
+    VkDeviceMemory vertexMemory;
+    VkBuffer       indexBuffer;
+    VkDeviceMemory indexMemory;
+    uint32_t       indexCount;
+    uint32_t       layout;
+  };
+
+  struct Draw
+  {
+    uint32_t mesh;
+    Float4x4 model;
+  };
+
+  struct Scene
+  {
+    std::vector<ClassicMesh> classicMeshes;
+    std::vector<uint32_t>    poolMeshes;
+    VkPipelineLayout         classicPipelineLayout;
+    VkPipeline               classicPipelines[LAYOUT_COUNT];
+    VkPipeline               pullPipeline;
+    std::vector<VkShaderModule> shaderModules;
+    Float4x4                 viewProjection;
+  };
+
+  struct ClassicConstants
+  {
+    Float4x4 viewProjection;
+    Float4x4 model;
+  };
+
+  bool submitAndWait(BenchmarkDevice &device, std::function<void(VkCommandBuffer)> const &record)
+  {
+    VkCommandBufferBeginInfo beginInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,   // VkStructureType                        sType
+      nullptr,                                       // const void                           * pNext
+      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,   // VkCommandBufferUsageFlags              flags
+      nullptr                                        // const VkCommandBufferInheritanceInfo * pInheritanceInfo
+    };
+
+    if((vkResetCommandPool(device.logicalDevice, device.commandPool, 0) != VK_SUCCESS) ||
+       (vkBeginCommandBuffer(device.commandBuffer, &beginInfo) != VK_SUCCESS))
+    {
+      std::cerr << "Could not begin command buffer." << std::endl;
+      return false;
+    }
+    record(device.commandBuffer);
+    if(vkEndCommandBuffer(device.commandBuffer) != VK_SUCCESS)
+    {
+      std::cerr << "Could not end command buffer." << std::endl;
+      return false;
+    }
+
+    VkCommandBufferSubmitInfo commandBufferInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,  // VkStructureType    sType
+      nullptr,                                       // const void       * pNext
+      device.commandBuffer,                          // VkCommandBuffer    commandBuffer
+      0                                              // uint32_t           deviceMask
+    };
+
+    VkSubmitInfo2 submitInfo = {
+      VK_STRUCTURE_TYPE_SUBMIT_INFO_2,               // VkStructureType                    sType
+      nullptr,                                       // const void                       * pNext
+      0,                                             // VkSubmitFlags                      flags
+      0,                                             // uint32_t                           waitSemaphoreInfoCount
+      nullptr,                                       // const VkSemaphoreSubmitInfo      * pWaitSemaphoreInfos
+      1,                                             // uint32_t                           commandBufferInfoCount
+      &commandBufferInfo,                            // const VkCommandBufferSubmitInfo  * pCommandBufferInfos
+      0,                                             // uint32_t                           signalSemaphoreInfoCount
+      nullptr                                        // const VkSemaphoreSubmitInfo      * pSignalSemaphoreInfos
+    };
+
+    if((vkQueueSubmit2(device.queue.handle, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) ||
+       (vkQueueWaitIdle(device.queue.handle) != VK_SUCCESS))
+    {
+      std::cerr << "Could not execute command buffer." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  void recordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+                          VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkImageLayout oldLayout,
+                          VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask, VkImageLayout newLayout)
+  {
+    VkImageMemoryBarrier2 imageBarrier = {
+      VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,   // VkStructureType            sType
+      nullptr,                                    // const void               * pNext
+      srcStageMask,                               // VkPipelineStageFlags2      srcStageMask
+      srcAccessMask,                              // VkAccessFlags2             srcAccessMask
+      dstStageMask,                               // VkPipelineStageFlags2      dstStageMask
+      dstAccessMask,                              // VkAccessFlags2             dstAccessMask
+      oldLayout,                                  // VkImageLayout              oldLayout
+      newLayout,                                  // VkImageLayout              newLayout
+      VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   srcQueueFamilyIndex
+      VK_QUEUE_FAMILY_IGNORED,                    // uint32_t                   dstQueueFamilyIndex
+      image,                                      // VkImage                    image
+      { aspect, 0, 1, 0, 1 }                      // VkImageSubresourceRange    subresourceRange
+    };
+
+    VkDependencyInfo dependencyInfo = {
+      VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+      nullptr,                                // const void                     * pNext
+      0,                                      // VkDependencyFlags                dependencyFlags
+      0,                                      // uint32_t                         memoryBarrierCount
+      nullptr,                                // const VkMemoryBarrier2         * pMemoryBarriers
+      0,                                      // uint32_t                         bufferMemoryBarrierCount
+      nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+      1,                                      // uint32_t                         imageMemoryBarrierCount
+      &imageBarrier                           // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+  }
+
+  // Orders the attachment writes of consecutive iterations
+  void recordAttachmentBarrier(VkCommandBuffer commandBuffer)
+  {
+    VkPipelineStageFlags2 attachmentStages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                             VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                             VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    VkAccessFlags2 attachmentWrites = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    VkMemoryBarrier2 memoryBarrier = {
+      VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,     // VkStructureType          sType
+      nullptr,                                // const void             * pNext
+      attachmentStages,                       // VkPipelineStageFlags2    srcStageMask
+      attachmentWrites,                       // VkAccessFlags2           srcAccessMask
+      attachmentStages,                       // VkPipelineStageFlags2    dstStageMask
+      attachmentWrites                        // VkAccessFlags2           dstAccessMask
+    };
+
+    VkDependencyInfo dependencyInfo = {
+      VK_STRUCTURE_TYPE_DEPENDENCY_INFO,      // VkStructureType                  sType
+      nullptr,                                // const void                     * pNext
+      0,                                      // VkDependencyFlags                dependencyFlags
+      1,                                      // uint32_t                         memoryBarrierCount
+      &memoryBarrier,                         // const VkMemoryBarrier2         * pMemoryBarriers
+      0,                                      // uint32_t                         bufferMemoryBarrierCount
+      nullptr,                                // const VkBufferMemoryBarrier2   * pBufferMemoryBarriers
+      0,                                      // uint32_t                         imageMemoryBarrierCount
+      nullptr                                 // const VkImageMemoryBarrier2    * pImageMemoryBarriers
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+  }
+
+  // Records the scene iterations times between two timestamps. Returns the GPU time and the CPU
+  // time spent recording, both in seconds per iteration.
+  bool measure(BenchmarkDevice &device, uint32_t iterations, std::function<void(VkCommandBuffer)> const &record,
+               double &gpuSeconds, double &cpuSeconds)
+  {
+    std::chrono::steady_clock::duration recording = {};
+    bool result = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      vkCmdResetQueryPool(commandBuffer, device.queryPool, 0, 2);
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, device.queryPool, 0);
+      auto start = std::chrono::steady_clock::now();
+      for(uint32_t iteration = 0; iteration < iterations; ++iteration)
+      {
+        if(iteration > 0)
+          recordAttachmentBarrier(commandBuffer);
+        record(commandBuffer);
+      }
+      recording = std::chrono::steady_clock::now() - start;
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, device.queryPool, 1);
+    });
+    if(!result)
+      return false;
+
+    uint64_t timestamps[2];
+    if(vkGetQueryPoolResults(device.logicalDevice, device.queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                             VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+    {
+      std::cerr << "Could not read timestamp queries." << std::endl;
+      return false;
+    }
+    gpuSeconds = (timestamps[1] - timestamps[0]) * static_cast<double>(device.capabilities.properties.limits.timestampPeriod) *
+                 1e-9 / iterations;
+    cpuSeconds = std::chrono::duration<double>(recording).count() / iterations;
+    return true;
+  }
+
+  bool uploadBuffer(BenchmarkDevice &device, void const *data, VkDeviceSize size, VkBufferUsageFlags usage,
+                    VkBuffer &buffer, VkDeviceMemory &memory)
+  {
+    if(size > STAGING_SIZE)
+    {
+      std::cerr << "Mesh exceeds the staging buffer." << std::endl;
+      return false;
+    }
+    if(!createBuffer(device.logicalDevice, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer) ||
+       !allocateAndBindMemoryObjectToBuffer(device.capabilities.memoryProperties, device.logicalDevice, buffer,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory))
+      return false;
+
+    std::memcpy(device.stagingData, data, static_cast<size_t>(size));
+    return submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      VkBufferCopy region = { 0, 0, size };
+      vkCmdCopyBuffer(commandBuffer, device.stagingBuffer, buffer, 1, &region);
+    });
+  }
+
+  bool createAttachment(BenchmarkDevice &device, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                        VkImage &image, VkDeviceMemory &memory, VkImageView &view)
+  {
+    VkImageCreateInfo imageCreateInfo = {
+      VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,  // VkStructureType          sType
+      nullptr,                              // const void             * pNext
+      0,                                    // VkImageCreateFlags       flags
+      VK_IMAGE_TYPE_2D,                     // VkImageType              imageType
+      format,                               // VkFormat                 format
+      { EXTENT.width, EXTENT.height, 1 },   // VkExtent3D               extent
+      1,                                    // uint32_t                 mipLevels
+      1,                                    // uint32_t                 arrayLayers
+      VK_SAMPLE_COUNT_1_BIT,                // VkSampleCountFlagBits    samples
+      VK_IMAGE_TILING_OPTIMAL,              // VkImageTiling            tiling
+      usage,                                // VkImageUsageFlags        usage
+      VK_SHARING_MODE_EXCLUSIVE,            // VkSharingMode            sharingMode
+      0,                                    // uint32_t                 queueFamilyIndexCount
+      nullptr,                              // const uint32_t         * pQueueFamilyIndices
+      VK_IMAGE_LAYOUT_UNDEFINED             // VkImageLayout            initialLayout
+    };
+
+    if((vkCreateImage(device.logicalDevice, &imageCreateInfo, nullptr, &image) != VK_SUCCESS) ||
+       !allocateAndBindMemoryObjectToImage(device.capabilities.memoryProperties, device.logicalDevice, image,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory))
+    {
+      std::cerr << "Could not create render target image." << std::endl;
+      return false;
+    }
+
+    VkImageViewCreateInfo imageViewCreateInfo = {
+      VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,   // VkStructureType            sType
+      nullptr,                                    // const void               * pNext
+      0,                                          // VkImageViewCreateFlags     flags
+      image,                                      // VkImage                    image
+      VK_IMAGE_VIEW_TYPE_2D,                      // VkImageViewType            viewType
+      format,                                     // VkFormat                   format
+      {},                                         // VkComponentMapping         components
+      { aspect, 0, 1, 0, 1 }                      // VkImageSubresourceRange    subresourceRange
+    };
+
+    if(vkCreateImageView(device.logicalDevice, &imageViewCreateInfo, nullptr, &view) != VK_SUCCESS)
+    {
+      std::cerr << "Could not create render target view." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool createRenderTarget(BenchmarkDevice &device, RenderTarget &target)
+  {
+    if(!createAttachment(device, COLOR_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                         VK_IMAGE_ASPECT_COLOR_BIT, target.colorImage, target.colorMemory, target.colorView) ||
+       !createAttachment(device, DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                         target.depthImage, target.depthMemory, target.depthView))
+      return false;
+
+    // Both attachments stay in their attachment layout, readback transitions the color image back
+    return submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      recordImageBarrier(commandBuffer, target.colorImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+      recordImageBarrier(commandBuffer, target.depthImage, VK_IMAGE_ASPECT_DEPTH_BIT,
+                         VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                         VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    });
+  }
+
+  void destroyRenderTarget(VkDevice logicalDevice, RenderTarget &target)
+  {
+    destroyImageView(logicalDevice, target.colorView);
+    destroyImage(logicalDevice, target.colorImage);
+    freeMemoryObject(logicalDevice, target.colorMemory);
+    destroyImageView(logicalDevice, target.depthView);
+    destroyImage(logicalDevice, target.depthImage);
+    freeMemoryObject(logicalDevice, target.depthMemory);
+  }
+
+  bool createPipeline(VkDevice logicalDevice, VkPipelineLayout pipelineLayout,
+                      std::vector<VkPipelineShaderStageCreateInfo> const &stages,
+                      std::vector<VkVertexInputBindingDescription> const &bindings,
+                      std::vector<VkVertexInputAttributeDescription> const &attributes, VkPipeline &pipeline)
+  {
+    VkPipelineVertexInputStateCreateInfo vertexInputState = {
+      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,  // VkStructureType                            sType
+      nullptr,                                                    // const void                               * pNext
+      0,                                                          // VkPipelineVertexInputStateCreateFlags      flags
+      static_cast<uint32_t>(bindings.size()),                     // uint32_t                                   vertexBindingDescriptionCount
+      bindings.data(),                                            // const VkVertexInputBindingDescription    * pVertexBindingDescriptions
+      static_cast<uint32_t>(attributes.size()),                   // uint32_t                                   vertexAttributeDescriptionCount
+      attributes.data()                                           // const VkVertexInputAttributeDescription  * pVertexAttributeDescriptions
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {
+      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,  // VkStructureType                          sType
+      nullptr,                                                      // const void                             * pNext
+      0,                                                            // VkPipelineInputAssemblyStateCreateFlags  flags
+      VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,                          // VkPrimitiveTopology                      topology
+      VK_FALSE                                                      // VkBool32                                 primitiveRestartEnable
+    };
+
+    VkViewport viewport = { 0.0f, 0.0f, float(EXTENT.width), float(EXTENT.height), 0.0f, 1.0f };
+    VkRect2D scissor = { { 0, 0 }, EXTENT };
+    VkPipelineViewportStateCreateInfo viewportState = {
+      VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,  // VkStructureType                      sType
+      nullptr,                                                // const void                         * pNext
+      0,                                                      // VkPipelineViewportStateCreateFlags   flags
+      1,                                                      // uint32_t                             viewportCount
+      &viewport,                                              // const VkViewport                   * pViewports
+      1,                                                      // uint32_t                             scissorCount
+      &scissor                                                // const VkRect2D                     * pScissors
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizationState = {};
+    rasterizationState.sType     = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationState.cullMode  = VK_CULL_MODE_BACK_BIT;
+    rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizationState.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampleState = {};
+    multisampleState.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Reversed Z
+    VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
+    depthStencilState.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilState.depthTestEnable  = VK_TRUE;
+    depthStencilState.depthWriteEnable = VK_TRUE;
+    depthStencilState.depthCompareOp   = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                                     VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colorBlendState = {};
+    colorBlendState.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendState.attachmentCount = 1;
+    colorBlendState.pAttachments    = &blendAttachment;
+
+    VkPipelineRenderingCreateInfo renderingCreateInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,   // VkStructureType    sType
+      nullptr,                                            // const void       * pNext
+      0,                                                  // uint32_t           viewMask
+      1,                                                  // uint32_t           colorAttachmentCount
+      &COLOR_FORMAT,                                      // const VkFormat   * pColorAttachmentFormats
+      DEPTH_FORMAT,                                       // VkFormat           depthAttachmentFormat
+      VK_FORMAT_UNDEFINED                                 // VkFormat           stencilAttachmentFormat
+    };
+
+    VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+    graphicsPipelineCreateInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    graphicsPipelineCreateInfo.pNext               = &renderingCreateInfo;
+    graphicsPipelineCreateInfo.stageCount          = static_cast<uint32_t>(stages.size());
+    graphicsPipelineCreateInfo.pStages             = stages.data();
+    graphicsPipelineCreateInfo.pVertexInputState   = &vertexInputState;
+    graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+    graphicsPipelineCreateInfo.pViewportState      = &viewportState;
+    graphicsPipelineCreateInfo.pRasterizationState = &rasterizationState;
+    graphicsPipelineCreateInfo.pMultisampleState   = &multisampleState;
+    graphicsPipelineCreateInfo.pDepthStencilState  = &depthStencilState;
+    graphicsPipelineCreateInfo.pColorBlendState    = &colorBlendState;
+    graphicsPipelineCreateInfo.layout              = pipelineLayout;
+    graphicsPipelineCreateInfo.basePipelineIndex   = -1;
+
+    if(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+      std::cerr << "Could not create benchmark graphics pipeline." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool createShaderStage(VkDevice logicalDevice, Scene &scene, VkShaderStageFlagBits stage, char const *name,
+                         std::vector<VkPipelineShaderStageCreateInfo> &stages)
+  {
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if(!createShaderModuleFromFile(logicalDevice, name, shaderModule))
+      return false;
+    scene.shaderModules.push_back(shaderModule);
+
+    stages.push_back({
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,  // VkStructureType                    sType
+      nullptr,                                              // const void                       * pNext
+      0,                                                    // VkPipelineShaderStageCreateFlags   flags
+      stage,                                                // VkShaderStageFlagBits              stage
+      shaderModule,                                         // VkShaderModule                     module
+      "main",                                               // const char                       * pName
+      nullptr                                               // const VkSpecializationInfo       * pSpecializationInfo
+    });
+    return true;
+  }
+
+  bool createPipelines(BenchmarkDevice &device, GeometryPool &pool, Scene &scene)
+  {
+    VkPushConstantRange pushConstantRange = {
+      VK_SHADER_STAGE_VERTEX_BIT,             // VkShaderStageFlags     stageFlags
+      0,                                      // uint32_t               offset
+      sizeof(ClassicConstants)                // uint32_t               size
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // VkStructureType                  sType
+      nullptr,                                        // const void                     * pNext
+      0,                                              // VkPipelineLayoutCreateFlags      flags
+      0,                                              // uint32_t                         setLayoutCount
+      nullptr,                                        // const VkDescriptorSetLayout    * pSetLayouts
+      1,                                              // uint32_t                         pushConstantRangeCount
+      &pushConstantRange                              // const VkPushConstantRange      * pPushConstantRanges
+    };
+
+    if(vkCreatePipelineLayout(device.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &scene.classicPipelineLayout) != VK_SUCCESS)
+    {
+      std::cerr << "Could not create benchmark pipeline layout." << std::endl;
+      return false;
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> classicStages;
+    if(!createShaderStage(device.logicalDevice, scene, VK_SHADER_STAGE_VERTEX_BIT, "geometry_classic.vert", classicStages) ||
+       !createShaderStage(device.logicalDevice, scene, VK_SHADER_STAGE_FRAGMENT_BIT, "meshlet.frag", classicStages))
+      return false;
+
+    for(uint32_t layout = 0; layout < LAYOUT_COUNT; ++layout)
+    {
+      VertexLayout const &vertexLayout = LAYOUTS[layout];
+      std::vector<VkVertexInputBindingDescription> bindings = { { 0, vertexLayout.stride, VK_VERTEX_INPUT_RATE_VERTEX } };
+      std::vector<VkVertexInputAttributeDescription> attributes = {
+        { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, vertexLayout.positionOffset },
+        { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, vertexLayout.normalOffset },
+        { 2, 0, VK_FORMAT_R32G32_SFLOAT,    vertexLayout.texCoordOffset }
+      };
+      if(!createPipeline(device.logicalDevice, scene.classicPipelineLayout, classicStages, bindings, attributes,
+                         scene.classicPipelines[layout]))
+        return false;
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> pullStages;
+    return pool.createShaderStages(pullStages) &&
+           createPipeline(device.logicalDevice, pool.getPipelineLayout(), pullStages, {}, {}, scene.pullPipeline);
+  }
+
+  void writeVertex(VertexLayout const &layout, unsigned char *vertex, float const (&position)[3], float const (&normal)[3],
+                   float const (&texCoord)[2])
+  {
+    std::memset(vertex, 0, layout.stride);
+    std::memcpy(vertex + layout.positionOffset, position, sizeof(position));
+    std::memcpy(vertex + layout.normalOffset, normal, sizeof(normal));
+    std::memcpy(vertex + layout.texCoordOffset, texCoord, sizeof(texCoord));
+  }
+
+  // UV sphere of radius 1, counter-clockwise seen from outside
+  void generateSphere(VertexLayout const &layout, uint32_t segments, std::vector<unsigned char> &vertices,
+                      std::vector<uint32_t> &indices)
+  {
+    uint32_t rings = segments / 2;
+    uint32_t columns = segments + 1;
+    vertices.resize(size_t(rings + 1) * columns * layout.stride);
+    for(uint32_t ring = 0; ring <= rings; ++ring)
+    {
+      float v = float(ring) / rings;
+      float theta = v * 3.14159265f;
+      for(uint32_t segment = 0; segment <= segments; ++segment)
+      {
+        float u = float(segment) / segments;
+        float phi = u * 6.28318531f;
+        float normal[3] = { std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi) };
+        float texCoord[2] = { u, v };
+        writeVertex(layout, &vertices[(size_t(ring) * columns + segment) * layout.stride], normal, normal, texCoord);
+      }
+    }
+
+    indices.clear();
+    for(uint32_t ring = 0; ring < rings; ++ring)
+    {
+      for(uint32_t segment = 0; segment < segments; ++segment)
+      {
+        uint32_t first = ring * columns + segment;
+        uint32_t second = first + columns;
+        indices.insert(indices.end(), { first, second, first + 1, first + 1, second, second + 1 });
+      }
+    }
+  }
+
+  bool createMeshes(BenchmarkDevice &device, GeometryPool &pool, Scene &scene)
+  {
+    std::vector<unsigned char> vertices;
+    std::vector<uint32_t> indices;
+    for(uint32_t mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+      uint32_t layout = mesh % LAYOUT_COUNT;
+      VertexLayout const &vertexLayout = LAYOUTS[layout];
+      uint32_t segments = 16 + 2 * (mesh % 13);
+      generateSphere(vertexLayout, segments, vertices, indices);
+      uint32_t vertexCount = static_cast<uint32_t>(vertices.size() / vertexLayout.stride);
+
+      ClassicMesh classicMesh = {};
+      classicMesh.indexCount = static_cast<uint32_t>(indices.size());
+      classicMesh.layout = layout;
+      uint32_t poolMesh = 0;
+      bool created = uploadBuffer(device, vertices.data(), vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                  classicMesh.vertexBuffer, classicMesh.vertexMemory) &&
+                     uploadBuffer(device, indices.data(), indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                  classicMesh.indexBuffer, classicMesh.indexMemory) &&
+                     pool.addMesh(vertexLayout, vertices.data(), vertexCount, indices, poolMesh);
+      scene.classicMeshes.push_back(classicMesh);
+      scene.poolMeshes.push_back(poolMesh);
+      if(!created)
+        return false;
+    }
+
+    bool uploaded = true;
+    if(!submitAndWait(device, [&](VkCommandBuffer commandBuffer) { uploaded = pool.recordUpload(commandBuffer); }))
+      uploaded = false;
+    pool.releaseTransferResources();
+    return uploaded;
+  }
+
+  // Spheres spread through the view frustum, sorted by layout and mesh as a classic renderer
+  // would sort them to save state changes
+  void generateDraws(uint32_t count, std::vector<Draw> &draws)
+  {
+    draws.resize(count);
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(float(count))));
+    for(uint32_t index = 0; index < count; ++index)
+    {
+      Draw &draw = draws[index];
+      draw.mesh = (index * 7) % MESH_COUNT;
+      float depth = 8.0f + 40.0f * float(index % 17) / 16.0f;
+      float x = (float(index % side) + 0.5f) / side * 2.0f - 1.0f;
+      float y = (float(index / side) + 0.5f) / side * 2.0f - 1.0f;
+      draw.model = identityMatrix();
+      draw.model.m[0] = draw.model.m[5] = draw.model.m[10] = 0.02f * depth;
+      draw.model.m[12] = x * 0.9f * depth;
+      draw.model.m[13] = y * 0.5f * depth;
+      draw.model.m[14] = -depth;
+    }
+    std::stable_sort(draws.begin(), draws.end(), [](Draw const &lhs, Draw const &rhs)
+    {
+      uint32_t lhsLayout = lhs.mesh % LAYOUT_COUNT;
+      uint32_t rhsLayout = rhs.mesh % LAYOUT_COUNT;
+      return lhsLayout != rhsLayout ? lhsLayout < rhsLayout : lhs.mesh < rhs.mesh;
+    });
+  }
+
+  // Reversed Z perspective with an infinite far plane and y pointing up, camera at the origin
+  Float4x4 getViewProjection()
+  {
+    float nearPlane = 0.1f;
+    float focal = 1.0f / std::tan(0.5f * 1.0471976f);
+    Float4x4 result = {};
+    result.m[0]  = focal * EXTENT.height / EXTENT.width;
+    result.m[5]  = -focal;
+    result.m[11] = -1.0f;
+    result.m[14] = nearPlane;
+    return result;
+  }
+
+  void beginRendering(VkCommandBuffer commandBuffer, RenderTarget const &target)
+  {
+    VkRenderingAttachmentInfo colorAttachment = {};
+    colorAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView   = target.colorView;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+
+    VkRenderingAttachmentInfo depthAttachment = {};
+    depthAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView   = target.depthView;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+    VkRenderingInfo renderingInfo = {};
+    renderingInfo.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea           = { { 0, 0 }, EXTENT };
+    renderingInfo.layerCount           = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments    = &colorAttachment;
+    renderingInfo.pDepthAttachment     = &depthAttachment;
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+  }
+
+  // Returns the number of vertex buffer binds
+  uint32_t recordClassic(VkCommandBuffer commandBuffer, Scene const &scene, RenderTarget const &target, std::vector<Draw> const &draws)
+  {
+    beginRendering(commandBuffer, target);
+    uint32_t binds = 0;
+    uint32_t boundLayout = LAYOUT_COUNT;
+    uint32_t boundMesh = MESH_COUNT;
+    ClassicConstants constants;
+    constants.viewProjection = scene.viewProjection;
+    for(auto const &draw : draws)
+    {
+      ClassicMesh const &mesh = scene.classicMeshes[draw.mesh];
+      if(mesh.layout != boundLayout)
+      {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.classicPipelines[mesh.layout]);
+        boundLayout = mesh.layout;
+      }
+      if(draw.mesh != boundMesh)
+      {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, &offset);
+        vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        boundMesh = draw.mesh;
+        ++binds;
+      }
+      constants.model = draw.model;
+      vkCmdPushConstants(commandBuffer, scene.classicPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+      vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, 0);
+    }
+    vkCmdEndRendering(commandBuffer);
+    return binds;
+  }
+
+  void recordPulled(VkCommandBuffer commandBuffer, GeometryPool &pool, Scene const &scene, RenderTarget const &target,
+                    std::vector<Draw> const &draws)
+  {
+    pool.beginFrame(0);
+    for(auto const &draw : draws)
+      pool.addDraw(scene.poolMeshes[draw.mesh], draw.model);
+
+    beginRendering(commandBuffer, target);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pullPipeline);
+    pool.recordDraws(commandBuffer, scene.viewProjection);
+    vkCmdEndRendering(commandBuffer);
+  }
+
+  bool readColor(BenchmarkDevice &device, RenderTarget const &target, std::function<void(VkCommandBuffer)> const &record,
+                 std::vector<unsigned char> &pixels)
+  {
+    bool result = submitAndWait(device, [&](VkCommandBuffer commandBuffer)
+    {
+      record(commandBuffer);
+      recordImageBarrier(commandBuffer, target.colorImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                         VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+      VkBufferImageCopy region = {
+        0,                                          // VkDeviceSize                bufferOffset
+        0,                                          // uint32_t                    bufferRowLength
+        0,                                          // uint32_t                    bufferImageHeight
+        { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },     // VkImageSubresourceLayers    imageSubresource
+        { 0, 0, 0 },                                // VkOffset3D                  imageOffset
+        { EXTENT.width, EXTENT.height, 1 }          // VkExtent3D                  imageExtent
+      };
+      vkCmdCopyImageToBuffer(commandBuffer, target.colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, device.stagingBuffer, 1, &region);
+      recordImageBarrier(commandBuffer, target.colorImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                         VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    });
+    auto data = static_cast<unsigned char*>(device.stagingData);
+    pixels.assign(data, data + size_t(EXTENT.width) * EXTENT.height * 4);
+    return result;
+  }
+
+  // Both paths run the same transforms, only rounding in differently ordered math may differ
+  bool validate(BenchmarkDevice &device, GeometryPool &pool, Scene const &scene, RenderTarget const &target)
+  {
+    std::vector<Draw> draws;
+    generateDraws(VALIDATION_DRAWS, draws);
+    std::vector<unsigned char> classic, pulled;
+    if(!readColor(device, target, [&](VkCommandBuffer commandBuffer) { recordClassic(commandBuffer, scene, target, draws); }, classic) ||
+       !readColor(device, target, [&](VkCommandBuffer commandBuffer) { recordPulled(commandBuffer, pool, scene, target, draws); }, pulled))
+      return false;
+
+    size_t mismatches = 0;
+    size_t covered = 0;
+    for(size_t pixel = 0; pixel < classic.size(); pixel += 4)
+    {
+      covered += classic[pixel + 3] != 0;
+      for(size_t channel = 0; channel < 3; ++channel)
+      {
+        if(std::abs(int(classic[pixel + channel]) - int(pulled[pixel + channel])) > 2)
+        {
+          ++mismatches;
+          break;
+        }
+      }
+    }
+    size_t pixels = classic.size() / 4;
+    bool valid = (covered > 0) && (mismatches * 1000 <= pixels);
+    std::cout << "  validation: " << (valid ? "ok" : "FAILED") << ", " << mismatches << " of " << pixels
+              << " pixels differ, " << covered << " covered" << std::endl;
+    return valid;
+  }
+
+  bool runBenchmarks(BenchmarkDevice &device, GeometryPool &pool, Scene const &scene, RenderTarget const &target,
+                     uint32_t iterations)
+  {
+    std::cout << "   draws   classic GPU ms  CPU ms   binds   pulled GPU ms  CPU ms   indirect calls" << std::endl;
+    for(uint32_t drawCount : DRAW_COUNTS)
+    {
+      std::vector<Draw> draws;
+      generateDraws(drawCount, draws);
+
+      uint32_t binds = 0;
+      double classicGpu = 0.0, classicCpu = 0.0, pulledGpu = 0.0, pulledCpu = 0.0;
+      bool measured =
+        measure(device, iterations, [&](VkCommandBuffer commandBuffer) { binds = recordClassic(commandBuffer, scene, target, draws); },
+                classicGpu, classicCpu) &&
+        measure(device, iterations, [&](VkCommandBuffer commandBuffer) { recordPulled(commandBuffer, pool, scene, target, draws); },
+                pulledGpu, pulledCpu);
+      if(!measured)
+        return false;
+
+      std::cout << std::setw(8) << drawCount << std::fixed << std::setprecision(3)
+                << std::setw(17) << classicGpu * 1e3 << std::setw(8) << classicCpu * 1e3 << std::setw(8) << binds
+                << std::setw(16) << pulledGpu * 1e3 << std::setw(8) << pulledCpu * 1e3
+                << std::setw(11) << pool.getStats().indirectCalls << std::endl;
+    }
+    return true;
+  }
+
+  bool benchmarkDevice(PhysicalDeviceProbe const &probe, uint32_t iterations)
+  {
+    std::cout << probe.properties.deviceName << std::endl;
+
+    BenchmarkDevice device = {};
+    QueueParameters graphicsQueue, computeQueue, presentQueue;
+    if(!createLogicalDevice({ probe }, device.logicalDevice, {}, VK_NULL_HANDLE, graphicsQueue, computeQueue, presentQueue,
+                            device.capabilities))
+      return false;
+    device.queue = graphicsQueue;
+
+    bool success = false;
+    GeometryPool pool;
+    Scene scene = {};
+    RenderTarget target = {};
+    if(!GeometryPool::isSupported(device.capabilities) || !device.capabilities.dynamicRenderingSupported)
+    {
+      std::cout << "  skipped, vertex pulling or dynamic rendering is not supported" << std::endl;
+      success = true;
+    }
+    else
+    {
+      VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,   // VkStructureType              sType
+        nullptr,                                      // const void                 * pNext
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,         // VkCommandPoolCreateFlags     flags
+        device.queue.familyIndex                      // uint32_t                     queueFamilyIndex
+      };
+
+      VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,     // VkStructureType                  sType
+        nullptr,                                      // const void                     * pNext
+        0,                                            // VkQueryPoolCreateFlags           flags
+        VK_QUERY_TYPE_TIMESTAMP,                      // VkQueryType                      queryType
+        2,                                            // uint32_t                         queryCount
+        0                                             // VkQueryPipelineStatisticFlags    pipelineStatistics
+      };
+
+      GeometryPoolParameters parameters = {
+        32 * 1024 * 1024,                             // VkDeviceSize    vertexBytes
+        4 * 1024 * 1024,                              // uint32_t        maxIndices
+        MESH_COUNT,                                   // uint32_t        maxMeshes
+        DRAW_COUNTS[sizeof(DRAW_COUNTS) / sizeof(DRAW_COUNTS[0]) - 1]   // uint32_t maxDrawsPerFrame
+      };
+
+      if((vkCreateCommandPool(device.logicalDevice, &commandPoolCreateInfo, nullptr, &device.commandPool) == VK_SUCCESS) &&
+         (vkCreateQueryPool(device.logicalDevice, &queryPoolCreateInfo, nullptr, &device.queryPool) == VK_SUCCESS) &&
+         createHostVisibleBuffer(device.capabilities.memoryProperties, device.logicalDevice, STAGING_SIZE,
+                                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr,
+                                 device.stagingBuffer, device.stagingMemory) &&
+         (vkMapMemory(device.logicalDevice, device.stagingMemory, 0, STAGING_SIZE, 0, &device.stagingData) == VK_SUCCESS))
+      {
+        VkCommandBufferAllocateInfo allocateInfo = {
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, // VkStructureType          sType
+          nullptr,                                        // const void             * pNext
+          device.commandPool,                             // VkCommandPool            commandPool
+          VK_COMMAND_BUFFER_LEVEL_PRIMARY,                // VkCommandBufferLevel     level
+          1                                               // uint32_t                 commandBufferCount
+        };
+
+        scene.viewProjection = getViewProjection();
+        success = (vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &device.commandBuffer) == VK_SUCCESS) &&
+                  pool.create(device.logicalDevice, device.capabilities, 1, parameters) &&
+                  createRenderTarget(device, target) &&
+                  createPipelines(device, pool, scene) &&
+                  createMeshes(device, pool, scene);
+        success = success && validate(device, pool, scene, target);
+        success = success && runBenchmarks(device, pool, scene, target, iterations);
+      }
+      else
+      {
+        std::cerr << "Could not create benchmark resources." << std::endl;
+      }
+    }
+
+    vkDeviceWaitIdle(device.logicalDevice);
+    for(auto &mesh : scene.classicMeshes)
+    {
+      destroyBuffer(device.logicalDevice, mesh.vertexBuffer);
+      freeMemoryObject(device.logicalDevice, mesh.vertexMemory);
+      destroyBuffer(device.logicalDevice, mesh.indexBuffer);
+      freeMemoryObject(device.logicalDevice, mesh.indexMemory);
+    }
+    for(auto &pipeline : scene.classicPipelines)
+      destroyPipeline(device.logicalDevice, pipeline);
+    destroyPipeline(device.logicalDevice, scene.pullPipeline);
+    destroyPipelineLayout(device.logicalDevice, scene.classicPipelineLayout);
+    for(auto &shaderModule : scene.shaderModules)
+      destroyShaderModule(device.logicalDevice, shaderModule);
+    destroyRenderTarget(device.logicalDevice, target);
+    pool.destroy();
+    destroyBuffer(device.logicalDevice, device.stagingBuffer);
+    freeMemoryObject(device.logicalDevice, device.stagingMemory);
+    if(device.queryPool != VK_NULL_HANDLE)
+      vkDestroyQueryPool(device.logicalDevice, device.queryPool, nullptr);
+    if(device.commandPool != VK_NULL_HANDLE)
+      vkDestroyCommandPool(device.logicalDevice, device.commandPool, nullptr);
+    vkDestroyDevice(device.logicalDevice, nullptr);
+    return success;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 20;
+  if(iterations == 0)
+  {
+    std::cerr << "Usage: VertexPullingBenchmark [iterations]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  LIBRARY_TYPE vkLibrary = nullptr;
+  VkInstance instance = VK_NULL_HANDLE;
+  std::vector<const char*> instanceExtensions;
+  std::vector<VkPhysicalDevice> physicalDevices;
+  if(!loadVkLibrary(vkLibrary) || !loadFunctionFromVulkanLibrary(vkLibrary) || !loadGlobalLevelFunctions() ||
+     !createInstance(instanceExtensions, "VertexPullingBenchmark", instance) ||
+     !loadInstanceLevelFunctions(instance, instanceExtensions) ||
+     !enumerateAvailablePhysicalDevices(instance, physicalDevices))
+  {
+    if(instance != VK_NULL_HANDLE)
+      vkDestroyInstance(instance, nullptr);
+    releaseVulkanLibrary(vkLibrary);
+    return EXIT_FAILURE;
+  }
+
+  // Devices are benchmarked one after another, device-level functions are reloaded for each of them
+  bool success = true;
+  for(VkPhysicalDevice physicalDevice : physicalDevices)
+  {
+    PhysicalDeviceProbe probe;
+    if(!probePhysicalDevice(physicalDevice, {}, probe) || !probe.suitable)
+      continue;
+    success &= benchmarkDevice(probe, iterations);
+  }
+
+  vkDestroyInstance(instance, nullptr);
+  releaseVulkanLibrary(vkLibrary);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}